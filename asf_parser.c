@@ -1,4 +1,6 @@
 #include "asf_parser.h"
+#include "container.h"
+#include "file_io.h"
 
 #include <stdarg.h>
 
@@ -874,25 +876,32 @@ DataNode* asf_parse_string(const char* text) {
 DataNode* asf_parse_file(const char* filename) {
     if (!filename) return NULL;
 
+    // Сжатый контейнер распознаем по магическому числу
+    if (container_is_file(filename)) {
+        unsigned int payload = 0;
+        char* text = (char*)container_read_file(filename, NULL, &payload);
+        if (!text || payload != CONTAINER_PAYLOAD_ASF) {
+            free(text);
+            fprintf(stderr, "Ошибка чтения сжатого файла %s\n", filename);
+            return NULL;
+        }
+        DataNode* root = asf_parse_string(text);
+        free(text);
+        return root;
+    }
+
     FILE* f = fopen(filename, "rb");
     if (!f) {
         fprintf(stderr, "Ошибка открытия файла %s: %s\n", filename, strerror(errno));
         return NULL;
     }
 
-    if (fseek(f, 0, SEEK_END) != 0) {
-        fclose(f);
-        fprintf(stderr, "Ошибка позиционирования в файле %s\n", filename);
-        return NULL;
-    }
-
-    long sz = ftell(f);
-    if (sz < 0) {
+    uint64_t sz = 0;
+    if (!file_size(f, &sz) || sz >= SIZE_MAX) {
         fclose(f);
         fprintf(stderr, "Ошибка определения размера файла %s\n", filename);
         return NULL;
     }
-    rewind(f);
 
     char* buf = (char*)malloc((size_t)sz + 1);
     if (!buf) {
@@ -97,6 +97,8 @@ DataNode* asf_parse_string(const char* text);
 // Сериализация
 char* asf_serialize_node(const DataNode* node, int pretty);
 int asf_save_file(const char* filename, const DataNode* node, int pretty);
+// Сохранение в сжатом блочном контейнере (container.h); asf_parse_file читает оба варианта
+int asf_save_file_compressed(const char* filename, const DataNode* node, int pretty);
 
 // Память / отладка
 void asf_free_node(DataNode* node);
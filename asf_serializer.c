@@ -1,4 +1,6 @@
 #include "asf_parser.h"
+#include "container.h"
+#include "file_io.h"
 
 #include <stdarg.h>
 
@@ -314,24 +316,54 @@ char* asf_serialize_node(const DataNode* node, int pretty) {
     return sb.buf;
 }
 
+// Заголовок (комментарий допустим по ТЗ) + сериализованный текст
+static char* asf_build_file_text(const DataNode* node, int pretty) {
+    char* text = asf_serialize_node(node, pretty);
+    if (!text) return NULL;
+
+    StrBuf sb;
+    memset(&sb, 0, sizeof(sb));
+    if (!sb_append(&sb, "// AutoService data file (ASF)\n") ||
+        !sb_append(&sb, "// Generated by program\n\n") ||
+        !sb_append(&sb, text)) {
+        free(sb.buf);
+        free(text);
+        return NULL;
+    }
+    free(text);
+    return sb.buf;
+}
+
 int asf_save_file(const char* filename, const DataNode* node, int pretty) {
     if (!filename || !node) return 0;
 
-    char* text = asf_serialize_node(node, pretty);
+    char* text = asf_build_file_text(node, pretty);
     if (!text) return 0;
 
-    FILE* f = fopen(filename, "w");
+    // Текст пишется рядом и заменяет прежний файл после сброса на диск
+    char tmp[300];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", filename);
+    FILE* f = fopen(tmp, "w");
     if (!f) {
         free(text);
         return 0;
     }
 
-    // Заголовок (комментарий допустим по ТЗ)
-    fputs("// AutoService data file (ASF)\n", f);
-    fputs("// Generated by program\n\n", f);
+    int ok = fputs(text, f) >= 0 && file_sync(f);
+    if (fclose(f) != 0) ok = 0;
+    if (ok) ok = file_replace(tmp, filename);
+    if (!ok) remove(tmp);
+    free(text);
+    return ok;
+}
+
+int asf_save_file_compressed(const char* filename, const DataNode* node, int pretty) {
+    if (!filename || !node) return 0;
+
+    char* text = asf_build_file_text(node, pretty);
+    if (!text) return 0;
 
-    fputs(text, f);
-    fclose(f);
+    int ok = container_write_file(filename, text, strlen(text), CONTAINER_PAYLOAD_ASF);
     free(text);
-    return 1;
+    return ok;
 }
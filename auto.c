@@ -3,6 +3,7 @@
 #include <string.h>
 #include <windows.h>
 #include "database.h"
+#include "user_store.h"
 
 // Простая хеш-функция на основе XOR и циклического сдвига
 unsigned int simple_hash(const char* password) {
@@ -19,65 +20,26 @@ void get_user_data_filename(const char* username, char* filename) {
     sprintf(filename, "data_%s.dat", username);
 }
 
-// Проверка существования пользователя
+// Проверка существования пользователя (хеш-индекс user_store.h вместо перебора users.dat)
 int user_exists(const char* username) {
-    FILE* file = fopen("users.dat", "rb");
-    if (!file) {
-        return 0;
-    }
-    
-    User existing_user;
-    while (fread(&existing_user, sizeof(User), 1, file) == 1) {
-        if (strcmp(existing_user.username, username) == 0) {
-            fclose(file);
-            return 1;
-        }
-    }
-    
-    fclose(file);
-    return 0;
+    return user_store_find(username, NULL);
 }
 
 // Сохранение пользователя с хешированным паролем
 void save_user(const User* new_user) {
-    FILE* file = fopen("users.dat", "ab");
-    if (!file) {
-        printf("Ошибка создания файла пользователей!\n");
-        return;
+    if (!user_store_add(new_user)) {
+        printf("Ошибка сохранения пользователя в %s!\n", USER_STORE_FILE);
     }
-
-    fwrite(new_user, sizeof(User), 1, file);
-    fclose(file);
 }
 
 // Проверка учетных данных
 int validate_credentials(const char* username, const char* password) {
-    FILE* file = fopen("users.dat", "rb");
-    if (!file) {
-        printf("│ Файл users.dat не найден!\n");
-        return 0;
-    }
-    
     User existing_user;
-    int found = 0;
-    
-    while (fread(&existing_user, sizeof(User), 1, file) == 1) {
-        if (strcmp(existing_user.username, username) == 0) {
-            found = 1;
-            unsigned int input_hash = simple_hash(password);
-            
-            fclose(file);
-            return (input_hash == existing_user.password_hash);
-        }
-    }
-    
-    fclose(file);
-    
-    if (!found) {
+    if (!user_store_find(username, &existing_user)) {
         printf("│ Пользователь '%s' не найден!\n", username);
+        return 0;
     }
-    
-    return 0;
+    return simple_hash(password) == existing_user.password_hash;
 }
 
 // Функция входа пользователя
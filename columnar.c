@@ -0,0 +1,383 @@
+#include "columnar.h"
+#include "work_dict.h"
+#include "crc32c.h"
+#include "file_io.h"
+
+// ============================================================================
+// Internal utilities
+// ============================================================================
+
+// Порядок байтов файла: little-endian
+static int host_is_little_endian(void) {
+    const uint16_t probe = 1;
+    return *(const uint8_t*)&probe == 1;
+}
+
+static uint32_t swap32(uint32_t v) {
+    return (v >> 24) | ((v >> 8) & 0xFF00u) | ((v << 8) & 0xFF0000u) | (v << 24);
+}
+
+static uint64_t swap64(uint64_t v) {
+    return ((uint64_t)swap32((uint32_t)v) << 32) | swap32((uint32_t)(v >> 32));
+}
+
+// Преобразование симметрично: годится и для записи, и для чтения
+static void header_to_little_endian(columnar_header* h) {
+    if (host_is_little_endian()) return;
+    h->magic = swap32(h->magic);
+    h->version = swap32(h->version);
+    h->record_count = swap64(h->record_count);
+    h->column_count = swap32(h->column_count);
+    h->flags = swap32(h->flags);
+    h->checkpoint_lsn = swap64(h->checkpoint_lsn);
+    for (int c = 0; c < COLUMN_COUNT; c++) {
+        column_desc* d = &h->columns[c];
+        d->column_id = swap32(d->column_id);
+        d->encoding = swap32(d->encoding);
+        d->offset = swap64(d->offset);
+        d->size = swap64(d->size);
+        d->checksum = swap32(d->checksum);
+        d->reserved = swap32(d->reserved);
+    }
+}
+
+// Числовые колонки - массивы 4-байтовых значений (float переставляется как uint32)
+static void values_to_little_endian(void* values, size_t count) {
+    if (host_is_little_endian()) return;
+    uint32_t* v = (uint32_t*)values;
+    for (size_t i = 0; i < count; i++) v[i] = swap32(v[i]);
+}
+
+static uint64_t align_up(uint64_t v) {
+    return (v + COLUMN_ALIGN - 1) / COLUMN_ALIGN * COLUMN_ALIGN;
+}
+
+static int column_encoding(int column) {
+    switch (column) {
+        case COLUMN_ID:        return COLUMN_ENC_INT32;
+        case COLUMN_DATE:      return COLUMN_ENC_DAYS;
+        case COLUMN_TYPE_WORK: return COLUMN_ENC_CODES;
+        case COLUMN_MILEAGE:   return COLUMN_ENC_INT32;
+        case COLUMN_PRICE:     return COLUMN_ENC_FLOAT32;
+        default:               return COLUMN_ENC_STRINGS;
+    }
+}
+
+// Блоки колонок, собранные в памяти перед записью
+typedef struct {
+    void* data[COLUMN_COUNT];
+    size_t size[COLUMN_COUNT];
+} ColumnSet;
+
+static void column_set_free(ColumnSet* set) {
+    for (int c = 0; c < COLUMN_COUNT; c++) free(set->data[c]);
+}
+
+static int build_columns(struct data_base* system, ColumnSet* set) {
+    size_t n = (size_t)system->size;
+    memset(set, 0, sizeof(*set));
+
+    int32_t* ids = malloc(n * sizeof(int32_t) + 1);
+    int32_t* dates = malloc(n * sizeof(int32_t) + 1);
+    uint32_t* codes = malloc(n * sizeof(uint32_t) + 1);
+    int32_t* mileage = malloc(n * sizeof(int32_t) + 1);
+    float* prices = malloc(n * sizeof(float) + 1);
+    set->data[COLUMN_ID] = ids;
+    set->data[COLUMN_DATE] = dates;
+    set->data[COLUMN_TYPE_WORK] = codes;
+    set->data[COLUMN_MILEAGE] = mileage;
+    set->data[COLUMN_PRICE] = prices;
+    if (!ids || !dates || !codes || !mileage || !prices) return 0;
+
+    // Коды колонки type_work - это id общего словаря, он и записывается блоком словаря
+    for (size_t i = 0; i < n; i++) {
+        const technical_maintenance* r = &system->records[i];
+        ids[i] = r->id;
+        dates[i] = r->date;
+        codes[i] = r->type_id;
+        mileage[i] = r->mileage;
+        prices[i] = r->price;
+    }
+
+    set->size[COLUMN_ID] = n * sizeof(int32_t);
+    set->size[COLUMN_DATE] = n * sizeof(int32_t);
+    set->size[COLUMN_TYPE_WORK] = n * sizeof(uint32_t);
+    set->size[COLUMN_MILEAGE] = n * sizeof(int32_t);
+    set->size[COLUMN_PRICE] = n * sizeof(float);
+    for (int c = 0; c < COLUMN_DICT; c++) values_to_little_endian(set->data[c], n);
+
+    set->data[COLUMN_DICT] = work_dict_serialize(work_dict_shared(), &set->size[COLUMN_DICT]);
+    return set->data[COLUMN_DICT] != NULL;
+}
+
+// ============================================================================
+// Запись
+// ============================================================================
+
+int save_to_columnar(struct data_base* system, const char* filename) {
+    db_verify_pending(system);
+    db_compact(system);
+    ColumnSet set;
+    if (!build_columns(system, &set)) {
+        printf("Ошибка: недостаточно памяти для поколоночного сохранения\n");
+        column_set_free(&set);
+        return 0;
+    }
+
+    columnar_header header;
+    memset(&header, 0, sizeof(header));
+    header.magic = FILE_MAGIC;
+    header.version = FILE_VERSION_COLUMNAR;
+    header.record_count = (uint64_t)system->size;
+    header.column_count = COLUMN_COUNT;
+    header.flags = COLUMNAR_FLAG_CRC32C;
+    header.checkpoint_lsn = system->lsn;
+
+    uint64_t offset = align_up(sizeof(header));
+    for (int c = 0; c < COLUMN_COUNT; c++) {
+        column_desc* d = &header.columns[c];
+        d->column_id = (uint32_t)c;
+        d->encoding = (uint32_t)column_encoding(c);
+        d->offset = offset;
+        d->size = set.size[c];
+        d->checksum = crc32c(0, set.data[c], set.size[c]);
+        offset = align_up(offset + set.size[c]);
+    }
+
+    // Файл пишется рядом и заменяет прежний после сброса на диск; отображение
+    // прежнего файла снимается до замены
+    db_detach_mapping(system, system->capacity);
+    char tmp[300];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", filename);
+    FILE* file = fopen(tmp, "wb");
+    if (!file) {
+        printf("Ошибка открытия файла для записи: %s\n", tmp);
+        column_set_free(&set);
+        return 0;
+    }
+
+    static const unsigned char zeros[COLUMN_ALIGN] = {0};
+    columnar_header disk = header;
+    header_to_little_endian(&disk);
+    int ok = fwrite(&disk, sizeof(disk), 1, file) == 1;
+    uint64_t pos = sizeof(header);
+    for (int c = 0; ok && c < COLUMN_COUNT; c++) {
+        size_t pad = (size_t)(header.columns[c].offset - pos);
+        if (pad && fwrite(zeros, 1, pad, file) != pad) ok = 0;
+        if (ok && set.size[c] && fwrite(set.data[c], 1, set.size[c], file) != set.size[c]) ok = 0;
+        pos = header.columns[c].offset + set.size[c];
+    }
+    if (ok && !file_sync(file)) ok = 0;
+    if (fclose(file) != 0) ok = 0;
+    if (ok) ok = file_replace(tmp, filename);
+    if (!ok) remove(tmp);
+    column_set_free(&set);
+
+    if (!ok) {
+        printf("Ошибка записи поколоночного файла: %s\n", filename);
+        return 0;
+    }
+    printf("Данные сохранены в поколоночном формате: %s\n", filename);
+    printf("  Записей: %lld\n", (long long)system->size);
+    return 1;
+}
+
+// ============================================================================
+// Выборочное чтение
+// ============================================================================
+
+int columnar_open(columnar_file* cf, const char* filename) {
+    memset(cf, 0, sizeof(*cf));
+    cf->file = fopen(filename, "rb");
+    if (!cf->file) {
+        printf("Файл не найден: %s\n", filename);
+        return 0;
+    }
+
+    uint64_t sz = 0;
+    if (!file_size(cf->file, &sz)) {
+        columnar_close(cf);
+        return 0;
+    }
+
+    columnar_header* h = &cf->header;
+    if (sz < sizeof(*h) || fread(h, sizeof(*h), 1, cf->file) != 1) {
+        printf("Ошибка чтения заголовка файла\n");
+        columnar_close(cf);
+        return 0;
+    }
+    header_to_little_endian(h);
+    cf->file_size = (size_t)sz;
+
+    if (h->magic != FILE_MAGIC || h->version != FILE_VERSION_COLUMNAR || h->column_count != COLUMN_COUNT) {
+        printf("Ошибка: файл %s не является поколоночной базой\n", filename);
+        columnar_close(cf);
+        return 0;
+    }
+
+    for (int c = 0; c < COLUMN_COUNT; c++) {
+        const column_desc* d = &h->columns[c];
+        if (d->column_id != (uint32_t)c || d->offset > cf->file_size || d->size > cf->file_size - d->offset) {
+            printf("Ошибка: повреждено описание колонки %d\n", c);
+            columnar_close(cf);
+            return 0;
+        }
+        if (c != COLUMN_DICT && d->size != h->record_count * 4) {
+            printf("Ошибка: размер колонки %d не совпадает с числом записей\n", c);
+            columnar_close(cf);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+void columnar_close(columnar_file* cf) {
+    if (cf->file) fclose(cf->file);
+    cf->file = NULL;
+}
+
+// Значения числовых колонок возвращаются в порядке байтов хоста
+void* columnar_read_column(columnar_file* cf, int column, size_t* out_count) {
+    if (!cf->file || column < 0 || column >= COLUMN_COUNT) return NULL;
+
+    const column_desc* d = &cf->header.columns[column];
+    void* data = malloc((size_t)d->size + 1);
+    if (!data) return NULL;
+
+    if (!file_seek(cf->file, d->offset) ||
+        (d->size && fread(data, 1, (size_t)d->size, cf->file) != d->size)) {
+        printf("Ошибка чтения колонки %d\n", column);
+        free(data);
+        return NULL;
+    }
+
+    uint32_t actual = (cf->header.flags & COLUMNAR_FLAG_CRC32C) ? crc32c(0, data, (size_t)d->size)
+                                                                : checksum_buffer(data, (size_t)d->size);
+    if (actual != d->checksum) {
+        printf("Ошибка: контрольная сумма колонки %d не совпадает\n", column);
+        free(data);
+        return NULL;
+    }
+
+    if (column != COLUMN_DICT) values_to_little_endian(data, (size_t)cf->header.record_count);
+    if (out_count) *out_count = column == COLUMN_DICT ? (size_t)d->size : (size_t)cf->header.record_count;
+    return data;
+}
+
+// ============================================================================
+// Полная загрузка в data_base
+// ============================================================================
+
+int load_from_columnar(struct data_base* system, const char* filename) {
+    columnar_file cf;
+    if (!columnar_open(&cf, filename)) return 0;
+
+    size_t n = 0, dict_size = 0;
+    int32_t* ids = columnar_read_column(&cf, COLUMN_ID, &n);
+    int32_t* dates = columnar_read_column(&cf, COLUMN_DATE, NULL);
+    uint32_t* codes = columnar_read_column(&cf, COLUMN_TYPE_WORK, NULL);
+    int32_t* mileage = columnar_read_column(&cf, COLUMN_MILEAGE, NULL);
+    float* prices = columnar_read_column(&cf, COLUMN_PRICE, NULL);
+    unsigned char* dict_block = columnar_read_column(&cf, COLUMN_DICT, &dict_size);
+    uint64_t lsn = cf.header.checkpoint_lsn;
+    columnar_close(&cf);
+
+    // Словарь файла добавляется в общий, коды переводятся в общие id
+    uint32_t* remap = NULL;
+    uint32_t remap_count = 0;
+    int ok = ids && dates && codes && mileage && prices && dict_block &&
+             work_dict_import(work_dict_shared(), dict_block, dict_size, &remap, &remap_count);
+    if (ok) {
+        technical_maintenance* records = malloc((n > 10 ? n : 10) * sizeof(technical_maintenance));
+        if (!records) {
+            ok = 0;
+        } else {
+            for (size_t i = 0; i < n; i++) {
+                technical_maintenance* r = &records[i];
+                memset(r, 0, sizeof(*r));
+                r->id = ids[i];
+                r->date = dates[i];
+                r->type_id = codes[i] < remap_count ? remap[codes[i]] : WORK_DICT_NONE;
+                r->mileage = mileage[i];
+                r->price = prices[i];
+            }
+            db_adopt_records(system, records, (int64_t)n, n > 10 ? (int64_t)n : 10);
+            system->lsn = lsn;
+        }
+    }
+
+    free(remap);
+    free(dict_block);
+    free(ids);
+    free(dates);
+    free(codes);
+    free(mileage);
+    free(prices);
+
+    if (!ok) {
+        printf("Ошибка загрузки поколоночного файла: %s\n", filename);
+        return 0;
+    }
+    printf("Данные загружены из поколоночного файла: %s\n", filename);
+    printf("  Записей: %lld\n", (long long)system->size);
+    return 1;
+}
+
+// ============================================================================
+// Агрегаты
+// ============================================================================
+
+// Циклы без ветвлений по плотным массивам компилятор векторизует (SSE/AVX)
+static void stats_float(const float* v, size_t n, column_stats* out) {
+    double sum = 0.0;
+    float mn = n ? v[0] : 0.0f, mx = n ? v[0] : 0.0f;
+    for (size_t i = 0; i < n; i++) {
+        sum += v[i];
+        mn = v[i] < mn ? v[i] : mn;
+        mx = v[i] > mx ? v[i] : mx;
+    }
+    out->count = n;
+    out->sum = sum;
+    out->min = mn;
+    out->max = mx;
+}
+
+static void stats_int32(const int32_t* v, size_t n, column_stats* out) {
+    int64_t sum = 0;
+    int32_t mn = n ? v[0] : 0, mx = n ? v[0] : 0;
+    for (size_t i = 0; i < n; i++) {
+        sum += v[i];
+        mn = v[i] < mn ? v[i] : mn;
+        mx = v[i] > mx ? v[i] : mx;
+    }
+    out->count = n;
+    out->sum = (double)sum;
+    out->min = mn;
+    out->max = mx;
+}
+
+static int column_stats_for(const char* filename, int column, column_stats* out) {
+    columnar_file cf;
+    if (!columnar_open(&cf, filename)) return 0;
+
+    size_t n = 0;
+    void* values = columnar_read_column(&cf, column, &n);
+    columnar_close(&cf);
+    if (!values) return 0;
+
+    if (column == COLUMN_PRICE) {
+        stats_float((const float*)values, n, out);
+    } else {
+        stats_int32((const int32_t*)values, n, out);
+    }
+    free(values);
+    return 1;
+}
+
+int columnar_price_stats(const char* filename, column_stats* out) {
+    return column_stats_for(filename, COLUMN_PRICE, out);
+}
+
+int columnar_mileage_stats(const char* filename, column_stats* out) {
+    return column_stats_for(filename, COLUMN_MILEAGE, out);
+}
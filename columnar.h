@@ -0,0 +1,84 @@
+#ifndef COLUMNAR_H
+#define COLUMNAR_H
+
+#include "database.h"
+
+// ============================================================================
+// Поколоночный формат базы (FILE_VERSION_COLUMNAR).
+// Каждое поле technical_maintenance хранится отдельным блоком, выровненным
+// на 64 байта, поэтому агрегаты по цене или пробегу читают только свою колонку
+// и обходят плотный массив чисел без 100-байтных строк type_work.
+// Заголовок и числовые колонки - little-endian, контрольные суммы считаются
+// по байтам файла; блок словаря - в формате work_dict_serialize.
+// ============================================================================
+
+// Колонки
+#define COLUMN_ID        0  // int32
+#define COLUMN_DATE      1  // int32, номер дня (date_to_days)
+#define COLUMN_TYPE_WORK 2  // uint32, код в словаре COLUMN_DICT
+#define COLUMN_MILEAGE   3  // int32
+#define COLUMN_PRICE     4  // float32
+#define COLUMN_DICT      5  // словарь: uint32 count, затем (uint32 len, байты) x count
+#define COLUMN_COUNT     6
+
+// Кодировки блоков
+#define COLUMN_ENC_INT32   1
+#define COLUMN_ENC_FLOAT32 2
+#define COLUMN_ENC_DAYS    3
+#define COLUMN_ENC_CODES   4
+#define COLUMN_ENC_STRINGS 5
+
+#define COLUMN_ALIGN 64
+
+// Флаги заголовка
+#define COLUMNAR_FLAG_CRC32C 0x1 // контрольные суммы колонок - CRC32C (иначе checksum_buffer)
+
+typedef struct column_desc {
+    uint32_t column_id; // COLUMN_*
+    uint32_t encoding;  // COLUMN_ENC_*
+    uint64_t offset;    // Смещение блока от начала файла (кратно COLUMN_ALIGN)
+    uint64_t size;      // Размер блока в байтах
+    uint32_t checksum;  // CRC32C блока (или checksum_buffer без COLUMNAR_FLAG_CRC32C)
+    uint32_t reserved;
+} column_desc;
+
+typedef struct columnar_header {
+    uint32_t magic;        // FILE_MAGIC
+    uint32_t version;      // FILE_VERSION_COLUMNAR
+    uint64_t record_count;
+    uint32_t column_count; // COLUMN_COUNT
+    uint32_t flags;
+    uint64_t checkpoint_lsn; // LSN последнего изменения журнала, вошедшего в файл (0 - нет)
+    column_desc columns[COLUMN_COUNT];
+} columnar_header;
+
+// Открытый файл для выборочного чтения колонок
+typedef struct columnar_file {
+    FILE* file;
+    size_t file_size;
+    columnar_header header;
+} columnar_file;
+
+// Сводка по числовой колонке
+typedef struct column_stats {
+    uint64_t count;
+    double sum;
+    double min;
+    double max;
+} column_stats;
+
+// Запись / полная загрузка
+int save_to_columnar(struct data_base* system, const char* filename);
+int load_from_columnar(struct data_base* system, const char* filename);
+
+// Выборочное чтение
+int columnar_open(columnar_file* cf, const char* filename);
+void columnar_close(columnar_file* cf);
+// Читает блок колонки целиком (malloc). Для числовых колонок *out_count = число значений.
+void* columnar_read_column(columnar_file* cf, int column, size_t* out_count);
+
+// Агрегаты, читающие только одну колонку
+int columnar_price_stats(const char* filename, column_stats* out);
+int columnar_mileage_stats(const char* filename, column_stats* out);
+
+#endif // COLUMNAR_H
@@ -0,0 +1,310 @@
+#include "container.h"
+#include "lz_codec.h"
+#include "parallel.h"
+#include "file_io.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// ============================================================================
+// Internal utilities
+// ============================================================================
+
+// Adler-32: быстрая побайтовая сумма для проверки блоков
+static uint32_t container_checksum(const unsigned char* data, size_t n) {
+    uint32_t a = 1, b = 0;
+    while (n > 0) {
+        size_t chunk = n < 5552 ? n : 5552;
+        n -= chunk;
+        while (chunk--) {
+            a += *data++;
+            b += a;
+        }
+        a %= 65521;
+        b %= 65521;
+    }
+    return (b << 16) | a;
+}
+
+// Заголовок и индекс блоков в файле - little-endian
+static int host_is_little_endian(void) {
+    const uint16_t probe = 1;
+    return *(const uint8_t*)&probe == 1;
+}
+
+static uint32_t swap32(uint32_t v) {
+    return (v >> 24) | ((v >> 8) & 0xFF00u) | ((v << 8) & 0xFF0000u) | (v << 24);
+}
+
+static uint64_t swap64(uint64_t v) {
+    return ((uint64_t)swap32((uint32_t)v) << 32) | swap32((uint32_t)(v >> 32));
+}
+
+// Преобразования симметричны: годятся и для записи, и для чтения
+static void header_to_little_endian(container_header* h) {
+    if (host_is_little_endian()) return;
+    h->magic = swap32(h->magic);
+    h->version = swap32(h->version);
+    h->payload_type = swap32(h->payload_type);
+    h->block_size = swap32(h->block_size);
+    h->raw_size = swap64(h->raw_size);
+    h->block_count = swap32(h->block_count);
+    h->index_checksum = swap32(h->index_checksum);
+}
+
+static void index_to_little_endian(container_block* index, size_t count) {
+    if (host_is_little_endian()) return;
+    for (size_t i = 0; i < count; i++) {
+        index[i].offset = swap64(index[i].offset);
+        index[i].packed_size = swap32(index[i].packed_size);
+        index[i].raw_size = swap32(index[i].raw_size);
+        index[i].checksum = swap32(index[i].checksum);
+        index[i].flags = swap32(index[i].flags);
+    }
+}
+
+static size_t block_count_for(size_t size) {
+    return (size + CONTAINER_BLOCK_SIZE - 1) / CONTAINER_BLOCK_SIZE;
+}
+
+// ============================================================================
+// Сжатие
+// ============================================================================
+
+typedef struct {
+    const unsigned char* src;
+    size_t size;
+    unsigned char** packed;
+    container_block* index;
+    int failed;
+} PackJob;
+
+static void pack_block(void* ctx, size_t i) {
+    PackJob* job = (PackJob*)ctx;
+    size_t start = i * CONTAINER_BLOCK_SIZE;
+    size_t len = job->size - start < CONTAINER_BLOCK_SIZE ? job->size - start : CONTAINER_BLOCK_SIZE;
+    const unsigned char* raw = job->src + start;
+
+    container_block* blk = &job->index[i];
+    blk->raw_size = (uint32_t)len;
+    blk->checksum = container_checksum(raw, len);
+    blk->flags = 0;
+
+    size_t cap = lz_compress_bound(len);
+    unsigned char* out = (unsigned char*)malloc(cap);
+    if (!out) {
+        job->failed = 1;
+        return;
+    }
+
+    size_t packed = lz_compress(raw, len, out, cap);
+    if (packed == 0 || packed >= len) {
+        // Несжимаемый блок храним как есть
+        memcpy(out, raw, len);
+        packed = len;
+        blk->flags = CONTAINER_BLOCK_STORED;
+    }
+    blk->packed_size = (uint32_t)packed;
+    job->packed[i] = out;
+}
+
+int container_write_file(const char* filename, const void* data, size_t size, unsigned int payload_type) {
+    if (!filename || (!data && size)) return 0;
+
+    size_t count = block_count_for(size);
+    container_block* index = (container_block*)calloc(count ? count : 1, sizeof(container_block));
+    unsigned char** packed = (unsigned char**)calloc(count ? count : 1, sizeof(unsigned char*));
+    if (!index || !packed) {
+        free(index);
+        free(packed);
+        return 0;
+    }
+
+    PackJob job;
+    job.src = (const unsigned char*)data;
+    job.size = size;
+    job.packed = packed;
+    job.index = index;
+    job.failed = 0;
+    parallel_for(count, pack_block, &job);
+
+    int ok = !job.failed;
+
+    // Смещения блоков известны только после сжатия
+    uint64_t offset = sizeof(container_header) + count * sizeof(container_block);
+    for (size_t i = 0; i < count; i++) {
+        index[i].offset = offset;
+        offset += index[i].packed_size;
+    }
+
+    // Контрольная сумма индекса считается по его байтам в файле
+    index_to_little_endian(index, count);
+    container_header header;
+    header.magic = CONTAINER_MAGIC;
+    header.version = CONTAINER_VERSION;
+    header.payload_type = payload_type;
+    header.block_size = CONTAINER_BLOCK_SIZE;
+    header.raw_size = size;
+    header.block_count = (uint32_t)count;
+    header.index_checksum = container_checksum((const unsigned char*)index, count * sizeof(container_block));
+    header_to_little_endian(&header);
+
+    // Контейнер пишется рядом и заменяет прежний файл только после сброса на диск:
+    // сбой посреди записи оставляет прежний файл целым
+    char tmp[300];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", filename);
+    FILE* f = ok ? fopen(tmp, "wb") : NULL;
+    if (!f) {
+        ok = 0;
+    } else {
+        if (fwrite(&header, sizeof(header), 1, f) != 1) ok = 0;
+        if (ok && count && fwrite(index, sizeof(container_block), count, f) != count) ok = 0;
+        index_to_little_endian(index, count);
+        for (size_t i = 0; ok && i < count; i++) {
+            if (fwrite(packed[i], 1, index[i].packed_size, f) != index[i].packed_size) ok = 0;
+        }
+        if (ok && !file_sync(f)) ok = 0;
+        if (fclose(f) != 0) ok = 0;
+        if (ok) ok = file_replace(tmp, filename);
+        if (!ok) remove(tmp);
+    }
+
+    for (size_t i = 0; i < count; i++) free(packed[i]);
+    free(packed);
+    free(index);
+    return ok;
+}
+
+// ============================================================================
+// Распаковка
+// ============================================================================
+
+typedef struct {
+    const unsigned char* file_data;
+    size_t file_size;
+    const container_block* index;
+    unsigned char* out;
+    int failed;
+} UnpackJob;
+
+static void unpack_block(void* ctx, size_t i) {
+    UnpackJob* job = (UnpackJob*)ctx;
+    const container_block* blk = &job->index[i];
+    unsigned char* dst = job->out + i * CONTAINER_BLOCK_SIZE;
+
+    if (blk->offset > job->file_size || blk->packed_size > job->file_size - blk->offset) {
+        job->failed = 1;
+        return;
+    }
+    const unsigned char* src = job->file_data + blk->offset;
+
+    if (blk->flags & CONTAINER_BLOCK_STORED) {
+        if (blk->packed_size != blk->raw_size) {
+            job->failed = 1;
+            return;
+        }
+        memcpy(dst, src, blk->raw_size);
+    } else if (!lz_decompress(src, blk->packed_size, dst, blk->raw_size)) {
+        job->failed = 1;
+        return;
+    }
+
+    if (container_checksum(dst, blk->raw_size) != blk->checksum) {
+        fprintf(stderr, "Ошибка: повреждён блок %lu контейнера\n", (unsigned long)i);
+        job->failed = 1;
+    }
+}
+
+int container_is_file(const char* filename) {
+    FILE* f = fopen(filename, "rb");
+    if (!f) return 0;
+    uint32_t magic = 0;
+    int ok = fread(&magic, sizeof(magic), 1, f) == 1 &&
+             (host_is_little_endian() ? magic : swap32(magic)) == CONTAINER_MAGIC;
+    fclose(f);
+    return ok;
+}
+
+unsigned char* container_read_file(const char* filename, size_t* out_size, unsigned int* payload_type) {
+    if (!filename) return NULL;
+
+    FILE* f = fopen(filename, "rb");
+    if (!f) return NULL;
+
+    // Читаем файл целиком одним вызовом: блоки лежат подряд
+    uint64_t fsz = 0;
+    if (!file_size(f, &fsz) || fsz < sizeof(container_header) || fsz > SIZE_MAX) {
+        fclose(f);
+        return NULL;
+    }
+
+    unsigned char* file_data = (unsigned char*)malloc((size_t)fsz);
+    if (!file_data) {
+        fclose(f);
+        return NULL;
+    }
+    size_t rd = fread(file_data, 1, (size_t)fsz, f);
+    fclose(f);
+    if (rd != (size_t)fsz) {
+        free(file_data);
+        return NULL;
+    }
+
+    container_header header;
+    memcpy(&header, file_data, sizeof(header));
+    header_to_little_endian(&header);
+
+    size_t index_bytes = (size_t)header.block_count * sizeof(container_block);
+    if (header.magic != CONTAINER_MAGIC || header.version != CONTAINER_VERSION ||
+        header.block_size != CONTAINER_BLOCK_SIZE ||
+        header.block_count != block_count_for((size_t)header.raw_size) ||
+        index_bytes > (size_t)fsz - sizeof(header)) {
+        fprintf(stderr, "Ошибка: неверный заголовок контейнера %s\n", filename);
+        free(file_data);
+        return NULL;
+    }
+
+    if (container_checksum(file_data + sizeof(header), index_bytes) != header.index_checksum) {
+        fprintf(stderr, "Ошибка: повреждён индекс блоков контейнера %s\n", filename);
+        free(file_data);
+        return NULL;
+    }
+    // Копия индекса в порядке байтов машины (в файле он еще и может быть не выровнен)
+    container_block* index = (container_block*)malloc(index_bytes ? index_bytes : 1);
+    unsigned char* out = (unsigned char*)malloc((size_t)header.raw_size + 1);
+    if (!index || !out) {
+        free(index);
+        free(out);
+        free(file_data);
+        return NULL;
+    }
+    memcpy(index, file_data + sizeof(header), index_bytes);
+    index_to_little_endian(index, header.block_count);
+
+    UnpackJob job;
+    job.file_data = file_data;
+    job.file_size = (size_t)fsz;
+    job.index = index;
+    job.out = out;
+    job.failed = 0;
+
+    for (size_t i = 0; i < header.block_count; i++) {
+        size_t expect = (size_t)header.raw_size - i * CONTAINER_BLOCK_SIZE;
+        if (expect > CONTAINER_BLOCK_SIZE) expect = CONTAINER_BLOCK_SIZE;
+        if (index[i].raw_size != expect) job.failed = 1;
+    }
+    if (!job.failed) parallel_for(header.block_count, unpack_block, &job);
+
+    free(index);
+    free(file_data);
+    if (job.failed) {
+        free(out);
+        return NULL;
+    }
+
+    out[header.raw_size] = '\0';
+    if (out_size) *out_size = (size_t)header.raw_size;
+    if (payload_type) *payload_type = header.payload_type;
+    return out;
+}
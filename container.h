@@ -0,0 +1,54 @@
+#ifndef CONTAINER_H
+#define CONTAINER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// ============================================================================
+// Блочный сжатый контейнер для файлов ASF и бинарной базы.
+// Формат: [container_header][container_block x block_count][сжатые блоки],
+// заголовок и индекс - little-endian.
+// Каждый блок сжимается независимо (lz_codec) и имеет свою контрольную сумму,
+// поэтому блоки можно распаковывать параллельно.
+// ============================================================================
+
+#define CONTAINER_MAGIC      0x5A465341  // "ASFZ"
+#define CONTAINER_VERSION    1
+#define CONTAINER_BLOCK_SIZE (64 * 1024)
+
+// Тип полезной нагрузки
+#define CONTAINER_PAYLOAD_ASF    1
+#define CONTAINER_PAYLOAD_BINARY 2
+
+// Флаги блока
+#define CONTAINER_BLOCK_STORED 1  // блок несжимаем и хранится как есть
+
+typedef struct container_header {
+    uint32_t magic;          // CONTAINER_MAGIC
+    uint32_t version;        // CONTAINER_VERSION
+    uint32_t payload_type;   // CONTAINER_PAYLOAD_*
+    uint32_t block_size;     // Размер несжатого блока
+    uint64_t raw_size;       // Общий размер несжатых данных
+    uint32_t block_count;    // Количество блоков в индексе
+    uint32_t index_checksum; // Контрольная сумма индекса блоков
+} container_header;
+
+typedef struct container_block {
+    uint64_t offset;      // Смещение сжатого блока от начала файла
+    uint32_t packed_size; // Размер на диске
+    uint32_t raw_size;    // Размер после распаковки
+    uint32_t checksum;    // Контрольная сумма несжатых данных
+    uint32_t flags;       // CONTAINER_BLOCK_*
+} container_block;
+
+// Проверка, что файл является контейнером (по магическому числу)
+int container_is_file(const char* filename);
+
+// Сжатие буфера и запись контейнера. Возвращает 1 при успехе.
+int container_write_file(const char* filename, const void* data, size_t size, unsigned int payload_type);
+
+// Чтение и параллельная распаковка контейнера.
+// Возвращает буфер (malloc, с завершающим '\0') или NULL при ошибке.
+unsigned char* container_read_file(const char* filename, size_t* out_size, unsigned int* payload_type);
+
+#endif // CONTAINER_H
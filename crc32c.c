@@ -0,0 +1,114 @@
+#include "crc32c.h"
+
+#include <string.h>
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define CRC32C_HAVE_SSE42 1
+#include <nmmintrin.h>
+#endif
+
+#define CRC32C_POLY_REFLECTED 0x82F63B78u
+
+static uint32_t crc_table[8][256];
+static int crc_ready = 0;
+static int crc_use_hw = 0;
+
+// ============================================================================
+// Программная реализация: slice-by-8
+// ============================================================================
+
+static void build_tables(void) {
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t c = i;
+        for (int k = 0; k < 8; k++) {
+            c = (c & 1) ? (c >> 1) ^ CRC32C_POLY_REFLECTED : c >> 1;
+        }
+        crc_table[0][i] = c;
+    }
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t c = crc_table[0][i];
+        for (int t = 1; t < 8; t++) {
+            c = crc_table[0][c & 0xFF] ^ (c >> 8);
+            crc_table[t][i] = c;
+        }
+    }
+}
+
+static uint32_t crc32c_sw(uint32_t crc, const unsigned char* p, size_t n) {
+    // Выравниваем указатель, затем обрабатываем по 8 байт (little-endian)
+    while (n && ((uintptr_t)p & 7)) {
+        crc = crc_table[0][(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+        n--;
+    }
+    while (n >= 8) {
+        uint32_t lo = crc ^ ((uint32_t)p[0] | ((uint32_t)p[1] << 8) |
+                             ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24));
+        uint32_t hi = (uint32_t)p[4] | ((uint32_t)p[5] << 8) |
+                      ((uint32_t)p[6] << 16) | ((uint32_t)p[7] << 24);
+        crc = crc_table[7][lo & 0xFF] ^ crc_table[6][(lo >> 8) & 0xFF] ^
+              crc_table[5][(lo >> 16) & 0xFF] ^ crc_table[4][lo >> 24] ^
+              crc_table[3][hi & 0xFF] ^ crc_table[2][(hi >> 8) & 0xFF] ^
+              crc_table[1][(hi >> 16) & 0xFF] ^ crc_table[0][hi >> 24];
+        p += 8;
+        n -= 8;
+    }
+    while (n--) {
+        crc = crc_table[0][(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+    }
+    return crc;
+}
+
+// ============================================================================
+// Аппаратная реализация: SSE4.2
+// ============================================================================
+
+#ifdef CRC32C_HAVE_SSE42
+__attribute__((target("sse4.2")))
+static uint32_t crc32c_hw(uint32_t crc, const unsigned char* p, size_t n) {
+    uint64_t c = crc;
+    while (n && ((uintptr_t)p & 7)) {
+        c = _mm_crc32_u8((uint32_t)c, *p++);
+        n--;
+    }
+    while (n >= 8) {
+        uint64_t v;
+        memcpy(&v, p, sizeof(v));
+        c = _mm_crc32_u64(c, v);
+        p += 8;
+        n -= 8;
+    }
+    while (n--) {
+        c = _mm_crc32_u8((uint32_t)c, *p++);
+    }
+    return (uint32_t)c;
+}
+#endif
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+void crc32c_init(void) {
+    if (crc_ready) return;
+    build_tables();
+#ifdef CRC32C_HAVE_SSE42
+    __builtin_cpu_init();
+    crc_use_hw = __builtin_cpu_supports("sse4.2") ? 1 : 0;
+#endif
+    crc_ready = 1;
+}
+
+int crc32c_hardware(void) {
+    crc32c_init();
+    return crc_use_hw;
+}
+
+uint32_t crc32c(uint32_t crc, const void* data, size_t size) {
+    crc32c_init();
+    const unsigned char* p = (const unsigned char*)data;
+    crc = ~crc;
+#ifdef CRC32C_HAVE_SSE42
+    if (crc_use_hw) return ~crc32c_hw(crc, p, size);
+#endif
+    return ~crc32c_sw(crc, p, size);
+}
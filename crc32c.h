@@ -0,0 +1,24 @@
+#ifndef CRC32C_H
+#define CRC32C_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// ============================================================================
+// CRC32C (полином Кастаньоли 0x1EDC6F41).
+// На x86 с SSE4.2 используется инструкция crc32, иначе программный slice-by-8.
+// Выбор реализации выполняется один раз при первом вызове.
+// ============================================================================
+
+// Продолжает crc по буферу: crc32c(0, ...) для нового буфера,
+// crc32c(prev, ...) для следующего фрагмента того же потока.
+uint32_t crc32c(uint32_t crc, const void* data, size_t size);
+
+// Подготовка таблиц и выбор реализации. Вызывается автоматически,
+// но перед параллельным использованием лучше вызвать явно из основного потока.
+void crc32c_init(void);
+
+// 1, если используется аппаратная реализация
+int crc32c_hardware(void);
+
+#endif // CRC32C_H
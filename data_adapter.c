@@ -12,9 +12,11 @@ static DataNode* make_record_object(const technical_maintenance* r) {
     DataNode* obj = asf_node_create(NODE_OBJECT);
     if (!obj) return NULL;
 
+    char date[DATE_TEXT_SIZE];
+    days_to_date(r->date, date);
     if (!asf_object_put(obj, "id", asf_node_integer(r->id)) ||
-        !asf_object_put(obj, "date", asf_node_string(r->date)) ||
-        !asf_object_put(obj, "type_work", asf_node_string(r->type_work)) ||
+        !asf_object_put(obj, "date", asf_node_string(date)) ||
+        !asf_object_put(obj, "type_work", asf_node_string(record_type_work(r))) ||
         !asf_object_put(obj, "mileage", asf_node_integer(r->mileage)) ||
         !asf_object_put(obj, "price", asf_node_float(r->price))) {
         asf_free_node(obj);
@@ -51,13 +53,14 @@ const DataNode* find_node_by_key_const(const DataNode* object, const char* key)
 // Convert business -> AST
 // ============================================================================
 
-DataNode* technical_maintenance_to_asf(const technical_maintenance* records, int count) {
+DataNode* technical_maintenance_to_asf(const technical_maintenance* records, int64_t count) {
     if (!records || count < 0) return NULL;
 
     DataNode* arr = asf_node_create(NODE_ARRAY);
     if (!arr) return NULL;
 
-    for (int i = 0; i < count; i++) {
+    for (int64_t i = 0; i < count; i++) {
+        if (record_is_deleted(&records[i])) continue;
         DataNode* obj = make_record_object(&records[i]);
         if (!obj) {
             asf_free_node(arr);
@@ -73,7 +76,7 @@ DataNode* technical_maintenance_to_asf(const technical_maintenance* records, int
     return arr;
 }
 
-DataNode* create_metadata(const char* username, int record_count) {
+DataNode* create_metadata(const char* username, int64_t record_count) {
     DataNode* meta = asf_node_create(NODE_OBJECT);
     if (!meta) return NULL;
 
@@ -90,7 +93,7 @@ DataNode* create_metadata(const char* username, int record_count) {
     if (!asf_object_put(meta, "version", asf_node_string("1.0")) ||
         !asf_object_put(meta, "created", asf_node_string(stamp)) ||
         !asf_object_put(meta, "user", asf_node_string(username ? username : "unknown")) ||
-        !asf_object_put(meta, "record_count", asf_node_integer(record_count))) {
+        !asf_object_put(meta, "record_count", asf_node_integer((long)record_count))) {
         asf_free_node(meta);
         return NULL;
     }
@@ -104,7 +107,7 @@ DataNode* database_to_asf(const data_base* db, const char* username) {
     DataNode* root = asf_node_create(NODE_OBJECT);
     if (!root) return NULL;
 
-    DataNode* meta = create_metadata(username, db->size);
+    DataNode* meta = create_metadata(username, db_live_count(db));
     DataNode* records = technical_maintenance_to_asf(db->records, db->size);
 
     if (!meta || !records) {
@@ -114,6 +117,17 @@ DataNode* database_to_asf(const data_base* db, const char* username) {
         return NULL;
     }
 
+    // LSN контрольной точки: журнал изменений проигрывается поверх файла начиная с него.
+    // Хранится десятичной строкой: long на Windows 32-битный
+    char lsn_text[24];
+    snprintf(lsn_text, sizeof(lsn_text), "%llu", (unsigned long long)db->lsn);
+    if (!asf_object_put(meta, "lsn", asf_node_string(lsn_text))) {
+        asf_free_node(meta);
+        asf_free_node(records);
+        asf_free_node(root);
+        return NULL;
+    }
+
     if (!asf_object_put(root, "metadata", meta) ||
         !asf_object_put(root, "records", records)) {
         asf_free_node(root);
@@ -134,6 +148,20 @@ static int node_to_long(const DataNode* n, long* out) {
     return 0;
 }
 
+// LSN: десятичная строка (64 бита) или целое из файлов прежних версий; 0 - нет LSN
+static uint64_t node_to_lsn(const DataNode* n) {
+    if (!n) return 0;
+    if (n->type == NODE_INTEGER) return n->value.int_value > 0 ? (uint64_t)n->value.int_value : 0;
+    if (n->type != NODE_STRING || !n->value.string_value) return 0;
+    const char* text = n->value.string_value;
+    if (*text < '0' || *text > '9') return 0;
+    char* end = NULL;
+    errno = 0;
+    unsigned long long lsn = strtoull(text, &end, 10);
+    if (errno != 0 || *end != '\0') return 0;
+    return (uint64_t)lsn;
+}
+
 static int node_to_double(const DataNode* n, double* out) {
     if (!n || !out) return 0;
     if (n->type == NODE_FLOAT) { *out = n->value.float_value; return 1; }
@@ -162,16 +190,10 @@ static int convert_asf_to_record(const DataNode* obj, technical_maintenance* r)
     if (node_to_long(idn, &idv)) r->id = (int)idv;
 
     const char* ds = node_to_cstr(daten);
-    if (ds) {
-        strncpy(r->date, ds, sizeof(r->date) - 1);
-        r->date[sizeof(r->date) - 1] = '\0';
-    }
+    if (!ds || !date_to_days(ds, &r->date)) r->date = DATE_NONE;
 
     const char* ts = node_to_cstr(typen);
-    if (ts) {
-        strncpy(r->type_work, ts, sizeof(r->type_work) - 1);
-        r->type_work[sizeof(r->type_work) - 1] = '\0';
-    }
+    if (ts) record_set_type_work(r, ts);
 
     long mv = 0;
     if (node_to_long(milen, &mv)) r->mileage = (int)mv;
@@ -240,5 +262,9 @@ data_base* asf_to_database(const DataNode* root) {
         }
     }
 
+    // Файлы без LSN сохранены без журнала: проигрывается весь журнал
+    const DataNode* meta = find_node_by_key_const(base, "metadata");
+    if (meta) db->lsn = node_to_lsn(find_node_by_key_const(meta, "lsn"));
+
     return db;
 }
@@ -11,7 +11,7 @@
 // ...
 
 // Конвертация структур автосервиса в AST
-DataNode* technical_maintenance_to_asf(const technical_maintenance* records, int count);
+DataNode* technical_maintenance_to_asf(const technical_maintenance* records, int64_t count);
 DataNode* database_to_asf(const data_base* db, const char* username);
 
 // Конвертация AST в структуры автосервиса
@@ -19,7 +19,7 @@ technical_maintenance* asf_to_technical_maintenance(const DataNode* node, int* c
 data_base* asf_to_database(const DataNode* root);
 
 // Создание метаданных для файла
-DataNode* create_metadata(const char* username, int record_count);
+DataNode* create_metadata(const char* username, int64_t record_count);
 
 // Поиск значения по ключу в объекте (возвращает именно значение, а не пару)
 DataNode* find_node_by_key(DataNode* object, const char* key);
@@ -0,0 +1,67 @@
+#include "data_source.h"
+#include "database_new.h"
+#include "container.h"
+
+static void set_name(data_source* src, const char* username) {
+    memset(src, 0, sizeof(*src));
+    strncpy(src->username, username ? username : "", sizeof(src->username) - 1);
+}
+
+void data_source_binary(data_source* src, const char* username) {
+    set_name(src, username);
+    src->kind = DATA_SOURCE_BINARY;
+    snprintf(src->filename, sizeof(src->filename), "data_%s.dat", src->username);
+}
+
+void data_source_select(data_source* src, const char* username, tenant_store* tenants) {
+    if (tenant_store_has(tenants, username)) {
+        set_name(src, username);
+        src->kind = DATA_SOURCE_TENANT;
+        src->tenants = tenants;
+        return;
+    }
+
+    set_name(src, username);
+    snprintf(src->filename, sizeof(src->filename), "data_%s.asf", src->username);
+    FILE* asf_file = fopen(src->filename, "r");
+    if (asf_file) {
+        fclose(asf_file);
+        src->kind = DATA_SOURCE_ASF;
+        return;
+    }
+    data_source_binary(src, username);
+}
+
+int data_source_load(const data_source* src, struct data_base* system) {
+    switch (src->kind) {
+        case DATA_SOURCE_TENANT:
+            return tenant_store_load(src->tenants, src->username, system);
+        case DATA_SOURCE_ASF:
+            load_from_asf(system, src->filename);
+            return 1;
+        default:
+            // Проверка CRC откладывается до изменения блоков: вход не читает весь файл
+            load_from_file_mapped(system, src->filename, LOAD_VERIFY_LAZY);
+            return 1;
+    }
+}
+
+int data_source_save(const data_source* src, struct data_base* system) {
+    switch (src->kind) {
+        case DATA_SOURCE_TENANT:
+            return tenant_store_save(src->tenants, src->username, system);
+        case DATA_SOURCE_ASF:
+            // В ASF надгробия не попадают: позиции в памяти должны совпасть
+            // с позициями после загрузки, на них ссылается журнал
+            db_compact(system);
+            return container_is_file(src->filename)
+                       ? save_to_asf_compressed(system, src->filename, src->username)
+                       : save_to_asf(system, src->filename, src->username);
+        default:
+            return save_to_file(system, src->filename);
+    }
+}
+
+const char* data_source_name(const data_source* src) {
+    return src->kind == DATA_SOURCE_TENANT ? TENANT_STORE_FILE : src->filename;
+}
@@ -0,0 +1,44 @@
+#ifndef DATA_SOURCE_H
+#define DATA_SOURCE_H
+
+#include "database.h"
+#include "tenant_store.h"
+
+// ============================================================================
+// Базовое хранилище данных пользователя - то, из чего загружается сессия и куда
+// сворачивается журнал изменений на контрольной точке. При входе выбирается
+// в порядке: общий файл TENANT_STORE_FILE (если в нем есть пользователь),
+// data_<логин>.asf, data_<логин>.dat. Сохранение в базовое хранилище записывает
+// в него LSN базы, поэтому следующий вход проигрывает поверх него только
+// изменения журнала после контрольной точки.
+// ============================================================================
+
+typedef enum {
+    DATA_SOURCE_BINARY = 0, // data_<логин>.dat (v2, сегменты, контейнер, поколоночный)
+    DATA_SOURCE_ASF,        // data_<логин>.asf (обычный или сжатый)
+    DATA_SOURCE_TENANT      // данные пользователя в общем файле
+} DataSourceKind;
+
+typedef struct data_source {
+    DataSourceKind kind;
+    char username[64];
+    char filename[260];    // DATA_SOURCE_BINARY / DATA_SOURCE_ASF
+    tenant_store* tenants; // DATA_SOURCE_TENANT; закрывает владелец
+} data_source;
+
+// Хранилище, которое загружается при входе (tenants может быть NULL)
+void data_source_select(data_source* src, const char* username, tenant_store* tenants);
+
+// Файл data_<логин>.dat независимо от наличия остальных
+void data_source_binary(data_source* src, const char* username);
+
+// Заменяет записи базы данными хранилища (db->lsn - LSN его контрольной точки)
+int data_source_load(const data_source* src, struct data_base* system);
+
+// Сохраняет базу (с уплотнением) в хранилище вместе с db->lsn
+int data_source_save(const data_source* src, struct data_base* system);
+
+// Имя для сообщений: файл или общий файл пользователей
+const char* data_source_name(const data_source* src);
+
+#endif // DATA_SOURCE_H
@@ -1,46 +1,443 @@
 #include "database.h"
+#include "db_index.h"
+#include "soa.h"
+#include "totals.h"
+#include "type_bitmap.h"
+#include "container.h"
+#include "file_io.h"
+#include "columnar.h"
+#include "crc32c.h"
+#include "parallel.h"
+#include "segment.h"
+#include "wal.h"
+#include "work_dict.h"
 
 // создание динамического массива
-void init_system(struct data_base* system, int capacity) {
-    system->records = malloc(capacity * sizeof(technical_maintenance));
+void init_system(struct data_base* system, int64_t capacity) {
+    system->records = malloc((size_t)capacity * sizeof(technical_maintenance));
     system->size = 0;
     system->capacity = capacity;
+    system->mapping = NULL;
+    system->mapping_size = 0;
+    system->wal = NULL;
+    system->lsn = 0;
+    system->dirty_pages = NULL;
+    system->dirty_bytes = 0;
+    system->dirty_all = 0;
+    system->synced_size = 0;
+    system->synced_file[0] = '\0';
+    system->lazy_crcs = NULL;
+    system->lazy_checked = NULL;
+    system->lazy_count = 0;
+    system->id_slots = NULL;
+    system->id_slot_count = 0;
+    system->id_index_ready = 0;
+    system->next_id = 1;
+    system->deleted = 0;
+    system->indexes = NULL;
+    system->soa = NULL;
+    system->totals = NULL;
+    system->type_bitmaps = NULL;
+}
+
+// ============================================================================
+// Отложенная проверка контрольных сумм
+// ============================================================================
+
+// Сверяет блоки first..last с таблицей CRC файла, пока записи еще совпадают с ним:
+// после изменения блок получит новую CRC, и повреждение стало бы незаметным.
+// Возвращает число поврежденных блоков.
+static size_t verify_lazy_blocks(struct data_base* system, size_t first, size_t last) {
+    if (!system->lazy_crcs || system->lazy_count <= 0) return 0;
+    size_t blocks = ((size_t)system->lazy_count + FILE_BLOCK_RECORDS - 1) / FILE_BLOCK_RECORDS;
+    if (last >= blocks) last = blocks - 1;
+
+    size_t damaged = 0;
+    for (size_t b = first; b <= last; b++) {
+        if ((system->lazy_checked[b / 8] >> (b % 8)) & 1) continue;
+        system->lazy_checked[b / 8] |= (uint8_t)(1u << (b % 8));
+        size_t from = b * FILE_BLOCK_RECORDS;
+        size_t to = from + FILE_BLOCK_RECORDS < (size_t)system->lazy_count ? from + FILE_BLOCK_RECORDS
+                                                                            : (size_t)system->lazy_count;
+        const technical_maintenance* data = system->records + from;
+        if (crc32c(0, data, (to - from) * sizeof(technical_maintenance)) == system->lazy_crcs[b]) continue;
+        if (damaged == 0) printf("Предупреждение: Контрольная сумма не совпадает!\n");
+        printf("  Повреждены записи %lu-%lu (блок %lu)\n", (unsigned long)from + 1, (unsigned long)to,
+               (unsigned long)b);
+        damaged++;
+    }
+    return damaged;
+}
+
+static void forget_lazy(struct data_base* system) {
+    free(system->lazy_checked);
+    system->lazy_crcs = NULL;
+    system->lazy_checked = NULL;
+    system->lazy_count = 0;
+}
+
+int db_verify_pending(struct data_base* system) {
+    if (!system->lazy_crcs) return 1;
+    size_t damaged = system->lazy_count > 0 ? verify_lazy_blocks(system, 0, (size_t)-1) : 0;
+    if (damaged > 0) printf("  Возможно повреждение данных\n");
+    forget_lazy(system);
+    return damaged == 0;
+}
+
+// ============================================================================
+// Битовая карта измененных страниц
+// ============================================================================
+
+// Отмечает страницы, содержащие записи first..last включительно
+static void mark_dirty(struct data_base* system, int64_t first, int64_t last) {
+    if (first > last) return;
+    if (system->lazy_crcs && first < system->lazy_count &&
+        verify_lazy_blocks(system, (size_t)first / FILE_BLOCK_RECORDS, (size_t)last / FILE_BLOCK_RECORDS) > 0) {
+        printf("  Возможно повреждение данных\n");
+    }
+    if (!system->synced_file[0] || system->dirty_all) return;
+
+    size_t last_page = (size_t)last / FILE_BLOCK_RECORDS;
+    size_t need = last_page / 8 + 1;
+    if (need > system->dirty_bytes) {
+        size_t bytes = system->dirty_bytes ? system->dirty_bytes : 16;
+        while (bytes < need) bytes *= 2;
+        uint8_t* pages = realloc(system->dirty_pages, bytes);
+        if (!pages) {
+            system->dirty_all = 1;
+            return;
+        }
+        memset(pages + system->dirty_bytes, 0, bytes - system->dirty_bytes);
+        system->dirty_pages = pages;
+        system->dirty_bytes = bytes;
+    }
+
+    for (size_t page = (size_t)first / FILE_BLOCK_RECORDS; page <= last_page; page++) {
+        system->dirty_pages[page / 8] |= (uint8_t)(1u << (page % 8));
+    }
+}
+
+static int page_is_dirty(const struct data_base* system, size_t page) {
+    if (page / 8 >= system->dirty_bytes) return 0;
+    return (system->dirty_pages[page / 8] >> (page % 8)) & 1;
+}
+
+// База совпадает с файлом filename (после загрузки или сохранения)
+void db_mark_synced(struct data_base* system, const char* filename) {
+    if (system->dirty_pages) memset(system->dirty_pages, 0, system->dirty_bytes);
+    system->dirty_all = 0;
+    system->synced_size = system->size;
+    strncpy(system->synced_file, filename ? filename : "", sizeof(system->synced_file) - 1);
+    system->synced_file[sizeof(system->synced_file) - 1] = '\0';
+}
+
+static void forget_sync(struct data_base* system) {
+    system->synced_file[0] = '\0';
+    system->dirty_all = 0;
+    if (system->dirty_pages) memset(system->dirty_pages, 0, system->dirty_bytes);
+}
+
+int db_range_dirty(const struct data_base* system, int64_t first, int64_t count) {
+    if (system->dirty_all || !system->synced_file[0]) return 1;
+    if (count <= 0) return 0;
+    size_t last_page = (size_t)(first + count - 1) / FILE_BLOCK_RECORDS;
+    for (size_t page = (size_t)first / FILE_BLOCK_RECORDS; page <= last_page; page++) {
+        if (page_is_dirty(system, page)) return 1;
+    }
+    return 0;
+}
+
+// Перенос записей из отображения файла в собственную память (copy-on-write)
+void db_detach_mapping(struct data_base* system, int64_t min_capacity) {
+    if (!system->mapping) return;
+    // Таблица CRC лежит в отображении: непроверенные блоки проверяются сейчас
+    db_verify_pending(system);
+
+    int64_t capacity = system->size > min_capacity ? system->size : min_capacity;
+    if (capacity < 10) capacity = 10;
+    technical_maintenance* copy = malloc((size_t)capacity * sizeof(technical_maintenance));
+    if (!copy) {
+        printf("Ошибка: недостаточно памяти для копирования базы\n");
+        return;
+    }
+    memcpy(copy, system->records, (size_t)system->size * sizeof(technical_maintenance));
+
+    file_unmap(system->mapping, system->mapping_size);
+    system->mapping = NULL;
+    system->mapping_size = 0;
+    system->records = copy;
+    system->capacity = capacity;
+}
+
+// Освобождение массива записей (куча или отображение файла)
+static void release_records(struct data_base* system) {
+    forget_lazy(system);
+    if (system->mapping) {
+        file_unmap(system->mapping, system->mapping_size);
+        system->mapping = NULL;
+        system->mapping_size = 0;
+    } else {
+        free(system->records);
+    }
+    system->records = NULL;
+    // Индексы относились к прежним записям
+    system->id_index_ready = 0;
+    system->deleted = 0;
+    db_index_invalidate(system);
+    soa_invalidate(system);
+    totals_invalidate(system);
+    type_bitmaps_invalidate(system);
+}
+
+// ============================================================================
+// Индекс id -> позиция
+// ============================================================================
+
+// Уплотнение в простое (db_compact_idle), когда надгробий не меньше четверти записей
+#define COMPACT_MIN_DELETED 64
+
+int record_is_deleted(const technical_maintenance* record) {
+    return (record->flags & RECORD_DELETED) != 0;
+}
+
+int64_t db_live_count(const struct data_base* system) {
+    return system->size - system->deleted;
+}
+
+static size_t id_hash(int32_t id, size_t slot_count) {
+    return (size_t)((uint32_t)id * 2654435761u) & (slot_count - 1);
+}
+
+// Ячейка с id или пустая ячейка, куда его можно вставить
+static size_t id_probe(const struct data_base* system, int32_t id) {
+    size_t mask = system->id_slot_count - 1;
+    size_t i = id_hash(id, system->id_slot_count);
+    while (system->id_slots[i] != 0 && system->records[system->id_slots[i] - 1].id != id) {
+        i = (i + 1) & mask;
+    }
+    return i;
+}
+
+// Таблица под count записей с заполнением не больше половины
+static int id_index_reserve(struct data_base* system, int64_t count) {
+    size_t need = 16;
+    while (need < (size_t)count * 2) need *= 2;
+    if (need <= system->id_slot_count) return 1;
+
+    int64_t* slots = calloc(need, sizeof(int64_t));
+    if (!slots) return 0;
+    int64_t* old = system->id_slots;
+    size_t old_count = system->id_slot_count;
+    system->id_slots = slots;
+    system->id_slot_count = need;
+    for (size_t i = 0; i < old_count; i++) {
+        if (old[i] != 0) system->id_slots[id_probe(system, system->records[old[i] - 1].id)] = old[i];
+    }
+    free(old);
+    return 1;
+}
+
+// Удаление из открытой адресации со сдвигом следующих ячеек цепочки назад
+static void id_index_remove(struct data_base* system, int32_t id) {
+    size_t mask = system->id_slot_count - 1;
+    size_t hole = id_probe(system, id);
+    if (system->id_slots[hole] == 0) return;
+    system->id_slots[hole] = 0;
+
+    for (size_t i = (hole + 1) & mask; system->id_slots[i] != 0; i = (i + 1) & mask) {
+        size_t home = id_hash(system->records[system->id_slots[i] - 1].id, system->id_slot_count);
+        // Ячейку можно сдвинуть в дыру, если ее место не лежит между дырой и ней
+        if (((i - home) & mask) >= ((i - hole) & mask)) {
+            system->id_slots[hole] = system->id_slots[i];
+            system->id_slots[i] = 0;
+            hole = i;
+        }
+    }
+}
+
+// Перестройка индекса по всем записям (после загрузки и уплотнения).
+// Повторяющиеся и неположительные id получают новые значения.
+static int ensure_id_index(struct data_base* system) {
+    if (system->id_index_ready) return 1;
+
+    free(system->id_slots);
+    system->id_slots = NULL;
+    system->id_slot_count = 0;
+    if (!id_index_reserve(system, system->size)) {
+        printf("Ошибка: недостаточно памяти для индекса записей\n");
+        return 0;
+    }
+
+    system->next_id = 1;
+    system->deleted = 0;
+    for (int64_t i = 0; i < system->size; i++) {
+        if (system->records[i].id >= system->next_id && system->records[i].id < INT32_MAX) {
+            system->next_id = system->records[i].id + 1;
+        }
+    }
+    for (int64_t i = 0; i < system->size; i++) {
+        technical_maintenance* r = &system->records[i];
+        if (record_is_deleted(r)) {
+            system->deleted++;
+            continue;
+        }
+        size_t slot = r->id > 0 ? id_probe(system, r->id) : 0;
+        if (r->id <= 0 || system->id_slots[slot] != 0) {
+            mark_dirty(system, i, i);
+            r->id = system->next_id++;
+            slot = id_probe(system, r->id);
+        }
+        system->id_slots[slot] = i + 1;
+    }
+    system->id_index_ready = 1;
+    return 1;
+}
+
+int64_t find_item(struct data_base* system, int32_t id) {
+    if (id <= 0 || !ensure_id_index(system)) return -1;
+    int64_t slot = system->id_slots[id_probe(system, id)];
+    return slot - 1;
 }
 
 // добавление записи
 void add_item(struct data_base* system, struct technical_maintenance record) {
+    if (!ensure_id_index(system) || !id_index_reserve(system, system->size + 1)) return;
+
+    // id выдается до записи в журнал, чтобы проигрывание дало тот же id
+    if (record.id <= 0 || system->id_slots[id_probe(system, record.id)] != 0) {
+        record.id = system->next_id;
+    }
+    if (record.id >= system->next_id && record.id < INT32_MAX) system->next_id = record.id + 1;
+    record.flags = 0;
+
+    if (system->wal) wal_append(system->wal, system, WAL_OP_ADD, system->size, &record);
+
+    // Отображение нельзя расширить: переносим записи в кучу
+    if (system->mapping && system->size >= system->capacity) {
+        db_detach_mapping(system, system->size * 2);
+    }
     if (system->size >= system->capacity) {
-        system->capacity *= 2;
-        system->records = realloc(system->records, system->capacity * sizeof(struct technical_maintenance));
+        system->capacity = system->capacity > 0 ? system->capacity * 2 : 10;
+        system->records = realloc(system->records, (size_t)system->capacity * sizeof(struct technical_maintenance));
     }
-    system->records[system->size++] = record;
+    mark_dirty(system, system->size, system->size);
+    system->records[system->size] = record;
+    system->id_slots[id_probe(system, record.id)] = system->size + 1;
+    db_index_on_add(system, system->size);
+    soa_on_write(system, system->size);
+    totals_on_add(system, &record);
+    type_bitmaps_on_add(system, system->size);
+    system->size++;
 }
 
-// удаление записи
-void delete_item(struct data_base* system, int index) {
-    if (index >= 0 && index < system->size) {
-        // смещаем элементы
-        for (int i = index; i < system->size - 1; i++) {
-            system->records[i] = system->records[i + 1];
-            // Обновляем ID
-            system->records[i].id = i + 1;
-        }
+// удаление записи: надгробие вместо сдвига, позиции остальных записей не меняются
+void delete_item(struct data_base* system, int64_t index) {
+    if (index < 0 || index >= system->size || !ensure_id_index(system)) return;
+    technical_maintenance* r = &system->records[index];
+    if (record_is_deleted(r)) return;
+
+    if (system->wal) wal_append(system->wal, system, WAL_OP_DELETE, index, NULL);
+    id_index_remove(system, r->id);
+    db_index_on_remove(system, index);
+    totals_on_remove(system, r);
+    type_bitmaps_on_remove(system, index);
+    mark_dirty(system, index, index);
+    r->flags |= RECORD_DELETED;
+    soa_on_write(system, index);
+    system->deleted++;
+
+    // Надгробия в конце массива просто отрезаются
+    while (system->size > 0 && record_is_deleted(&system->records[system->size - 1])) {
         system->size--;
+        system->deleted--;
     }
 }
 
 // изменение элемента
-void modify_item(struct data_base* system, int index, struct technical_maintenance new_item) {
-    if (index >= 0 && index < system->size) {
+void modify_item(struct data_base* system, int64_t index, struct technical_maintenance new_item) {
+    if (index >= 0 && index < system->size && !record_is_deleted(&system->records[index])) {
+        new_item.id = system->records[index].id;
+        new_item.flags = 0;
+        if (system->wal) wal_append(system->wal, system, WAL_OP_MODIFY, index, &new_item);
+        mark_dirty(system, index, index);
+        db_index_on_remove(system, index);
+        totals_on_remove(system, &system->records[index]);
+        type_bitmaps_on_remove(system, index);
         system->records[index] = new_item;
+        db_index_on_add(system, index);
+        soa_on_write(system, index);
+        totals_on_add(system, &new_item);
+        type_bitmaps_on_add(system, index);
+    }
+}
+
+int delete_item_by_id(struct data_base* system, int32_t id) {
+    int64_t index = find_item(system, id);
+    if (index < 0) return 0;
+    delete_item(system, index);
+    return 1;
+}
+
+int modify_item_by_id(struct data_base* system, int32_t id, struct technical_maintenance new_item) {
+    int64_t index = find_item(system, id);
+    if (index < 0) return 0;
+    modify_item(system, index, new_item);
+    return 1;
+}
+
+// Уплотнение: живые записи сдвигаются к началу одним проходом, индекс перестраивается.
+// Детерминировано и пишется в журнал, поэтому при проигрывании позиции совпадают с исходными.
+void db_compact(struct data_base* system) {
+    if (system->deleted == 0) return;
+    if (system->wal) wal_append(system->wal, system, WAL_OP_COMPACT, 0, NULL);
+
+    int64_t first = 0;
+    while (first < system->size && !record_is_deleted(&system->records[first])) first++;
+    mark_dirty(system, first, system->size - 1);
+
+    int64_t out = first;
+    for (int64_t i = first; i < system->size; i++) {
+        if (!record_is_deleted(&system->records[i])) system->records[out++] = system->records[i];
     }
+    system->size = out;
+    system->deleted = 0;
+    system->id_index_ready = 0;
+    ensure_id_index(system);
+    db_index_invalidate(system);
+    soa_invalidate(system);
+    type_bitmaps_invalidate(system);
+}
+
+int db_compact_idle(struct data_base* system) {
+    if (system->deleted < COMPACT_MIN_DELETED || system->deleted * 4 < system->size) return 0;
+    db_compact(system);
+    return 1;
+}
+
+void db_adopt_records(struct data_base* system, technical_maintenance* records, int64_t count, int64_t capacity) {
+    release_records(system);
+    system->records = records;
+    system->size = count;
+    system->capacity = capacity;
+    forget_sync(system);
 }
 
 // освобождение памяти
 void free_system(struct data_base* system) {
-    free(system->records);
+    release_records(system);
     system->size = 0;
     system->capacity = 0;
+    free(system->dirty_pages);
+    system->dirty_pages = NULL;
+    system->dirty_bytes = 0;
+    free(system->id_slots);
+    system->id_slots = NULL;
+    system->id_slot_count = 0;
+    db_index_disable(system);
+    soa_disable(system);
+    totals_disable(system);
+    type_bitmaps_disable(system);
+    forget_sync(system);
 }
 
 //проверка коректного ввода пробега
@@ -52,35 +449,385 @@ int validate_mileage(int mileage){
     }
 }
 
+// Разбор "дд.мм.гггг" по цифрам (без sscanf): 1, если формат верный
+static int parse_date(const char* date, int* day, int* month, int* year) {
+    static const int digits[] = { 0, 1, 3, 4, 6, 7, 8, 9 };
+    if (!date || date[2] != '.' || date[5] != '.' || date[10] != '\0') return 0;
+    for (size_t i = 0; i < sizeof(digits) / sizeof(digits[0]); i++) {
+        if (date[digits[i]] < '0' || date[digits[i]] > '9') return 0;
+    }
+    *day = (date[0] - '0') * 10 + (date[1] - '0');
+    *month = (date[3] - '0') * 10 + (date[4] - '0');
+    *year = (date[6] - '0') * 1000 + (date[7] - '0') * 100 + (date[8] - '0') * 10 + (date[9] - '0');
+    return *day >= 1 && *day <= 31 && *month >= 1 && *month <= 12;
+}
+
 //проверка корректного ввода даты
 int validate_date(const char* date) {
-    if (strlen(date) != 10) return 0;
-    if (date[2] != '.' || date[5] != '.') return 0;  
     int day, month, year;
-    if (sscanf(date, "%2d.%2d.%4d", &day, &month, &year) != 3) return 0;   
-    if (day < 1 || day > 31) return 0;
-    if (month < 1 || month > 12) return 0;
+    if (strlen(date) != 10 || !parse_date(date, &day, &month, &year)) return 0;
     if (year < 2000 || year > 2100) return 0;
     
     return 1;
 }
 
-// Расчет контрольной суммы
-unsigned int calculate_checksum(struct data_base* system) {
+// Дата "дд.мм.гггг" -> номер дня от 01.01.1970 (пролептический григорианский календарь)
+int date_to_days(const char* date, int32_t* out_days) {
+    int day, month, year;
+    if (!date || strlen(date) != 10 || !parse_date(date, &day, &month, &year)) return 0;
+
+    int y = month <= 2 ? year - 1 : year;
+    int era = (y >= 0 ? y : y - 399) / 400;
+    int yoe = y - era * 400;
+    int doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    int doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    *out_days = (int32_t)(era * 146097 + doe - 719468);
+    return 1;
+}
+
+// Номер дня -> "дд.мм.гггг" (буфер не меньше 11 байт)
+void days_to_ymd(int32_t days, int* year, int* month, int* day) {
+    int z = days + 719468;
+    int era = (z >= 0 ? z : z - 146096) / 146097;
+    int doe = z - era * 146097;
+    int yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    int doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    int mp = (5 * doy + 2) / 153;
+    *day = doy - (153 * mp + 2) / 5 + 1;
+    *month = mp < 10 ? mp + 3 : mp - 9;
+    *year = yoe + era * 400 + (*month <= 2);
+}
+
+void days_to_date(int32_t days, char* out) {
+    if (days == DATE_NONE) {
+        out[0] = '\0';
+        return;
+    }
+    int year, month, day;
+    days_to_ymd(days, &year, &month, &day);
+    snprintf(out, 11, "%02u.%02u.%04u", (unsigned)day % 100u, (unsigned)month % 100u, (unsigned)year % 10000u);
+}
+
+int32_t date_month(int32_t days) {
+    if (days == DATE_NONE) return 0;
+    int year, month, day;
+    days_to_ymd(days, &year, &month, &day);
+    return year * 100 + month;
+}
+
+// ============================================================================
+// Тип работы: id в общем словаре
+// ============================================================================
+
+const char* record_type_work(const technical_maintenance* record) {
+    const char* s = work_dict_get(work_dict_shared(), record->type_id);
+    return s ? s : "";
+}
+
+int record_set_type_work(technical_maintenance* record, const char* type_work) {
+    record->type_id = work_dict_intern(work_dict_shared(), type_work ? type_work : "");
+    return record->type_id != WORK_DICT_NONE;
+}
+
+void record_to_wide(const technical_maintenance* record, wide_record* out) {
+    memset(out, 0, sizeof(*out));
+    out->id = record->id;
+    days_to_date(record->date, out->date);
+    strncpy(out->type_work, record_type_work(record), sizeof(out->type_work) - 1);
+    out->mileage = record->mileage;
+    out->price = record->price;
+}
+
+void record_from_wide(const wide_record* wide, technical_maintenance* out) {
+    char type_work[sizeof(wide->type_work) + 1];
+    memcpy(type_work, wide->type_work, sizeof(wide->type_work));
+    type_work[sizeof(wide->type_work)] = '\0';
+
+    char date[sizeof(wide->date) + 1];
+    memcpy(date, wide->date, sizeof(wide->date));
+    date[sizeof(wide->date)] = '\0';
+
+    memset(out, 0, sizeof(*out));
+    out->id = wide->id;
+    if (!date_to_days(date, &out->date)) out->date = DATE_NONE;
+    record_set_type_work(out, type_work);
+    out->mileage = wide->mileage;
+    out->price = wide->price;
+}
+
+void records_remap_types(technical_maintenance* records, size_t count,
+                         const uint32_t* remap, uint32_t remap_count) {
+    for (size_t i = 0; i < count; i++) {
+        uint32_t id = records[i].type_id;
+        records[i].type_id = id < remap_count ? remap[id] : WORK_DICT_NONE;
+    }
+}
+
+static int remap_is_identity(const uint32_t* remap, uint32_t remap_count) {
+    for (uint32_t i = 0; i < remap_count; i++) {
+        if (remap[i] != i) return 0;
+    }
+    return 1;
+}
+
+// Контрольная сумма произвольного буфера (циклический сдвиг + XOR)
+unsigned int checksum_buffer(const void* data, size_t data_size) {
+    const unsigned char* bytes = (const unsigned char*)data;
     unsigned int checksum = 0;
-    unsigned char* data = (unsigned char*)system->records;
-    size_t data_size = system->size * sizeof(technical_maintenance);
-    
     for (size_t i = 0; i < data_size; i++) {
-        checksum = (checksum << 3) ^ data[i] ^ (checksum >> 29);
+        checksum = (checksum << 3) ^ bytes[i] ^ (checksum >> 29);
     }
+    return checksum;
+}
+
+// Побайтовая контрольная сумма (формат v1 и v2)
+static unsigned int checksum_bytes(const unsigned char* data, size_t data_size, unsigned int count) {
+    unsigned int checksum = checksum_buffer(data, data_size);
     
     // Добавляем размер в контрольную сумму
-    checksum ^= system->size;
+    checksum ^= count;
     
     return checksum;
 }
 
+// ============================================================================
+// Порядок байтов: формат v2 всегда little-endian
+// ============================================================================
+
+static int host_is_little_endian(void) {
+    const uint16_t probe = 1;
+    return *(const unsigned char*)&probe == 1;
+}
+
+static uint32_t swap32(uint32_t v) {
+    return (v >> 24) | ((v >> 8) & 0xFF00u) | ((v << 8) & 0xFF0000u) | (v << 24);
+}
+
+static uint64_t swap64(uint64_t v) {
+    return ((uint64_t)swap32((uint32_t)v) << 32) | swap32((uint32_t)(v >> 32));
+}
+
+// На big-endian хосте переставляет байты числовых полей записей
+static void records_to_little_endian(technical_maintenance* records, int64_t count) {
+    if (host_is_little_endian()) return;
+    for (int64_t i = 0; i < count; i++) {
+        uint32_t price_bits;
+        records[i].id = (int32_t)swap32((uint32_t)records[i].id);
+        records[i].date = (int32_t)swap32((uint32_t)records[i].date);
+        records[i].type_id = swap32(records[i].type_id);
+        records[i].mileage = (int32_t)swap32((uint32_t)records[i].mileage);
+        memcpy(&price_bits, &records[i].price, sizeof(price_bits));
+        price_bits = swap32(price_bits);
+        memcpy(&records[i].price, &price_bits, sizeof(price_bits));
+    }
+}
+
+// Запись в раскладке RECORD_LAYOUT_WIDE (или 124 байта v1) из дискового представления
+static void record_from_disk_wide(const unsigned char* src, size_t size, technical_maintenance* out) {
+    wide_record wide;
+    memset(&wide, 0, sizeof(wide));
+    memcpy(&wide, src, size);
+    if (!host_is_little_endian()) {
+        uint32_t price_bits;
+        wide.id = (int32_t)swap32((uint32_t)wide.id);
+        wide.mileage = (int32_t)swap32((uint32_t)wide.mileage);
+        memcpy(&price_bits, &wide.price, sizeof(price_bits));
+        price_bits = swap32(price_bits);
+        memcpy(&wide.price, &price_bits, sizeof(price_bits));
+    }
+    record_from_wide(&wide, out);
+}
+
+// Раскладка RECORD_LAYOUT_TEXT_DATE: type_id уже в записи, дата строкой
+typedef struct text_date_record {
+    int32_t id;
+    char date[11];
+    char pad0;
+    uint32_t type_id;
+    int32_t mileage;
+    float price;
+    uint32_t reserved;
+} text_date_record;
+
+typedef char text_date_record_size_check[sizeof(text_date_record) == 32 ? 1 : -1];
+
+// Размер записи в раскладке layout (0 - неизвестная раскладка)
+static uint32_t layout_record_size(uint32_t layout) {
+    switch (layout) {
+        case RECORD_LAYOUT:           return sizeof(technical_maintenance);
+        case RECORD_LAYOUT_TEXT_DATE: return sizeof(text_date_record);
+        case RECORD_LAYOUT_WIDE:      return sizeof(wide_record);
+        default:                      return 0;
+    }
+}
+
+// Записи файла в раскладке layout -> technical_maintenance.
+// WIDE дописывает строки type_work в общий словарь (только из одного потока);
+// в остальных раскладках type_id остаются номерами словаря файла.
+static void records_from_disk(uint32_t layout, const unsigned char* src, size_t count,
+                              technical_maintenance* dest) {
+    if (layout == RECORD_LAYOUT) {
+        memcpy(dest, src, count * sizeof(technical_maintenance));
+        records_to_little_endian(dest, (int64_t)count);
+        return;
+    }
+    for (size_t i = 0; i < count; i++) {
+        if (layout == RECORD_LAYOUT_WIDE) {
+            record_from_disk_wide(src + i * sizeof(wide_record), sizeof(wide_record), &dest[i]);
+            continue;
+        }
+        text_date_record old;
+        memcpy(&old, src + i * sizeof(old), sizeof(old));
+        old.date[sizeof(old.date) - 1] = '\0';
+        technical_maintenance* r = &dest[i];
+        memset(r, 0, sizeof(*r));
+        r->id = old.id;
+        r->type_id = old.type_id;
+        r->mileage = old.mileage;
+        r->price = old.price;
+        records_to_little_endian(r, 1);
+        if (!date_to_days(old.date, &r->date)) r->date = DATE_NONE;
+    }
+}
+
+static void header_to_little_endian(file_header_v2* header) {
+    if (host_is_little_endian()) return;
+    uint32_t* words[] = { &header->magic, &header->version, &header->record_size,
+                          &header->record_layout, &header->flags, &header->checksum,
+                          &header->block_records, &header->block_capacity };
+    for (size_t i = 0; i < sizeof(words) / sizeof(words[0]); i++) {
+        *words[i] = swap32(*words[i]);
+    }
+    header->record_count = swap64(header->record_count);
+    header->data_offset = swap64(header->data_offset);
+    header->checkpoint_lsn = swap64(header->checkpoint_lsn);
+    header->zone_checksum = swap32(header->zone_checksum);
+}
+
+// ============================================================================
+// Контрольные суммы блоков (CRC32C)
+// ============================================================================
+
+static size_t block_count_for(size_t count) {
+    return (count + FILE_BLOCK_RECORDS - 1) / FILE_BLOCK_RECORDS;
+}
+
+// Таблица сводок лежит сразу за таблицей CRC той же емкости
+static uint64_t zone_table_offset(uint32_t block_capacity) {
+    return sizeof(file_header_v2) + (uint64_t)block_capacity * sizeof(uint32_t);
+}
+
+static uint32_t load_le32(const void* p) {
+    const unsigned char* b = (const unsigned char*)p;
+    return (uint32_t)b[0] | ((uint32_t)b[1] << 8) | ((uint32_t)b[2] << 16) | ((uint32_t)b[3] << 24);
+}
+
+// min/max дат, пробега и цены по записям в дисковом представлении
+static void compute_zone(const unsigned char* records, size_t n, block_zone* zone) {
+    zone->date_min = INT32_MAX;
+    zone->date_max = INT32_MIN;
+    zone->mileage_min = INT32_MAX;
+    zone->mileage_max = INT32_MIN;
+    zone->price_min = 1.0f;
+    zone->price_max = 0.0f;
+    for (size_t i = 0; i < n; i++) {
+        const technical_maintenance* r = (const technical_maintenance*)(records + i * sizeof(technical_maintenance));
+        int32_t days = (int32_t)load_le32(&r->date);
+        if (days != DATE_NONE) {
+            if (days < zone->date_min) zone->date_min = days;
+            if (days > zone->date_max) zone->date_max = days;
+        }
+        int32_t mileage = (int32_t)load_le32(&r->mileage);
+        if (mileage < zone->mileage_min) zone->mileage_min = mileage;
+        if (mileage > zone->mileage_max) zone->mileage_max = mileage;
+        uint32_t price_bits = load_le32(&r->price);
+        float price;
+        memcpy(&price, &price_bits, sizeof(price));
+        if (i == 0 || price < zone->price_min) zone->price_min = price;
+        if (i == 0 || price > zone->price_max) zone->price_max = price;
+    }
+}
+
+typedef struct {
+    const unsigned char* records; // записи в том виде, в каком они лежат на диске
+    size_t count;
+    size_t record_size;
+    uint32_t* table;
+    block_zone* zones; // NULL - сводки не нужны (только для текущей раскладки)
+} BlockCrcJob;
+
+static void crc_block(void* ctx, size_t block) {
+    BlockCrcJob* job = (BlockCrcJob*)ctx;
+    size_t first = block * FILE_BLOCK_RECORDS;
+    size_t n = job->count - first < FILE_BLOCK_RECORDS ? job->count - first : FILE_BLOCK_RECORDS;
+    const unsigned char* data = job->records + first * job->record_size;
+    job->table[block] = crc32c(0, data, n * job->record_size);
+    if (job->zones) compute_zone(data, n, &job->zones[block]);
+}
+
+// Заполняет table[block_count_for(count)] и, если zones != NULL, сводки блоков;
+// при parallel == 0 - в текущем потоке (для сегментов, которые уже обрабатываются параллельно)
+static void compute_blocks(const unsigned char* records, size_t count, size_t record_size,
+                           uint32_t* table, block_zone* zones, int parallel) {
+    BlockCrcJob job;
+    job.records = records;
+    job.count = count;
+    job.record_size = record_size;
+    job.table = table;
+    job.zones = zones;
+    crc32c_init();
+    if (parallel) {
+        parallel_for(block_count_for(count), crc_block, &job);
+    } else {
+        for (size_t b = 0; b < block_count_for(count); b++) crc_block(&job, b);
+    }
+}
+
+static void compute_block_crcs(const unsigned char* records, size_t count, uint32_t* table, int parallel) {
+    compute_blocks(records, count, sizeof(technical_maintenance), table, NULL, parallel);
+}
+
+// Таблица сводок хранится в little-endian
+static void zones_to_little_endian(block_zone* zones, size_t blocks) {
+    if (host_is_little_endian()) return;
+    for (size_t b = 0; b < blocks; b++) {
+        uint32_t* words = (uint32_t*)&zones[b];
+        for (size_t w = 0; w < sizeof(block_zone) / sizeof(uint32_t); w++) words[w] = swap32(words[w]);
+    }
+}
+
+// Продолжение суммы числом записей в little-endian, как оно лежит в заголовке
+static uint32_t checksum_count(uint32_t crc, uint64_t count) {
+    uint64_t disk = host_is_little_endian() ? count : swap64(count);
+    return crc32c(crc, &disk, sizeof(disk));
+}
+
+// Итоговая сумма заголовка: CRC таблицы блоков, продолженный числом записей.
+// Обе части хешируются в little-endian - сумма не зависит от порядка байтов машины
+static uint32_t combine_checksum(const uint32_t* table, size_t blocks, uint64_t count) {
+    uint32_t crc = 0;
+    if (host_is_little_endian()) {
+        crc = crc32c(0, table, blocks * sizeof(uint32_t));
+    } else {
+        for (size_t b = 0; b < blocks; b++) {
+            uint32_t disk = swap32(table[b]);
+            crc = crc32c(crc, &disk, sizeof(disk));
+        }
+    }
+    return checksum_count(crc, count);
+}
+
+// Расчет контрольной суммы
+unsigned int calculate_checksum(struct data_base* system) {
+    size_t blocks = block_count_for((size_t)system->size);
+    uint32_t* table = malloc((blocks ? blocks : 1) * sizeof(uint32_t));
+    if (!table) return 0;
+    compute_block_crcs((const unsigned char*)system->records, (size_t)system->size, table, 1);
+    unsigned int checksum = combine_checksum(table, blocks, (uint64_t)system->size);
+    free(table);
+    return checksum;
+}
+
 // Валидация заголовка файла
 int validate_file_header(struct file_header* header) {
     if (header->magic != FILE_MAGIC) {
@@ -88,108 +835,1045 @@ int validate_file_header(struct file_header* header) {
         return 0;
     }
     
+    if (header->version != FILE_VERSION_LEGACY) {
+        printf("Ошибка: Несовместимая версия файла (%u, ожидается %u)\n", 
+               header->version, FILE_VERSION_LEGACY);
+        return 0;
+    }
+    
+    // Число записей сверяется с размером файла при загрузке
+    return 1;
+}
+
+// Валидация заголовка формата v2 относительно фактического размера файла
+int validate_file_header_v2(const struct file_header_v2* header, size_t file_size) {
+    if (header->magic != FILE_MAGIC) {
+        printf("Ошибка: Неверный формат файла (магическое число)\n");
+        return 0;
+    }
+    
     if (header->version != FILE_VERSION) {
         printf("Ошибка: Несовместимая версия файла (%u, ожидается %u)\n", 
                header->version, FILE_VERSION);
         return 0;
     }
     
-    if (header->record_count > 100000) { // Разумный лимит
-        printf("Ошибка: Некорректное количество записей: %u\n", header->record_count);
+    uint32_t layout_size = layout_record_size(header->record_layout);
+    if (layout_size == 0 || header->record_size != layout_size) {
+        printf("Ошибка: Неизвестная раскладка записей (%u байт, версия %u)\n",
+               header->record_size, header->record_layout);
+        return 0;
+    }
+    
+    if (header->flags & FILE_FLAG_BLOCK_CRC) {
+        if (header->block_records != FILE_BLOCK_RECORDS ||
+            header->block_capacity < block_count_for((size_t)header->record_count) ||
+            sizeof(file_header_v2) + (uint64_t)header->block_capacity * sizeof(uint32_t) > header->data_offset) {
+            printf("Ошибка: Повреждена таблица контрольных сумм блоков\n");
+            return 0;
+        }
+    }
+    
+    if (header->flags & FILE_FLAG_ZONE_MAPS) {
+        if (!(header->flags & FILE_FLAG_BLOCK_CRC) ||
+            zone_table_offset(header->block_capacity) +
+            (uint64_t)header->block_capacity * sizeof(block_zone) > header->data_offset) {
+            printf("Ошибка: Повреждена таблица сводок блоков\n");
+            return 0;
+        }
+    }
+    
+    if (header->data_offset < sizeof(file_header_v2) || header->data_offset % 8 != 0 ||
+        header->data_offset > file_size ||
+        header->record_count > (file_size - header->data_offset) / header->record_size ||
+        header->record_count > (uint64_t)INT64_MAX / header->record_size) {
+        printf("Ошибка: Некорректное количество записей: %llu\n",
+               (unsigned long long)header->record_count);
         return 0;
     }
     
     return 1;
 }
 
-// Сохранение в бинарный файл с заголовком
-void save_to_file(struct data_base* system, const char* filename) {
-    FILE* file = fopen(filename, "wb");
-    if (!file) {
-        printf("Ошибка открытия файла для записи: %s\n", filename);
-        return;
+// ============================================================================
+// Образ файла v2 в памяти
+// ============================================================================
+
+// Емкость таблицы блоков берется с запасом (степень двойки),
+// чтобы рост базы не сдвигал начало записей при каждом сохранении
+static uint32_t block_capacity_for(size_t count) {
+    size_t blocks = block_count_for(count);
+    uint32_t capacity = 16;
+    while (capacity < blocks) capacity *= 2;
+    return capacity;
+}
+
+static size_t data_offset_for(size_t count) {
+    size_t end = (size_t)zone_table_offset(block_capacity_for(count)) +
+                 (size_t)block_capacity_for(count) * sizeof(block_zone);
+    return (end + FILE_DATA_OFFSET - 1) / FILE_DATA_OFFSET * FILE_DATA_OFFSET;
+}
+
+// Словарь type_work для конца файла: file_dict_header + work_dict_serialize
+static unsigned char* build_dict_tail(size_t* out_size) {
+    size_t dict_size = 0;
+    unsigned char* dict = work_dict_serialize(work_dict_shared(), &dict_size);
+    if (!dict) return NULL;
+
+    unsigned char* tail = malloc(sizeof(file_dict_header) + dict_size);
+    if (!tail) {
+        free(dict);
+        return NULL;
     }
-    file_header header;
-    header.magic = FILE_MAGIC;
-    header.version = FILE_VERSION;
-    header.record_count = system->size;
-    header.checksum = calculate_checksum(system);
-    
-    if (fwrite(&header, sizeof(file_header), 1, file) != 1) {
-        printf("Ошибка записи заголовка файла\n");
-        fclose(file);
-        return;
+
+    file_dict_header header;
+    memset(&header, 0, sizeof(header));
+    header.magic = FILE_DICT_MAGIC;
+    header.size = (uint32_t)dict_size;
+    header.checksum = crc32c(0, dict, dict_size);
+    memcpy(tail, &header, sizeof(header));
+    memcpy(tail + sizeof(header), dict, dict_size);
+    free(dict);
+
+    *out_size = sizeof(header) + dict_size;
+    return tail;
+}
+
+// Заголовок v2 текущей раскладки без контрольных сумм (в порядке байтов хоста)
+static void fill_header_v2(file_header_v2* header, size_t count, uint64_t lsn, int with_dict) {
+    memset(header, 0, sizeof(*header));
+    header->magic = FILE_MAGIC;
+    header->version = FILE_VERSION;
+    header->record_count = (uint64_t)count;
+    header->record_size = sizeof(technical_maintenance);
+    header->record_layout = RECORD_LAYOUT;
+    header->data_offset = data_offset_for(count);
+    header->flags = FILE_FLAG_BLOCK_CRC | FILE_FLAG_ZONE_MAPS | (with_dict ? FILE_FLAG_WORK_DICT : 0);
+    header->block_records = FILE_BLOCK_RECORDS;
+    header->block_capacity = block_capacity_for(count);
+    header->checkpoint_lsn = lsn;
+}
+
+// Заголовок v2, таблица CRC блоков и таблица сводок (все, что лежит до первой записи).
+// records - записи в дисковом (little-endian) представлении.
+// with_dict - за записями будет записан словарь type_work (build_dict_tail).
+static unsigned char* build_prefix_v2(const unsigned char* records, size_t count, uint64_t lsn,
+                                      int parallel, int with_dict, size_t* out_size) {
+    size_t offset = data_offset_for(count);
+    size_t blocks = block_count_for(count);
+    unsigned char* prefix = calloc(1, offset);
+    if (!prefix) return NULL;
+
+    uint32_t* table = (uint32_t*)(prefix + sizeof(file_header_v2));
+    block_zone* zones = (block_zone*)(prefix + zone_table_offset(block_capacity_for(count)));
+    compute_blocks(records, count, sizeof(technical_maintenance), table, zones, parallel);
+
+    file_header_v2 header;
+    fill_header_v2(&header, count, lsn, with_dict);
+    header.checksum = combine_checksum(table, blocks, header.record_count);
+
+    if (!host_is_little_endian()) {
+        for (size_t b = 0; b < blocks; b++) table[b] = swap32(table[b]);
     }
-    
-    for (int i = 0; i < system->size; i++) {
-        if (fwrite(&system->records[i], sizeof(technical_maintenance), 1, file) != 1) {
-            printf("Ошибка записи записи %d\n", i);
-            break;
+    zones_to_little_endian(zones, blocks);
+    header.zone_checksum = crc32c(0, zones, blocks * sizeof(block_zone));
+    header_to_little_endian(&header);
+    memcpy(prefix, &header, sizeof(header));
+
+    *out_size = offset;
+    return prefix;
+}
+
+// Заголовок + записи (+ словарь) одним буфером в little-endian (для контейнера и big-endian хостов)
+static unsigned char* build_image_v2(const technical_maintenance* records, size_t count, uint64_t lsn,
+                                     int parallel, int with_dict, size_t* out_size) {
+    size_t records_size = count * sizeof(technical_maintenance);
+    size_t offset = data_offset_for(count);
+    size_t tail_size = 0;
+    unsigned char* tail = with_dict ? build_dict_tail(&tail_size) : NULL;
+    unsigned char* image = malloc(offset + records_size + tail_size);
+    if (!image || (with_dict && !tail)) {
+        free(image);
+        free(tail);
+        return NULL;
+    }
+
+    memcpy(image + offset, records, records_size);
+    records_to_little_endian((technical_maintenance*)(image + offset), (int64_t)count);
+    if (tail) memcpy(image + offset + records_size, tail, tail_size);
+    free(tail);
+
+    size_t prefix_size = 0;
+    unsigned char* prefix = build_prefix_v2(image + offset, count, lsn, parallel, with_dict, &prefix_size);
+    if (!prefix) {
+        free(image);
+        return NULL;
+    }
+    memcpy(image, prefix, prefix_size);
+    free(prefix);
+
+    *out_size = offset + records_size + tail_size;
+    return image;
+}
+
+// ============================================================================
+// Инкрементальное сохранение
+// ============================================================================
+
+// Перезаписывает на месте только измененные страницы файла v2, с которым база
+// была синхронизирована, пересчитывает их CRC и сводки и обновляет заголовок.
+// Обновление на месте не атомарно: страницы, таблицы и словарь сбрасываются на диск
+// до записи заголовка, заголовок - до возврата, но сбой посреди записи страниц
+// оставляет файл, который отвергнет полная проверка при загрузке.
+// Возвращает 1, если файл обновлен (или изменений не было), 0 - нужна полная перезапись.
+static int save_incremental(struct data_base* system, const char* filename) {
+    if (!host_is_little_endian() || system->dirty_all || !system->synced_file[0] ||
+        strcmp(system->synced_file, filename) != 0) {
+        return 0;
+    }
+
+    file_rw* f = file_open_rw(filename);
+    if (!f) return 0;
+
+    file_header_v2 header;
+    size_t count = (size_t)system->size;
+    size_t old_count = (size_t)system->synced_size;
+    size_t blocks = block_count_for(count);
+    size_t old_blocks = block_count_for(old_count);
+    if (!file_pread(f, &header, sizeof(header), 0) ||
+        header.magic != FILE_MAGIC || header.version != FILE_VERSION ||
+        !(header.flags & FILE_FLAG_BLOCK_CRC) || !(header.flags & FILE_FLAG_ZONE_MAPS) ||
+        !(header.flags & FILE_FLAG_WORK_DICT) ||
+        header.record_size != sizeof(technical_maintenance) ||
+        header.record_layout != RECORD_LAYOUT ||
+        header.block_records != FILE_BLOCK_RECORDS ||
+        header.record_count != (uint64_t)old_count ||
+        blocks > header.block_capacity) {
+        file_close_rw(f);
+        return 0;
+    }
+
+    // Словарь лежит за последней записью и переписывается целиком (он мал)
+    uint64_t old_end = header.data_offset + (uint64_t)old_count * sizeof(technical_maintenance);
+    uint64_t new_end = header.data_offset + (uint64_t)count * sizeof(technical_maintenance);
+    file_dict_header old_dict, new_dict;
+    size_t tail_size = 0;
+    unsigned char* tail = build_dict_tail(&tail_size);
+    if (!tail || !file_pread(f, &old_dict, sizeof(old_dict), old_end) || old_dict.magic != FILE_DICT_MAGIC) {
+        free(tail);
+        file_close_rw(f);
+        return 0;
+    }
+    memcpy(&new_dict, tail, sizeof(new_dict));
+    int dict_changed = old_dict.size != new_dict.size || old_dict.checksum != new_dict.checksum;
+
+    // Страница, на которой меняется число записей, перезаписывается всегда
+    size_t tail_page = count != old_count && blocks > 0 ? blocks - 1 : (size_t)-1;
+    size_t dirty = 0;
+    for (size_t page = 0; page < blocks; page++) {
+        if (page_is_dirty(system, page) || page >= old_blocks || page == tail_page) dirty++;
+    }
+
+    if (dirty == 0 && count == old_count && header.checkpoint_lsn == system->lsn && !dict_changed) {
+        free(tail);
+        file_close_rw(f);
+        printf("Изменений нет, файл не перезаписан: %s\n", filename);
+        return 1;
+    }
+
+    // Частное отображение не должно видеть страницы, которые мы перезаписываем
+    db_detach_mapping(system, system->capacity);
+
+    uint32_t* table = malloc((blocks ? blocks : 1) * sizeof(uint32_t));
+    block_zone* zones = malloc((blocks ? blocks : 1) * sizeof(block_zone));
+    uint64_t zones_at = zone_table_offset(header.block_capacity);
+    size_t kept = blocks < old_blocks ? blocks : old_blocks;
+    int ok = table && zones;
+    if (ok && kept > 0) {
+        ok = file_pread(f, table, kept * sizeof(uint32_t), sizeof(file_header_v2)) &&
+             file_pread(f, zones, kept * sizeof(block_zone), zones_at);
+    }
+
+    BlockCrcJob job;
+    job.records = (const unsigned char*)system->records;
+    job.count = count;
+    job.record_size = sizeof(technical_maintenance);
+    job.table = table;
+    job.zones = zones;
+    crc32c_init();
+
+    // Соседние измененные страницы пишутся одним вызовом
+    size_t page = 0;
+    while (ok && page < blocks) {
+        if (!page_is_dirty(system, page) && page < old_blocks && page != tail_page) {
+            page++;
+            continue;
         }
+        size_t end = page;
+        while (end < blocks && (page_is_dirty(system, end) || end >= old_blocks || end == tail_page)) {
+            crc_block(&job, end);
+            end++;
+        }
+        size_t first = page * FILE_BLOCK_RECORDS;
+        size_t last = end * FILE_BLOCK_RECORDS < count ? end * FILE_BLOCK_RECORDS : count;
+        ok = file_pwrite(f, system->records + first, (last - first) * sizeof(technical_maintenance),
+                         header.data_offset + (uint64_t)first * sizeof(technical_maintenance));
+        page = end;
     }
-    
-    fclose(file);
+
+    if (ok) ok = file_pwrite(f, tail, tail_size, new_end);
+
+    if (ok) {
+        header.record_count = (uint64_t)count;
+        header.checksum = combine_checksum(table, blocks, header.record_count);
+        header.checkpoint_lsn = system->lsn;
+        header.zone_checksum = crc32c(0, zones, blocks * sizeof(block_zone));
+        // Заголовок ссылается на страницы и таблицы: он уходит на диск только после них
+        ok = (blocks == 0 || (file_pwrite(f, table, blocks * sizeof(uint32_t), sizeof(file_header_v2)) &&
+                              file_pwrite(f, zones, blocks * sizeof(block_zone), zones_at))) &&
+             file_rw_sync(f) &&
+             file_pwrite(f, &header, sizeof(header), 0) &&
+             file_rw_sync(f);
+    }
+    file_close_rw(f);
+    free(table);
+    free(zones);
+    free(tail);
+
+    if (ok && new_end + tail_size < old_end + sizeof(old_dict) + old_dict.size) {
+        ok = file_truncate(filename, new_end + tail_size);
+    }
+    if (!ok) return 0;
+
     printf("Данные сохранены в файл: %s\n", filename);
-    printf("  Записей: %d\n", system->size);
+    printf("  Записей: %lld, перезаписано страниц: %lu\n", (long long)system->size, (unsigned long)dirty);
+    return 1;
 }
 
-// Загрузка из бинарного файла с проверкой заголовка
-void load_from_file(struct data_base* system, const char* filename) {
-    FILE* file = fopen(filename, "rb");
+// Сохранение в бинарный файл с заголовком
+int save_to_file(struct data_base* system, const char* filename) {
+    // Надгробия в файл не попадают
+    db_compact(system);
+
+    // Большие базы (и базы, уже разбитые на сегменты) хранятся сегментами за манифестом
+    if (system->size > SEGMENT_RECORDS || segment_is_manifest(filename)) {
+        return save_to_segments(system, filename);
+    }
+
+    if (save_incremental(system, filename)) {
+        db_mark_synced(system, filename);
+        return 1;
+    }
+
+    // Нельзя перезаписывать файл, пока он отображен в память
+    db_detach_mapping(system, system->capacity);
+    forget_sync(system);
+
+    // Полный образ пишется рядом и заменяет файл только после сброса на диск:
+    // сбой посреди записи (или сразу после контрольной точки журнала) оставляет прежний файл
+    char tmp[300];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", filename);
+    FILE* file = fopen(tmp, "wb");
     if (!file) {
-        printf("Файл не найден, начинаем с пустой базы: %s\n", filename);
-        return;
+        printf("Ошибка открытия файла для записи: %s\n", tmp);
+        return 0;
+    }
+
+    int ok = 1;
+    if (host_is_little_endian()) {
+        // Заголовок с таблицей CRC и массив записей уходят двумя последовательными вызовами
+        size_t prefix_size = 0;
+        size_t tail_size = 0;
+        unsigned char* prefix = build_prefix_v2((const unsigned char*)system->records,
+                                                (size_t)system->size, system->lsn, 1, 1, &prefix_size);
+        unsigned char* tail = build_dict_tail(&tail_size);
+        if (!prefix || !tail || fwrite(prefix, 1, prefix_size, file) != prefix_size) {
+            printf("Ошибка записи заголовка файла\n");
+            ok = 0;
+        } else if (system->size > 0 &&
+                   fwrite(system->records, sizeof(technical_maintenance), system->size, file) != (size_t)system->size) {
+            printf("Ошибка записи записей\n");
+            ok = 0;
+        } else if (fwrite(tail, 1, tail_size, file) != tail_size) {
+            printf("Ошибка записи словаря типов работ\n");
+            ok = 0;
+        }
+        free(prefix);
+        free(tail);
+    } else {
+        size_t image_size = 0;
+        unsigned char* image = build_image_v2(system->records, (size_t)system->size, system->lsn, 1, 1, &image_size);
+        if (!image || fwrite(image, 1, image_size, file) != image_size) {
+            printf("Ошибка записи файла\n");
+            ok = 0;
+        }
+        free(image);
     }
     
-    // Читаем заголовок
-    file_header header;
-    if (fread(&header, sizeof(file_header), 1, file) != 1) {
-        printf("Ошибка чтения заголовка файла\n");
+    if (ok && !file_sync(file)) ok = 0;
+    if (fclose(file) != 0) ok = 0;
+    if (ok && !file_replace(tmp, filename)) {
+        printf("Ошибка замены файла: %s\n", filename);
+        ok = 0;
+    }
+    if (!ok) remove(tmp);
+    if (ok) {
+        db_mark_synced(system, filename);
+        printf("Данные сохранены в файл: %s\n", filename);
+        printf("  Записей: %lld\n", (long long)system->size);
+    }
+    return ok;
+}
+
+// Сохранение бинарного образа базы в сжатый блочный контейнер
+int save_to_file_compressed(struct data_base* system, const char* filename) {
+    db_verify_pending(system);
+    db_compact(system);
+    size_t image_size = 0;
+    unsigned char* image = build_image_v2(system->records, (size_t)system->size, system->lsn, 1, 1, &image_size);
+    if (!image) {
+        printf("Ошибка: недостаточно памяти для сохранения\n");
+        return 0;
+    }
+
+    int ok = container_write_file(filename, image, image_size, CONTAINER_PAYLOAD_BINARY);
+    if (!ok) {
+        printf("Ошибка записи сжатого файла: %s\n", filename);
+    } else {
+        printf("Данные сохранены в сжатый файл: %s\n", filename);
+        printf("  Записей: %lld\n", (long long)system->size);
+    }
+    free(image);
+    return ok;
+}
+
+// ============================================================================
+// Файлы сегментов: v2 из произвольного массива без вывода сообщений
+// ============================================================================
+
+int write_records_v2(const char* filename, const technical_maintenance* records, size_t count,
+                     uint64_t lsn, uint32_t* out_checksum) {
+    size_t image_size = 0;
+    unsigned char* image = build_image_v2(records, count, lsn, 0, 0, &image_size);
+    if (!image) return 0;
+
+    file_header_v2 header;
+    memcpy(&header, image, sizeof(header));
+    header_to_little_endian(&header);
+    if (out_checksum) *out_checksum = header.checksum;
+
+    FILE* file = fopen(filename, "wb");
+    int ok = file && fwrite(image, 1, image_size, file) == image_size && file_sync(file);
+    if (file && fclose(file) != 0) ok = 0;
+    free(image);
+    return ok;
+}
+
+int read_records_v2(const char* filename, technical_maintenance* dest, size_t count,
+                    const uint32_t* remap, uint32_t remap_count, uint32_t* out_checksum) {
+    FILE* file = fopen(filename, "rb");
+    if (!file) return 0;
+
+    file_header_v2 header;
+    uint64_t file_bytes = 0;
+    if (!file_size(file, &file_bytes) || fread(&header, sizeof(header), 1, file) != 1) {
         fclose(file);
-        return;
+        return 0;
     }
-    
-    // Проверяем заголовок
-    if (!validate_file_header(&header)) {
+    header_to_little_endian(&header);
+    // Сегменты прежних версий хранят записи в прежних раскладках
+    uint32_t layout_size = layout_record_size(header.record_layout);
+    int converted = header.record_layout != RECORD_LAYOUT;
+    if (header.magic != FILE_MAGIC || header.version != FILE_VERSION ||
+        layout_size == 0 || header.record_size != layout_size ||
+        !(header.flags & FILE_FLAG_BLOCK_CRC) || header.block_records != FILE_BLOCK_RECORDS ||
+        header.record_count != (uint64_t)count ||
+        header.block_capacity < block_count_for(count) ||
+        header.data_offset < sizeof(header) + (uint64_t)header.block_capacity * sizeof(uint32_t) ||
+        header.data_offset + (uint64_t)count * header.record_size > file_bytes) {
         fclose(file);
-        return;
+        return 0;
     }
-    
-    // Подготавливаем память
-    if (header.record_count > system->capacity) {
-        system->capacity = header.record_count;
-        system->records = realloc(system->records, system->capacity * sizeof(technical_maintenance));
+
+    size_t blocks = block_count_for(count);
+    uint32_t* stored = malloc((blocks ? blocks : 1) * sizeof(uint32_t));
+    uint32_t* actual = malloc((blocks ? blocks : 1) * sizeof(uint32_t));
+    unsigned char* raw = converted ? malloc((count ? count : 1) * (size_t)layout_size) : (unsigned char*)dest;
+    int ok = stored && actual && raw &&
+             fread(stored, sizeof(uint32_t), blocks, file) == blocks &&
+             file_seek(file, header.data_offset) &&
+             fread(raw, header.record_size, count, file) == count;
+    fclose(file);
+
+    if (ok) {
+        if (!host_is_little_endian()) {
+            for (size_t b = 0; b < blocks; b++) stored[b] = swap32(stored[b]);
+        }
+        compute_blocks(raw, count, header.record_size, actual, NULL, 0);
+        if (memcmp(stored, actual, blocks * sizeof(uint32_t)) != 0 ||
+            combine_checksum(stored, blocks, header.record_count) != header.checksum) {
+            ok = -1;
+        }
+        if (converted) {
+            records_from_disk(header.record_layout, raw, count, dest);
+        } else {
+            records_to_little_endian(dest, (int64_t)count);
+        }
+        if (remap && header.record_layout != RECORD_LAYOUT_WIDE) records_remap_types(dest, count, remap, remap_count);
+        if (out_checksum) *out_checksum = header.checksum;
     }
-    
-    // Читаем записи
-    int records_read = 0;
-    for (int i = 0; i < header.record_count; i++) {
-        if (fread(&system->records[i], sizeof(technical_maintenance), 1, file) != 1) {
-            printf("Ошибка чтения записи %d\n", i);
-            break;
+    if (converted) free(raw);
+    free(stored);
+    free(actual);
+    return ok;
+}
+
+// ============================================================================
+// Потоковые чтение и запись файла v2
+// ============================================================================
+
+static void stream_free(v2_stream* s) {
+    if (s->file) file_close_rw(s->file);
+    free(s->buffer);
+    free(s->crcs);
+    free(s->zones);
+    free(s->remap);
+    memset(s, 0, sizeof(*s));
+}
+
+static size_t stream_portion(size_t buffer_records) {
+    size_t n = buffer_records / FILE_BLOCK_RECORDS * FILE_BLOCK_RECORDS;
+    return n ? n : FILE_BLOCK_RECORDS;
+}
+
+static int stream_read_dict(v2_stream* s) {
+    uint64_t at = s->header.data_offset + s->header.record_count * s->header.record_size;
+    file_dict_header dict;
+    if (!file_pread(s->file, &dict, sizeof(dict), at) || dict.magic != FILE_DICT_MAGIC) return 0;
+
+    unsigned char* block = malloc(dict.size ? dict.size : 1);
+    int ok = block && file_pread(s->file, block, dict.size, at + sizeof(dict)) &&
+             crc32c(0, block, dict.size) == dict.checksum &&
+             work_dict_import(work_dict_shared(), block, dict.size, &s->remap, &s->remap_count);
+    free(block);
+    return ok;
+}
+
+int v2_stream_open_read(v2_stream* s, const char* filename, size_t buffer_records) {
+    memset(s, 0, sizeof(*s));
+    s->file = file_open_read(filename);
+    if (!s->file || !file_pread(s->file, &s->header, sizeof(s->header), 0)) {
+        stream_free(s);
+        return 0;
+    }
+    file_header_v2* h = &s->header;
+    header_to_little_endian(h);
+    uint32_t layout_size = layout_record_size(h->record_layout);
+    if (h->magic != FILE_MAGIC || h->version != FILE_VERSION ||
+        layout_size == 0 || h->record_size != layout_size ||
+        !(h->flags & FILE_FLAG_BLOCK_CRC) || h->block_records != FILE_BLOCK_RECORDS ||
+        h->block_capacity < block_count_for((size_t)h->record_count) ||
+        h->data_offset < sizeof(*h) + (uint64_t)h->block_capacity * sizeof(uint32_t)) {
+        stream_free(s);
+        return 0;
+    }
+    // WIDE хранит строки type_work в самих записях
+    if ((h->flags & FILE_FLAG_WORK_DICT) && h->record_layout != RECORD_LAYOUT_WIDE && !stream_read_dict(s)) {
+        stream_free(s);
+        return 0;
+    }
+
+    s->buffer_records = stream_portion(buffer_records);
+    size_t blocks = s->buffer_records / FILE_BLOCK_RECORDS;
+    s->crcs = malloc(2 * blocks * sizeof(uint32_t));
+    // Записи текущей раскладки читаются прямо в dest
+    if (h->record_layout != RECORD_LAYOUT) s->buffer = malloc(s->buffer_records * h->record_size);
+    if (!s->crcs || (h->record_layout != RECORD_LAYOUT && !s->buffer)) {
+        stream_free(s);
+        return 0;
+    }
+    return 1;
+}
+
+int64_t v2_stream_read(v2_stream* s, technical_maintenance* dest, size_t max) {
+    const file_header_v2* h = &s->header;
+    uint64_t left = h->record_count - s->position;
+    size_t n = max < s->buffer_records ? max : s->buffer_records;
+    if (n < left) {
+        n = n / FILE_BLOCK_RECORDS * FILE_BLOCK_RECORDS;
+        if (n == 0) return -1;
+    } else {
+        n = (size_t)left;
+    }
+    if (n == 0) return 0;
+
+    size_t first_block = (size_t)(s->position / FILE_BLOCK_RECORDS);
+    size_t blocks = block_count_for(n);
+    uint32_t* stored = s->crcs;
+    uint32_t* actual = s->crcs + s->buffer_records / FILE_BLOCK_RECORDS;
+    unsigned char* raw = s->buffer ? s->buffer : (unsigned char*)dest;
+    if (!file_pread(s->file, raw, n * h->record_size, h->data_offset + s->position * h->record_size) ||
+        !file_pread(s->file, stored, blocks * sizeof(uint32_t), sizeof(*h) + (uint64_t)first_block * sizeof(uint32_t))) {
+        return -1;
+    }
+    // Сумма таблицы считается по байтам файла (little-endian)
+    s->table_crc = crc32c(s->table_crc, stored, blocks * sizeof(uint32_t));
+    if (!host_is_little_endian()) {
+        for (size_t b = 0; b < blocks; b++) stored[b] = swap32(stored[b]);
+    }
+    compute_blocks(raw, n, h->record_size, actual, NULL, 1);
+    if (memcmp(stored, actual, blocks * sizeof(uint32_t)) != 0) return -1;
+
+    if (s->buffer) {
+        records_from_disk(h->record_layout, raw, n, dest);
+    } else {
+        records_to_little_endian(dest, (int64_t)n);
+    }
+    if (s->remap) records_remap_types(dest, n, s->remap, s->remap_count);
+    s->position += n;
+    return (int64_t)n;
+}
+
+int v2_stream_seek(v2_stream* s, uint64_t position) {
+    if (s->writing || position % FILE_BLOCK_RECORDS != 0 || position > s->header.record_count) return 0;
+    s->position = position;
+    s->seeked = 1;
+    return 1;
+}
+
+int v2_stream_create(v2_stream* s, const char* filename, uint64_t count, int with_dict, size_t buffer_records) {
+    memset(s, 0, sizeof(*s));
+    FILE* created = fopen(filename, "wb");
+    if (!created || fclose(created) != 0) return 0;
+
+    s->writing = 1;
+    s->with_dict = with_dict;
+    fill_header_v2(&s->header, (size_t)count, 0, with_dict);
+    s->buffer_records = stream_portion(buffer_records);
+    size_t blocks = s->buffer_records / FILE_BLOCK_RECORDS;
+    s->file = file_open_rw(filename);
+    s->buffer = malloc(s->buffer_records * sizeof(technical_maintenance));
+    s->crcs = malloc(blocks * sizeof(uint32_t));
+    s->zones = malloc(blocks * sizeof(block_zone));
+    if (!s->file || !s->buffer || !s->crcs || !s->zones) {
+        stream_free(s);
+        return 0;
+    }
+    return 1;
+}
+
+// Записи порции, их CRC и сводки уходят каждые на свое место в файле;
+// порции, кроме последней, заканчиваются на границе блока
+static int stream_flush(v2_stream* s) {
+    size_t n = s->buffered;
+    if (n == 0) return 1;
+    const file_header_v2* h = &s->header;
+    size_t first_block = (size_t)(s->position / FILE_BLOCK_RECORDS);
+    size_t blocks = block_count_for(n);
+
+    records_to_little_endian((technical_maintenance*)s->buffer, (int64_t)n);
+    compute_blocks(s->buffer, n, sizeof(technical_maintenance), s->crcs, s->zones, 1);
+    if (!host_is_little_endian()) {
+        for (size_t b = 0; b < blocks; b++) s->crcs[b] = swap32(s->crcs[b]);
+    }
+    s->table_crc = crc32c(s->table_crc, s->crcs, blocks * sizeof(uint32_t));
+    zones_to_little_endian(s->zones, blocks);
+    s->zone_crc = crc32c(s->zone_crc, s->zones, blocks * sizeof(block_zone));
+
+    int ok = file_pwrite(s->file, s->buffer, n * sizeof(technical_maintenance),
+                         h->data_offset + s->position * sizeof(technical_maintenance)) &&
+             file_pwrite(s->file, s->crcs, blocks * sizeof(uint32_t),
+                         sizeof(*h) + (uint64_t)first_block * sizeof(uint32_t)) &&
+             file_pwrite(s->file, s->zones, blocks * sizeof(block_zone),
+                         zone_table_offset(h->block_capacity) + (uint64_t)first_block * sizeof(block_zone));
+    s->position += n;
+    s->buffered = 0;
+    return ok;
+}
+
+int v2_stream_write(v2_stream* s, const technical_maintenance* records, size_t count) {
+    if (!s->writing || s->position + s->buffered + count > s->header.record_count) return 0;
+    while (count > 0) {
+        size_t n = s->buffer_records - s->buffered;
+        if (n > count) n = count;
+        memcpy(s->buffer + s->buffered * sizeof(technical_maintenance), records, n * sizeof(technical_maintenance));
+        s->buffered += n;
+        records += n;
+        count -= n;
+        if (s->buffered == s->buffer_records && !stream_flush(s)) return 0;
+    }
+    return 1;
+}
+
+int v2_stream_close(v2_stream* s, uint32_t* out_checksum) {
+    int ok = 1;
+    if (s->writing) {
+        file_header_v2 header = s->header;
+        ok = stream_flush(s) && s->position == header.record_count;
+        if (ok && s->with_dict) {
+            size_t tail_size = 0;
+            unsigned char* tail = build_dict_tail(&tail_size);
+            ok = tail && file_pwrite(s->file, tail, tail_size,
+                                     header.data_offset + header.record_count * sizeof(technical_maintenance));
+            free(tail);
         }
-        records_read++;
+        // Сумма заголовка - та же, что у combine_checksum по всей таблице
+        header.checksum = checksum_count(s->table_crc, header.record_count);
+        header.zone_checksum = s->zone_crc;
+        if (out_checksum) *out_checksum = header.checksum;
+        header_to_little_endian(&header);
+        if (ok) ok = file_pwrite(s->file, &header, sizeof(header), 0);
+    } else if (!s->seeked && s->position == s->header.record_count) {
+        ok = checksum_count(s->table_crc, s->header.record_count) == s->header.checksum;
+        if (out_checksum) *out_checksum = s->header.checksum;
     }
-    
-    system->size = records_read;
-    fclose(file);
-    
-    unsigned int actual_checksum = calculate_checksum(system);
-    if (actual_checksum != header.checksum) {
+    stream_free(s);
+    return ok;
+}
+
+// ============================================================================
+// Загрузка
+// ============================================================================
+
+// Готовит собственный массив под count записей (старые данные отбрасываются)
+static int reserve_records(struct data_base* system, int64_t count) {
+    if (system->mapping) {
+        release_records(system);
+        system->capacity = 0;
+    }
+    if (!system->records || count > system->capacity) {
+        int64_t capacity = count > 10 ? count : 10;
+        technical_maintenance* records = realloc(system->records, (size_t)capacity * sizeof(technical_maintenance));
+        if (!records) {
+            printf("Ошибка: недостаточно памяти для загрузки\n");
+            return 0;
+        }
+        system->records = records;
+        system->capacity = capacity;
+    }
+    system->size = 0;
+    system->lsn = 0;
+    system->id_index_ready = 0;
+    system->deleted = 0;
+    db_index_invalidate(system);
+    soa_invalidate(system);
+    totals_invalidate(system);
+    type_bitmaps_invalidate(system);
+    forget_sync(system);
+    return 1;
+}
+
+static void report_checksum(struct data_base* system, unsigned int expected, unsigned int actual,
+                            const char* filename) {
+    if (actual != expected) {
         printf("Предупреждение: Контрольная сумма не совпадает!\n");
-        printf("  Ожидалось: 0x%08X, Получено: 0x%08X\n", header.checksum, actual_checksum);
+        printf("  Ожидалось: 0x%08X, Получено: 0x%08X\n", expected, actual);
+        printf("  Возможно повреждение данных\n");
+    } else {
+        printf("Данные загружены из файла: %s\n", filename);
+        printf("  Записей: %lld\n", (long long)system->size);
+    }
+}
+
+// Проверка образа v2 до копирования/перестановки байтов.
+// С таблицей блоков CRC пересчитываются параллельно, и для каждого
+// поврежденного блока печатается точный диапазон номеров записей.
+static int verify_image_v2(struct data_base* system, const file_header_v2* header,
+                           const unsigned char* image, const char* filename) {
+    size_t count = (size_t)header->record_count;
+    const unsigned char* records = image + header->data_offset;
+
+    if (!(header->flags & FILE_FLAG_BLOCK_CRC)) {
+        // Файлы v2 без таблицы блоков: прежняя побайтовая сумма
+        unsigned int actual = checksum_bytes(records, count * header->record_size, (unsigned int)count);
+        report_checksum(system, header->checksum, actual, filename);
+        return actual == header->checksum;
+    }
+
+    size_t blocks = block_count_for(count);
+    uint32_t* stored = malloc((blocks ? blocks : 1) * sizeof(uint32_t));
+    uint32_t* actual = malloc((blocks ? blocks : 1) * sizeof(uint32_t));
+    if (!stored || !actual) {
+        printf("Предупреждение: недостаточно памяти для проверки контрольных сумм\n");
+        free(stored);
+        free(actual);
+        return 0;
+    }
+    memcpy(stored, image + sizeof(file_header_v2), blocks * sizeof(uint32_t));
+    if (!host_is_little_endian()) {
+        for (size_t b = 0; b < blocks; b++) stored[b] = swap32(stored[b]);
+    }
+    compute_blocks(records, count, header->record_size, actual, NULL, 1);
+
+    size_t damaged = 0;
+    for (size_t b = 0; b < blocks; b++) {
+        if (stored[b] == actual[b]) continue;
+        size_t first = b * FILE_BLOCK_RECORDS;
+        size_t last = first + FILE_BLOCK_RECORDS < count ? first + FILE_BLOCK_RECORDS : count;
+        if (damaged == 0) printf("Предупреждение: Контрольная сумма не совпадает!\n");
+        printf("  Повреждены записи %lu-%lu (блок %lu)\n",
+               (unsigned long)first + 1, (unsigned long)last, (unsigned long)b);
+        damaged++;
+    }
+
+    if (damaged == 0 && combine_checksum(stored, blocks, header->record_count) != header->checksum) {
+        printf("Предупреждение: Повреждена таблица контрольных сумм блоков\n");
+        damaged++;
+    }
+
+    if ((header->flags & FILE_FLAG_ZONE_MAPS) &&
+        crc32c(0, image + zone_table_offset(header->block_capacity), blocks * sizeof(block_zone)) !=
+        header->zone_checksum) {
+        printf("Предупреждение: Повреждена таблица сводок блоков\n");
+        damaged++;
+    }
+
+    if (damaged > 0) {
         printf("  Возможно повреждение данных\n");
     } else {
         printf("Данные загружены из файла: %s\n", filename);
-        printf("  Записей: %d\n", system->size);
+        printf("  Записей: %lld\n", (long long)system->size);
+    }
+    free(stored);
+    free(actual);
+    return damaged == 0;
+}
+
+// Словарь из конца образа v2. *remap переводит id файла в id общего словаря;
+// без FILE_FLAG_WORK_DICT *remap = NULL (id записей уже общие).
+static int import_dict_tail(const unsigned char* image, size_t image_size, const file_header_v2* header,
+                            uint32_t** remap, uint32_t* remap_count) {
+    *remap = NULL;
+    *remap_count = 0;
+    if (!(header->flags & FILE_FLAG_WORK_DICT)) return 1;
+
+    uint64_t at = header->data_offset + header->record_count * header->record_size;
+    file_dict_header dict;
+    if (at > image_size || image_size - at < sizeof(dict)) return 0;
+    memcpy(&dict, image + at, sizeof(dict));
+    if (!host_is_little_endian()) {
+        dict.magic = swap32(dict.magic);
+        dict.size = swap32(dict.size);
+        dict.checksum = swap32(dict.checksum);
+    }
+    if (dict.magic != FILE_DICT_MAGIC || dict.size > image_size - at - sizeof(dict) ||
+        crc32c(0, image + at + sizeof(dict), dict.size) != dict.checksum) {
+        return 0;
+    }
+    return work_dict_import(work_dict_shared(), image + at + sizeof(dict), dict.size, remap, remap_count);
+}
+
+// Переводит type_id загруженных записей в общий словарь по результату import_dict_tail.
+// Возвращает 1, если записи изменились и отличаются от файла.
+static int remap_loaded_types(struct data_base* system, int imported, uint32_t* remap, uint32_t remap_count) {
+    if (!imported) {
+        printf("Предупреждение: Поврежден словарь типов работ, типы работ сброшены\n");
+        records_remap_types(system->records, (size_t)system->size, NULL, 0);
+        return 1;
+    }
+    int changed = remap && !remap_is_identity(remap, remap_count);
+    if (changed) records_remap_types(system->records, (size_t)system->size, remap, remap_count);
+    free(remap);
+    return changed;
+}
+
+static int apply_dict_tail(struct data_base* system, const unsigned char* image, size_t image_size,
+                           const file_header_v2* header) {
+    uint32_t* remap = NULL;
+    uint32_t remap_count = 0;
+    int imported = import_dict_tail(image, image_size, header, &remap, &remap_count);
+    return remap_loaded_types(system, imported, remap, remap_count);
+}
+
+// Старый формат: 124-байтные записи подряд после 16-байтного заголовка
+#define LEGACY_RECORD_SIZE 124
+
+static void load_image_v1(struct data_base* system, const unsigned char* image, size_t image_size,
+                          const char* filename) {
+    file_header header;
+    memcpy(&header, image, sizeof(file_header));
+    if (!validate_file_header(&header)) return;
+
+    size_t available = (image_size - sizeof(file_header)) / LEGACY_RECORD_SIZE;
+    int64_t count = header.record_count < available ? (int64_t)header.record_count : (int64_t)available;
+    if (count < (int64_t)header.record_count) {
+        printf("Ошибка чтения записи %lld\n", (long long)count);
+    }
+    if (!reserve_records(system, count)) return;
+
+    const unsigned char* src = image + sizeof(file_header);
+    unsigned int expected = checksum_bytes(src, (size_t)count * LEGACY_RECORD_SIZE, (unsigned int)count);
+    for (int64_t i = 0; i < count; i++) {
+        record_from_disk_wide(src + (size_t)i * LEGACY_RECORD_SIZE, LEGACY_RECORD_SIZE, &system->records[i]);
+    }
+    system->size = count;
+
+    report_checksum(system, header.checksum, expected, filename);
+}
+
+static void load_image_v2(struct data_base* system, const unsigned char* image, size_t image_size,
+                          const char* filename) {
+    file_header_v2 header;
+    memcpy(&header, image, sizeof(header));
+    header_to_little_endian(&header);
+    if (!validate_file_header_v2(&header, image_size)) return;
+
+    int64_t count = (int64_t)header.record_count;
+    if (!reserve_records(system, count)) return;
+    // Файлы до словаря типов работ хранят строку type_work прямо в записи
+    records_from_disk(header.record_layout, image + header.data_offset, (size_t)count, system->records);
+    system->size = count;
+    if (header.record_layout != RECORD_LAYOUT_WIDE) apply_dict_tail(system, image, image_size, &header);
+    system->lsn = header.checkpoint_lsn;
+
+    verify_image_v2(system, &header, image, filename);
+}
+
+// Загрузка из образа файла любого поддерживаемого формата (с копированием)
+static void load_from_image(struct data_base* system, const unsigned char* image, size_t image_size,
+                            const char* filename) {
+    if (image_size < sizeof(file_header)) {
+        printf("Ошибка чтения заголовка файла\n");
+        return;
+    }
+
+    uint32_t version;
+    memcpy(&version, image + 4, sizeof(version));
+    if (!host_is_little_endian()) version = swap32(version);
+
+    if (version == FILE_VERSION_LEGACY) {
+        load_image_v1(system, image, image_size, filename);
+    } else if (image_size >= sizeof(file_header_v2)) {
+        load_image_v2(system, image, image_size, filename);
+    } else {
+        printf("Ошибка чтения заголовка файла\n");
+    }
+}
+
+// Загрузка образа базы из сжатого контейнера
+static void load_from_container(struct data_base* system, const char* filename) {
+    size_t image_size = 0;
+    unsigned int payload = 0;
+    unsigned char* image = container_read_file(filename, &image_size, &payload);
+    if (!image || payload != CONTAINER_PAYLOAD_BINARY) {
+        printf("Ошибка чтения сжатого файла: %s\n", filename);
+        free(image);
+        return;
+    }
+    load_from_image(system, image, image_size, filename);
+    free(image);
+}
+
+// Загрузка через отображение файла в память.
+// Файл v2 на little-endian хосте используется без копирования: records указывает
+// прямо в отображение, запись в него создает частные копии страниц (copy-on-write),
+// а расширение или сохранение переносит базу в кучу. При LOAD_VERIFY_NONE и
+// LOAD_VERIFY_LAZY загрузка не читает записи: время не зависит от их числа.
+void load_from_file_mapped(struct data_base* system, const char* filename, int verify) {
+    if (container_is_file(filename)) {
+        load_from_container(system, filename);
+        return;
+    }
+
+    size_t map_size = 0;
+    unsigned char* map = file_map_private(filename, &map_size);
+    if (!map) {
+        printf("Файл не найден, начинаем с пустой базы: %s\n", filename);
+        return;
+    }
+
+    uint32_t magic = 0, version = 0;
+    if (map_size >= 8) {
+        memcpy(&magic, map, sizeof(magic));
+        memcpy(&version, map + 4, sizeof(version));
+        if (!host_is_little_endian()) {
+            magic = swap32(magic);
+            version = swap32(version);
+        }
+    }
+    if (magic == SEGMENT_MAGIC) {
+        file_unmap(map, map_size);
+        load_from_segments(system, filename);
+        return;
+    }
+    if (version == FILE_VERSION_COLUMNAR) {
+        file_unmap(map, map_size);
+        load_from_columnar(system, filename);
+        return;
+    }
+
+    file_header_v2 header;
+    if (!host_is_little_endian() || map_size < sizeof(header)) {
+        load_from_image(system, map, map_size, filename);
+        file_unmap(map, map_size);
+        return;
+    }
+
+    memcpy(&header, map, sizeof(header));
+    if (header.version != FILE_VERSION || header.record_layout != RECORD_LAYOUT) {
+        load_from_image(system, map, map_size, filename);
+        file_unmap(map, map_size);
+        return;
     }
+
+    if (!validate_file_header_v2(&header, map_size)) {
+        file_unmap(map, map_size);
+        return;
+    }
+
+    release_records(system);
+    system->records = (technical_maintenance*)(map + header.data_offset);
+    system->size = (int64_t)header.record_count;
+    system->capacity = system->size;
+    system->mapping = map;
+    system->mapping_size = map_size;
+    system->lsn = header.checkpoint_lsn;
+
+    // Файл совпадает с базой: следующие сохранения могут перезаписывать только измененные страницы
+    forget_sync(system);
+    uint32_t* remap = NULL;
+    uint32_t remap_count = 0;
+    int imported = import_dict_tail(map, map_size, &header, &remap, &remap_count);
+    int retyped = !imported || (remap && !remap_is_identity(remap, remap_count));
+
+    // Перевод type_id переписывает все записи: откладывать проверку незачем
+    int synced = 1;
+    if (verify == LOAD_VERIFY_FULL || (verify == LOAD_VERIFY_LAZY && retyped) ||
+        !(header.flags & FILE_FLAG_BLOCK_CRC)) {
+        if (verify != LOAD_VERIFY_NONE) synced = verify_image_v2(system, &header, map, filename);
+    } else if (verify == LOAD_VERIFY_LAZY) {
+        size_t blocks = block_count_for((size_t)system->size);
+        system->lazy_checked = calloc(blocks / 8 + 1, 1);
+        if (system->lazy_checked) {
+            system->lazy_crcs = (const uint32_t*)(map + sizeof(file_header_v2));
+            system->lazy_count = system->size;
+        } else {
+            synced = verify_image_v2(system, &header, map, filename);
+        }
+    }
+    if (verify == LOAD_VERIFY_NONE || system->lazy_crcs) {
+        printf("Данные отображены из файла: %s\n", filename);
+        printf("  Записей: %lld\n", (long long)system->size);
+    }
+
+    // id типов работ переводятся в общий словарь после проверки CRC (страницы копируются при записи);
+    // если они изменились, файл при следующем сохранении переписывается целиком
+    if (remap_loaded_types(system, imported, remap, remap_count)) synced = 0;
+    if (synced) db_mark_synced(system, filename);
+}
+
+// Загрузка из бинарного файла с проверкой заголовка
+void load_from_file(struct data_base* system, const char* filename) {
+    load_from_file_mapped(system, filename, LOAD_VERIFY_FULL);
 }
 
 // Полная очистка базы данных
 void clear_database(struct data_base* system) {
-    free(system->records);
+    if (system->wal) wal_append(system->wal, system, WAL_OP_CLEAR, 0, NULL);
+    if (system->synced_file[0]) system->dirty_all = 1;
+    release_records(system);
     system->records = malloc(10 * sizeof(technical_maintenance));
     system->size = 0;
     system->capacity = 10;
     printf("База данных полностью очищена!\n");
-}
\ No newline at end of file
+}
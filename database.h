@@ -4,9 +4,26 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
 
 #define FILE_MAGIC 0x4D41494E
-#define FILE_VERSION 1
+#define FILE_VERSION_LEGACY 1  // построчная запись 124-байтных структур
+#define FILE_VERSION 2         // выровненный little-endian формат для mmap
+#define FILE_VERSION_COLUMNAR 3 // поколоночный формат для аналитики (columnar.h)
+#define RECORD_LAYOUT 3        // версия раскладки technical_maintenance на диске
+#define RECORD_LAYOUT_WIDE 1   // прежняя 128-байтная раскладка со строкой type_work (wide_record)
+#define RECORD_LAYOUT_TEXT_DATE 2 // 32-байтная раскладка с type_id и датой строкой
+#define FILE_DATA_OFFSET 64    // записи начинаются сразу после заголовка v2
+#define DATE_NONE INT32_MIN    // дата не задана или не распознана
+#define DATE_TEXT_SIZE 11      // "дд.мм.гггг" с завершающим нулем
+
+// Флаги заголовка v2
+#define FILE_FLAG_BLOCK_CRC 0x1 // после заголовка лежит таблица CRC32C блоков записей
+#define FILE_BLOCK_RECORDS 32   // записей в блоке контрольной суммы (768 байт)
+#define FILE_FLAG_ZONE_MAPS 0x2 // за таблицей CRC лежит таблица block_zone (min/max по блокам)
+#define FILE_FLAG_WORK_DICT 0x4 // за последней записью лежит словарь type_work (file_dict_header)
+
+#define FILE_DICT_MAGIC 0x43494457 // "WDIC"
 
 // Структура пользователя
 typedef struct User{
@@ -20,21 +37,79 @@ typedef struct UserSession{
     int is_authenticated;
 } UserSession;
 
+// Раскладка совпадает с записью файла v2 (little-endian, 24 байта),
+// поэтому массив записей можно отображать из файла без копирования.
+// Тип работы хранится как id в общем словаре (work_dict_shared):
+// строку дает record_type_work, изменяет record_set_type_work.
+// Дата - номер дня (date_to_days): разбирается при вводе и загрузке,
+// в "дд.мм.гггг" переводится только для вывода (days_to_date).
 typedef struct technical_maintenance {
-    int id;
-    char date[11]; // формата xx.xx.xxxx
-    char type_work[100]; // тип работы
-    int mileage; // пробег
+    int32_t id;
+    int32_t date; // номер дня от 01.01.1970, DATE_NONE - не задана
+    uint32_t type_id; // тип работы (id в общем словаре)
+    int32_t mileage; // пробег
     float price; // стоимость
+    uint32_t flags; // RECORD_DELETED; в файлах всегда 0
 } technical_maintenance;
 
+#define RECORD_DELETED 0x1 // надгробие: запись удалена и ждет уплотнения (db_compact)
+
+typedef char technical_maintenance_size_check[sizeof(technical_maintenance) == 24 ? 1 : -1];
+
+// Прежняя раскладка записи со строкой type_work (RECORD_LAYOUT_WIDE, 128 байт).
+// Первые 124 байта совпадают с записью формата v1; в этом же виде записи
+// лежат в журнале изменений, чтобы не зависеть от номеров словаря.
+typedef struct wide_record {
+    int32_t id;
+    char date[11];
+    char type_work[100];
+    char pad0;
+    int32_t mileage;
+    float price;
+    uint32_t reserved;
+} wide_record;
+
+typedef char wide_record_size_check[sizeof(wide_record) == 128 ? 1 : -1];
+
+struct wal;
+struct db_index;
+struct soa_mirror;
+struct db_totals;
+struct type_bitmaps;
+
 // структура для динамического массива
 typedef struct data_base {
     technical_maintenance* records;
-    int size;  // кол-во элементов
-    int capacity; // макс вместимость
+    int64_t size;  // кол-во элементов
+    int64_t capacity; // макс вместимость
+    void* mapping; // отображение файла, если records указывает в него
+    size_t mapping_size;
+    struct wal* wal; // журнал изменений (NULL - не ведется)
+    uint64_t lsn;    // LSN последнего примененного изменения
+    // Отслеживание изменений для сохранения только измененных страниц
+    uint8_t* dirty_pages;  // бит на страницу из FILE_BLOCK_RECORDS записей
+    size_t dirty_bytes;
+    int dirty_all;         // страницы неизвестны, нужна полная перезапись
+    int64_t synced_size;   // число записей в synced_file на момент загрузки/сохранения
+    char synced_file[260]; // файл, совпадающий с базой везде, кроме dirty_pages
+    // Отложенная проверка CRC (LOAD_VERIFY_LAZY): блок файла проверяется перед первым изменением
+    const uint32_t* lazy_crcs; // таблица CRC блоков в отображении, NULL - проверять нечего
+    uint8_t* lazy_checked;     // бит на блок: уже проверен
+    int64_t lazy_count;        // записей в файле на момент загрузки
+    // Стабильные id: индекс id -> позиция в records (открытая адресация).
+    // Строится лениво после загрузки, дальше поддерживается за O(1) на операцию.
+    int64_t* id_slots;     // позиция + 1, 0 - пусто
+    size_t id_slot_count;  // степень двойки
+    int id_index_ready;
+    int32_t next_id;       // следующий выдаваемый id
+    int64_t deleted;       // надгробий среди records[0..size)
+    struct db_index* indexes; // вторичные индексы (db_index.h), NULL - не ведутся
+    struct soa_mirror* soa;   // столбцовое зеркало (soa.h), NULL - не ведется
+    struct db_totals* totals; // накопительные итоги (totals.h), NULL - не ведутся
+    struct type_bitmaps* type_bitmaps; // битовые индексы видов работ (type_bitmap.h), NULL - не ведутся
 } data_base;
 
+// Заголовок старого формата (v1)
 typedef struct file_header {
     unsigned int magic;        // Магическое число
     unsigned int version;      // Версия формата
@@ -42,6 +117,44 @@ typedef struct file_header {
     unsigned int checksum;     // Контрольная сумма
 } file_header;
 
+// Заголовок формата v2: все поля little-endian, 64-битные поля выровнены на 8
+typedef struct file_header_v2 {
+    uint32_t magic;         // FILE_MAGIC
+    uint32_t version;       // FILE_VERSION
+    uint64_t record_count;  // Количество записей
+    uint32_t record_size;   // sizeof(technical_maintenance)
+    uint32_t record_layout; // RECORD_LAYOUT
+    uint64_t data_offset;   // Смещение первой записи от начала файла
+    uint32_t flags;         // FILE_FLAG_*
+    uint32_t checksum;      // CRC32C таблицы CRC блоков и числа записей
+    uint32_t block_records; // Записей в блоке контрольной суммы
+    uint32_t block_capacity; // Емкость таблицы CRC блоков (uint32 x N сразу после заголовка)
+    uint64_t checkpoint_lsn; // LSN последнего изменения журнала, вошедшего в файл
+    uint32_t zone_checksum;  // CRC32C таблицы block_zone (FILE_FLAG_ZONE_MAPS)
+    uint8_t reserved[4];
+} file_header_v2;
+
+typedef char file_header_v2_size_check[sizeof(file_header_v2) == FILE_DATA_OFFSET ? 1 : -1];
+
+// Заголовок словаря type_work в конце файла v2 (FILE_FLAG_WORK_DICT)
+typedef struct file_dict_header {
+    uint32_t magic;    // FILE_DICT_MAGIC
+    uint32_t size;     // Байт сериализованного словаря (work_dict_serialize) после заголовка
+    uint32_t checksum; // CRC32C словаря
+    uint32_t reserved;
+} file_dict_header;
+
+// Сводка блока записей для пропуска блоков при выборке по диапазону.
+// Пустой диапазон (min > max) - в блоке нет ни одного значения поля.
+typedef struct block_zone {
+    int32_t date_min;    // номер дня (date_to_days); нераспознанные даты не учитываются
+    int32_t date_max;
+    int32_t mileage_min;
+    int32_t mileage_max;
+    float price_min;
+    float price_max;
+} block_zone;
+
 // Прототипы функций аутентификации
 unsigned int simple_hash(const char* password);
 int register_user(UserSession* session);
@@ -53,19 +166,111 @@ void show_auth_menu(UserSession* session);
 void get_user_data_filename(const char* username, char* filename);
 
 // Прототипы основных функций
-void init_system(struct data_base* system, int capacity);
+void init_system(struct data_base* system, int64_t capacity);
+// add_item выдает записи новый id, если record.id <= 0 или уже занят.
+// delete_item ставит надгробие (O(1)) и никогда не уплотняет базу сам; позиции
+// остальных записей не меняются до уплотнения. modify_item сохраняет id записи.
 void add_item(struct data_base* system, struct technical_maintenance record);
-void delete_item(struct data_base* system, int index);
-void modify_item(struct data_base* system, int index, struct technical_maintenance new_item);
+void delete_item(struct data_base* system, int64_t index);
+void modify_item(struct data_base* system, int64_t index, struct technical_maintenance new_item);
+// Позиция записи с данным id или -1 (O(1))
+int64_t find_item(struct data_base* system, int32_t id);
+int delete_item_by_id(struct data_base* system, int32_t id);
+int modify_item_by_id(struct data_base* system, int32_t id, struct technical_maintenance new_item);
+// Заменяет записи базы массивом records (malloc), владение переходит к базе.
+// Включенные индексы сохраняются и перестраиваются при следующем обращении.
+void db_adopt_records(struct data_base* system, technical_maintenance* records, int64_t count, int64_t capacity);
+// Удаляет надгробия, сдвигая живые записи (выполняется и перед сохранением)
+void db_compact(struct data_base* system);
+// Уплотнение в простое (между командами меню): только если надгробий набралось
+// не меньше четверти записей. Возвращает 1, если база уплотнена.
+int db_compact_idle(struct data_base* system);
+int record_is_deleted(const technical_maintenance* record);
+int64_t db_live_count(const struct data_base* system);
 void display_items(struct data_base* system);
 void free_system(struct data_base* system);
 void autoprice(technical_maintenance* record);
+const char* record_type_work(const technical_maintenance* record);
+int record_set_type_work(technical_maintenance* record, const char* type_work);
+void record_to_wide(const technical_maintenance* record, wide_record* out);
+void record_from_wide(const wide_record* wide, technical_maintenance* out);
+// Перевод type_id из номеров словаря файла в номера общего словаря
+void records_remap_types(technical_maintenance* records, size_t count,
+                         const uint32_t* remap, uint32_t remap_count);
 int  validate_date(const char* date);
+int date_to_days(const char* date, int32_t* out_days);
+void days_to_date(int32_t days, char* out); // out не меньше DATE_TEXT_SIZE байт
+void days_to_ymd(int32_t days, int* year, int* month, int* day);
+int32_t date_month(int32_t days); // гггг*100 + мм, 0 для DATE_NONE
 int validate_mileage(int mileage); 
-void save_to_file(struct data_base* system, const char* filename);
+int save_to_file(struct data_base* system, const char* filename);
+int save_to_file_compressed(struct data_base* system, const char* filename);
 void load_from_file(struct data_base* system, const char* filename);
+
+// Режимы проверки контрольных сумм при загрузке через отображение
+#define LOAD_VERIFY_NONE 0 // без проверки
+#define LOAD_VERIFY_FULL 1 // все блоки при загрузке
+#define LOAD_VERIFY_LAZY 2 // блок - перед первым изменением, остальные - перед полной перезаписью
+void load_from_file_mapped(struct data_base* system, const char* filename, int verify);
 void clear_database(struct data_base* system);
+unsigned int checksum_buffer(const void* data, size_t data_size);
 unsigned int calculate_checksum(struct data_base* system);
 int validate_file_header(struct file_header* header);
+int validate_file_header_v2(const struct file_header_v2* header, size_t file_size);
+void db_detach_mapping(struct data_base* system, int64_t min_capacity);
+// Проверяет блоки, отложенные LOAD_VERIFY_LAZY. 0 - найдены поврежденные.
+int db_verify_pending(struct data_base* system);
+
+// Отслеживание синхронизации с файлом (инкрементальное сохранение)
+void db_mark_synced(struct data_base* system, const char* filename);
+int db_range_dirty(const struct data_base* system, int64_t first, int64_t count);
+
+// Одиночный файл v2 без словаря и без вывода сообщений (файлы сегментов,
+// словарь хранится в манифесте). remap - перевод type_id (NULL - без перевода);
+// файлы в раскладке RECORD_LAYOUT_WIDE дописывают строки в общий словарь,
+// поэтому читать их можно только из одного потока.
+// read_records_v2: 1 - успех, 0 - ошибка чтения или формата, -1 - не совпали CRC
+int write_records_v2(const char* filename, const technical_maintenance* records, size_t count,
+                     uint64_t lsn, uint32_t* out_checksum);
+int read_records_v2(const char* filename, technical_maintenance* dest, size_t count,
+                    const uint32_t* remap, uint32_t remap_count, uint32_t* out_checksum);
+
+// Потоковые чтение и запись файла v2 порциями (файлы больше памяти, ext_sort.h).
+// Порция кратна FILE_BLOCK_RECORDS: CRC и сводки считаются по целым блокам,
+// таблицы блоков читаются и пишутся вместе с порцией записей.
+struct file_rw;
+
+typedef struct v2_stream {
+    struct file_rw* file;
+    file_header_v2 header;   // в порядке байтов хоста
+    uint64_t position;       // записей прочитано / записано
+    int writing;
+    int with_dict;           // запись: за записями пишется словарь type_work
+    int seeked;              // чтение: после v2_stream_seek сумма всей таблицы не проверяется
+    unsigned char* buffer;   // порция записей в дисковом представлении
+    size_t buffer_records;   // емкость порции (кратна FILE_BLOCK_RECORDS)
+    size_t buffered;         // запись: записей в порции
+    uint32_t* crcs;          // CRC блоков порции (чтение: из файла и вычисленные)
+    block_zone* zones;
+    uint32_t table_crc;      // CRC32C таблицы CRC блоков по пройденной части
+    uint32_t zone_crc;
+    uint32_t* remap;         // чтение: словарь файла -> общий словарь
+    uint32_t remap_count;
+} v2_stream;
+
+// Открытие файла v2 любой известной раскладки; type_id переводятся в общий словарь.
+// 1 - успех, 0 - ошибка чтения или формата.
+int v2_stream_open_read(v2_stream* s, const char* filename, size_t buffer_records);
+// До max записей (не больше порции) в dest: число записей, 0 - конец файла,
+// -1 - ошибка чтения или несовпадение CRC
+int64_t v2_stream_read(v2_stream* s, technical_maintenance* dest, size_t max);
+// Переход к записи position (кратно FILE_BLOCK_RECORDS)
+int v2_stream_seek(v2_stream* s, uint64_t position);
+// Создает файл ровно на count записей; with_dict - дописать словарь type_work
+int v2_stream_create(v2_stream* s, const char* filename, uint64_t count, int with_dict, size_t buffer_records);
+int v2_stream_write(v2_stream* s, const technical_maintenance* records, size_t count);
+// Запись: дописывает порцию, словарь и заголовок (0 - ошибка или записано не count записей).
+// Чтение: 0, если файл прочитан целиком, но не совпала итоговая сумма заголовка.
+int v2_stream_close(v2_stream* s, uint32_t* out_checksum);
 
 #endif
\ No newline at end of file
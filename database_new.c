@@ -6,62 +6,35 @@
 // ИНТЕГРАЦИЯ С СУЩЕСТВУЮЩИМ КОДОМ
 // ============================================================================
 
-// Сохранение в ASF формат
-void save_to_asf(struct data_base* system, const char* filename, const char* username) {
+// Сохранение в ASF формат (обычный текст или сжатый контейнер)
+static int save_to_asf_impl(struct data_base* system, const char* filename, const char* username, int compressed) {
     if (!system || !filename) {
         printf("Ошибка: неверные параметры для сохранения\n");
-        return;
+        return 0;
     }
     
     printf("Сохранение данных в ASF формат: %s\n", filename);
     
-    // Конвертируем базу данных в AST
-    DataNode* root = database_to_asf(system);
+    // Конвертируем базу данных в AST (метаданные - с именем пользователя и LSN)
+    DataNode* root = database_to_asf(system, username);
     if (!root) {
         printf("Ошибка: не удалось конвертировать данные в ASF формат\n");
-        return;
-    }
-    
-    // Обновляем метаданные с именем пользователя
-    DataNode* metadata_node = find_node_by_key(root, "metadata");
-    if (metadata_node && username) {
-        // Добавляем или обновляем поле user
-        DataNode* user_node = NULL;
-        for (int i = 0; i < metadata_node->value.object.count; i++) {
-            DataNode* pair = metadata_node->value.object.pairs[i];
-            if (pair->key && strcmp(pair->key, "user") == 0) {
-                user_node = pair;
-                break;
-            }
-        }
-        
-        if (!user_node) {
-            // Создаем новый узел user
-            user_node = create_string_node("user", username);
-            if (user_node) {
-                if (metadata_node->value.object.count >= metadata_node->value.object.capacity) {
-                    metadata_node->value.object.capacity *= 2;
-                    metadata_node->value.object.pairs = (DataNode**)realloc(
-                        metadata_node->value.object.pairs,
-                        metadata_node->value.object.capacity * sizeof(DataNode*)
-                    );
-                }
-                metadata_node->value.object.pairs[metadata_node->value.object.count++] = user_node;
-            }
-        } else if (user_node->type == NODE_STRING && user_node->value.string_value) {
-            // Обновляем существующий узел
-            free(user_node->value.string_value);
-            user_node->value.string_value = strdup(username);
-        }
+        return 0;
     }
     
     // Сохраняем в файл с красивым форматированием
-    if (!asf_save_file(filename, root, 1)) {
+    int saved = compressed ? asf_save_file_compressed(filename, root, 1)
+                           : asf_save_file(filename, root, 1);
+    if (!saved) {
         printf("Ошибка: не удалось сохранить файл %s\n", filename);
+    } else if (compressed) {
+        printf("Данные успешно сохранены в сжатом формате ASF:\n");
+        printf("  Файл: %s\n", filename);
+        printf("  Записей: %lld\n", (long long)system->size);
     } else {
         printf("Данные успешно сохранены в формате ASF:\n");
         printf("  Файл: %s\n", filename);
-        printf("  Записей: %d\n", system->size);
+        printf("  Записей: %lld\n", (long long)system->size);
         
         // Показываем превью файла
         char* preview = asf_serialize_node(root, 1);
@@ -74,6 +47,15 @@ void save_to_asf(struct data_base* system, const char* filename, const char* use
     
     // Очищаем память
     asf_free_node(root);
+    return saved;
+}
+
+int save_to_asf(struct data_base* system, const char* filename, const char* username) {
+    return save_to_asf_impl(system, filename, username, 0);
+}
+
+int save_to_asf_compressed(struct data_base* system, const char* filename, const char* username) {
+    return save_to_asf_impl(system, filename, username, 1);
 }
 
 // Загрузка из ASF формата
@@ -101,12 +83,12 @@ void load_from_asf(struct data_base* system, const char* filename) {
     }
     
     // Очищаем старую базу и копируем новую
-    free_system(system);
-    system->records = new_db->records;
-    system->size = new_db->size;
-    system->capacity = new_db->capacity;
+    db_adopt_records(system, new_db->records, new_db->size, new_db->capacity);
+    system->lsn = new_db->lsn;
     
-    // Освобождаем временную структуру (но не записи!)
+    // Освобождаем временную структуру (но не записи!); индексы перестроятся лениво
+    new_db->records = NULL;
+    free_system(new_db);
     free(new_db);
     
     // Показываем метаданные
@@ -126,7 +108,7 @@ void load_from_asf(struct data_base* system, const char* filename) {
         if (user_node && user_node->type == NODE_STRING) {
             printf("  Пользователь: %s\n", user_node->value.string_value);
         }
-        printf("  Загружено записей: %d\n", system->size);
+        printf("  Загружено записей: %lld\n", (long long)system->size);
     }
     
     // Очищаем AST
@@ -199,13 +181,15 @@ void test_asf_parser(void) {
     data_base* test_db = asf_to_database(parsed);
     if (test_db) {
         printf("✅ Конвертация успешна!\n");
-        printf("Записей в базе: %d\n", test_db->size);
+        printf("Записей в базе: %lld\n", (long long)test_db->size);
         
         // Показываем записи
-        for (int i = 0; i < test_db->size; i++) {
+        for (int64_t i = 0; i < test_db->size; i++) {
             printf("\nЗапись #%d:\n", test_db->records[i].id);
-            printf("  Дата: %s\n", test_db->records[i].date);
-            printf("  Тип работы: %s\n", test_db->records[i].type_work);
+            char date[DATE_TEXT_SIZE];
+            days_to_date(test_db->records[i].date, date);
+            printf("  Дата: %s\n", date);
+            printf("  Тип работы: %s\n", record_type_work(&test_db->records[i]));
             printf("  Пробег: %d\n", test_db->records[i].mileage);
             printf("  Стоимость: %.2f\n", test_db->records[i].price);
         }
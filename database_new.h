@@ -8,10 +8,13 @@
 // НОВЫЕ ФУНКЦИИ ДЛЯ РАБОТЫ С ASF ФОРМАТОМ
 // ============================================================================
 
-// Сохранение в ASF формат (замена save_to_file)
-void save_to_asf(struct data_base* system, const char* filename, const char* username);
+// Сохранение в ASF формат (замена save_to_file). 0 - ошибка записи.
+int save_to_asf(struct data_base* system, const char* filename, const char* username);
 
-// Загрузка из ASF формата (замена load_from_file)
+// Сохранение в ASF формат внутри сжатого блочного контейнера
+int save_to_asf_compressed(struct data_base* system, const char* filename, const char* username);
+
+// Загрузка из ASF формата (замена load_from_file), сжатые файлы распознаются автоматически
 void load_from_asf(struct data_base* system, const char* filename);
 
 // Тестовая функция для проверки парсера
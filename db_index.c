@@ -0,0 +1,365 @@
+#include "db_index.h"
+#include "parallel.h"
+
+#include <float.h>
+
+#define PENDING_MIN 256 // буфер вставок вливается, когда больше max(PENDING_MIN, sqrt(n))
+
+// ============================================================================
+// Ключи
+// ============================================================================
+
+// Биты float -> целое с тем же порядком (отрицательные инвертируются целиком)
+static int64_t price_key(float price) {
+    uint32_t bits;
+    memcpy(&bits, &price, sizeof(bits));
+    bits = (bits & 0x80000000u) ? ~bits : bits | 0x80000000u;
+    return (int64_t)bits;
+}
+
+static int64_t record_key(const technical_maintenance* r, IndexField field) {
+    switch (field) {
+        case INDEX_DATE:    return r->date;
+        case INDEX_MILEAGE: return r->mileage;
+        default:            return price_key(r->price);
+    }
+}
+
+// Наименьший ключ >= value (lower = 1) или наибольший ключ <= value (lower = 0)
+static int64_t bound_key(IndexField field, double value, int lower) {
+    if (field != INDEX_PRICE) {
+        // Сами INT32_MIN (DATE_NONE) и INT32_MAX - обычные ключи, за границы выходят только значения за ними
+        if (value < (double)INT32_MIN) return lower ? INT32_MIN : (int64_t)INT32_MIN - 1;
+        if (value > (double)INT32_MAX) return lower ? (int64_t)INT32_MAX + 1 : INT32_MAX;
+        int64_t k = (int64_t)value; // отбрасывание дробной части к нулю
+        if (lower && (double)k < value) k++;
+        if (!lower && (double)k > value) k--;
+        return k;
+    }
+    if (value < -FLT_MAX) return lower ? 0 : -1;
+    if (value > FLT_MAX) return lower ? (int64_t)UINT32_MAX + 1 : UINT32_MAX;
+    float f = (float)value;
+    int64_t k = price_key(f);
+    // Соседние float отличаются на 1 в пространстве ключей
+    if (lower && (double)f < value) k++;
+    if (!lower && (double)f > value) k--;
+    return k;
+}
+
+static int entry_less(const index_entry* a, const index_entry* b) {
+    int64_t sa = a->slot & ~INDEX_REMOVED, sb = b->slot & ~INDEX_REMOVED;
+    return a->key < b->key || (a->key == b->key && sa < sb);
+}
+
+static int entry_compare(const void* a, const void* b) {
+    const index_entry* x = (const index_entry*)a;
+    const index_entry* y = (const index_entry*)b;
+    return entry_less(x, y) ? -1 : entry_less(y, x) ? 1 : 0;
+}
+
+// Первый элемент >= e
+static size_t lower_bound(const index_entry* entries, size_t count, const index_entry* e) {
+    size_t lo = 0, hi = count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (entry_less(&entries[mid], e)) lo = mid + 1; else hi = mid;
+    }
+    return lo;
+}
+
+// ============================================================================
+// Параллельная сортировка при построении
+// ============================================================================
+
+typedef struct {
+    const struct data_base* system;
+    IndexField field;
+    index_entry* src;
+    index_entry* dst;
+    size_t count;
+    size_t width; // длина сливаемых отрезков (или куска при заполнении)
+} BuildJob;
+
+static void fill_chunk(void* ctx, size_t chunk) {
+    BuildJob* job = (BuildJob*)ctx;
+    size_t from = chunk * job->width;
+    size_t to = from + job->width < job->count ? from + job->width : job->count;
+    for (size_t i = from; i < to; i++) {
+        const technical_maintenance* r = &job->system->records[i];
+        job->src[i].key = record_key(r, job->field);
+        job->src[i].slot = (int64_t)i | (record_is_deleted(r) ? INDEX_REMOVED : 0);
+    }
+    qsort(job->src + from, to - from, sizeof(index_entry), entry_compare);
+}
+
+static void merge_pair(void* ctx, size_t pair) {
+    BuildJob* job = (BuildJob*)ctx;
+    size_t lo = pair * 2 * job->width;
+    size_t mid = lo + job->width < job->count ? lo + job->width : job->count;
+    size_t hi = mid + job->width < job->count ? mid + job->width : job->count;
+    size_t i = lo, j = mid, out = lo;
+    while (i < mid && j < hi) {
+        job->dst[out++] = entry_less(&job->src[j], &job->src[i]) ? job->src[j++] : job->src[i++];
+    }
+    while (i < mid) job->dst[out++] = job->src[i++];
+    while (j < hi) job->dst[out++] = job->src[j++];
+}
+
+// Куски сортируются параллельно, затем сливаются попарно (каждый проход - параллельно)
+static int build_field(struct data_base* system, sorted_index* index, IndexField field) {
+    size_t n = (size_t)system->size;
+    index_entry* a = malloc((n ? n : 1) * sizeof(index_entry));
+    index_entry* b = malloc((n ? n : 1) * sizeof(index_entry));
+    if (!a || !b) {
+        free(a);
+        free(b);
+        return 0;
+    }
+
+    size_t chunks = (size_t)parallel_cpu_count();
+    BuildJob job;
+    job.system = system;
+    job.field = field;
+    job.src = a;
+    job.dst = b;
+    job.count = n;
+    job.width = (n + chunks - 1) / chunks;
+    if (job.width == 0) job.width = 1;
+    parallel_for((n + job.width - 1) / job.width, fill_chunk, &job);
+
+    while (job.width < n) {
+        size_t pairs = (n + 2 * job.width - 1) / (2 * job.width);
+        parallel_for(pairs, merge_pair, &job);
+        index_entry* t = job.src;
+        job.src = job.dst;
+        job.dst = t;
+        job.width *= 2;
+    }
+
+    // Надгробия в индекс не попадают
+    size_t live = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (!(job.src[i].slot & INDEX_REMOVED)) job.src[live++] = job.src[i];
+    }
+    free(job.dst);
+    free(index->entries);
+    index->entries = job.src;
+    index->count = live;
+    index->removed = 0;
+    index->pending_count = 0;
+    return 1;
+}
+
+static int ensure_built(struct data_base* system) {
+    db_index* idx = system->indexes;
+    if (!idx) return 0;
+    return idx->ready || db_index_build(system);
+}
+
+// ============================================================================
+// Изменения
+// ============================================================================
+
+// Слияние буфера вставок с основным массивом с выбрасыванием удаленных
+static int merge_pending(sorted_index* index) {
+    size_t total = index->count - index->removed + index->pending_count;
+    index_entry* merged = malloc((total ? total : 1) * sizeof(index_entry));
+    if (!merged) return 0;
+
+    size_t i = 0, j = 0, out = 0;
+    while (i < index->count || j < index->pending_count) {
+        if (i < index->count && (index->entries[i].slot & INDEX_REMOVED)) {
+            i++;
+            continue;
+        }
+        if (j >= index->pending_count ||
+            (i < index->count && entry_less(&index->entries[i], &index->pending[j]))) {
+            merged[out++] = index->entries[i++];
+        } else {
+            merged[out++] = index->pending[j++];
+        }
+    }
+    free(index->entries);
+    index->entries = merged;
+    index->count = out;
+    index->removed = 0;
+    index->pending_count = 0;
+    return 1;
+}
+
+static int pending_full(const sorted_index* index) {
+    size_t limit = PENDING_MIN;
+    while (limit * limit < index->count) limit *= 2;
+    return index->pending_count >= limit;
+}
+
+static int index_insert(sorted_index* index, index_entry e) {
+    if (index->pending_count == index->pending_capacity) {
+        size_t capacity = index->pending_capacity ? index->pending_capacity * 2 : PENDING_MIN;
+        index_entry* pending = realloc(index->pending, capacity * sizeof(index_entry));
+        if (!pending) return 0;
+        index->pending = pending;
+        index->pending_capacity = capacity;
+    }
+    size_t pos = lower_bound(index->pending, index->pending_count, &e);
+    memmove(index->pending + pos + 1, index->pending + pos, (index->pending_count - pos) * sizeof(index_entry));
+    index->pending[pos] = e;
+    index->pending_count++;
+    return !pending_full(index) || merge_pending(index);
+}
+
+static void index_remove(sorted_index* index, index_entry e) {
+    size_t pos = lower_bound(index->pending, index->pending_count, &e);
+    if (pos < index->pending_count && index->pending[pos].key == e.key && index->pending[pos].slot == e.slot) {
+        memmove(index->pending + pos, index->pending + pos + 1,
+                (index->pending_count - pos - 1) * sizeof(index_entry));
+        index->pending_count--;
+        return;
+    }
+    pos = lower_bound(index->entries, index->count, &e);
+    if (pos < index->count && index->entries[pos].key == e.key && index->entries[pos].slot == e.slot) {
+        index->entries[pos].slot |= INDEX_REMOVED;
+        index->removed++;
+    }
+}
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+int db_index_enable(struct data_base* system, unsigned mask) {
+    if (!system->indexes) {
+        system->indexes = calloc(1, sizeof(db_index));
+        if (!system->indexes) return 0;
+    }
+    if ((system->indexes->enabled | mask) != system->indexes->enabled) {
+        system->indexes->enabled |= mask & INDEX_ALL;
+        system->indexes->ready = 0;
+    }
+    return 1;
+}
+
+void db_index_disable(struct data_base* system) {
+    db_index* idx = system->indexes;
+    if (!idx) return;
+    for (int f = 0; f < INDEX_COUNT; f++) {
+        free(idx->fields[f].entries);
+        free(idx->fields[f].pending);
+    }
+    free(idx);
+    system->indexes = NULL;
+}
+
+int db_index_build(struct data_base* system) {
+    db_index* idx = system->indexes;
+    if (!idx) return 0;
+    for (int f = 0; f < INDEX_COUNT; f++) {
+        if (!(idx->enabled & INDEX_MASK(f))) continue;
+        if (!build_field(system, &idx->fields[f], (IndexField)f)) {
+            printf("Ошибка: недостаточно памяти для построения индекса\n");
+            idx->ready = 0;
+            return 0;
+        }
+    }
+    idx->ready = 1;
+    return 1;
+}
+
+void db_index_on_add(struct data_base* system, int64_t slot) {
+    db_index* idx = system->indexes;
+    if (!idx || !idx->ready) return;
+    for (int f = 0; f < INDEX_COUNT; f++) {
+        if (!(idx->enabled & INDEX_MASK(f))) continue;
+        index_entry e;
+        e.key = record_key(&system->records[slot], (IndexField)f);
+        e.slot = slot;
+        // Без памяти индекс перестроится при следующем обращении
+        if (!index_insert(&idx->fields[f], e)) idx->ready = 0;
+    }
+}
+
+void db_index_on_remove(struct data_base* system, int64_t slot) {
+    db_index* idx = system->indexes;
+    if (!idx || !idx->ready) return;
+    for (int f = 0; f < INDEX_COUNT; f++) {
+        if (!(idx->enabled & INDEX_MASK(f))) continue;
+        index_entry e;
+        e.key = record_key(&system->records[slot], (IndexField)f);
+        e.slot = slot;
+        index_remove(&idx->fields[f], e);
+    }
+}
+
+void db_index_invalidate(struct data_base* system) {
+    if (system->indexes) system->indexes->ready = 0;
+}
+
+int db_index_range(struct data_base* system, IndexField field, double from, double to, index_iter* it) {
+    memset(it, 0, sizeof(*it));
+    if (field < 0 || field >= INDEX_COUNT || !system->indexes ||
+        !(system->indexes->enabled & INDEX_MASK(field)) || !ensure_built(system)) {
+        return 0;
+    }
+
+    const sorted_index* index = &system->indexes->fields[field];
+    index_entry start;
+    start.key = bound_key(field, from, 1);
+    start.slot = 0;
+    it->index = index;
+    it->key_to = bound_key(field, to, 0);
+    it->pos = lower_bound(index->entries, index->count, &start);
+    it->pending_pos = lower_bound(index->pending, index->pending_count, &start);
+    return 1;
+}
+
+int db_index_range_desc(struct data_base* system, IndexField field, double from, double to, index_iter* it) {
+    if (!db_index_range(system, field, from, to, it)) return 0;
+
+    // Граница сверху: после всех элементов с ключом key_to
+    const sorted_index* index = it->index;
+    index_entry end;
+    end.key = it->key_to;
+    end.slot = INDEX_REMOVED - 1;
+    it->key_from = bound_key(field, from, 1);
+    it->pos = lower_bound(index->entries, index->count, &end);
+    it->pending_pos = lower_bound(index->pending, index->pending_count, &end);
+    it->reverse = 1;
+    return 1;
+}
+
+static int64_t iter_prev(index_iter* it) {
+    const sorted_index* index = it->index;
+    while (it->pos > 0 && (index->entries[it->pos - 1].slot & INDEX_REMOVED)) it->pos--;
+    const index_entry* a = it->pos > 0 ? &index->entries[it->pos - 1] : NULL;
+    const index_entry* b = it->pending_pos > 0 ? &index->pending[it->pending_pos - 1] : NULL;
+    if (a && a->key < it->key_from) a = NULL;
+    if (b && b->key < it->key_from) b = NULL;
+    if (!a && !b) return -1;
+
+    if (a && (!b || entry_less(b, a))) {
+        it->pos--;
+        return a->slot;
+    }
+    it->pending_pos--;
+    return b->slot;
+}
+
+int64_t index_iter_next(index_iter* it) {
+    const sorted_index* index = it->index;
+    if (!index) return -1;
+    if (it->reverse) return iter_prev(it);
+
+    while (it->pos < index->count && (index->entries[it->pos].slot & INDEX_REMOVED)) it->pos++;
+    const index_entry* a = it->pos < index->count ? &index->entries[it->pos] : NULL;
+    const index_entry* b = it->pending_pos < index->pending_count ? &index->pending[it->pending_pos] : NULL;
+    if (a && a->key > it->key_to) a = NULL;
+    if (b && b->key > it->key_to) b = NULL;
+    if (!a && !b) return -1;
+
+    if (a && (!b || entry_less(a, b))) {
+        it->pos++;
+        return a->slot;
+    }
+    it->pending_pos++;
+    return b->slot;
+}
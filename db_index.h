@@ -0,0 +1,82 @@
+#ifndef DB_INDEX_H
+#define DB_INDEX_H
+
+#include "database.h"
+
+// ============================================================================
+// Вторичные индексы data_base по дате, пробегу и цене.
+// Индекс - отсортированный массив пар (ключ, позиция записи) и небольшой
+// отсортированный буфер вставок, который вливается в массив, когда вырастает
+// до ~sqrt(n). Удаленные элементы массива помечаются и выбрасываются при
+// слиянии. add_item / modify_item / delete_item обновляют индексы за
+// O(log n + sqrt n), выборка диапазона стоит O(log n + k).
+// После загрузки и уплотнения индексы строятся заново при первом обращении
+// параллельной сортировкой.
+// ============================================================================
+
+typedef enum {
+    INDEX_DATE = 0,    // номер дня (date_to_days)
+    INDEX_MILEAGE = 1,
+    INDEX_PRICE = 2,
+    INDEX_COUNT = 3
+} IndexField;
+
+#define INDEX_MASK(field) (1u << (field))
+#define INDEX_ALL ((1u << INDEX_COUNT) - 1)
+
+typedef struct index_entry {
+    int64_t key;  // ключ с сохранением порядка (для цены - преобразованные биты float)
+    int64_t slot; // позиция в records; бит INDEX_REMOVED - элемент удален
+} index_entry;
+
+#define INDEX_REMOVED ((int64_t)1 << 62)
+
+typedef struct sorted_index {
+    index_entry* entries; // основной массив, по (key, slot)
+    size_t count;
+    size_t removed;       // помеченных в entries
+    index_entry* pending; // буфер вставок, тоже отсортирован
+    size_t pending_count;
+    size_t pending_capacity;
+} sorted_index;
+
+typedef struct db_index {
+    unsigned enabled; // маска INDEX_MASK
+    int ready;        // 0 - перестроить при следующем обращении
+    sorted_index fields[INDEX_COUNT];
+} db_index;
+
+// Итератор по позициям записей с ключом в диапазоне, в порядке возрастания
+// (или убывания) ключа. Действителен до следующего изменения базы.
+typedef struct index_iter {
+    const sorted_index* index;
+    int64_t key_from;   // обратный обход
+    int64_t key_to;     // прямой обход
+    size_t pos;         // при обратном обходе - число еще не просмотренных
+    size_t pending_pos;
+    int reverse;
+} index_iter;
+
+// Включает индексы по полям из mask (построение откладывается до первого обращения)
+int db_index_enable(struct data_base* system, unsigned mask);
+void db_index_disable(struct data_base* system);
+
+// Строит включенные индексы заново (параллельно)
+int db_index_build(struct data_base* system);
+
+// Вызываются из database.c. on_remove - до изменения/удаления записи в позиции slot,
+// on_add - после записи в позицию slot. invalidate - записи заменены целиком.
+void db_index_on_add(struct data_base* system, int64_t slot);
+void db_index_on_remove(struct data_base* system, int64_t slot);
+void db_index_invalidate(struct data_base* system);
+
+// Диапазон [from, to] включительно. Возвращает 0, если индекс по полю не включен.
+int db_index_range(struct data_base* system, IndexField field, double from, double to, index_iter* it);
+
+// Тот же диапазон в порядке убывания ключа (при равных ключах - убывания позиции)
+int db_index_range_desc(struct data_base* system, IndexField field, double from, double to, index_iter* it);
+
+// Позиция следующей записи или -1
+int64_t index_iter_next(index_iter* it);
+
+#endif // DB_INDEX_H
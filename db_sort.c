@@ -0,0 +1,205 @@
+#include "db_sort.h"
+#include "parallel.h"
+#include "work_dict.h"
+
+#define RADIX_BITS 8
+#define RADIX_SIZE (1 << RADIX_BITS)
+#define SORT_MIN_CHUNK 65536 // меньше кусок не делится между потоками
+
+// ============================================================================
+// Ключи
+// ============================================================================
+
+static uint32_t signed_key(int32_t v) {
+    return (uint32_t)v ^ 0x80000000u;
+}
+
+// Биты float -> беззнаковое с тем же порядком (отрицательные инвертируются целиком)
+static uint32_t float_key(float f) {
+    uint32_t bits;
+    memcpy(&bits, &f, sizeof(bits));
+    return (bits & 0x80000000u) ? ~bits : bits | 0x80000000u;
+}
+
+static int compare_type_ids(const void* a, const void* b) {
+    const work_dict* dict = work_dict_shared();
+    return strcmp(work_dict_get(dict, *(const uint32_t*)a), work_dict_get(dict, *(const uint32_t*)b));
+}
+
+// rank[type_id] - место строки среди всех строк словаря
+uint32_t* db_sort_type_ranks(uint32_t* out_count) {
+    const work_dict* dict = work_dict_shared();
+    uint32_t count = dict->count;
+    uint32_t* order = malloc((count ? count : 1) * sizeof(uint32_t));
+    uint32_t* rank = malloc((count ? count : 1) * sizeof(uint32_t));
+    if (!order || !rank) {
+        free(order);
+        free(rank);
+        return NULL;
+    }
+    for (uint32_t i = 0; i < count; i++) order[i] = i;
+    qsort(order, count, sizeof(uint32_t), compare_type_ids);
+    for (uint32_t i = 0; i < count; i++) rank[order[i]] = i;
+    free(order);
+    *out_count = count;
+    return rank;
+}
+
+uint32_t db_sort_key(const technical_maintenance* r, const sort_key* key,
+                     const uint32_t* ranks, uint32_t rank_count) {
+    uint32_t k;
+    switch (key->field) {
+        case SORT_ID:      k = signed_key(r->id); break;
+        case SORT_DATE:    k = signed_key(r->date); break;
+        case SORT_MILEAGE: k = signed_key(r->mileage); break;
+        case SORT_PRICE:   k = float_key(r->price); break;
+        default:           k = r->type_id < rank_count ? ranks[r->type_id] : 0xffffffffu; break;
+    }
+    return key->descending ? ~k : k;
+}
+
+// ============================================================================
+// Поразрядная сортировка
+// ============================================================================
+
+typedef struct {
+    const struct data_base* system;
+    sort_key key;
+    const uint32_t* ranks;
+    uint32_t rank_count;
+    uint32_t* keys[2];  // ключи текущего поля, в порядке slots
+    int64_t* slots[2];
+    int cur;            // какая половина буферов текущая
+    size_t count;
+    size_t chunk_size;
+    size_t chunks;
+    unsigned shift;
+    size_t* hist;       // [chunks][RADIX_SIZE]; после префиксных сумм - смещения
+} SortJob;
+
+static void chunk_range(const SortJob* job, size_t chunk, size_t* from, size_t* to) {
+    *from = chunk * job->chunk_size;
+    *to = *from + job->chunk_size < job->count ? *from + job->chunk_size : job->count;
+}
+
+static void fill_keys(void* ctx, size_t chunk) {
+    SortJob* job = (SortJob*)ctx;
+    size_t from, to;
+    chunk_range(job, chunk, &from, &to);
+    const int64_t* slots = job->slots[job->cur];
+    uint32_t* keys = job->keys[job->cur];
+    for (size_t i = from; i < to; i++) {
+        keys[i] = db_sort_key(&job->system->records[slots[i]], &job->key, job->ranks, job->rank_count);
+    }
+}
+
+static void count_digits(void* ctx, size_t chunk) {
+    SortJob* job = (SortJob*)ctx;
+    size_t from, to;
+    chunk_range(job, chunk, &from, &to);
+    size_t* hist = job->hist + chunk * RADIX_SIZE;
+    const uint32_t* keys = job->keys[job->cur];
+    memset(hist, 0, RADIX_SIZE * sizeof(size_t));
+    for (size_t i = from; i < to; i++) hist[(keys[i] >> job->shift) & (RADIX_SIZE - 1)]++;
+}
+
+// Каждый кусок пишет в свои смещения по порядку, поэтому проход устойчив
+static void scatter(void* ctx, size_t chunk) {
+    SortJob* job = (SortJob*)ctx;
+    size_t from, to;
+    chunk_range(job, chunk, &from, &to);
+    size_t* offsets = job->hist + chunk * RADIX_SIZE;
+    const uint32_t* keys = job->keys[job->cur];
+    const int64_t* slots = job->slots[job->cur];
+    uint32_t* dst_keys = job->keys[!job->cur];
+    int64_t* dst_slots = job->slots[!job->cur];
+    for (size_t i = from; i < to; i++) {
+        size_t pos = offsets[(keys[i] >> job->shift) & (RADIX_SIZE - 1)]++;
+        dst_keys[pos] = keys[i];
+        dst_slots[pos] = slots[i];
+    }
+}
+
+// Один байт ключа; 0 - все значения байта совпали, проход пропущен
+static int radix_pass(SortJob* job) {
+    parallel_for(job->chunks, count_digits, job);
+
+    size_t running = 0;
+    for (size_t d = 0; d < RADIX_SIZE; d++) {
+        size_t digit_total = 0;
+        for (size_t c = 0; c < job->chunks; c++) {
+            size_t n = job->hist[c * RADIX_SIZE + d];
+            job->hist[c * RADIX_SIZE + d] = running;
+            running += n;
+            digit_total += n;
+        }
+        if (digit_total == job->count) return 0;
+    }
+
+    parallel_for(job->chunks, scatter, job);
+    job->cur = !job->cur;
+    return 1;
+}
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+int64_t db_sort(struct data_base* system, const sort_key* keys, size_t key_count, int64_t** out_slots) {
+    *out_slots = NULL;
+    if (key_count > SORT_MAX_KEYS) {
+        printf("Ошибка: не больше %d полей сортировки\n", SORT_MAX_KEYS);
+        return -1;
+    }
+
+    SortJob job;
+    memset(&job, 0, sizeof(job));
+    job.system = system;
+    job.count = (size_t)db_live_count(system);
+    job.chunks = (size_t)parallel_cpu_count();
+    job.chunk_size = (job.count + job.chunks - 1) / job.chunks;
+    if (job.chunk_size < SORT_MIN_CHUNK) job.chunk_size = SORT_MIN_CHUNK;
+    job.chunks = (job.count + job.chunk_size - 1) / job.chunk_size;
+
+    size_t n = job.count ? job.count : 1;
+    job.slots[0] = malloc(n * sizeof(int64_t));
+    job.slots[1] = malloc(n * sizeof(int64_t));
+    job.keys[0] = malloc(n * sizeof(uint32_t));
+    job.keys[1] = malloc(n * sizeof(uint32_t));
+    job.hist = malloc((job.chunks ? job.chunks : 1) * RADIX_SIZE * sizeof(size_t));
+    int ok = job.slots[0] && job.slots[1] && job.keys[0] && job.keys[1] && job.hist;
+
+    // Начальный порядок - позиции живых записей
+    if (ok) {
+        size_t live = 0;
+        for (int64_t i = 0; i < system->size; i++) {
+            if (!record_is_deleted(&system->records[i])) job.slots[0][live++] = i;
+        }
+    }
+
+    // От младшего поля к старшему: устойчивость сохраняет порядок предыдущих
+    for (size_t k = key_count; k-- > 0 && ok;) {
+        job.key = keys[k];
+        if (job.key.field == SORT_TYPE_WORK && !job.ranks) {
+            uint32_t* ranks = db_sort_type_ranks(&job.rank_count);
+            ok = ranks != NULL;
+            job.ranks = ranks;
+            if (!ok) break;
+        }
+        parallel_for(job.chunks, fill_keys, &job);
+        for (job.shift = 0; job.shift < 32; job.shift += RADIX_BITS) radix_pass(&job);
+    }
+
+    free((void*)job.ranks);
+    free(job.keys[0]);
+    free(job.keys[1]);
+    free(job.hist);
+    free(job.slots[!job.cur]);
+    if (!ok) {
+        printf("Ошибка: недостаточно памяти для сортировки\n");
+        free(job.slots[job.cur]);
+        return -1;
+    }
+    *out_slots = job.slots[job.cur];
+    return (int64_t)job.count;
+}
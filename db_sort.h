@@ -0,0 +1,43 @@
+#ifndef DB_SORT_H
+#define DB_SORT_H
+
+#include "database.h"
+
+// ============================================================================
+// Сортировка data_base по одному или нескольким полям. Записи не двигаются:
+// результат - вектор позиций живых записей в нужном порядке.
+// Каждое поле переводится в 32-битный ключ с сохранением порядка (type_work -
+// в ранг строки среди всех строк словаря), и позиции сортируются
+// поразрядно (LSD, байт за проход) от последнего поля к первому.
+// Проходы устойчивы и параллельны: гистограммы и раскладка по кускам.
+// Записи с равными ключами остаются в порядке позиций.
+// ============================================================================
+
+typedef enum {
+    SORT_ID,
+    SORT_DATE,      // записи без даты идут раньше всех
+    SORT_MILEAGE,
+    SORT_PRICE,
+    SORT_TYPE_WORK  // по строке (побайтово)
+} SortField;
+
+#define SORT_MAX_KEYS 8
+
+typedef struct sort_key {
+    SortField field;
+    int descending;
+} sort_key;
+
+// Позиции живых записей в порядке keys[0], затем keys[1] и т.д.
+// *out_slots - malloc (освобождает вызывающий). Возвращает их число или -1.
+int64_t db_sort(struct data_base* system, const sort_key* keys, size_t key_count, int64_t** out_slots);
+
+// Ключ поля key.field записи r с учетом направления: ключи сравниваются как
+// беззнаковые числа в том же порядке, что и в db_sort (слияние прогонов ext_sort.h).
+// ranks - из db_sort_type_ranks, нужны только для SORT_TYPE_WORK.
+uint32_t db_sort_key(const technical_maintenance* r, const sort_key* key,
+                     const uint32_t* ranks, uint32_t rank_count);
+// Ранги строк общего словаря: ranks[type_id] (malloc) или NULL без памяти
+uint32_t* db_sort_type_ranks(uint32_t* out_count);
+
+#endif // DB_SORT_H
@@ -0,0 +1,461 @@
+#include "ext_sort.h"
+#include "file_io.h"
+
+#define EXT_RECORD_COST 72        // байт на запись прогона: сами записи и буферы db_sort
+#define EXT_IO_RECORDS 32768      // порция чтения/записи одного потока (768 КиБ)
+#define EXT_MAX_IO_RECORDS 1048576
+#define EXT_FENCE_BUFFER (1 << 20)
+
+// ============================================================================
+// Временные файлы прогонов
+// ============================================================================
+
+typedef struct {
+    char** names;
+    uint64_t* counts;
+    size_t count;
+    size_t capacity;
+} run_list;
+
+static char* run_name(const char* output, size_t number) {
+    size_t size = strlen(output) + 32;
+    char* name = malloc(size);
+    if (name) snprintf(name, size, "%s.run%lu.tmp", output, (unsigned long)number);
+    return name;
+}
+
+static int runs_push(run_list* runs, char* name, uint64_t count) {
+    if (runs->count == runs->capacity) {
+        size_t capacity = runs->capacity ? runs->capacity * 2 : 16;
+        char** names = realloc(runs->names, capacity * sizeof(char*));
+        if (!names) return 0;
+        runs->names = names;
+        uint64_t* counts = realloc(runs->counts, capacity * sizeof(uint64_t));
+        if (!counts) return 0;
+        runs->counts = counts;
+        runs->capacity = capacity;
+    }
+    runs->names[runs->count] = name;
+    runs->counts[runs->count++] = count;
+    return 1;
+}
+
+// Удаляет файлы прогонов и освобождает список
+static void runs_discard(run_list* runs) {
+    for (size_t i = 0; i < runs->count; i++) {
+        remove(runs->names[i]);
+        free(runs->names[i]);
+    }
+    free(runs->names);
+    free(runs->counts);
+    memset(runs, 0, sizeof(*runs));
+}
+
+// ============================================================================
+// Приемник отсортированных записей: файл прогона или итоговый файл
+// ============================================================================
+
+typedef struct {
+    v2_stream out;
+    FILE* fence;        // NULL - без .fence
+    char* fence_name;
+    SortField fence_field;
+    int fence_descending;
+    uint64_t written;
+} sink;
+
+static double field_value(const technical_maintenance* r, SortField field) {
+    switch (field) {
+        case SORT_ID:      return r->id;
+        case SORT_DATE:    return r->date;
+        case SORT_MILEAGE: return r->mileage;
+        default:           return r->price;
+    }
+}
+
+static char* fence_name(const char* output) {
+    size_t size = strlen(output) + 8;
+    char* name = malloc(size);
+    if (name) snprintf(name, size, "%s.fence", output);
+    return name;
+}
+
+// fence_key - первое поле сортировки для .fence (NULL - не строить)
+static int sink_open(sink* s, const char* filename, uint64_t count, int with_dict, size_t io_records,
+                     const sort_key* fence_key) {
+    memset(s, 0, sizeof(*s));
+    if (!v2_stream_create(&s->out, filename, count, with_dict, io_records)) return 0;
+    if (!fence_key) return 1;
+
+    s->fence_field = fence_key->field;
+    s->fence_descending = fence_key->descending ? 1 : 0;
+    s->fence_name = fence_name(filename);
+    s->fence = s->fence_name ? fopen(s->fence_name, "wb") : NULL;
+    fence_header header;
+    memset(&header, 0, sizeof(header));
+    // Заголовок дописывается в конце, когда известно число записей
+    if (!s->fence || setvbuf(s->fence, NULL, _IOFBF, EXT_FENCE_BUFFER) != 0 ||
+        fwrite(&header, sizeof(header), 1, s->fence) != 1) {
+        if (s->fence) fclose(s->fence);
+        free(s->fence_name);
+        v2_stream_close(&s->out, NULL);
+        return 0;
+    }
+    return 1;
+}
+
+static int sink_put(sink* s, const technical_maintenance* r) {
+    if (s->fence && s->written % FILE_BLOCK_RECORDS == 0) {
+        double value = field_value(r, s->fence_field);
+        if (fwrite(&value, sizeof(value), 1, s->fence) != 1) return 0;
+    }
+    s->written++;
+    return v2_stream_write(&s->out, r, 1);
+}
+
+static int sink_close(sink* s, int ok) {
+    ok = v2_stream_close(&s->out, NULL) && ok;
+    if (s->fence) {
+        fence_header header;
+        memset(&header, 0, sizeof(header));
+        header.magic = FENCE_MAGIC;
+        header.field = (uint32_t)s->fence_field;
+        header.descending = (uint32_t)s->fence_descending;
+        header.block_records = FILE_BLOCK_RECORDS;
+        header.record_count = s->written;
+        header.entries = (s->written + FILE_BLOCK_RECORDS - 1) / FILE_BLOCK_RECORDS;
+        ok = file_seek(s->fence, 0) && fwrite(&header, sizeof(header), 1, s->fence) == 1 && ok;
+        if (fclose(s->fence) != 0) ok = 0;
+        if (!ok) remove(s->fence_name);
+        free(s->fence_name);
+    }
+    return ok;
+}
+
+// ============================================================================
+// Слияние прогонов
+// ============================================================================
+
+typedef struct {
+    v2_stream in;
+    technical_maintenance* records;
+    size_t count;
+    size_t next;
+    uint32_t key[SORT_MAX_KEYS];
+} merge_source;
+
+typedef struct {
+    const sort_key* keys;
+    size_t key_count;
+    const uint32_t* ranks;
+    uint32_t rank_count;
+    merge_source* sources;
+    size_t* heap;       // номера источников; в корне - следующая запись результата
+    size_t heap_count;
+} merger;
+
+// Равные ключи выдаются в порядке прогонов, поэтому слияние устойчиво
+static int source_less(const merger* m, size_t a, size_t b) {
+    const uint32_t* ka = m->sources[a].key;
+    const uint32_t* kb = m->sources[b].key;
+    for (size_t k = 0; k < m->key_count; k++) {
+        if (ka[k] != kb[k]) return ka[k] < kb[k];
+    }
+    return a < b;
+}
+
+static void sift_down(merger* m, size_t i) {
+    for (;;) {
+        size_t best = i, l = 2 * i + 1, r = l + 1;
+        if (l < m->heap_count && source_less(m, m->heap[l], m->heap[best])) best = l;
+        if (r < m->heap_count && source_less(m, m->heap[r], m->heap[best])) best = r;
+        if (best == i) return;
+        size_t t = m->heap[i];
+        m->heap[i] = m->heap[best];
+        m->heap[best] = t;
+        i = best;
+    }
+}
+
+// Следующая запись источника: 1 - есть, 0 - источник исчерпан, -1 - ошибка чтения
+static int source_advance(merger* m, size_t index, size_t io_records) {
+    merge_source* src = &m->sources[index];
+    if (++src->next >= src->count) {
+        int64_t n = v2_stream_read(&src->in, src->records, io_records);
+        if (n <= 0) return (int)n;
+        src->count = (size_t)n;
+        src->next = 0;
+    }
+    const technical_maintenance* r = &src->records[src->next];
+    for (size_t k = 0; k < m->key_count; k++) {
+        src->key[k] = db_sort_key(r, &m->keys[k], m->ranks, m->rank_count);
+    }
+    return 1;
+}
+
+// Сливает прогоны runs[first, first + k) в приемник
+static int merge_runs(merger* m, const run_list* runs, size_t first, size_t k, size_t io_records, sink* out) {
+    m->sources = calloc(k, sizeof(merge_source));
+    m->heap = malloc(k * sizeof(size_t));
+    m->heap_count = 0;
+    int ok = m->sources && m->heap;
+
+    for (size_t i = 0; i < k && ok; i++) {
+        merge_source* src = &m->sources[i];
+        src->records = malloc(io_records * sizeof(technical_maintenance));
+        ok = src->records && v2_stream_open_read(&src->in, runs->names[first + i], io_records);
+        if (!ok) {
+            free(src->records);
+            src->records = NULL;
+            break;
+        }
+        // Порция пуста: первый source_advance ее читает
+        int state = source_advance(m, i, io_records);
+        if (state < 0) ok = 0;
+        if (state > 0) m->heap[m->heap_count++] = i;
+    }
+    for (size_t i = m->heap_count / 2; i-- > 0;) sift_down(m, i);
+
+    while (ok && m->heap_count > 0) {
+        size_t top = m->heap[0];
+        merge_source* src = &m->sources[top];
+        if (!sink_put(out, &src->records[src->next])) {
+            ok = 0;
+            break;
+        }
+        int state = source_advance(m, top, io_records);
+        if (state < 0) {
+            ok = 0;
+            break;
+        }
+        if (state == 0) m->heap[0] = m->heap[--m->heap_count];
+        sift_down(m, 0);
+    }
+
+    for (size_t i = 0; m->sources && i < k; i++) {
+        if (!m->sources[i].records) continue;
+        // Прогон прочитан до конца - проверяется и итоговая сумма его заголовка
+        if (!v2_stream_close(&m->sources[i].in, NULL)) ok = 0;
+        free(m->sources[i].records);
+    }
+    free(m->sources);
+    free(m->heap);
+    m->sources = NULL;
+    m->heap = NULL;
+    return ok;
+}
+
+static size_t merge_io_records(size_t budget, size_t k) {
+    size_t n = budget / ((k + 1) * sizeof(technical_maintenance));
+    if (n > EXT_MAX_IO_RECORDS) n = EXT_MAX_IO_RECORDS;
+    n = n / FILE_BLOCK_RECORDS * FILE_BLOCK_RECORDS;
+    return n ? n : FILE_BLOCK_RECORDS;
+}
+
+// ============================================================================
+// Прогоны
+// ============================================================================
+
+// Пишет records в порядке slots в приемник
+static int write_sorted(sink* out, const technical_maintenance* records, const int64_t* slots, int64_t count) {
+    for (int64_t i = 0; i < count; i++) {
+        if (!sink_put(out, &records[slots[i]])) return 0;
+    }
+    return 1;
+}
+
+// Порция входа до run_records записей; 0 - конец, -1 - ошибка
+static int64_t read_run(v2_stream* in, technical_maintenance* run, size_t run_records) {
+    size_t filled = 0;
+    while (filled < run_records) {
+        int64_t n = v2_stream_read(in, run + filled, run_records - filled);
+        if (n < 0) return -1;
+        if (n == 0) break;
+        filled += (size_t)n;
+    }
+    return (int64_t)filled;
+}
+
+static int64_t sort_run(technical_maintenance* run, int64_t count, const sort_key* keys, size_t key_count,
+                        int64_t** slots) {
+    // Временная база над массивом прогона: db_sort нужны только записи и размер
+    data_base view;
+    memset(&view, 0, sizeof(view));
+    view.records = run;
+    view.size = count;
+    view.capacity = count;
+    return db_sort(&view, keys, key_count, slots);
+}
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+int external_sort(const char* input, const char* output, const sort_key* keys, size_t key_count,
+                  size_t memory_budget, unsigned flags, ext_sort_stats* stats) {
+    ext_sort_stats local;
+    if (!stats) stats = &local;
+    memset(stats, 0, sizeof(*stats));
+    if (key_count == 0 || key_count > SORT_MAX_KEYS) {
+        printf("Ошибка: нужно от 1 до %d полей сортировки\n", SORT_MAX_KEYS);
+        return 0;
+    }
+    if (memory_budget < EXT_SORT_MIN_BUDGET) memory_budget = EXT_SORT_MIN_BUDGET;
+    const sort_key* fence_key = (flags & EXT_SORT_FENCE) ? &keys[0] : NULL;
+    if (fence_key && fence_key->field == SORT_TYPE_WORK) {
+        printf("Предупреждение: разреженный индекс по type_work не строится\n");
+        fence_key = NULL;
+    }
+
+    v2_stream in;
+    if (!v2_stream_open_read(&in, input, EXT_IO_RECORDS)) {
+        printf("Ошибка: %s не является файлом базы v2 или поврежден\n", input);
+        return 0;
+    }
+    uint64_t total = in.header.record_count;
+    stats->records = total;
+
+    size_t run_records = memory_budget / EXT_RECORD_COST / FILE_BLOCK_RECORDS * FILE_BLOCK_RECORDS;
+    if ((uint64_t)run_records > total) run_records = (size_t)total;
+    technical_maintenance* run = malloc((run_records ? run_records : 1) * sizeof(technical_maintenance));
+    if (!run) {
+        printf("Ошибка: недостаточно памяти для сортировки\n");
+        v2_stream_close(&in, NULL);
+        return 0;
+    }
+
+    // Фаза 1: отсортированные прогоны
+    run_list runs;
+    memset(&runs, 0, sizeof(runs));
+    size_t serial = 0;
+    int ok = 1, single = 0;
+    for (;;) {
+        int64_t n = read_run(&in, run, run_records);
+        if (n < 0) {
+            printf("Ошибка чтения %s: повреждены блоки записей\n", input);
+            ok = 0;
+            break;
+        }
+        if (n == 0 && runs.count > 0) break;
+
+        int64_t* slots = NULL;
+        if (sort_run(run, n, keys, key_count, &slots) < 0) {
+            ok = 0;
+            break;
+        }
+
+        sink out;
+        if ((uint64_t)n == total) {
+            // Весь вход в одном прогоне: сразу в результат
+            single = 1;
+            ok = v2_stream_close(&in, NULL);
+            if (ok) ok = sink_open(&out, output, total, 1, EXT_IO_RECORDS, fence_key);
+            if (ok) ok = sink_close(&out, write_sorted(&out, run, slots, n));
+            free(slots);
+            if (!ok) printf("Ошибка записи %s\n", output);
+            break;
+        }
+
+        char* name = run_name(output, serial++);
+        ok = name && sink_open(&out, name, (uint64_t)n, 0, EXT_IO_RECORDS, NULL);
+        if (ok) ok = sink_close(&out, write_sorted(&out, run, slots, n));
+        free(slots);
+        if (!ok || !runs_push(&runs, name, (uint64_t)n)) {
+            printf("Ошибка записи временного файла прогона\n");
+            if (name) remove(name);
+            free(name);
+            ok = 0;
+            break;
+        }
+    }
+    free(run);
+    if (single || !ok) {
+        if (!single) v2_stream_close(&in, NULL);
+        runs_discard(&runs);
+        stats->runs = single ? 1 : 0;
+        return ok;
+    }
+    if (!v2_stream_close(&in, NULL)) {
+        printf("Ошибка: не совпала контрольная сумма заголовка %s\n", input);
+        runs_discard(&runs);
+        return 0;
+    }
+    stats->runs = runs.count;
+
+    // Фаза 2: слияние. Число путей ограничено буферами чтения в бюджете
+    merger m;
+    memset(&m, 0, sizeof(m));
+    m.keys = keys;
+    m.key_count = key_count;
+    for (size_t k = 0; k < key_count; k++) {
+        if (keys[k].field == SORT_TYPE_WORK && !m.ranks) m.ranks = db_sort_type_ranks(&m.rank_count);
+    }
+    size_t fan_in = memory_budget / ((size_t)EXT_IO_RECORDS * sizeof(technical_maintenance));
+    fan_in = fan_in > 3 ? fan_in - 1 : 2;
+
+    while (ok && runs.count > fan_in) {
+        run_list next;
+        memset(&next, 0, sizeof(next));
+        for (size_t first = 0; first < runs.count && ok; first += fan_in) {
+            size_t k = runs.count - first < fan_in ? runs.count - first : fan_in;
+            uint64_t count = 0;
+            for (size_t i = 0; i < k; i++) count += runs.counts[first + i];
+
+            char* name = run_name(output, serial++);
+            sink out;
+            size_t io = merge_io_records(memory_budget, k);
+            ok = name && sink_open(&out, name, count, 0, io, NULL);
+            if (ok) ok = sink_close(&out, merge_runs(&m, &runs, first, k, io, &out));
+            if (!ok || !runs_push(&next, name, count)) {
+                if (name) remove(name);
+                free(name);
+                ok = 0;
+            }
+        }
+        runs_discard(&runs);
+        runs = next;
+        stats->passes++;
+    }
+
+    if (ok) {
+        sink out;
+        size_t io = merge_io_records(memory_budget, runs.count);
+        ok = sink_open(&out, output, total, 1, io, fence_key);
+        if (ok) ok = sink_close(&out, merge_runs(&m, &runs, 0, runs.count, io, &out));
+        stats->passes++;
+    }
+    if (!ok) printf("Ошибка слияния прогонов в %s\n", output);
+    runs_discard(&runs);
+    free((void*)m.ranks);
+    return ok;
+}
+
+int64_t fence_lookup(const char* output, double value) {
+    char* name = fence_name(output);
+    file_rw* f = name ? file_open_read(name) : NULL;
+    free(name);
+    if (!f) return -1;
+
+    fence_header header;
+    if (!file_pread(f, &header, sizeof(header), 0) || header.magic != FENCE_MAGIC ||
+        header.block_records == 0 ||
+        header.entries != (header.record_count + header.block_records - 1) / header.block_records) {
+        file_close_rw(f);
+        return -1;
+    }
+
+    // Последний блок, первая запись которого строго раньше value:
+    // записи, равные value, могут начинаться уже в нем
+    uint64_t lo = 0, hi = header.entries;
+    int ok = 1;
+    while (lo < hi && ok) {
+        uint64_t mid = lo + (hi - lo) / 2;
+        double v;
+        ok = file_pread(f, &v, sizeof(v), sizeof(header) + mid * sizeof(double));
+        int before = header.descending ? v > value : v < value;
+        if (before) lo = mid + 1; else hi = mid;
+    }
+    file_close_rw(f);
+    if (!ok) return -1;
+    return lo == 0 ? 0 : (int64_t)((lo - 1) * header.block_records);
+}
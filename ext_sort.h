@@ -0,0 +1,50 @@
+#ifndef EXT_SORT_H
+#define EXT_SORT_H
+
+#include "db_sort.h"
+
+// ============================================================================
+// Внешняя сортировка файла базы v2, который не помещается в память.
+// 1. Вход читается порциями по бюджету памяти; каждая порция сортируется
+//    db_sort и сбрасывается во временный файл прогона (<output>.runN.tmp).
+// 2. Прогоны сливаются k-путевым слиянием через кучу; если прогонов больше,
+//    чем позволяет бюджет на буферы чтения, слияние идет в несколько проходов.
+// Все файлы читаются и пишутся большими последовательными порциями (v2_stream),
+// с CRC и сводками блоков. Порядок записей тот же, что у db_sort (устойчивый).
+// Если вход помещается в один прогон, результат пишется сразу, без слияния.
+// ============================================================================
+
+#define EXT_SORT_MIN_BUDGET ((size_t)4 << 20) // меньший бюджет поднимается до этого
+#define EXT_SORT_FENCE 0x1 // рядом с результатом пишется <output>.fence
+
+#define FENCE_MAGIC 0x45434E46 // "FNCE"
+
+// Разреженный индекс отсортированного файла (<output>.fence): значение
+// первого поля сортировки у первой записи каждого блока (FILE_BLOCK_RECORDS).
+// За заголовком - double x entries. Для SORT_TYPE_WORK не строится.
+typedef struct fence_header {
+    uint32_t magic;         // FENCE_MAGIC
+    uint32_t field;         // SortField
+    uint32_t descending;
+    uint32_t block_records; // FILE_BLOCK_RECORDS
+    uint64_t record_count;
+    uint64_t entries;
+} fence_header;
+
+typedef struct ext_sort_stats {
+    uint64_t records;
+    size_t runs;    // прогонов после первой фазы
+    size_t passes;  // проходов слияния (0 - хватило одного прогона)
+} ext_sort_stats;
+
+// Сортирует файл input в файл output (v2 со словарем) по keys.
+// input и output могут совпадать. stats можно не передавать.
+int external_sort(const char* input, const char* output, const sort_key* keys, size_t key_count,
+                  size_t memory_budget, unsigned flags, ext_sort_stats* stats);
+
+// Позиция в отсортированном файле output, с которой начинаются записи
+// со значением первого поля не раньше value (кратна FILE_BLOCK_RECORDS;
+// все записи до нее идут строго раньше value). -1 - нет или поврежден .fence.
+int64_t fence_lookup(const char* output, double value);
+
+#endif // EXT_SORT_H
@@ -0,0 +1,239 @@
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "file_io.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+
+// ============================================================================
+// Отображение файлов в память
+// ============================================================================
+
+void* file_map_private(const char* filename, size_t* out_size) {
+    if (!filename || !out_size) return NULL;
+    *out_size = 0;
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) return NULL;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+        CloseHandle(file);
+        return NULL;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+    CloseHandle(file);
+    if (!mapping) return NULL;
+
+    // Представление остается валидным и после закрытия дескрипторов
+    void* data = MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+    CloseHandle(mapping);
+    if (!data) return NULL;
+
+    *out_size = (size_t)size.QuadPart;
+    return data;
+#else
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) return NULL;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        close(fd);
+        return NULL;
+    }
+
+    void* data = mmap(NULL, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) return NULL;
+
+    *out_size = (size_t)st.st_size;
+    return data;
+#endif
+}
+
+void file_unmap(void* data, size_t size) {
+    if (!data) return;
+#ifdef _WIN32
+    (void)size;
+    UnmapViewOfFile(data);
+#else
+    munmap(data, size);
+#endif
+}
+
+// ============================================================================
+// Надежная запись
+// ============================================================================
+
+int file_sync(FILE* f) {
+    if (!f || fflush(f) != 0) return 0;
+#ifdef _WIN32
+    return _commit(_fileno(f)) == 0;
+#else
+    return fsync(fileno(f)) == 0;
+#endif
+}
+
+int file_truncate(const char* filename, uint64_t size) {
+#ifdef _WIN32
+    HANDLE file = CreateFileA(filename, GENERIC_WRITE, 0, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) return 0;
+    LARGE_INTEGER pos;
+    pos.QuadPart = (LONGLONG)size;
+    int ok = SetFilePointerEx(file, pos, NULL, FILE_BEGIN) && SetEndOfFile(file);
+    CloseHandle(file);
+    return ok;
+#else
+    return truncate(filename, (off_t)size) == 0;
+#endif
+}
+
+int file_replace(const char* from, const char* to) {
+#ifdef _WIN32
+    return MoveFileExA(from, to, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+    return rename(from, to) == 0;
+#endif
+}
+
+int file_size(FILE* f, uint64_t* out_size) {
+    if (!f || !out_size) return 0;
+#ifdef _WIN32
+    __int64 size = _filelengthi64(_fileno(f));
+    if (size < 0) return 0;
+#else
+    struct stat st;
+    if (fstat(fileno(f), &st) != 0 || st.st_size < 0) return 0;
+    off_t size = st.st_size;
+#endif
+    *out_size = (uint64_t)size;
+    return 1;
+}
+
+int file_seek(FILE* f, uint64_t offset) {
+    if (!f) return 0;
+#ifdef _WIN32
+    return _fseeki64(f, (__int64)offset, SEEK_SET) == 0;
+#else
+    return fseeko(f, (off_t)offset, SEEK_SET) == 0;
+#endif
+}
+
+// ============================================================================
+// Позиционный ввод-вывод
+// ============================================================================
+
+struct file_rw {
+#ifdef _WIN32
+    HANDLE handle;
+#else
+    int fd;
+#endif
+};
+
+static file_rw* file_open_mode(const char* filename, int writable) {
+    file_rw* f = (file_rw*)malloc(sizeof(file_rw));
+    if (!f) return NULL;
+#ifdef _WIN32
+    f->handle = CreateFileA(filename, writable ? GENERIC_READ | GENERIC_WRITE : GENERIC_READ,
+                            FILE_SHARE_READ | FILE_SHARE_WRITE, NULL,
+                            OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (f->handle == INVALID_HANDLE_VALUE) {
+        free(f);
+        return NULL;
+    }
+#else
+    f->fd = open(filename, writable ? O_RDWR : O_RDONLY);
+    if (f->fd < 0) {
+        free(f);
+        return NULL;
+    }
+#endif
+    return f;
+}
+
+file_rw* file_open_rw(const char* filename) {
+    return file_open_mode(filename, 1);
+}
+
+file_rw* file_open_read(const char* filename) {
+    return file_open_mode(filename, 0);
+}
+
+void file_close_rw(file_rw* f) {
+    if (!f) return;
+#ifdef _WIN32
+    CloseHandle(f->handle);
+#else
+    close(f->fd);
+#endif
+    free(f);
+}
+
+int file_pread(file_rw* f, void* buf, size_t size, uint64_t offset) {
+    unsigned char* p = (unsigned char*)buf;
+    while (size > 0) {
+#ifdef _WIN32
+        OVERLAPPED ov;
+        memset(&ov, 0, sizeof(ov));
+        ov.Offset = (DWORD)offset;
+        ov.OffsetHigh = (DWORD)(offset >> 32);
+        DWORD chunk = size > 0x40000000u ? 0x40000000u : (DWORD)size;
+        DWORD done = 0;
+        if (!ReadFile(f->handle, p, chunk, &done, &ov) || done == 0) return 0;
+#else
+        ssize_t done = pread(f->fd, p, size, (off_t)offset);
+        if (done <= 0) return 0;
+#endif
+        p += done;
+        size -= (size_t)done;
+        offset += (uint64_t)done;
+    }
+    return 1;
+}
+
+int file_pwrite(file_rw* f, const void* buf, size_t size, uint64_t offset) {
+    const unsigned char* p = (const unsigned char*)buf;
+    while (size > 0) {
+#ifdef _WIN32
+        OVERLAPPED ov;
+        memset(&ov, 0, sizeof(ov));
+        ov.Offset = (DWORD)offset;
+        ov.OffsetHigh = (DWORD)(offset >> 32);
+        DWORD chunk = size > 0x40000000u ? 0x40000000u : (DWORD)size;
+        DWORD done = 0;
+        if (!WriteFile(f->handle, p, chunk, &done, &ov) || done == 0) return 0;
+#else
+        ssize_t done = pwrite(f->fd, p, size, (off_t)offset);
+        if (done <= 0) return 0;
+#endif
+        p += done;
+        size -= (size_t)done;
+        offset += (uint64_t)done;
+    }
+    return 1;
+}
+
+int file_rw_sync(file_rw* f) {
+    if (!f) return 0;
+#ifdef _WIN32
+    return FlushFileBuffers(f->handle) != 0;
+#else
+    return fsync(f->fd) == 0;
+#endif
+}
@@ -0,0 +1,53 @@
+#ifndef FILE_IO_H
+#define FILE_IO_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// ============================================================================
+// Платформенные файловые операции (WinAPI / POSIX)
+// ============================================================================
+
+// Отображает файл в память целиком в режиме copy-on-write:
+// страницы читаются из файла, а запись создает частную копию страницы
+// и никогда не попадает обратно в файл.
+// Возвращает адрес отображения или NULL (пустой файл, ошибка).
+void* file_map_private(const char* filename, size_t* out_size);
+
+// Снятие отображения, созданного file_map_private
+void file_unmap(void* data, size_t size);
+
+// Сброс буферов потока и данных файла на диск (fflush + fsync/_commit)
+int file_sync(FILE* f);
+
+// Обрезка файла до size байт
+int file_truncate(const char* filename, uint64_t size);
+
+// Переименование from в to с заменой существующего to одной операцией
+int file_replace(const char* from, const char* to);
+
+// Размер открытого файла и позиционирование без ограничения long (файлы > 2 ГиБ)
+int file_size(FILE* f, uint64_t* out_size);
+int file_seek(FILE* f, uint64_t offset);
+
+// ============================================================================
+// Позиционный ввод-вывод (pread/pwrite) для обновления файла на месте
+// ============================================================================
+
+typedef struct file_rw file_rw;
+
+// Открывает существующий файл для чтения и записи (file_open_read - только для чтения)
+file_rw* file_open_rw(const char* filename);
+file_rw* file_open_read(const char* filename);
+void file_close_rw(file_rw* f);
+
+// Чтение/запись ровно size байт по смещению offset. Возвращают 1 при успехе.
+int file_pread(file_rw* f, void* buf, size_t size, uint64_t offset);
+int file_pwrite(file_rw* f, const void* buf, size_t size, uint64_t offset);
+
+// Сброс записанных данных файла на диск (fsync / FlushFileBuffers): барьер,
+// после которого можно писать данные, ссылающиеся на уже записанные
+int file_rw_sync(file_rw* f);
+
+#endif // FILE_IO_H
@@ -0,0 +1,691 @@
+#include "filter.h"
+#include "db_index.h"
+#include "work_dict.h"
+#include "trigram.h"
+#include "type_bitmap.h"
+
+#include <ctype.h>
+#include <float.h>
+
+// ============================================================================
+// Байткод
+// ============================================================================
+
+typedef enum { FOP_CMP, FOP_AND, FOP_OR, FOP_NOT } FilterOp;
+typedef enum { FIELD_ID, FIELD_DATE, FIELD_TYPE_WORK, FIELD_MILEAGE, FIELD_PRICE } FilterField;
+typedef enum { CMP_EQ, CMP_NE, CMP_LT, CMP_LE, CMP_GT, CMP_GE, CMP_CONTAINS } FilterCmp;
+
+typedef struct {
+    uint8_t op;      // FilterOp
+    uint8_t field;   // FilterField (FOP_CMP)
+    uint8_t cmp;     // FilterCmp (FOP_CMP)
+    double value;    // число или номер дня
+    uint32_t type_id; // FIELD_TYPE_WORK: id в общем словаре или WORK_DICT_NONE
+    char* text;      // FIELD_TYPE_WORK: строка для поиска id, если ее еще нет в словаре
+                     // (для ~ - подстрока в нижнем регистре, utf8_fold)
+    uint64_t* matches;    // CMP_CONTAINS: бит на id словаря, содержащий подстроку
+    uint32_t match_count; // id словаря, покрытые matches (более новые проверяются по строке)
+} filter_insn;
+
+// Диапазон поля из верхней конъюнкции (надмножество подходящих значений)
+typedef struct {
+    int used;
+    double from;
+    double to;
+} filter_hint;
+
+// Верхнее условие на type_work (= "...", ~ "...", in (...)): сравнения code[first, end),
+// объединенные or. Кандидаты берутся из битовых индексов видов работ (type_bitmap.h).
+typedef struct {
+    int used;
+    size_t first;
+    size_t end;
+} type_hint;
+
+struct filter_program {
+    filter_insn* code;
+    size_t count;
+    size_t capacity;
+    filter_hint hints[INDEX_COUNT];
+    type_hint types;
+};
+
+// ============================================================================
+// Разбор
+// ============================================================================
+
+typedef enum { TOK_END, TOK_WORD, TOK_NUMBER, TOK_DATE, TOK_STRING, TOK_CMP, TOK_LPAREN, TOK_RPAREN, TOK_COMMA, TOK_ERROR } TokenKind;
+
+typedef struct {
+    const char* pos;
+    TokenKind kind;
+    char text[128];
+    double number;
+    int cmp;
+    int depth;     // глубина стека масок в точке разбора
+    int top_or;    // в верхнем уровне встретился or
+    char* error;
+    size_t error_size;
+    filter_program* program;
+} Parser;
+
+static void fail(Parser* p, const char* message, const char* detail) {
+    if (p->kind == TOK_ERROR) return;
+    p->kind = TOK_ERROR;
+    if (p->error) snprintf(p->error, p->error_size, "%s%s", message, detail ? detail : "");
+}
+
+static void next_token(Parser* p) {
+    if (p->kind == TOK_ERROR) return;
+    while (isspace((unsigned char)*p->pos)) p->pos++;
+    const char* s = p->pos;
+    p->text[0] = '\0';
+
+    if (*s == '\0') {
+        p->kind = TOK_END;
+        return;
+    }
+    if (*s == '(' || *s == ')') {
+        p->kind = *s == '(' ? TOK_LPAREN : TOK_RPAREN;
+        p->pos++;
+        return;
+    }
+    if (*s == ',') {
+        p->kind = TOK_COMMA;
+        p->pos++;
+        return;
+    }
+    if (*s == '"') {
+        const char* end = strchr(s + 1, '"');
+        if (!end || (size_t)(end - s - 1) >= sizeof(p->text)) {
+            fail(p, "Ошибка в выражении: незакрытая или слишком длинная строка", NULL);
+            return;
+        }
+        memcpy(p->text, s + 1, (size_t)(end - s - 1));
+        p->text[end - s - 1] = '\0';
+        p->kind = TOK_STRING;
+        p->pos = end + 1;
+        return;
+    }
+
+    static const struct { const char* text; int cmp; } ops[] = {
+        { "<=", CMP_LE }, { ">=", CMP_GE }, { "!=", CMP_NE }, { "<>", CMP_NE }, { "==", CMP_EQ },
+        { "<", CMP_LT }, { ">", CMP_GT }, { "=", CMP_EQ }, { "~", CMP_CONTAINS }
+    };
+    for (size_t i = 0; i < sizeof(ops) / sizeof(ops[0]); i++) {
+        size_t len = strlen(ops[i].text);
+        if (strncmp(s, ops[i].text, len) == 0) {
+            p->kind = TOK_CMP;
+            p->cmp = ops[i].cmp;
+            p->pos += len;
+            return;
+        }
+    }
+    if (strncmp(s, "&&", 2) == 0 || strncmp(s, "||", 2) == 0) {
+        strcpy(p->text, *s == '&' ? "and" : "or");
+        p->kind = TOK_WORD;
+        p->pos += 2;
+        return;
+    }
+    if (*s == '!') {
+        strcpy(p->text, "not");
+        p->kind = TOK_WORD;
+        p->pos++;
+        return;
+    }
+
+    // Слово, число или дата: до пробела, скобки, кавычки или знака сравнения
+    size_t len = 0;
+    while (s[len] && !isspace((unsigned char)s[len]) && !strchr("()\",<>=!&|~", s[len])) len++;
+    if (len == 0 || len >= sizeof(p->text)) {
+        fail(p, "Ошибка в выражении: неожиданный символ около: ", s);
+        return;
+    }
+    memcpy(p->text, s, len);
+    p->text[len] = '\0';
+    p->pos += len;
+
+    int32_t days;
+    char* end = NULL;
+    if (date_to_days(p->text, &days)) {
+        p->kind = TOK_DATE;
+        p->number = days;
+    } else if ((p->number = strtod(p->text, &end)), end && *end == '\0') {
+        p->kind = TOK_NUMBER;
+    } else {
+        for (char* c = p->text; *c; c++) *c = (char)tolower((unsigned char)*c);
+        p->kind = TOK_WORD;
+    }
+}
+
+static int emit(Parser* p, filter_insn insn) {
+    filter_program* prog = p->program;
+    if (prog->count == prog->capacity) {
+        size_t capacity = prog->capacity ? prog->capacity * 2 : 16;
+        filter_insn* code = realloc(prog->code, capacity * sizeof(filter_insn));
+        if (!code) {
+            free(insn.text);
+            free(insn.matches);
+            fail(p, "Ошибка: недостаточно памяти для фильтра", NULL);
+            return 0;
+        }
+        prog->code = code;
+        prog->capacity = capacity;
+    }
+    prog->code[prog->count++] = insn;
+
+    if (insn.op == FOP_CMP && ++p->depth > FILTER_MAX_DEPTH) {
+        fail(p, "Ошибка в выражении: слишком глубокая вложенность", NULL);
+        return 0;
+    }
+    if (insn.op == FOP_AND || insn.op == FOP_OR) p->depth--;
+    return 1;
+}
+
+static void emit_op(Parser* p, FilterOp op) {
+    filter_insn insn;
+    memset(&insn, 0, sizeof(insn));
+    insn.op = (uint8_t)op;
+    emit(p, insn);
+}
+
+// Сужает подсказку для индекса по условию верхней конъюнкции
+static void add_hint(filter_program* prog, const filter_insn* insn) {
+    int index;
+    switch (insn->field) {
+        case FIELD_DATE:    index = INDEX_DATE; break;
+        case FIELD_MILEAGE: index = INDEX_MILEAGE; break;
+        case FIELD_PRICE:   index = INDEX_PRICE; break;
+        default:            return;
+    }
+    if (insn->cmp == CMP_NE) return;
+
+    filter_hint* h = &prog->hints[index];
+    if (!h->used) {
+        h->used = 1;
+        h->from = -DBL_MAX;
+        h->to = DBL_MAX;
+    }
+    // Строгие сравнения дают тот же диапазон: лишние записи отсеет сам фильтр
+    if ((insn->cmp == CMP_GT || insn->cmp == CMP_GE || insn->cmp == CMP_EQ) && insn->value > h->from) {
+        h->from = insn->value;
+    }
+    if ((insn->cmp == CMP_LT || insn->cmp == CMP_LE || insn->cmp == CMP_EQ) && insn->value < h->to) {
+        h->to = insn->value;
+    }
+}
+
+static void parse_or(Parser* p, int top);
+
+static void set_type_hint(filter_program* prog, size_t first, size_t end) {
+    if (prog->types.used) return;
+    prog->types.used = 1;
+    prog->types.first = first;
+    prog->types.end = end;
+}
+
+// type_work = "строка": id ищется сразу, а если строки еще нет в словаре - при проверке
+static int compile_equals(Parser* p, filter_insn* insn) {
+    insn->type_id = work_dict_find(work_dict_shared(), p->text);
+    insn->text = malloc(strlen(p->text) + 1);
+    if (!insn->text) {
+        fail(p, "Ошибка: недостаточно памяти для фильтра", NULL);
+        return 0;
+    }
+    strcpy(insn->text, p->text);
+    return 1;
+}
+
+// type_work in ("a", "b", ...) - равенства, объединенные or
+static void parse_type_set(Parser* p, int top) {
+    size_t first = p->program->count;
+    next_token(p);
+    if (p->kind != TOK_LPAREN) {
+        fail(p, "Ошибка в выражении: после in ожидалась (", NULL);
+        return;
+    }
+    next_token(p);
+    for (size_t items = 0;; items++) {
+        if (p->kind != TOK_STRING) {
+            fail(p, "Ошибка в выражении: в списке in ожидалась строка в кавычках", NULL);
+            return;
+        }
+        filter_insn insn;
+        memset(&insn, 0, sizeof(insn));
+        insn.op = FOP_CMP;
+        insn.field = FIELD_TYPE_WORK;
+        insn.cmp = CMP_EQ;
+        if (!compile_equals(p, &insn) || !emit(p, insn)) return;
+        if (items > 0) emit_op(p, FOP_OR);
+        next_token(p);
+        if (p->kind == TOK_RPAREN) break;
+        if (p->kind != TOK_COMMA) {
+            fail(p, "Ошибка в выражении: в списке in ожидалась , или )", NULL);
+            return;
+        }
+        next_token(p);
+    }
+    if (p->kind == TOK_ERROR) return;
+    if (top) set_type_hint(p->program, first, p->program->count);
+    next_token(p);
+}
+
+// type_work ~ "подстрока": подходящие строки словаря находятся один раз при компиляции
+static int compile_contains(Parser* p, filter_insn* insn) {
+    uint32_t dict_count = work_dict_shared()->count;
+    uint32_t* ids = NULL;
+    insn->text = utf8_fold(p->text);
+    int64_t found = insn->text ? trigram_search(p->text, &ids) : -1;
+    size_t words = ((size_t)dict_count + 63) / 64;
+    insn->matches = found >= 0 ? calloc(words ? words : 1, sizeof(uint64_t)) : NULL;
+    if (!insn->matches) {
+        free(ids);
+        free(insn->text);
+        insn->text = NULL;
+        fail(p, "Ошибка: недостаточно памяти для фильтра", NULL);
+        return 0;
+    }
+    for (int64_t i = 0; i < found; i++) {
+        if (ids[i] < dict_count) insn->matches[ids[i] / 64] |= (uint64_t)1 << (ids[i] % 64);
+    }
+    insn->match_count = dict_count;
+    free(ids);
+    return 1;
+}
+
+static void parse_comparison(Parser* p, int top) {
+    static const struct { const char* name; FilterField field; } fields[] = {
+        { "id", FIELD_ID }, { "date", FIELD_DATE }, { "type_work", FIELD_TYPE_WORK },
+        { "mileage", FIELD_MILEAGE }, { "price", FIELD_PRICE }
+    };
+
+    filter_insn insn;
+    memset(&insn, 0, sizeof(insn));
+    insn.op = FOP_CMP;
+    size_t f = 0;
+    while (f < sizeof(fields) / sizeof(fields[0]) && strcmp(fields[f].name, p->text) != 0) f++;
+    if (p->kind != TOK_WORD || f == sizeof(fields) / sizeof(fields[0])) {
+        fail(p, "Ошибка в выражении: ожидалось поле (id, date, type_work, mileage, price), получено: ",
+             p->kind == TOK_END ? "конец строки" : p->text);
+        return;
+    }
+    insn.field = (uint8_t)fields[f].field;
+
+    next_token(p);
+    if (insn.field == FIELD_TYPE_WORK && p->kind == TOK_WORD && strcmp(p->text, "in") == 0) {
+        parse_type_set(p, top);
+        return;
+    }
+    if (p->kind != TOK_CMP) {
+        fail(p, "Ошибка в выражении: ожидался знак сравнения после ", fields[f].name);
+        return;
+    }
+    insn.cmp = (uint8_t)p->cmp;
+    next_token(p);
+
+    if (insn.field == FIELD_TYPE_WORK) {
+        if (p->kind != TOK_STRING) {
+            fail(p, "Ошибка в выражении: type_work сравнивается со строкой в кавычках", NULL);
+            return;
+        }
+        if (insn.cmp == CMP_CONTAINS) {
+            if (!compile_contains(p, &insn)) return;
+        } else if (insn.cmp != CMP_EQ && insn.cmp != CMP_NE) {
+            fail(p, "Ошибка в выражении: для type_work допустимы только =, !=, ~ и in", NULL);
+            return;
+        } else if (!compile_equals(p, &insn)) {
+            return;
+        }
+    } else if (insn.cmp == CMP_CONTAINS) {
+        fail(p, "Ошибка в выражении: ~ (содержит) допустимо только для type_work", NULL);
+        return;
+    } else if (insn.field == FIELD_DATE) {
+        int32_t days;
+        if (p->kind == TOK_DATE || p->kind == TOK_NUMBER) {
+            insn.value = p->number;
+        } else if (p->kind == TOK_STRING && date_to_days(p->text, &days)) {
+            insn.value = days;
+        } else {
+            fail(p, "Ошибка в выражении: ожидалась дата дд.мм.гггг", NULL);
+            return;
+        }
+    } else if (p->kind == TOK_NUMBER) {
+        insn.value = p->number;
+    } else {
+        fail(p, "Ошибка в выражении: ожидалось число после ", fields[f].name);
+        return;
+    }
+
+    if (!emit(p, insn)) return;
+    if (top) add_hint(p->program, &insn);
+    if (top && insn.field == FIELD_TYPE_WORK && insn.cmp != CMP_NE) {
+        set_type_hint(p->program, p->program->count - 1, p->program->count);
+    }
+    next_token(p);
+}
+
+static void parse_unary(Parser* p, int top) {
+    if (p->kind == TOK_WORD && strcmp(p->text, "not") == 0) {
+        next_token(p);
+        parse_unary(p, 0);
+        emit_op(p, FOP_NOT);
+    } else if (p->kind == TOK_LPAREN) {
+        next_token(p);
+        parse_or(p, 0);
+        if (p->kind != TOK_RPAREN) {
+            fail(p, "Ошибка в выражении: ожидалась )", NULL);
+            return;
+        }
+        next_token(p);
+    } else {
+        parse_comparison(p, top);
+    }
+}
+
+static void parse_and(Parser* p, int top) {
+    parse_unary(p, top);
+    while (p->kind == TOK_WORD && strcmp(p->text, "and") == 0) {
+        next_token(p);
+        parse_unary(p, top);
+        emit_op(p, FOP_AND);
+    }
+}
+
+static void parse_or(Parser* p, int top) {
+    parse_and(p, top);
+    while (p->kind == TOK_WORD && strcmp(p->text, "or") == 0) {
+        if (top) p->top_or = 1;
+        next_token(p);
+        parse_and(p, top);
+        emit_op(p, FOP_OR);
+    }
+}
+
+// ============================================================================
+// Выполнение
+// ============================================================================
+
+#define CMP_LOOP(get)                                                              \
+    switch (insn->cmp) {                                                           \
+        case CMP_EQ: for (size_t i = 0; i < n; i++) out[i] = (get) == v; break;    \
+        case CMP_NE: for (size_t i = 0; i < n; i++) out[i] = (get) != v; break;    \
+        case CMP_LT: for (size_t i = 0; i < n; i++) out[i] = (get) < v; break;     \
+        case CMP_LE: for (size_t i = 0; i < n; i++) out[i] = (get) <= v; break;    \
+        case CMP_GT: for (size_t i = 0; i < n; i++) out[i] = (get) > v; break;     \
+        default:     for (size_t i = 0; i < n; i++) out[i] = (get) >= v; break;    \
+    }
+
+static void eval_cmp(const filter_insn* insn, const technical_maintenance* r, size_t n, uint8_t* out) {
+    double v = insn->value;
+    switch (insn->field) {
+        case FIELD_ID:      CMP_LOOP((double)r[i].id); break;
+        case FIELD_MILEAGE: CMP_LOOP((double)r[i].mileage); break;
+        case FIELD_PRICE:   CMP_LOOP((double)r[i].price); break;
+        case FIELD_DATE:
+            // Записи без даты не проходят ни одно сравнение, кроме !=
+            CMP_LOOP((double)r[i].date);
+            for (size_t i = 0; i < n; i++) {
+                if (r[i].date == DATE_NONE) out[i] = insn->cmp == CMP_NE;
+            }
+            break;
+        default: {
+            if (insn->cmp == CMP_CONTAINS) {
+                // Строки, добавленные в словарь после компиляции, проверяются по тексту
+                const work_dict* dict = work_dict_shared();
+                for (size_t i = 0; i < n; i++) {
+                    uint32_t id = r[i].type_id;
+                    out[i] = id < insn->match_count
+                                 ? (uint8_t)((insn->matches[id / 64] >> (id % 64)) & 1)
+                                 : (uint8_t)utf8_contains_folded(work_dict_get(dict, id), insn->text);
+                }
+                break;
+            }
+            // Строки, которой нет в словаре, нет и ни в одной записи
+            uint32_t id = insn->type_id != WORK_DICT_NONE ? insn->type_id
+                                                          : work_dict_find(work_dict_shared(), insn->text);
+            uint8_t eq = insn->cmp == CMP_EQ;
+            if (id == WORK_DICT_NONE) {
+                memset(out, !eq, n);
+            } else {
+                for (size_t i = 0; i < n; i++) out[i] = (uint8_t)((r[i].type_id == id) == eq);
+            }
+            break;
+        }
+    }
+}
+
+// Маска результата в stack[0]
+static void eval_masks(const filter_program* program, const technical_maintenance* records, size_t n,
+                       uint8_t stack[FILTER_MAX_DEPTH][FILTER_BATCH]) {
+    size_t top = 0;
+    for (size_t pc = 0; pc < program->count; pc++) {
+        const filter_insn* insn = &program->code[pc];
+        switch (insn->op) {
+            case FOP_CMP:
+                eval_cmp(insn, records, n, stack[top++]);
+                break;
+            case FOP_AND:
+                top--;
+                for (size_t i = 0; i < n; i++) stack[top - 1][i] &= stack[top][i];
+                break;
+            case FOP_OR:
+                top--;
+                for (size_t i = 0; i < n; i++) stack[top - 1][i] |= stack[top][i];
+                break;
+            default:
+                for (size_t i = 0; i < n; i++) stack[top - 1][i] ^= 1;
+                break;
+        }
+    }
+}
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+filter_program* filter_compile(const char* expr, char* error, size_t error_size) {
+    filter_program* program = calloc(1, sizeof(filter_program));
+    if (!program) return NULL;
+
+    Parser p;
+    memset(&p, 0, sizeof(p));
+    p.pos = expr ? expr : "";
+    p.kind = TOK_END;
+    p.error = error;
+    p.error_size = error_size;
+    p.program = program;
+    if (error && error_size) error[0] = '\0';
+
+    next_token(&p);
+    parse_or(&p, 1);
+    if (p.kind != TOK_END && p.kind != TOK_ERROR) {
+        fail(&p, "Ошибка в выражении: лишний текст: ", p.text);
+    }
+    if (p.kind == TOK_ERROR) {
+        filter_free(program);
+        return NULL;
+    }
+    if (p.top_or) {
+        memset(program->hints, 0, sizeof(program->hints));
+        program->types.used = 0;
+    }
+    return program;
+}
+
+void filter_free(filter_program* program) {
+    if (!program) return;
+    for (size_t i = 0; i < program->count; i++) {
+        free(program->code[i].text);
+        free(program->code[i].matches);
+    }
+    free(program->code);
+    free(program);
+}
+
+int filter_match(const filter_program* program, const technical_maintenance* record) {
+    uint32_t index;
+    return filter_eval_batch(program, record, 1, &index) == 1;
+}
+
+size_t filter_eval_batch(const filter_program* program, const technical_maintenance* records,
+                         size_t count, uint32_t* selection) {
+    uint8_t stack[FILTER_MAX_DEPTH][FILTER_BATCH];
+    if (count > FILTER_BATCH) count = FILTER_BATCH;
+    eval_masks(program, records, count, stack);
+
+    size_t selected = 0;
+    for (size_t i = 0; i < count; i++) {
+        selection[selected] = (uint32_t)i;
+        selected += stack[0][i] & !record_is_deleted(&records[i]);
+    }
+    return selected;
+}
+
+static int compare_slots(const void* a, const void* b) {
+    int64_t x = *(const int64_t*)a, y = *(const int64_t*)b;
+    return (x > y) - (x < y);
+}
+
+// Позиции-кандидаты из индекса по первому полю подсказки, для которого индекс включен
+static int64_t* index_candidates(const filter_program* program, struct data_base* system, size_t* out_count) {
+    for (int f = 0; f < INDEX_COUNT; f++) {
+        const filter_hint* h = &program->hints[f];
+        index_iter it;
+        if (!h->used || !system->indexes || !(system->indexes->enabled & INDEX_MASK(f)) ||
+            !db_index_range(system, (IndexField)f, h->from, h->to, &it)) {
+            continue;
+        }
+
+        size_t count = 0, capacity = 1024;
+        int64_t* slots = malloc(capacity * sizeof(int64_t));
+        int64_t slot;
+        while (slots && (slot = index_iter_next(&it)) >= 0) {
+            if (count == capacity) {
+                int64_t* grown = realloc(slots, capacity * 2 * sizeof(int64_t));
+                if (!grown) {
+                    free(slots);
+                    slots = NULL;
+                    break;
+                }
+                slots = grown;
+                capacity *= 2;
+            }
+            slots[count++] = slot;
+        }
+        if (!slots) return NULL;
+        qsort(slots, count, sizeof(int64_t), compare_slots);
+        *out_count = count;
+        return slots;
+    }
+    return NULL;
+}
+
+static int type_matches(const filter_insn* insn, uint32_t id) {
+    if (insn->cmp == CMP_CONTAINS) {
+        return id < insn->match_count ? (int)((insn->matches[id / 64] >> (id % 64)) & 1)
+                                      : utf8_contains_folded(work_dict_get(work_dict_shared(), id), insn->text);
+    }
+    uint32_t wanted = insn->type_id != WORK_DICT_NONE ? insn->type_id
+                                                      : work_dict_find(work_dict_shared(), insn->text);
+    return id == wanted;
+}
+
+// Позиции-кандидаты из битовых индексов видов работ: объединение множеств
+// всех id словаря, подходящих под верхнее условие на type_work (уже по возрастанию)
+static int64_t* type_candidates(const filter_program* program, struct data_base* system, size_t* out_count) {
+    const type_hint* h = &program->types;
+    if (!h->used || !system->type_bitmaps) return NULL;
+
+    const work_dict* dict = work_dict_shared();
+    uint32_t* ids = malloc((dict->count ? dict->count : 1) * sizeof(uint32_t));
+    if (!ids) return NULL;
+    size_t id_count = 0;
+    for (uint32_t id = 0; id < dict->count; id++) {
+        for (size_t pc = h->first; pc < h->end; pc++) {
+            const filter_insn* insn = &program->code[pc];
+            if (insn->op == FOP_CMP && type_matches(insn, id)) {
+                ids[id_count++] = id;
+                break;
+            }
+        }
+    }
+
+    roaring set;
+    roaring_init(&set);
+    int64_t* slots = NULL;
+    int64_t count = type_bitmaps_union(system, ids, id_count, &set) ? roaring_to_slots(&set, &slots) : -1;
+    roaring_free(&set);
+    free(ids);
+    if (count < 0) return NULL;
+    *out_count = (size_t)count;
+    return slots;
+}
+
+int64_t filter_select(const filter_program* program, struct data_base* system, int64_t** out_slots) {
+    *out_slots = NULL;
+    size_t candidates_count = 0;
+    int64_t* candidates = type_candidates(program, system, &candidates_count);
+    if (!candidates) candidates = index_candidates(program, system, &candidates_count);
+    size_t total = candidates ? candidates_count : (size_t)system->size;
+
+    int64_t* result = malloc((total ? total : 1) * sizeof(int64_t));
+    technical_maintenance* gathered = candidates ? malloc(FILTER_BATCH * sizeof(technical_maintenance)) : NULL;
+    if (!result || (candidates && !gathered)) {
+        printf("Ошибка: недостаточно памяти для фильтра\n");
+        free(result);
+        free(gathered);
+        free(candidates);
+        return -1;
+    }
+
+    uint32_t selection[FILTER_BATCH];
+    int64_t found = 0;
+    for (size_t first = 0; first < total; first += FILTER_BATCH) {
+        size_t n = total - first < FILTER_BATCH ? total - first : FILTER_BATCH;
+        const technical_maintenance* batch = system->records + first;
+        if (candidates) {
+            // Кандидаты из индекса собираются в плотную пачку
+            for (size_t i = 0; i < n; i++) gathered[i] = system->records[candidates[first + i]];
+            batch = gathered;
+        }
+        size_t selected = filter_eval_batch(program, batch, n, selection);
+        for (size_t i = 0; i < selected; i++) {
+            result[found++] = candidates ? candidates[first + selection[i]] : (int64_t)(first + selection[i]);
+        }
+    }
+
+    free(gathered);
+    free(candidates);
+    *out_slots = result;
+    return found;
+}
+
+int64_t filter_bitmap(const filter_program* program, struct data_base* system, uint64_t* bits) {
+    size_t words = ((size_t)system->size + 63) / 64;
+    memset(bits, 0, words * sizeof(uint64_t));
+
+    // По виду работ проверяются только позиции из битовых индексов
+    if (program->types.used && system->type_bitmaps) {
+        int64_t* slots = NULL;
+        int64_t found = filter_select(program, system, &slots);
+        if (found >= 0) {
+            for (int64_t i = 0; i < found; i++) bits[slots[i] / 64] |= (uint64_t)1 << (slots[i] % 64);
+            free(slots);
+            return found;
+        }
+    }
+
+    // Пачки кратны 64, поэтому слова карты заполняются по порядку
+    uint32_t selection[FILTER_BATCH];
+    int64_t found = 0;
+    for (size_t first = 0; first < (size_t)system->size; first += FILTER_BATCH) {
+        size_t n = (size_t)system->size - first < FILTER_BATCH ? (size_t)system->size - first : FILTER_BATCH;
+        size_t selected = filter_eval_batch(program, system->records + first, n, selection);
+        for (size_t i = 0; i < selected; i++) {
+            size_t slot = first + selection[i];
+            bits[slot / 64] |= (uint64_t)1 << (slot % 64);
+        }
+        found += (int64_t)selected;
+    }
+    return found;
+}
@@ -0,0 +1,49 @@
+#ifndef FILTER_H
+#define FILTER_H
+
+#include "database.h"
+
+// ============================================================================
+// Фильтр записей по выражению, например:
+//   mileage > 50000 and type_work = "замена масла" and date >= 01.01.2024
+// Поля: id, date, type_work, mileage, price. Сравнения: = != < <= > >=
+// (для type_work только =, != и ~ - содержит подстроку без учета регистра,
+// см. trigram.h), а также type_work in ("a", "b") - один из видов работ.
+// Связки: and, or, not, скобки.
+// Даты пишутся как дд.мм.гггг (можно в кавычках), строки - в двойных кавычках.
+//
+// Выражение один раз компилируется в плоский байткод стековой машины.
+// Записи проверяются пачками по FILTER_BATCH: каждая инструкция проходит
+// по всей пачке одним циклом и оставляет байтовую маску на стеке, в конце
+// маска превращается в вектор выбранных позиций.
+// ============================================================================
+
+#define FILTER_BATCH 1024
+#define FILTER_MAX_DEPTH 16 // глубина стека масок
+
+typedef struct filter_program filter_program;
+
+// Компиляция. При ошибке возвращает NULL и пишет сообщение в error (может быть NULL).
+filter_program* filter_compile(const char* expr, char* error, size_t error_size);
+void filter_free(filter_program* program);
+
+// Проверка одной записи
+int filter_match(const filter_program* program, const technical_maintenance* record);
+
+// Пачка из count <= FILTER_BATCH записей подряд: в selection пишутся номера
+// подходящих записей внутри пачки. Надгробия не выбираются. Возвращает их число.
+size_t filter_eval_batch(const filter_program* program, const technical_maintenance* records,
+                         size_t count, uint32_t* selection);
+
+// Все подходящие записи базы в порядке позиций. *out_slots - malloc (освобождает вызывающий).
+// Если в верхней конъюнкции есть условие на поле с включенным индексом (db_index.h),
+// проверяются только записи из диапазона индекса; условие на type_work в ней при
+// включенных битовых индексах (type_bitmap.h) сужает проверку до их объединения.
+// Возвращает число записей или -1.
+int64_t filter_select(const filter_program* program, struct data_base* system, int64_t** out_slots);
+
+// То же в виде битовой карты по позициям (бит i - слово i / 64) для ядер soa.h.
+// bits - (size + 63) / 64 слов, заполняется целиком. Возвращает число записей.
+int64_t filter_bitmap(const filter_program* program, struct data_base* system, uint64_t* bits);
+
+#endif // FILTER_H
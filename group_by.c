@@ -0,0 +1,234 @@
+#include "group_by.h"
+#include "parallel.h"
+#include "work_dict.h"
+
+// ============================================================================
+// Хеш-таблица групп
+// ============================================================================
+
+typedef struct {
+    uint64_t* keys;     // keys[i] - ключ строки rows[i]
+    group_row* rows;    // плотный массив групп
+    size_t count;
+    size_t capacity;
+    uint32_t* slots;    // открытая адресация: номер строки + 1, 0 = пусто
+    size_t slot_count;  // степень двойки
+} group_table;
+
+static uint64_t group_key(uint32_t type_id, int32_t month) {
+    return ((uint64_t)type_id << 32) | (uint32_t)month;
+}
+
+static size_t key_hash(uint64_t key, size_t mask) {
+    key ^= key >> 29;
+    key *= 0xbf58476d1ce4e5b9ull;
+    key ^= key >> 32;
+    return (size_t)key & mask;
+}
+
+static void table_free(group_table* t) {
+    free(t->keys);
+    free(t->rows);
+    free(t->slots);
+    memset(t, 0, sizeof(*t));
+}
+
+static int table_grow(group_table* t) {
+    size_t slot_count = t->slot_count ? t->slot_count * 2 : 64;
+    uint32_t* slots = calloc(slot_count, sizeof(uint32_t));
+    if (!slots) return 0;
+    for (size_t i = 0; i < t->count; i++) {
+        size_t h = key_hash(t->keys[i], slot_count - 1);
+        while (slots[h]) h = (h + 1) & (slot_count - 1);
+        slots[h] = (uint32_t)(i + 1);
+    }
+    free(t->slots);
+    t->slots = slots;
+    t->slot_count = slot_count;
+    return 1;
+}
+
+// Строка группы по ключу (создается при первом обращении) или NULL без памяти
+static group_row* table_find(group_table* t, uint64_t key) {
+    if (t->slot_count) {
+        size_t mask = t->slot_count - 1;
+        for (size_t h = key_hash(key, mask); t->slots[h]; h = (h + 1) & mask) {
+            if (t->keys[t->slots[h] - 1] == key) return &t->rows[t->slots[h] - 1];
+        }
+    }
+
+    // Заполнение не больше половины
+    if ((t->count + 1) * 2 > t->slot_count && !table_grow(t)) return NULL;
+    if (t->count == t->capacity) {
+        size_t capacity = t->capacity ? t->capacity * 2 : 16;
+        uint64_t* keys = realloc(t->keys, capacity * sizeof(uint64_t));
+        if (!keys) return NULL;
+        t->keys = keys;
+        group_row* rows = realloc(t->rows, capacity * sizeof(group_row));
+        if (!rows) return NULL;
+        t->rows = rows;
+        t->capacity = capacity;
+    }
+
+    size_t mask = t->slot_count - 1;
+    size_t h = key_hash(key, mask);
+    while (t->slots[h]) h = (h + 1) & mask;
+    t->slots[h] = (uint32_t)(t->count + 1);
+
+    group_row* row = &t->rows[t->count];
+    row->type_id = (uint32_t)(key >> 32);
+    row->month = (int32_t)(uint32_t)key;
+    row->count = 0;
+    row->sum = 0;
+    row->min = 0;
+    row->max = 0;
+    t->keys[t->count++] = key;
+    return row;
+}
+
+static void row_add(group_row* row, double value) {
+    if (row->count == 0 || value < row->min) row->min = value;
+    if (row->count == 0 || value > row->max) row->max = value;
+    row->sum += value;
+    row->count++;
+}
+
+static void row_merge(group_row* dst, const group_row* src) {
+    if (dst->count == 0 || src->min < dst->min) dst->min = src->min;
+    if (dst->count == 0 || src->max > dst->max) dst->max = src->max;
+    dst->sum += src->sum;
+    dst->count += src->count;
+}
+
+// ============================================================================
+// Морсели
+// ============================================================================
+
+typedef struct {
+    const struct data_base* system;
+    unsigned keys;
+    AggField field;
+    const filter_program* where;
+    group_table* tables; // по одной на морсель
+    int failed;
+} GroupJob;
+
+static int add_record(GroupJob* job, group_table* t, const technical_maintenance* r) {
+    uint32_t type_id = (job->keys & GROUP_BY_TYPE_WORK) ? r->type_id : WORK_DICT_NONE;
+    int32_t month = (job->keys & GROUP_BY_MONTH) ? date_month(r->date) : -1;
+    group_row* row = table_find(t, group_key(type_id, month));
+    if (!row) return 0;
+    row_add(row, job->field == AGG_PRICE ? (double)r->price : (double)r->mileage);
+    return 1;
+}
+
+static void group_morsel(void* ctx, size_t morsel) {
+    GroupJob* job = (GroupJob*)ctx;
+    group_table* t = &job->tables[morsel];
+    size_t from = morsel * GROUP_MORSEL;
+    size_t to = from + GROUP_MORSEL < (size_t)job->system->size ? from + GROUP_MORSEL : (size_t)job->system->size;
+    const technical_maintenance* records = job->system->records;
+
+    for (size_t first = from; first < to; first += FILTER_BATCH) {
+        size_t n = to - first < FILTER_BATCH ? to - first : FILTER_BATCH;
+        if (job->where) {
+            uint32_t selection[FILTER_BATCH];
+            size_t selected = filter_eval_batch(job->where, records + first, n, selection);
+            for (size_t i = 0; i < selected; i++) {
+                if (!add_record(job, t, &records[first + selection[i]])) goto fail;
+            }
+        } else {
+            for (size_t i = first; i < first + n; i++) {
+                if (!record_is_deleted(&records[i]) && !add_record(job, t, &records[i])) goto fail;
+            }
+        }
+    }
+    return;
+
+fail:
+    job->failed = 1;
+}
+
+static int compare_rows(const void* a, const void* b) {
+    const group_row* x = (const group_row*)a;
+    const group_row* y = (const group_row*)b;
+    if (x->month != y->month) return x->month < y->month ? -1 : 1;
+    if (x->type_id == y->type_id) return 0;
+    const work_dict* dict = work_dict_shared();
+    const char* sx = work_dict_get(dict, x->type_id);
+    const char* sy = work_dict_get(dict, y->type_id);
+    return strcmp(sx ? sx : "", sy ? sy : "");
+}
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+int group_by(struct data_base* system, unsigned keys, AggField field,
+             const filter_program* where, group_result* result) {
+    memset(result, 0, sizeof(*result));
+    size_t morsels = ((size_t)system->size + GROUP_MORSEL - 1) / GROUP_MORSEL;
+
+    GroupJob job;
+    job.system = system;
+    job.keys = keys;
+    job.field = field;
+    job.where = where;
+    job.failed = 0;
+    job.tables = calloc(morsels ? morsels : 1, sizeof(group_table));
+    if (!job.tables) {
+        printf("Ошибка: недостаточно памяти для группировки\n");
+        return 0;
+    }
+    parallel_for(morsels, group_morsel, &job);
+
+    // Слияние в таблицу первого морселя
+    group_table* total = &job.tables[0];
+    for (size_t m = 1; m < morsels && !job.failed; m++) {
+        const group_table* t = &job.tables[m];
+        for (size_t i = 0; i < t->count; i++) {
+            group_row* row = table_find(total, t->keys[i]);
+            if (!row) {
+                job.failed = 1;
+                break;
+            }
+            row_merge(row, &t->rows[i]);
+        }
+    }
+    for (size_t m = 1; m < morsels; m++) table_free(&job.tables[m]);
+
+    if (job.failed) {
+        printf("Ошибка: недостаточно памяти для группировки\n");
+        table_free(total);
+        free(job.tables);
+        return 0;
+    }
+
+    result->rows = total->rows;
+    result->count = total->count;
+    total->rows = NULL;
+    group_result_sort(result);
+    table_free(total);
+    free(job.tables);
+    return 1;
+}
+
+void group_result_free(group_result* result) {
+    free(result->rows);
+    result->rows = NULL;
+    result->count = 0;
+}
+
+void group_result_sort(group_result* result) {
+    if (result->count > 1) qsort(result->rows, result->count, sizeof(group_row), compare_rows);
+}
+
+double group_value(const group_row* row, AggFunc func) {
+    switch (func) {
+        case AGG_COUNT: return (double)row->count;
+        case AGG_SUM:   return row->sum;
+        case AGG_MIN:   return row->min;
+        case AGG_MAX:   return row->max;
+        default:        return row->count ? row->sum / (double)row->count : 0.0;
+    }
+}
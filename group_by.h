@@ -0,0 +1,60 @@
+#ifndef GROUP_BY_H
+#define GROUP_BY_H
+
+#include "database.h"
+#include "filter.h"
+
+// ============================================================================
+// Группировка записей с агрегатами: число, сумма, минимум, максимум, среднее.
+// Ключ группы - type_work, месяц даты или оба сразу. Записи делятся на
+// морсели по GROUP_MORSEL, каждый морсель считается в своей хеш-таблице
+// (открытая адресация) в пуле потоков, затем таблицы сливаются в одну.
+// ============================================================================
+
+#define GROUP_BY_TYPE_WORK 0x1
+#define GROUP_BY_MONTH     0x2
+
+#define GROUP_MORSEL 16384 // записей на одну задачу пула
+
+typedef enum {
+    AGG_PRICE,
+    AGG_MILEAGE
+} AggField;
+
+typedef enum {
+    AGG_COUNT,
+    AGG_SUM,
+    AGG_MIN,
+    AGG_MAX,
+    AGG_AVG
+} AggFunc;
+
+typedef struct group_row {
+    uint32_t type_id; // id в общем словаре; WORK_DICT_NONE - без группировки по type_work
+    int32_t month;    // гггг*100 + мм (date_month), 0 - без даты; -1 - без группировки по месяцу
+    int64_t count;
+    double sum;
+    double min;
+    double max;
+} group_row;
+
+typedef struct group_result {
+    group_row* rows; // по месяцу, затем по type_work
+    size_t count;
+} group_result;
+
+// Группирует живые записи по полям из keys (0 - одна общая группа) и считает
+// агрегаты по field. where - необязательный фильтр (NULL - все записи).
+// Возвращает 1 при успехе; result освобождается group_result_free.
+int group_by(struct data_base* system, unsigned keys, AggField field,
+             const filter_program* where, group_result* result);
+
+void group_result_free(group_result* result);
+
+// Сортирует строки по месяцу, затем по type_work (как в результате group_by)
+void group_result_sort(group_result* result);
+
+// Значение агрегата для строки результата
+double group_value(const group_row* row, AggFunc func);
+
+#endif // GROUP_BY_H
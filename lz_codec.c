@@ -0,0 +1,160 @@
+#include "lz_codec.h"
+
+#include <string.h>
+
+#define LZ_MIN_MATCH     4
+#define LZ_MAX_OFFSET    65535
+#define LZ_HASH_BITS     13
+#define LZ_HASH_SIZE     (1u << LZ_HASH_BITS)
+#define LZ_LAST_LITERALS 5
+
+// ============================================================================
+// Internal utilities
+// ============================================================================
+
+static unsigned int lz_read32(const unsigned char* p) {
+    return (unsigned int)p[0] | ((unsigned int)p[1] << 8) |
+           ((unsigned int)p[2] << 16) | ((unsigned int)p[3] << 24);
+}
+
+static unsigned int lz_hash(unsigned int v) {
+    return (v * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+// Длина 15+ кодируется продолжением: байты 255..., затем остаток
+static unsigned char* lz_write_length(unsigned char* op, size_t len) {
+    while (len >= 255) {
+        *op++ = 255;
+        len -= 255;
+    }
+    *op++ = (unsigned char)len;
+    return op;
+}
+
+static unsigned char* lz_emit(unsigned char* op, const unsigned char* lit, size_t lit_len,
+                              size_t offset, size_t match_len) {
+    unsigned char* token = op++;
+    size_t ml = match_len ? match_len - LZ_MIN_MATCH : 0;
+
+    *token = (unsigned char)(((lit_len >= 15 ? 15 : lit_len) << 4) | (ml >= 15 ? 15 : ml));
+    if (lit_len >= 15) op = lz_write_length(op, lit_len - 15);
+
+    memcpy(op, lit, lit_len);
+    op += lit_len;
+
+    if (match_len) {
+        *op++ = (unsigned char)(offset & 0xFF);
+        *op++ = (unsigned char)(offset >> 8);
+        if (ml >= 15) op = lz_write_length(op, ml - 15);
+    }
+    return op;
+}
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+size_t lz_compress_bound(size_t n) {
+    return n + n / 255 + 16;
+}
+
+size_t lz_compress(const unsigned char* src, size_t n, unsigned char* dst, size_t cap) {
+    if (!src || !dst || cap < lz_compress_bound(n)) return 0;
+
+    unsigned int table[LZ_HASH_SIZE];
+    memset(table, 0, sizeof(table));
+
+    const unsigned char* ip = src;
+    const unsigned char* anchor = src;
+    const unsigned char* end = src + n;
+    const unsigned char* match_limit = n > LZ_LAST_LITERALS + LZ_MIN_MATCH
+                                       ? end - LZ_LAST_LITERALS - LZ_MIN_MATCH
+                                       : src;
+    unsigned char* op = dst;
+
+    // Позиции в таблице хранятся со смещением +1, чтобы 0 означал "пусто"
+    while (ip < match_limit) {
+        unsigned int seq = lz_read32(ip);
+        unsigned int h = lz_hash(seq);
+        size_t pos = (size_t)(ip - src);
+        size_t cand = table[h];
+        table[h] = (unsigned int)(pos + 1);
+
+        if (cand == 0 || pos - (cand - 1) > LZ_MAX_OFFSET || lz_read32(src + cand - 1) != seq) {
+            ip++;
+            continue;
+        }
+
+        const unsigned char* ref = src + cand - 1;
+        const unsigned char* mp = ip + LZ_MIN_MATCH;
+        const unsigned char* rp = ref + LZ_MIN_MATCH;
+        while (mp < end - LZ_LAST_LITERALS && *mp == *rp) {
+            mp++;
+            rp++;
+        }
+
+        op = lz_emit(op, anchor, (size_t)(ip - anchor), (size_t)(ip - ref), (size_t)(mp - ip));
+        ip = mp;
+        anchor = ip;
+    }
+
+    // Хвост всегда уходит литералами
+    op = lz_emit(op, anchor, (size_t)(end - anchor), 0, 0);
+    return (size_t)(op - dst);
+}
+
+int lz_decompress(const unsigned char* src, size_t n, unsigned char* dst, size_t raw_size) {
+    if (!src || (!dst && raw_size)) return 0;
+
+    const unsigned char* ip = src;
+    const unsigned char* iend = src + n;
+    unsigned char* op = dst;
+    unsigned char* oend = dst + raw_size;
+
+    while (ip < iend) {
+        unsigned int token = *ip++;
+
+        size_t lit_len = token >> 4;
+        if (lit_len == 15) {
+            unsigned int b;
+            do {
+                if (ip >= iend) return 0;
+                b = *ip++;
+                lit_len += b;
+            } while (b == 255);
+        }
+        if ((size_t)(iend - ip) < lit_len || (size_t)(oend - op) < lit_len) return 0;
+        memcpy(op, ip, lit_len);
+        ip += lit_len;
+        op += lit_len;
+
+        // Последняя последовательность состоит только из литералов
+        if (ip == iend) break;
+
+        if (iend - ip < 2) return 0;
+        size_t offset = (size_t)ip[0] | ((size_t)ip[1] << 8);
+        ip += 2;
+        if (offset == 0 || offset > (size_t)(op - dst)) return 0;
+
+        size_t match_len = token & 15;
+        if (match_len == 15) {
+            unsigned int b;
+            do {
+                if (ip >= iend) return 0;
+                b = *ip++;
+                match_len += b;
+            } while (b == 255);
+        }
+        match_len += LZ_MIN_MATCH;
+        if ((size_t)(oend - op) < match_len) return 0;
+
+        // Совпадение может перекрываться с выводом, поэтому копируем побайтно
+        const unsigned char* ref = op - offset;
+        for (size_t i = 0; i < match_len; i++) {
+            op[i] = ref[i];
+        }
+        op += match_len;
+    }
+
+    return op == oend;
+}
@@ -0,0 +1,21 @@
+#ifndef LZ_CODEC_H
+#define LZ_CODEC_H
+
+#include <stddef.h>
+
+// ============================================================================
+// Встроенный LZ77-кодек (семейство LZ4): без внешних зависимостей.
+// Поток: последовательности [токен][литералы][смещение][доп. длина совпадения].
+// ============================================================================
+
+// Максимальный размер сжатых данных для входа длиной n байт
+size_t lz_compress_bound(size_t n);
+
+// Сжимает src[0..n) в dst (емкость cap >= lz_compress_bound(n)).
+// Возвращает размер сжатых данных или 0 при ошибке.
+size_t lz_compress(const unsigned char* src, size_t n, unsigned char* dst, size_t cap);
+
+// Распаковывает ровно raw_size байт. Возвращает 1 при успехе, 0 если поток поврежден.
+int lz_decompress(const unsigned char* src, size_t n, unsigned char* dst, size_t raw_size);
+
+#endif // LZ_CODEC_H
@@ -22,7 +22,7 @@ int main(void) {
         load_from_file(&db, user_data_file);
     }
 
-    show_main_menu(&db, session.username);
+    show_main_menu(&db, session.username, NULL);
     
     // Сохранение данных при выходе
     if (session.is_authenticated) {
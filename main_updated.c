@@ -3,6 +3,14 @@
 #include "database.h"
 #include "menu.h"
 #include "database_new.h"
+#include "wal.h"
+#include "totals.h"
+#include "trigram.h"
+#include "type_bitmap.h"
+#include "price_catalog.h"
+#include "tenant_store.h"
+#include "columnar.h"
+#include "data_source.h"
 
 int main(void) {
     SetConsoleOutputCP(CP_UTF8);
@@ -19,44 +27,58 @@ int main(void) {
     
     data_base db;
     init_system(&db, 10);
+    totals_enable(&db);       // итоги для отчета в меню
+    trigram_enable();         // поиск по части type_work (type_work ~ "...")
+    type_bitmaps_enable(&db); // битовые индексы для условий на type_work
+    tenant_store* tenants = NULL;
+    data_source base; // откуда загружена сессия: туда же сворачивается журнал
+    data_source_binary(&base, session.username);
+    wal log;
+    memset(&log, 0, sizeof(log));
     
-    // Загрузка данных пользователя (старый бинарный формат)
+    // Загрузка данных пользователя
     if (session.is_authenticated) {
-        char user_data_file[100];
-        get_user_data_filename(session.username, user_data_file);
-        
-        // Пробуем загрузить из нового ASF формата
+        // Имя ASF-файла - для конвертации из старого формата
         char asf_filename[100];
         snprintf(asf_filename, sizeof(asf_filename), "data_%s.asf", session.username);
         
-        FILE* asf_file = fopen(asf_filename, "r");
-        if (asf_file) {
-            // Файл ASF существует - загружаем из него
-            fclose(asf_file);
+        // Общий файл всех пользователей (если он заведен) - в первую очередь
+        tenants = tenant_store_open(TENANT_STORE_FILE, 0);
+        data_source_select(&base, session.username, tenants);
+        if (base.kind == DATA_SOURCE_ASF) {
             printf("Обнаружен файл в новом ASF формате, загружаем...\n");
-            load_from_asf(&db, asf_filename);
-        } else {
-            // Пробуем загрузить из старого бинарного формата
+        } else if (base.kind == DATA_SOURCE_BINARY) {
             printf("Файл ASF не найден, пробуем загрузить из старого формата...\n");
-            load_from_file(&db, user_data_file);
-            
+        }
+        data_source_load(&base, &db);
+        if (base.kind == DATA_SOURCE_BINARY) {
             // Если загрузили из старого формата, предлагаем сохранить в новый
             if (db.size > 0) {
                 printf("\n⚠️  Обнаружены данные в старом формате.\n");
                 printf("Хотите автоматически конвертировать в новый ASF формат? (1-Да/0-Нет): ");
                 
                 int choice;
-                if (scanf("%d", &choice) == 1 && choice == 1) {
-                    save_to_asf(&db, asf_filename, session.username);
+                if (scanf("%d", &choice) == 1 && choice == 1 &&
+                    save_to_asf(&db, asf_filename, session.username)) {
+                    // Дальше сессия загружается из ASF: контрольные точки - тоже в него
+                    data_source_select(&base, session.username, tenants);
                     printf("✅ Данные конвертированы в ASF формат!\n");
                 }
                 while (getchar() != '\n'); // Очистка буфера
             }
         }
+        
+        // Изменения после последнего сохранения лежат в журнале
+        char wal_filename[100];
+        get_user_wal_filename(session.username, wal_filename);
+        wal_replay(&db, wal_filename);
+        if (wal_open(&log, wal_filename, &db)) {
+            db.wal = &log;
+        }
     }
     
     // Запускаем главное меню
-    show_main_menu(&db, session.username);
+    show_main_menu(&db, session.username, &base);
     
     // Сохранение данных при выходе
     if (session.is_authenticated) {
@@ -67,35 +89,79 @@ int main(void) {
         printf("1. Сохранить в новом ASF формате (рекомендуется)\n");
         printf("2. Сохранить в старом бинарном формате\n");
         printf("3. Сохранить в обоих форматах\n");
-        printf("Выберите вариант (1-3): ");
+        printf("4. Сохранить в сжатом ASF формате\n");
+        printf("5. Сохранить в общий файл всех пользователей (%s)\n", TENANT_STORE_FILE);
+        printf("6. Сохранить в сжатом бинарном формате\n");
+        printf("7. Сохранить в поколоночном формате\n");
+        printf("Выберите вариант (1-7): ");
         
+        // Сохранение - контрольная точка: журнал больше не нужен
         int choice;
+        int saved = 0;
+        int targets = 0; // биты (1 << DataSourceKind) хранилищ, получивших данные
         if (scanf("%d", &choice) == 1) {
+            char user_data_file[100];
+            get_user_data_filename(session.username, user_data_file);
             switch (choice) {
                 case 1:
-                    save_to_asf(&db, asf_filename, session.username);
+                    saved = save_to_asf(&db, asf_filename, session.username);
+                    targets = 1 << DATA_SOURCE_ASF;
                     break;
-                case 2: {
-                    char user_data_file[100];
-                    get_user_data_filename(session.username, user_data_file);
-                    save_to_file(&db, user_data_file);
+                case 2:
+                    saved = save_to_file(&db, user_data_file);
+                    targets = 1 << DATA_SOURCE_BINARY;
                     break;
-                }
                 case 3:
-                    save_to_asf(&db, asf_filename, session.username);
-                    char user_data_file[100];
-                    get_user_data_filename(session.username, user_data_file);
-                    save_to_file(&db, user_data_file);
-                    printf("✅ Данные сохранены в обоих форматах!\n");
+                    saved = save_to_asf(&db, asf_filename, session.username) &&
+                            save_to_file(&db, user_data_file);
+                    targets = (1 << DATA_SOURCE_ASF) | (1 << DATA_SOURCE_BINARY);
+                    if (saved) printf("✅ Данные сохранены в обоих форматах!\n");
+                    break;
+                case 4:
+                    saved = save_to_asf_compressed(&db, asf_filename, session.username);
+                    targets = 1 << DATA_SOURCE_ASF;
+                    break;
+                case 5:
+                    if (!tenants) tenants = tenant_store_open(TENANT_STORE_FILE, 1);
+                    saved = tenants && tenant_store_save(tenants, session.username, &db);
+                    targets = 1 << DATA_SOURCE_TENANT;
+                    break;
+                case 6:
+                    // load_from_file распознает контейнер сам
+                    saved = save_to_file_compressed(&db, user_data_file);
+                    targets = 1 << DATA_SOURCE_BINARY;
+                    break;
+                case 7:
+                    // Поколоночный файл тоже распознается при загрузке
+                    saved = save_to_columnar(&db, user_data_file);
+                    targets = 1 << DATA_SOURCE_BINARY;
                     break;
                 default:
                     printf("❌ Неверный выбор, данные не сохранены!\n");
                     break;
             }
         }
+
+        // Следующий вход загрузит хранилище с наивысшим приоритетом; если сохранение
+        // ушло в другое, оно устарело бы, а журнал был бы уже очищен
+        if (saved) {
+            data_source_select(&base, session.username, tenants);
+            if (!(targets & (1 << base.kind))) saved = data_source_save(&base, &db);
+        }
+        
+        if (db.wal) {
+            if (saved) {
+                wal_reset(&log);
+            }
+            wal_close(&log);
+            db.wal = NULL;
+        }
     }
     
     free_system(&db);
+    trigram_disable();
+    price_catalog_free();
+    tenant_store_close(tenants);
     
     printf("\nСпасибо за использование системы!\n");
     return 0;
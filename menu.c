@@ -1,4 +1,14 @@
 #include "menu.h"
+#include "wal.h"
+#include "filter.h"
+#include "group_by.h"
+#include "totals.h"
+#include "type_bitmap.h"
+#include "topk.h"
+#include "db_sort.h"
+#include "work_dict.h"
+#include "reprice.h"
+#include "price_catalog.h"
 #include <stdio.h>
 #include <windows.h>
 
@@ -10,9 +20,10 @@ void clear_input_buffer() {
 // Добавление новой записи
 void handle_add_record(struct data_base* db) {
     technical_maintenance new_record;
+    memset(&new_record, 0, sizeof(new_record));
     
-    // Присвоение ID
-    new_record.id = db->size + 1;
+    // ID выдает add_item (0 - следующий свободный)
+    new_record.id = 0;
     int cnt_date = 0;
     while (cnt_date == 0)
     {   
@@ -25,14 +36,16 @@ void handle_add_record(struct data_base* db) {
             printf("│ Ошибка ввода! Неверный формат даты.\n");
             continue;
         } else {
-            strcpy(new_record.date, new_date);  // Копируем в структуру
+            date_to_days(new_date, &new_record.date);  // Номер дня в структуру
             cnt_date++;
         }
     }
     
     printf("│ Введите тип работы:");
-    fgets(new_record.type_work, sizeof(new_record.type_work), stdin);
-    new_record.type_work[strcspn(new_record.type_work, "\n")] = 0;
+    char type_work[100];
+    fgets(type_work, sizeof(type_work), stdin);
+    type_work[strcspn(type_work, "\n")] = 0;
+    record_set_type_work(&new_record, type_work);
     autoprice(&new_record);
     
     int cnt_mileage = 0;
@@ -59,7 +72,7 @@ void handle_add_record(struct data_base* db) {
     
     // Добавление записи в базу
     add_item(db, new_record);
-    printf("│ Запись успешно добавлена!\n\n");
+    printf("│ Запись #%d успешно добавлена!\n\n", db->records[db->size - 1].id);
 }
 //Удаление всей базы данных
 void handle_clear_database(struct data_base* db) {
@@ -98,14 +111,14 @@ void handle_delete_record(struct data_base* db) {
         scanf("%d", &index_selection4);
         clear_input_buffer(); // Очистка буфера
         
-        if (index_selection4 >= 1 && index_selection4 <= db->size) {
+        if (index_selection4 >= 1 && find_item(db, index_selection4) >= 0) {
             printf("│ Вы уверены? (да-1, нет-0): ");
             scanf("%d", &confirmation);
             clear_input_buffer(); // Очистка буфера
             
             if (confirmation == 1) {
                 printf("│ Хорошо! Заявка номер %d удалена\n", index_selection4);
-                delete_item(db, index_selection4 - 1); 
+                delete_item_by_id(db, index_selection4); 
                 cnt_selection4++;
             } else if (confirmation == 0) {
                 printf("│ Операция прекращена!\n");
@@ -134,8 +147,8 @@ void handle_edit_record(struct data_base* db) {
         return;
     }
     
-    if (index_selection3 > 0 && index_selection3 <= db->size) {
-        int actual_index = index_selection3 - 1;
+    int64_t actual_index = index_selection3 > 0 ? find_item(db, index_selection3) : -1;
+    if (actual_index >= 0) {
         int selection_edit_record;
         printf("│ что вы хотите изменить?\n");
         printf("│ 1 - тип работы\n");
@@ -154,7 +167,7 @@ void handle_edit_record(struct data_base* db) {
                 new_type_work[strcspn(new_type_work, "\n")] = 0;
 
                 technical_maintenance updated = db->records[actual_index];
-                strncpy(updated.type_work, new_type_work, sizeof(updated.type_work) - 1);
+                record_set_type_work(&updated, new_type_work);
                 modify_item(db, actual_index, updated);
                 printf("│ Тип работы изменен!\n");
                 break;
@@ -186,7 +199,7 @@ void handle_edit_record(struct data_base* db) {
                     
                     if (validate_date(new_date) == 1) {
                         technical_maintenance updated_date = db->records[actual_index];
-                        strncpy(updated_date.date, new_date, sizeof(updated_date.date)-1);
+                        date_to_days(new_date, &updated_date.date);
                         modify_item(db, actual_index, updated_date);
                         printf("│ Дата изменена!\n");
                         cnt_validate_date++;
@@ -251,14 +264,19 @@ int get_int_input(const char* prompt, int min, int max) {
     }
 }
 // Обновленная главное меню в menu.c
-void show_main_menu(struct data_base* db, const char* username) {
+void show_main_menu(struct data_base* db, const char* username, const data_source* base) {
+    data_source binary;
+    if (!base) {
+        data_source_binary(&binary, username);
+        base = &binary;
+    }
     int cnt = 0;
     while (cnt == 0) {
         printf("╔═════════════════════════════════════════╗\n");
         printf("║  Система управления базой данных авто   ║\n");
         printf("╠═════════════════════════════════════════╣\n");
         printf("║ Пользователь: %-25s ║\n", username);
-        printf("║ Текущее количество записей в базе:%-4d  ║\n",db->size);
+        printf("║ Текущее количество записей в базе:%-4lld  ║\n",(long long)db_live_count(db));
         printf("║ Главное меню:                           ║\n");
         printf("║ 1. Показать все заказы                  ║\n");
         printf("║ 2. Добавить новый заказ                 ║\n");
@@ -267,10 +285,16 @@ void show_main_menu(struct data_base* db, const char* username) {
         printf("║ 5. Сохранить изменения                  ║\n");
         printf("║ 6. Загрузить данные                     ║\n");
         printf("║ 7. Очистить всю базу данных             ║\n");
-        printf("║ 8. Выход                                ║\n");
+        printf("║ 8. Найти заказы по условию              ║\n");
+        printf("║ 9. Отчет по видам работ и месяцам       ║\n");
+        printf("║ 10. Последние и самые дорогие заказы    ║\n");
+        printf("║ 11. Переоценить по прайс-листу          ║\n");
+        printf("║ 12. Выход                               ║\n");
         printf("╚═════════════════════════════════════════╝\n\n");
-        
-        int selection = get_int_input(" Выберите пункт меню (1-8): ", 1, 8);
+
+        // Удаления только ставят надгробия; уплотнение - здесь, пока меню ждет ввода
+        db_compact_idle(db);
+        int selection = get_int_input(" Выберите пункт меню (1-12): ", 1, 12);
         switch (selection) {
             case 1:
                 handle_show_all(db);
@@ -293,10 +317,16 @@ void show_main_menu(struct data_base* db, const char* username) {
                     if (scanf("%d", &confirmation) == 1) {
                         clear_input_buffer();
                         if (confirmation == 1) {
-                            // Используем файл пользователя
-                            char user_data_file[100];
-                            get_user_data_filename(username, user_data_file);
-                            save_to_file(db, user_data_file);
+                            if (db->wal) {
+                                // Изменения уже в журнале: достаточно сбросить его на диск,
+                                // базовое хранилище переписывается только на контрольной точке
+                                wal_commit(db->wal);
+                                if (wal_needs_checkpoint(db->wal)) {
+                                    wal_checkpoint(db->wal, db, base);
+                                }
+                            } else {
+                                data_source_save(base, db);
+                            }
                             printf("│ Данные успешно сохранены!\n");
                             cnt_case5++;
                         } else if (confirmation == 0) {
@@ -318,10 +348,22 @@ void show_main_menu(struct data_base* db, const char* username) {
                 if (scanf("%d", &load_confirmation) == 1) {
                     clear_input_buffer();
                     if (load_confirmation == 1) {
-                        // Используем файл пользователя
-                        char user_data_file[100];
-                        get_user_data_filename(username, user_data_file);
-                        load_from_file(db, user_data_file);
+                        if (db->wal) {
+                            // Сохраненное состояние = базовое хранилище + журнал
+                            wal* log = db->wal;
+                            wal_commit(log);
+                            int keep_totals = db->totals != NULL;
+                            int keep_bitmaps = db->type_bitmaps != NULL;
+                            free_system(db);
+                            init_system(db, 10);
+                            if (keep_totals) totals_enable(db);
+                            if (keep_bitmaps) type_bitmaps_enable(db);
+                            data_source_load(base, db);
+                            db->wal = log;
+                            wal_replay(db, db->wal->filename);
+                        } else {
+                            data_source_load(base, db);
+                        }
                         printf("│ Данные загружены!\n");
                     } else {
                         printf("│ Загрузка отменена.\n");
@@ -335,26 +377,178 @@ void show_main_menu(struct data_base* db, const char* username) {
                 handle_clear_database(db);
                 break;
             case 8:
+                clear_input_buffer();
+                handle_filter_records(db);
+                break;
+            case 9:
+                handle_report(db);
+                break;
+            case 10:
+                handle_top_records(db);
+                break;
+            case 11:
+                clear_input_buffer();
+                handle_reprice(db);
+                break;
+            case 12:
                 printf("GGWP!\n");
                 cnt++;
                 break;
         }
     }
 }
+// Вывод одной записи
+static void print_record(const technical_maintenance* record) {
+    printf("┌────────────────── ЗАПИСЬ #%d ──────────────────┐\n", record->id);
+    char date[DATE_TEXT_SIZE];
+    days_to_date(record->date, date);
+    printf("│ Дата:            %-28s │\n", date);
+    printf("│ Тип работы:      %-28s │\n", record_type_work(record));
+    printf("│ Пробег:          %-28d │\n", record->mileage);
+    printf("│ Стоимость:       %-28.2f │\n", record->price);
+    printf("└────────────────────────────────────────────────┘\n");
+}
+
 void handle_show_all(struct data_base* db) {
-    if (db->size == 0) {
+    if (db_live_count(db) == 0) {
         printf("│ Нет записей для отображения.\n");
         return;
     }
     
-    for (int i = 0; i < db->size; i++) {
-        printf("┌────────────────── ЗАПИСЬ #%d ──────────────────┐\n", db->records[i].id);
-        printf("│ Дата:            %-28s │\n", db->records[i].date);
-        printf("│ Тип работы:      %-28s │\n", db->records[i].type_work);
-        printf("│ Пробег:          %-28d │\n", db->records[i].mileage);
-        printf("│ Стоимость:       %-28.2f │\n", db->records[i].price);
-        printf("└────────────────────────────────────────────────┘\n");
-        
-        
+    printf("│ Порядок: 0 - как добавлены, 1 - по дате, 2 - по типу работы и дате, 3 - по убыванию цены\n");
+    int order = get_int_input("│ Выберите порядок (0-3): ", 0, 3);
+    clear_input_buffer();
+    if (order == 0) {
+        for (int64_t i = 0; i < db->size; i++) {
+            if (record_is_deleted(&db->records[i])) continue;
+            print_record(&db->records[i]);
+        }
+        return;
+    }
+
+    sort_key keys[2] = { { SORT_DATE, 0 }, { SORT_DATE, 0 } };
+    size_t key_count = 1;
+    if (order == 2) {
+        keys[0].field = SORT_TYPE_WORK;
+        key_count = 2;
+    } else if (order == 3) {
+        keys[0].field = SORT_PRICE;
+        keys[0].descending = 1;
+    }
+    int64_t* slots;
+    int64_t count = db_sort(db, keys, key_count, &slots);
+    for (int64_t i = 0; i < count; i++) print_record(&db->records[slots[i]]);
+    free(slots);
+}
+
+// Поиск записей по условию (см. filter.h)
+void handle_filter_records(struct data_base* db) {
+    printf("│ Поля: id, date, type_work, mileage, price; связки and, or, not\n");
+    printf("│ Например: mileage > 50000 and type_work = \"замена масла\" and date >= 01.01.2024\n");
+    printf("│ Поиск по части названия работы: type_work ~ \"фильтр\"\n");
+    printf("│ Несколько видов работ: type_work in (\"замена масла\", \"шиномонтаж\")\n");
+    printf("│ Введите условие: ");
+    char expr[512];
+    if (!fgets(expr, sizeof(expr), stdin)) return;
+    expr[strcspn(expr, "\n")] = 0;
+
+    char error[256];
+    filter_program* program = filter_compile(expr, error, sizeof(error));
+    if (!program) {
+        printf("│ %s\n", error);
+        return;
+    }
+
+    int64_t* slots;
+    int64_t found = filter_select(program, db, &slots);
+    filter_free(program);
+    if (found < 0) return;
+
+    for (int64_t i = 0; i < found; i++) {
+        print_record(&db->records[slots[i]]);
+    }
+    printf("│ Найдено записей: %lld\n", (long long)found);
+    free(slots);
+}
+
+// Отчет: число работ и выручка по типу работы, по месяцу или по обоим
+void handle_report(struct data_base* db) {
+    printf("│ Группировка: 1 - по типу работы, 2 - по месяцу, 3 - по типу и месяцу\n");
+    int mode = get_int_input("│ Выберите вариант (1-3): ", 1, 3);
+    clear_input_buffer();
+    unsigned keys = mode == 1 ? GROUP_BY_TYPE_WORK : mode == 2 ? GROUP_BY_MONTH : GROUP_BY_TYPE_WORK | GROUP_BY_MONTH;
+
+    // По одному ключу есть готовые итоги, иначе группировка по записям
+    group_result report;
+    int ready = db->totals && keys != (GROUP_BY_TYPE_WORK | GROUP_BY_MONTH)
+                    ? totals_to_groups(db, keys, &report)
+                    : group_by(db, keys, AGG_PRICE, NULL, &report);
+    if (!ready) return;
+    if (report.count == 0) {
+        printf("│ Нет записей для отчета.\n");
+        return;
+    }
+
+    printf("│ %-7s │ %-28s │ %7s │ %12s │ %10s │\n", "Месяц", "Тип работы", "Работ", "Выручка", "Средняя");
+    for (size_t i = 0; i < report.count; i++) {
+        const group_row* row = &report.rows[i];
+        char month[16] = "-";
+        if (row->month > 0) snprintf(month, sizeof(month), "%02u.%04u", (unsigned)(row->month % 100), (unsigned)(row->month / 100));
+        const char* type_work = row->type_id == WORK_DICT_NONE ? "-" : work_dict_get(work_dict_shared(), row->type_id);
+        printf("│ %-7s │ %-28s │ %7lld │ %12.2f │ %10.2f │\n", month, type_work ? type_work : "",
+               (long long)row->count, group_value(row, AGG_SUM), group_value(row, AGG_AVG));
     }
-}
\ No newline at end of file
+    group_result_free(&report);
+}
+
+// Постраничный вывод по убыванию даты, цены или пробега
+void handle_top_records(struct data_base* db) {
+    printf("│ Порядок: 1 - последние по дате, 2 - самые дорогие, 3 - с наибольшим пробегом\n");
+    int mode = get_int_input("│ Выберите вариант (1-3): ", 1, 3);
+    clear_input_buffer();
+    SortField field = mode == 1 ? SORT_DATE : mode == 2 ? SORT_PRICE : SORT_MILEAGE;
+
+    enum { PAGE_SIZE = 20 };
+    int64_t slots[PAGE_SIZE];
+    page_cursor cursor = { 0 };
+    for (;;) {
+        int64_t found = topk_page(db, field, 1, &cursor, PAGE_SIZE, NULL, slots, &cursor);
+        if (found <= 0) {
+            printf("│ Больше записей нет.\n");
+            return;
+        }
+        for (int64_t i = 0; i < found; i++) print_record(&db->records[slots[i]]);
+        if (found < PAGE_SIZE) return;
+
+        int more = get_int_input("│ Следующая страница? (1-Да/0-Нет): ", 0, 1);
+        clear_input_buffer();
+        if (!more) return;
+    }
+}
+
+// Переоценка всех заказов или заказов по условию по текущему прайс-листу
+void handle_reprice(struct data_base* db) {
+    printf("│ Цены берутся из %s. Условие отбора (пусто - все заказы): ", PRICE_CATALOG_FILE);
+    char expr[512];
+    if (!fgets(expr, sizeof(expr), stdin)) return;
+    expr[strcspn(expr, "\n")] = 0;
+
+    filter_program* program = NULL;
+    if (expr[0]) {
+        char error[256];
+        program = filter_compile(expr, error, sizeof(error));
+        if (!program) {
+            printf("│ %s\n", error);
+            return;
+        }
+    }
+
+    reprice_stats stats;
+    int ok = reprice_apply(db, program, &stats);
+    filter_free(program);
+    if (!ok) return;
+    printf("│ Проверено заказов: %lld, из них в прайс-листе: %lld\n",
+           (long long)stats.checked, (long long)stats.priced);
+    printf("│ Изменена цена: %lld, изменение выручки: %+.2f\n",
+           (long long)stats.changed, stats.revenue_delta);
+}
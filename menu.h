@@ -2,9 +2,11 @@
 #define MENU_H
 
 #include "database.h"
+#include "data_source.h"
 
 // Прототипы функций меню
-void show_main_menu(struct data_base* db, const char* username);
+// base - хранилище, из которого загружена сессия (NULL - data_<логин>.dat)
+void show_main_menu(struct data_base* db, const char* username, const data_source* base);
 void handle_show_all(struct data_base* db);
 void handle_add_record(struct data_base* db);
 void handle_edit_record(struct data_base* db);
@@ -12,5 +14,9 @@ void handle_delete_record(struct data_base* db);
 void clear_input_buffer();
 int get_int_input(const char* prompt, int min, int max);
 void handle_clear_database(struct data_base* db);
+void handle_filter_records(struct data_base* db);
+void handle_report(struct data_base* db);
+void handle_top_records(struct data_base* db);
+void handle_reprice(struct data_base* db);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,109 @@
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "parallel.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+#include <stdlib.h>
+
+#define PARALLEL_MAX_THREADS 64
+
+// ============================================================================
+// Общее состояние цикла: итерации раздаются атомарным счетчиком
+// ============================================================================
+
+typedef struct {
+    parallel_fn fn;
+    void* ctx;
+    size_t count;
+    volatile long next;
+} ParallelJob;
+
+static size_t job_take(ParallelJob* job) {
+#ifdef _WIN32
+    return (size_t)(InterlockedIncrement(&job->next) - 1);
+#else
+    return (size_t)(__sync_fetch_and_add(&job->next, 1));
+#endif
+}
+
+static void job_run(ParallelJob* job) {
+    for (;;) {
+        size_t i = job_take(job);
+        if (i >= job->count) break;
+        job->fn(job->ctx, i);
+    }
+}
+
+#ifdef _WIN32
+static DWORD WINAPI worker_main(LPVOID arg) {
+    job_run((ParallelJob*)arg);
+    return 0;
+}
+#else
+static void* worker_main(void* arg) {
+    job_run((ParallelJob*)arg);
+    return NULL;
+}
+#endif
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+int parallel_cpu_count(void) {
+#ifdef _WIN32
+    SYSTEM_INFO si;
+    GetSystemInfo(&si);
+    int n = (int)si.dwNumberOfProcessors;
+#else
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+    if (n < 1) return 1;
+    if (n > PARALLEL_MAX_THREADS) return PARALLEL_MAX_THREADS;
+    return (int)n;
+}
+
+void parallel_for(size_t count, parallel_fn fn, void* ctx) {
+    if (!fn || count == 0) return;
+
+    ParallelJob job;
+    job.fn = fn;
+    job.ctx = ctx;
+    job.count = count;
+    job.next = 0;
+
+    int threads = parallel_cpu_count();
+    if ((size_t)threads > count) threads = (int)count;
+
+    // Текущий поток тоже работает, поэтому запускаем на один меньше
+    int spawned = 0;
+#ifdef _WIN32
+    HANDLE handles[PARALLEL_MAX_THREADS];
+    for (int t = 0; t < threads - 1; t++) {
+        handles[spawned] = CreateThread(NULL, 0, worker_main, &job, 0, NULL);
+        if (!handles[spawned]) break;
+        spawned++;
+    }
+    job_run(&job);
+    if (spawned > 0) {
+        WaitForMultipleObjects((DWORD)spawned, handles, TRUE, INFINITE);
+        for (int t = 0; t < spawned; t++) CloseHandle(handles[t]);
+    }
+#else
+    pthread_t handles[PARALLEL_MAX_THREADS];
+    for (int t = 0; t < threads - 1; t++) {
+        if (pthread_create(&handles[spawned], NULL, worker_main, &job) != 0) break;
+        spawned++;
+    }
+    job_run(&job);
+    for (int t = 0; t < spawned; t++) pthread_join(handles[t], NULL);
+#endif
+}
@@ -0,0 +1,21 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <stddef.h>
+
+// ============================================================================
+// Простейший параллельный цикл поверх потоков ОС (WinAPI / pthreads)
+// ============================================================================
+
+// Тело цикла: вызывается для каждого index из [0, count)
+typedef void (*parallel_fn)(void* ctx, size_t index);
+
+// Количество доступных логических процессоров (>= 1)
+int parallel_cpu_count(void);
+
+// Выполняет fn(ctx, i) для всех i из [0, count) на пуле рабочих потоков.
+// Возвращается только после завершения всех итераций.
+// При count <= 1 или ошибке создания потоков работает последовательно.
+void parallel_for(size_t count, parallel_fn fn, void* ctx);
+
+#endif // PARALLEL_H
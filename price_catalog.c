@@ -0,0 +1,190 @@
+#include "price_catalog.h"
+#include "asf_parser.h"
+#include "trigram.h"
+
+#include <stdint.h>
+#include <sys/stat.h>
+#include <time.h>
+
+typedef struct {
+    char* key;   // название в нижнем регистре; NULL - пустой слот
+    float price;
+} price_entry;
+
+typedef struct {
+    price_entry* slots; // открытая адресация
+    size_t slot_count;  // степень двойки
+    size_t count;
+} price_table;
+
+static price_table catalog;
+static char catalog_file[260];
+static time_t catalog_mtime;
+static long long catalog_size = -1; // -1 - файл еще не читался
+
+// ============================================================================
+// Таблица
+// ============================================================================
+
+// FNV-1a
+static uint32_t key_hash(const char* s) {
+    uint32_t h = 2166136261u;
+    for (const unsigned char* p = (const unsigned char*)s; *p; ++p) {
+        h ^= *p;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static size_t probe(const price_table* t, const char* key) {
+    size_t mask = t->slot_count - 1;
+    size_t i = key_hash(key) & mask;
+    while (t->slots[i].key && strcmp(t->slots[i].key, key) != 0) i = (i + 1) & mask;
+    return i;
+}
+
+static void table_free(price_table* t) {
+    for (size_t i = 0; i < t->slot_count; i++) free(t->slots[i].key);
+    free(t->slots);
+    memset(t, 0, sizeof(*t));
+}
+
+// Заполнение не больше половины: размер известен заранее, таблица не растет
+static int table_init(price_table* t, size_t count) {
+    memset(t, 0, sizeof(*t));
+    t->slot_count = 16;
+    while (t->slot_count < count * 2) t->slot_count *= 2;
+    t->slots = calloc(t->slot_count, sizeof(price_entry));
+    return t->slots != NULL;
+}
+
+// Повтор названия (в любом регистре) заменяет прежнюю цену
+static int table_put(price_table* t, const char* name, float price) {
+    char* key = utf8_fold(name);
+    if (!key) return 0;
+    price_entry* e = &t->slots[probe(t, key)];
+    if (e->key) {
+        free(key);
+    } else {
+        e->key = key;
+        t->count++;
+    }
+    e->price = price;
+    return 1;
+}
+
+// ============================================================================
+// Файл
+// ============================================================================
+
+static int file_version(const char* filename, time_t* mtime, long long* size) {
+    struct stat st;
+    if (stat(filename, &st) != 0) return 0;
+    *mtime = st.st_mtime;
+    *size = (long long)st.st_size;
+    return 1;
+}
+
+// Таблица из объекта prices (или из корня, если такого ключа нет)
+static int build_table(const DataNode* root, price_table* t, const char* filename) {
+    const DataNode* prices = asf_object_get(root, "prices");
+    if (!prices) prices = root;
+    if (prices->type != NODE_OBJECT) {
+        printf("Ошибка: в прайс-листе %s prices должен быть объектом\n", filename);
+        return 0;
+    }
+
+    if (!table_init(t, (size_t)prices->value.object.count)) {
+        printf("Ошибка: недостаточно памяти для прайс-листа\n");
+        return 0;
+    }
+    for (int i = 0; i < prices->value.object.count; i++) {
+        const DataNode* pair = prices->value.object.pairs[i];
+        const DataNode* value = pair->value.child;
+        double price = value && value->type == NODE_INTEGER ? (double)value->value.int_value
+                     : value && value->type == NODE_FLOAT   ? value->value.float_value
+                                                             : -1;
+        if (price < 0) {
+            printf("Ошибка: в прайс-листе %s у \"%s\" должна быть неотрицательная цена\n", filename, pair->key);
+            table_free(t);
+            return 0;
+        }
+        if (!table_put(t, pair->key, (float)price)) {
+            printf("Ошибка: недостаточно памяти для прайс-листа\n");
+            table_free(t);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+int price_catalog_load(const char* filename) {
+    if (!filename) filename = PRICE_CATALOG_FILE;
+    if (filename != catalog_file) {
+        strncpy(catalog_file, filename, sizeof(catalog_file) - 1);
+        catalog_file[sizeof(catalog_file) - 1] = '\0';
+    }
+
+    // Версия запоминается и при ошибке, чтобы не разбирать тот же файл на каждом поиске
+    time_t mtime = 0;
+    long long size = 0;
+    if (!file_version(catalog_file, &mtime, &size)) {
+        catalog_size = 0;
+        catalog_mtime = 0;
+        return 0;
+    }
+    catalog_mtime = mtime;
+    catalog_size = size;
+
+    DataNode* root = asf_parse_file(catalog_file);
+    if (!root) {
+        printf("Ошибка: не удалось прочитать прайс-лист %s\n", catalog_file);
+        return 0;
+    }
+    price_table t;
+    int ok = build_table(root, &t, catalog_file);
+    asf_free_node(root);
+    if (!ok) return 0;
+
+    table_free(&catalog);
+    catalog = t;
+    return 1;
+}
+
+void price_catalog_refresh(void) {
+    if (catalog_size < 0) {
+        price_catalog_load(catalog_file[0] ? catalog_file : NULL);
+        return;
+    }
+    time_t mtime = 0;
+    long long size = 0;
+    int exists = file_version(catalog_file, &mtime, &size);
+    if (!exists && catalog_size == 0 && catalog_mtime == 0) return;
+    if (!exists || mtime != catalog_mtime || size != catalog_size) price_catalog_load(catalog_file);
+}
+
+int price_catalog_find(const char* type_work, float* price) {
+    if (!catalog.count || !type_work) return 0;
+    char* key = utf8_fold(type_work);
+    if (!key) return 0;
+    const price_entry* e = &catalog.slots[probe(&catalog, key)];
+    free(key);
+    if (!e->key) return 0;
+    *price = e->price;
+    return 1;
+}
+
+size_t price_catalog_count(void) {
+    return catalog.count;
+}
+
+void price_catalog_free(void) {
+    table_free(&catalog);
+    catalog_file[0] = '\0';
+    catalog_size = -1;
+    catalog_mtime = 0;
+}
@@ -0,0 +1,33 @@
+#ifndef PRICE_CATALOG_H
+#define PRICE_CATALOG_H
+
+#include <stddef.h>
+
+// ============================================================================
+// Прайс-лист видов работ из файла ASF, например:
+//   prices = {
+//       "замена масла" = 2100
+//       "осмотр ТС" = 999.99
+//   }
+// Названия приводятся к нижнему регистру (utf8_fold из trigram.h) и лежат
+// в хеш-таблице с открытой адресацией, поэтому "Замена масла" и "замена масла" -
+// одна позиция. Файл перечитывается, когда меняются его время изменения или
+// размер; если новая версия не разбирается, остается прежняя таблица.
+// ============================================================================
+
+#define PRICE_CATALOG_FILE "prices.asf"
+
+// Загружает прайс-лист из filename (NULL - PRICE_CATALOG_FILE) и дальше следит за этим файлом.
+// 0 - файл не прочитан или в нем ошибка (прежняя таблица сохраняется).
+int price_catalog_load(const char* filename);
+
+// Перечитывает файл, если он изменился с прошлой загрузки (при первом вызове - загружает).
+void price_catalog_refresh(void);
+
+// Цена вида работы без учета регистра. 1 - найдена.
+int price_catalog_find(const char* type_work, float* price);
+
+size_t price_catalog_count(void);
+void price_catalog_free(void);
+
+#endif // PRICE_CATALOG_H
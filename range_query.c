@@ -0,0 +1,247 @@
+#include "range_query.h"
+#include "crc32c.h"
+#include "file_io.h"
+#include "segment.h"
+#include "work_dict.h"
+
+#include <float.h>
+
+#define RANGE_READ_BLOCKS 256 // наибольшее число соседних блоков в одном чтении (192 КиБ)
+
+enum { QUERY_ERROR = 0, QUERY_OK = 1, QUERY_NO_ZONES = -1 };
+
+// ============================================================================
+// Internal utilities
+// ============================================================================
+
+static int dates_bounded(const range_query* q) {
+    return q->date_from != INT32_MIN || q->date_to != INT32_MAX;
+}
+
+// 0, если по сводке блока в нем гарантированно нет подходящих записей
+static int zone_may_match(const range_query* q, const block_zone* zone) {
+    if (dates_bounded(q) &&
+        (zone->date_min > zone->date_max || zone->date_max < q->date_from || zone->date_min > q->date_to)) {
+        return 0;
+    }
+    if (zone->mileage_max < q->mileage_from || zone->mileage_min > q->mileage_to) return 0;
+    if (zone->price_max < q->price_from || zone->price_min > q->price_to) return 0;
+    return 1;
+}
+
+// remap переводит id типов работ файла в общий словарь (NULL - id уже общие)
+static void collect(const range_query* q, technical_maintenance* records, size_t count,
+                    const uint32_t* remap, uint32_t remap_count,
+                    struct data_base* out, range_query_stats* stats) {
+    for (size_t i = 0; i < count; i++) {
+        if (!range_query_match(q, &records[i])) continue;
+        if (remap) records_remap_types(&records[i], 1, remap, remap_count);
+        add_item(out, records[i]);
+        stats->records_matched++;
+    }
+}
+
+// Словарь типов работ из конца одиночного файла v2
+static int read_dict_tail(file_rw* f, const file_header_v2* header, uint32_t** remap, uint32_t* remap_count) {
+    uint64_t at = header->data_offset + header->record_count * sizeof(technical_maintenance);
+    file_dict_header dict;
+    if (!file_pread(f, &dict, sizeof(dict), at) || dict.magic != FILE_DICT_MAGIC) return 0;
+
+    unsigned char* block = malloc(dict.size ? dict.size : 1);
+    int ok = block && file_pread(f, block, dict.size, at + sizeof(dict)) &&
+             crc32c(0, block, dict.size) == dict.checksum &&
+             work_dict_import(work_dict_shared(), block, dict.size, remap, remap_count);
+    free(block);
+    return ok;
+}
+
+// Выборка из одного файла v2 по сводкам блоков.
+// QUERY_NO_ZONES - в файле нет сводок (старый формат, big-endian хост и т.п.).
+// remap - словарь сегментированной базы; для одиночного файла читается его собственный.
+static int query_v2_file(const char* filename, const range_query* q, struct data_base* out,
+                         range_query_stats* stats, uint64_t first_record,
+                         const uint32_t* remap, uint32_t remap_count) {
+    file_rw* f = file_open_read(filename);
+    if (!f) return QUERY_ERROR;
+
+    // Заголовок читается как есть: на big-endian хосте magic не совпадет,
+    // и файл будет прочитан обычной загрузкой с перестановкой байтов
+    file_header_v2 header;
+    if (!file_pread(f, &header, sizeof(header), 0) ||
+        header.magic != FILE_MAGIC || header.version != FILE_VERSION ||
+        !(header.flags & FILE_FLAG_BLOCK_CRC) || !(header.flags & FILE_FLAG_ZONE_MAPS) ||
+        header.record_size != sizeof(technical_maintenance) || header.record_layout != RECORD_LAYOUT ||
+        header.block_records != FILE_BLOCK_RECORDS) {
+        file_close_rw(f);
+        return QUERY_NO_ZONES;
+    }
+
+    uint32_t* own_remap = NULL;
+    if (header.flags & FILE_FLAG_WORK_DICT) {
+        if (!read_dict_tail(f, &header, &own_remap, &remap_count)) {
+            file_close_rw(f);
+            return QUERY_NO_ZONES;
+        }
+        remap = own_remap;
+    }
+
+    uint64_t zones_at = sizeof(header) + (uint64_t)header.block_capacity * sizeof(uint32_t);
+    size_t count = (size_t)header.record_count;
+    size_t blocks = (count + FILE_BLOCK_RECORDS - 1) / FILE_BLOCK_RECORDS;
+    if (blocks > header.block_capacity ||
+        zones_at + (uint64_t)header.block_capacity * sizeof(block_zone) > header.data_offset) {
+        printf("Ошибка: Повреждена таблица сводок блоков\n");
+        file_close_rw(f);
+        return QUERY_ERROR;
+    }
+
+    uint32_t* crcs = malloc((blocks ? blocks : 1) * sizeof(uint32_t));
+    block_zone* zones = malloc((blocks ? blocks : 1) * sizeof(block_zone));
+    technical_maintenance* buffer = malloc((size_t)RANGE_READ_BLOCKS * FILE_BLOCK_RECORDS *
+                                           sizeof(technical_maintenance));
+    int result = crcs && zones && buffer &&
+                 (blocks == 0 ||
+                  (file_pread(f, crcs, blocks * sizeof(uint32_t), sizeof(header)) &&
+                   file_pread(f, zones, blocks * sizeof(block_zone), zones_at)))
+                 ? QUERY_OK : QUERY_ERROR;
+
+    if (result == QUERY_OK && crc32c(0, zones, blocks * sizeof(block_zone)) != header.zone_checksum) {
+        printf("Предупреждение: повреждена таблица сводок блоков, файл будет прочитан целиком\n");
+        result = QUERY_NO_ZONES;
+    }
+
+    stats->blocks_total += blocks;
+    size_t block = 0;
+    while (result == QUERY_OK && block < blocks) {
+        if (!zone_may_match(q, &zones[block])) {
+            block++;
+            continue;
+        }
+
+        // Соседние подходящие блоки читаются одним вызовом
+        size_t end = block + 1;
+        while (end < blocks && end - block < RANGE_READ_BLOCKS && zone_may_match(q, &zones[end])) end++;
+
+        size_t first = block * FILE_BLOCK_RECORDS;
+        size_t last = end * FILE_BLOCK_RECORDS < count ? end * FILE_BLOCK_RECORDS : count;
+        if (!file_pread(f, buffer, (last - first) * sizeof(technical_maintenance),
+                        header.data_offset + (uint64_t)first * sizeof(technical_maintenance))) {
+            printf("Ошибка чтения файла: %s\n", filename);
+            result = QUERY_ERROR;
+            break;
+        }
+        stats->blocks_read += end - block;
+
+        for (size_t b = block; b < end; b++) {
+            size_t from = b * FILE_BLOCK_RECORDS - first;
+            size_t n = last - first - from < FILE_BLOCK_RECORDS ? last - first - from : FILE_BLOCK_RECORDS;
+            if (crc32c(0, buffer + from, n * sizeof(technical_maintenance)) != crcs[b]) {
+                printf("Предупреждение: Повреждены записи %llu-%llu (блок %lu)\n",
+                       (unsigned long long)(first_record + first + from + 1),
+                       (unsigned long long)(first_record + first + from + n), (unsigned long)b);
+            }
+            collect(q, buffer + from, n, remap, remap_count, out, stats);
+        }
+        block = end;
+    }
+
+    free(own_remap);
+    free(crcs);
+    free(zones);
+    free(buffer);
+    file_close_rw(f);
+    return result;
+}
+
+static int query_segments(const char* manifest, const range_query* q, struct data_base* out,
+                          range_query_stats* stats) {
+    segment_manifest_header header;
+    segment_entry* entries = NULL;
+    uint32_t* remap = NULL;
+    uint32_t remap_count = 0;
+    if (!segment_read_manifest(manifest, &header, &entries, &remap, &remap_count)) {
+        printf("Ошибка: поврежден манифест сегментированной базы: %s\n", manifest);
+        return 0;
+    }
+
+    int ok = 1;
+    for (uint32_t i = 0; ok && i < header.segment_count; i++) {
+        char filename[300];
+        get_segment_filename(manifest, i, entries[i].generation, filename, sizeof(filename));
+        uint64_t first = (uint64_t)i * header.segment_records;
+
+        int result = query_v2_file(filename, q, out, stats, first, remap, remap_count);
+        if (result == QUERY_NO_ZONES) {
+            // Сегмент без сводок: читаем целиком
+            size_t n = (size_t)entries[i].record_count;
+            technical_maintenance* records = malloc((n ? n : 1) * sizeof(technical_maintenance));
+            result = records && read_records_v2(filename, records, n, remap, remap_count, NULL) != 0;
+            if (result) {
+                size_t blocks = (n + FILE_BLOCK_RECORDS - 1) / FILE_BLOCK_RECORDS;
+                stats->blocks_total += blocks;
+                stats->blocks_read += blocks;
+                collect(q, records, n, NULL, 0, out, stats);
+            }
+            free(records);
+        }
+        if (result != QUERY_OK) {
+            printf("Ошибка чтения сегмента: %s\n", filename);
+            ok = 0;
+        }
+    }
+    free(entries);
+    free(remap);
+    return ok;
+}
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+void range_query_init(range_query* q) {
+    q->date_from = INT32_MIN;
+    q->date_to = INT32_MAX;
+    q->mileage_from = INT32_MIN;
+    q->mileage_to = INT32_MAX;
+    q->price_from = -FLT_MAX;
+    q->price_to = FLT_MAX;
+}
+
+int range_query_set_dates(range_query* q, const char* from, const char* to) {
+    if (from && from[0] && !date_to_days(from, &q->date_from)) return 0;
+    if (to && to[0] && !date_to_days(to, &q->date_to)) return 0;
+    return 1;
+}
+
+int range_query_match(const range_query* q, const technical_maintenance* record) {
+    if (dates_bounded(q) &&
+        (record->date == DATE_NONE || record->date < q->date_from || record->date > q->date_to)) {
+        return 0;
+    }
+    return record->mileage >= q->mileage_from && record->mileage <= q->mileage_to &&
+           record->price >= q->price_from && record->price <= q->price_to;
+}
+
+int range_query_file(const char* filename, const range_query* q, struct data_base* out,
+                     range_query_stats* stats) {
+    range_query_stats local;
+    if (!stats) stats = &local;
+    memset(stats, 0, sizeof(*stats));
+    crc32c_init();
+
+    if (segment_is_manifest(filename)) return query_segments(filename, q, out, stats);
+
+    int result = query_v2_file(filename, q, out, stats, 0, NULL, 0);
+    if (result != QUERY_NO_ZONES) return result == QUERY_OK;
+
+    // Остальные форматы (v1, поколоночный, сжатый): полная загрузка и фильтр
+    struct data_base all;
+    init_system(&all, 10);
+    load_from_file(&all, filename);
+    size_t blocks = ((size_t)all.size + FILE_BLOCK_RECORDS - 1) / FILE_BLOCK_RECORDS;
+    stats->blocks_total = blocks;
+    stats->blocks_read = blocks;
+    collect(q, all.records, (size_t)all.size, NULL, 0, out, stats);
+    free_system(&all);
+    return 1;
+}
@@ -0,0 +1,43 @@
+#ifndef RANGE_QUERY_H
+#define RANGE_QUERY_H
+
+#include "database.h"
+
+// ============================================================================
+// Выборка записей по диапазонам даты, пробега и цены прямо из файла базы.
+// Файл v2 хранит для каждого блока из FILE_BLOCK_RECORDS записей min/max
+// этих полей (block_zone), поэтому читаются только блоки, которые могут
+// содержать подходящие записи. Для сегментированной базы сводки проверяются
+// в каждом сегменте; файлы других форматов загружаются целиком и фильтруются.
+// ============================================================================
+
+// Границы включительные; init задает полностью открытые диапазоны
+typedef struct range_query {
+    int32_t date_from; // номер дня (date_to_days)
+    int32_t date_to;
+    int32_t mileage_from;
+    int32_t mileage_to;
+    float price_from;
+    float price_to;
+} range_query;
+
+typedef struct range_query_stats {
+    uint64_t blocks_total;   // блоков в файле(ах)
+    uint64_t blocks_read;    // блоков, прочитанных с диска
+    uint64_t records_matched;
+} range_query_stats;
+
+void range_query_init(range_query* q);
+
+// Диапазон дат "дд.мм.гггг"; NULL или пустая строка - граница не задана
+int range_query_set_dates(range_query* q, const char* from, const char* to);
+
+// 1, если запись попадает во все диапазоны
+int range_query_match(const range_query* q, const technical_maintenance* record);
+
+// Добавляет в out (инициализированную init_system) подходящие записи файла.
+// stats может быть NULL. Возвращает 1 при успехе.
+int range_query_file(const char* filename, const range_query* q, struct data_base* out,
+                     range_query_stats* stats);
+
+#endif // RANGE_QUERY_H
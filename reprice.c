@@ -0,0 +1,120 @@
+#include "reprice.h"
+#include "price_catalog.h"
+#include "soa.h"
+#include "work_dict.h"
+
+#define REPRICE_BATCH 1024
+
+typedef struct {
+    float* prices;   // prices[type_id]
+    uint8_t* known;  // 1 - вид работы есть в прайс-листе
+    uint32_t count;  // = число строк словаря
+} price_column;
+
+// Таблица type_id -> цена: поиск в прайс-листе один раз на строку словаря
+static int build_prices(price_column* column) {
+    const work_dict* dict = work_dict_shared();
+    column->count = dict->count;
+    column->prices = malloc((dict->count ? dict->count : 1) * sizeof(float));
+    column->known = calloc(dict->count ? dict->count : 1, 1);
+    if (!column->prices || !column->known) {
+        free(column->prices);
+        free(column->known);
+        return 0;
+    }
+    for (uint32_t id = 0; id < dict->count; id++) {
+        column->known[id] = (uint8_t)price_catalog_find(work_dict_get(dict, id), &column->prices[id]);
+        if (!column->known[id]) column->prices[id] = 0;
+    }
+    return 1;
+}
+
+static int bit(const uint64_t* bits, size_t slot) {
+    return (int)((bits[slot / 64] >> (slot % 64)) & 1);
+}
+
+// Позиции пачки [first, first + n), которым нужна новая цена. Проход без ветвлений
+// по столбцам type_id и price: новая цена - выборка из таблицы по type_id.
+static size_t scan_soa(const soa_mirror* soa, const price_column* column, const uint64_t* selection,
+                       size_t first, size_t n, int64_t* slots, reprice_stats* stats) {
+    size_t count = 0;
+    for (size_t i = 0; i < n; i++) {
+        size_t slot = first + i;
+        uint32_t type = soa->type_id[slot];
+        int in_dict = type < column->count;
+        uint32_t t = in_dict ? type : 0;
+        int live = bit(soa->live, slot) & (selection ? bit(selection, slot) : 1);
+        int priced = live & in_dict & column->known[t];
+        stats->checked += live;
+        stats->priced += priced;
+        slots[count] = (int64_t)slot;
+        count += (size_t)(priced & (column->prices[t] != soa->price[slot]));
+    }
+    return count;
+}
+
+// То же по записям, когда зеркало не включено
+static size_t scan_records(const technical_maintenance* records, const price_column* column,
+                           const uint64_t* selection, size_t first, size_t n, int64_t* slots,
+                           reprice_stats* stats) {
+    size_t count = 0;
+    for (size_t i = 0; i < n; i++) {
+        size_t slot = first + i;
+        const technical_maintenance* r = &records[slot];
+        int in_dict = r->type_id < column->count;
+        uint32_t t = in_dict ? r->type_id : 0;
+        int live = (!record_is_deleted(r)) & (selection ? bit(selection, slot) : 1);
+        int priced = live & in_dict & column->known[t];
+        stats->checked += live;
+        stats->priced += priced;
+        slots[count] = (int64_t)slot;
+        count += (size_t)(priced & (column->prices[t] != r->price));
+    }
+    return count;
+}
+
+int reprice_apply(struct data_base* system, const filter_program* filter, reprice_stats* stats) {
+    memset(stats, 0, sizeof(*stats));
+    price_catalog_refresh();
+
+    price_column column;
+    if (!build_prices(&column)) {
+        printf("Ошибка: недостаточно памяти для переоценки\n");
+        return 0;
+    }
+    size_t size = (size_t)system->size;
+    uint64_t* selection = NULL;
+    if (filter) {
+        selection = malloc((size + 63) / 64 * sizeof(uint64_t) + sizeof(uint64_t));
+        if (!selection) {
+            free(column.prices);
+            free(column.known);
+            printf("Ошибка: недостаточно памяти для переоценки\n");
+            return 0;
+        }
+        filter_bitmap(filter, system, selection);
+    }
+
+    // Пачка сначала просматривается целиком, затем изменения проводятся через
+    // modify_item (он поправляет зеркало, но type_id и отбор от этого не меняются)
+    const soa_mirror* soa = soa_get(system);
+    int64_t slots[REPRICE_BATCH];
+    for (size_t first = 0; first < size; first += REPRICE_BATCH) {
+        size_t n = size - first < REPRICE_BATCH ? size - first : REPRICE_BATCH;
+        size_t count = soa ? scan_soa(soa, &column, selection, first, n, slots, stats)
+                           : scan_records(system->records, &column, selection, first, n, slots, stats);
+        for (size_t i = 0; i < count; i++) {
+            technical_maintenance updated = system->records[slots[i]];
+            float price = column.prices[updated.type_id];
+            stats->revenue_delta += (double)price - (double)updated.price;
+            updated.price = price;
+            modify_item(system, slots[i], updated);
+        }
+        stats->changed += (int64_t)count;
+    }
+
+    free(selection);
+    free(column.prices);
+    free(column.known);
+    return 1;
+}
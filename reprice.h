@@ -0,0 +1,27 @@
+#ifndef REPRICE_H
+#define REPRICE_H
+
+#include "database.h"
+#include "filter.h"
+
+// ============================================================================
+// Переоценка базы по прайс-листу (price_catalog.h) за один проход.
+// Цена ищется не для каждой записи, а один раз для каждой строки общего
+// словаря: получается таблица type_id -> цена, и новая цена записи - выборка
+// по столбцу type_id (из зеркала soa.h, если оно включено). Изменившиеся
+// записи проводятся через modify_item, поэтому журнал, индексы, зеркало,
+// итоги и битовые индексы видов работ остаются согласованными.
+// ============================================================================
+
+typedef struct reprice_stats {
+    int64_t checked;       // живые записи, попавшие под фильтр
+    int64_t priced;        // из них с видом работы из прайс-листа
+    int64_t changed;       // из них с другой ценой
+    double revenue_delta;  // новая выручка минус прежняя
+} reprice_stats;
+
+// Ставит записям (только отобранным filter, если он не NULL) цены из прайс-листа.
+// Записи с видом работы не из прайс-листа не меняются. 0 - нет памяти.
+int reprice_apply(struct data_base* system, const filter_program* filter, reprice_stats* stats);
+
+#endif // REPRICE_H
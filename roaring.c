@@ -0,0 +1,510 @@
+#include "roaring.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+typedef enum { SET_AND, SET_OR, SET_ANDNOT } SetOp;
+
+static int lowest_bit(uint64_t w) {
+#ifdef __GNUC__
+    return __builtin_ctzll(w);
+#else
+    int i = 0;
+    while (!(w & 1)) {
+        w >>= 1;
+        i++;
+    }
+    return i;
+#endif
+}
+
+static int bit_count(uint64_t w) {
+#ifdef __GNUC__
+    return __builtin_popcountll(w);
+#else
+    int c = 0;
+    for (; w; w &= w - 1) c++;
+    return c;
+#endif
+}
+
+static int test_bit(const uint64_t* bits, uint32_t v) {
+    return (int)((bits[v >> 6] >> (v & 63)) & 1);
+}
+
+// ============================================================================
+// Куски
+// ============================================================================
+
+static void container_free(roaring_container* c) {
+    free(c->values);
+    free(c->bits);
+    memset(c, 0, sizeof(*c));
+}
+
+// 1 - значение найдено; *pos - его место или место для вставки
+static int array_find(const roaring_container* c, uint16_t v, uint32_t* pos) {
+    uint32_t lo = 0, hi = c->cardinality;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (c->values[mid] < v) lo = mid + 1; else hi = mid;
+    }
+    *pos = lo;
+    return lo < c->cardinality && c->values[lo] == v;
+}
+
+static int to_bitmap(roaring_container* c) {
+    uint64_t* bits = calloc(ROARING_WORDS, sizeof(uint64_t));
+    if (!bits) return 0;
+    for (uint32_t i = 0; i < c->cardinality; i++) bits[c->values[i] >> 6] |= (uint64_t)1 << (c->values[i] & 63);
+    free(c->values);
+    c->values = NULL;
+    c->capacity = 0;
+    c->bits = bits;
+    return 1;
+}
+
+static int to_array(roaring_container* c) {
+    uint16_t* values = malloc((c->cardinality ? c->cardinality : 1) * sizeof(uint16_t));
+    if (!values) return 0;
+    uint32_t n = 0;
+    for (uint32_t w = 0; w < ROARING_WORDS; w++) {
+        for (uint64_t bits = c->bits[w]; bits; bits &= bits - 1) values[n++] = (uint16_t)(w * 64 + lowest_bit(bits));
+    }
+    free(c->bits);
+    c->bits = NULL;
+    c->values = values;
+    c->capacity = c->cardinality;
+    return 1;
+}
+
+static int container_add(roaring_container* c, uint16_t v) {
+    if (c->bits) {
+        uint64_t bit = (uint64_t)1 << (v & 63);
+        if (!(c->bits[v >> 6] & bit)) {
+            c->bits[v >> 6] |= bit;
+            c->cardinality++;
+        }
+        return 1;
+    }
+
+    uint32_t pos;
+    // Позиции записей обычно добавляются по возрастанию
+    if (c->cardinality == 0 || c->values[c->cardinality - 1] < v) {
+        pos = c->cardinality;
+    } else if (array_find(c, v, &pos)) {
+        return 1;
+    }
+    if (c->cardinality == ROARING_ARRAY_MAX) {
+        if (!to_bitmap(c)) return 0;
+        return container_add(c, v);
+    }
+    if (c->cardinality == c->capacity) {
+        uint32_t capacity = c->capacity ? c->capacity * 2 : 4;
+        if (capacity > ROARING_ARRAY_MAX) capacity = ROARING_ARRAY_MAX;
+        uint16_t* values = realloc(c->values, capacity * sizeof(uint16_t));
+        if (!values) return 0;
+        c->values = values;
+        c->capacity = capacity;
+    }
+    memmove(c->values + pos + 1, c->values + pos, (c->cardinality - pos) * sizeof(uint16_t));
+    c->values[pos] = v;
+    c->cardinality++;
+    return 1;
+}
+
+static void container_remove(roaring_container* c, uint16_t v) {
+    if (c->bits) {
+        uint64_t bit = (uint64_t)1 << (v & 63);
+        if (!(c->bits[v >> 6] & bit)) return;
+        c->bits[v >> 6] &= ~bit;
+        c->cardinality--;
+        // С запасом, чтобы чередование вставок и удалений на границе не гоняло кусок туда-обратно.
+        // Без памяти кусок остается картой.
+        if (c->cardinality <= ROARING_ARRAY_MAX / 2) to_array(c);
+        return;
+    }
+    uint32_t pos;
+    if (!array_find(c, v, &pos)) return;
+    memmove(c->values + pos, c->values + pos + 1, (c->cardinality - pos - 1) * sizeof(uint16_t));
+    c->cardinality--;
+}
+
+static int container_copy(roaring_container* dst, const roaring_container* src) {
+    memset(dst, 0, sizeof(*dst));
+    dst->cardinality = src->cardinality;
+    if (src->bits) {
+        dst->bits = malloc(ROARING_WORDS * sizeof(uint64_t));
+        if (!dst->bits) return 0;
+        memcpy(dst->bits, src->bits, ROARING_WORDS * sizeof(uint64_t));
+        return 1;
+    }
+    dst->values = malloc((src->cardinality ? src->cardinality : 1) * sizeof(uint16_t));
+    if (!dst->values) return 0;
+    memcpy(dst->values, src->values, src->cardinality * sizeof(uint16_t));
+    dst->capacity = src->cardinality;
+    return 1;
+}
+
+// Кусок как битовая карта: собственная или развернутая в tmp
+static const uint64_t* container_words(const roaring_container* c, uint64_t* tmp) {
+    if (c->bits) return c->bits;
+    memset(tmp, 0, ROARING_WORDS * sizeof(uint64_t));
+    for (uint32_t i = 0; i < c->cardinality; i++) tmp[c->values[i] >> 6] |= (uint64_t)1 << (c->values[i] & 63);
+    return tmp;
+}
+
+// Операция над кусками с одним ключом; пустой результат - cardinality 0. 0 - нет памяти.
+static int container_op(const roaring_container* a, const roaring_container* b, SetOp op, roaring_container* out) {
+    memset(out, 0, sizeof(*out));
+
+    // Массив с массивом - слиянием
+    if (!a->bits && !b->bits) {
+        uint32_t capacity = op == SET_OR ? a->cardinality + b->cardinality : a->cardinality;
+        uint16_t* values = malloc((capacity ? capacity : 1) * sizeof(uint16_t));
+        if (!values) return 0;
+        uint32_t i = 0, j = 0, n = 0;
+        while (i < a->cardinality && j < b->cardinality) {
+            uint16_t x = a->values[i], y = b->values[j];
+            if (x < y) {
+                if (op != SET_AND) values[n++] = x;
+                i++;
+            } else if (y < x) {
+                if (op == SET_OR) values[n++] = y;
+                j++;
+            } else {
+                if (op != SET_ANDNOT) values[n++] = x;
+                i++;
+                j++;
+            }
+        }
+        if (op != SET_AND) {
+            while (i < a->cardinality) values[n++] = a->values[i++];
+        }
+        if (op == SET_OR) {
+            while (j < b->cardinality) values[n++] = b->values[j++];
+        }
+        out->values = values;
+        out->cardinality = n;
+        out->capacity = capacity;
+        if (n > ROARING_ARRAY_MAX && !to_bitmap(out)) {
+            container_free(out);
+            return 0;
+        }
+        return 1;
+    }
+
+    // Массив против карты - проверкой битов; результат не больше массива
+    const roaring_container* array = NULL;
+    const roaring_container* bitmap = NULL;
+    if (op == SET_AND && (!a->bits || !b->bits)) {
+        array = a->bits ? b : a;
+        bitmap = a->bits ? a : b;
+    } else if (op == SET_ANDNOT && !a->bits) {
+        array = a;
+        bitmap = b;
+    }
+    if (array) {
+        uint16_t* values = malloc((array->cardinality ? array->cardinality : 1) * sizeof(uint16_t));
+        if (!values) return 0;
+        uint32_t n = 0;
+        for (uint32_t i = 0; i < array->cardinality; i++) {
+            if (test_bit(bitmap->bits, array->values[i]) == (op == SET_AND)) values[n++] = array->values[i];
+        }
+        out->values = values;
+        out->cardinality = n;
+        out->capacity = array->cardinality;
+        return 1;
+    }
+
+    // Остальное - по словам
+    uint64_t ta[ROARING_WORDS], tb[ROARING_WORDS];
+    const uint64_t* wa = container_words(a, ta);
+    const uint64_t* wb = container_words(b, tb);
+    uint64_t* bits = malloc(ROARING_WORDS * sizeof(uint64_t));
+    if (!bits) return 0;
+    uint32_t n = 0;
+    for (uint32_t w = 0; w < ROARING_WORDS; w++) {
+        uint64_t x = op == SET_AND ? wa[w] & wb[w] : op == SET_OR ? wa[w] | wb[w] : wa[w] & ~wb[w];
+        bits[w] = x;
+        n += (uint32_t)bit_count(x);
+    }
+    out->bits = bits;
+    out->cardinality = n;
+    if (n <= ROARING_ARRAY_MAX) to_array(out);
+    return 1;
+}
+
+// ============================================================================
+// Список кусков
+// ============================================================================
+
+// 1 - кусок с ключом есть; *pos - его место или место для вставки
+static int find_key(const roaring* r, uint16_t key, uint32_t* pos) {
+    if (r->count == 0 || r->keys[r->count - 1] < key) {
+        *pos = r->count;
+        return 0;
+    }
+    uint32_t lo = 0, hi = r->count;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (r->keys[mid] < key) lo = mid + 1; else hi = mid;
+    }
+    *pos = lo;
+    return r->keys[lo] == key;
+}
+
+// Вставляет пустой кусок на место pos
+static roaring_container* insert_container(roaring* r, uint32_t pos, uint16_t key) {
+    if (r->count == r->capacity) {
+        uint32_t capacity = r->capacity ? r->capacity * 2 : 4;
+        uint16_t* keys = realloc(r->keys, capacity * sizeof(uint16_t));
+        if (!keys) return NULL;
+        r->keys = keys;
+        roaring_container* containers = realloc(r->containers, capacity * sizeof(roaring_container));
+        if (!containers) return NULL;
+        r->containers = containers;
+        r->capacity = capacity;
+    }
+    memmove(r->keys + pos + 1, r->keys + pos, (r->count - pos) * sizeof(uint16_t));
+    memmove(r->containers + pos + 1, r->containers + pos, (r->count - pos) * sizeof(roaring_container));
+    r->keys[pos] = key;
+    memset(&r->containers[pos], 0, sizeof(roaring_container));
+    r->count++;
+    return &r->containers[pos];
+}
+
+static void erase_container(roaring* r, uint32_t pos) {
+    container_free(&r->containers[pos]);
+    memmove(r->keys + pos, r->keys + pos + 1, (r->count - pos - 1) * sizeof(uint16_t));
+    memmove(r->containers + pos, r->containers + pos + 1, (r->count - pos - 1) * sizeof(roaring_container));
+    r->count--;
+}
+
+// Дописывает кусок в конец (ключи идут по возрастанию); владение c переходит к r
+static int push_container(roaring* r, uint16_t key, roaring_container* c) {
+    roaring_container* slot = insert_container(r, r->count, key);
+    if (!slot) {
+        container_free(c);
+        return 0;
+    }
+    *slot = *c;
+    return 1;
+}
+
+static int set_op(roaring* out, const roaring* a, const roaring* b, SetOp op) {
+    roaring result;
+    roaring_init(&result);
+    uint32_t i = 0, j = 0;
+    int ok = 1;
+    while (ok && (i < a->count || j < b->count)) {
+        roaring_container c;
+        if (j >= b->count || (i < a->count && a->keys[i] < b->keys[j])) {
+            // Кусок только в a
+            if (op != SET_AND) ok = container_copy(&c, &a->containers[i]) && push_container(&result, a->keys[i], &c);
+            i++;
+        } else if (i >= a->count || b->keys[j] < a->keys[i]) {
+            if (op == SET_OR) ok = container_copy(&c, &b->containers[j]) && push_container(&result, b->keys[j], &c);
+            j++;
+        } else {
+            ok = container_op(&a->containers[i], &b->containers[j], op, &c);
+            if (ok && c.cardinality == 0) container_free(&c);
+            else if (ok) ok = push_container(&result, a->keys[i], &c);
+            i++;
+            j++;
+        }
+    }
+    if (!ok) {
+        roaring_free(&result);
+        return 0;
+    }
+    roaring_free(out);
+    *out = result;
+    return 1;
+}
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+void roaring_init(roaring* r) {
+    memset(r, 0, sizeof(*r));
+}
+
+void roaring_free(roaring* r) {
+    for (uint32_t i = 0; i < r->count; i++) container_free(&r->containers[i]);
+    free(r->keys);
+    free(r->containers);
+    memset(r, 0, sizeof(*r));
+}
+
+void roaring_clear(roaring* r) {
+    for (uint32_t i = 0; i < r->count; i++) container_free(&r->containers[i]);
+    r->count = 0;
+}
+
+int roaring_add(roaring* r, uint32_t value) {
+    uint32_t pos;
+    roaring_container* c;
+    if (find_key(r, (uint16_t)(value >> 16), &pos)) {
+        c = &r->containers[pos];
+    } else if (!(c = insert_container(r, pos, (uint16_t)(value >> 16)))) {
+        return 0;
+    }
+    if (container_add(c, (uint16_t)value)) return 1;
+    if (c->cardinality == 0) erase_container(r, pos);
+    return 0;
+}
+
+void roaring_remove(roaring* r, uint32_t value) {
+    uint32_t pos;
+    if (!find_key(r, (uint16_t)(value >> 16), &pos)) return;
+    container_remove(&r->containers[pos], (uint16_t)value);
+    if (r->containers[pos].cardinality == 0) erase_container(r, pos);
+}
+
+int roaring_contains(const roaring* r, uint32_t value) {
+    uint32_t pos;
+    if (!find_key(r, (uint16_t)(value >> 16), &pos)) return 0;
+    const roaring_container* c = &r->containers[pos];
+    if (c->bits) return test_bit(c->bits, (uint16_t)value);
+    return array_find(c, (uint16_t)value, &pos);
+}
+
+uint64_t roaring_cardinality(const roaring* r) {
+    uint64_t total = 0;
+    for (uint32_t i = 0; i < r->count; i++) total += r->containers[i].cardinality;
+    return total;
+}
+
+int roaring_and(roaring* out, const roaring* a, const roaring* b) {
+    return set_op(out, a, b, SET_AND);
+}
+
+int roaring_or(roaring* out, const roaring* a, const roaring* b) {
+    return set_op(out, a, b, SET_OR);
+}
+
+int roaring_andnot(roaring* out, const roaring* a, const roaring* b) {
+    return set_op(out, a, b, SET_ANDNOT);
+}
+
+uint64_t roaring_and_cardinality(const roaring* a, const roaring* b) {
+    uint64_t total = 0;
+    uint32_t i = 0, j = 0;
+    while (i < a->count && j < b->count) {
+        if (a->keys[i] < b->keys[j]) {
+            i++;
+            continue;
+        }
+        if (b->keys[j] < a->keys[i]) {
+            j++;
+            continue;
+        }
+        const roaring_container* x = &a->containers[i++];
+        const roaring_container* y = &b->containers[j++];
+        if (x->bits && y->bits) {
+            for (uint32_t w = 0; w < ROARING_WORDS; w++) total += (uint64_t)bit_count(x->bits[w] & y->bits[w]);
+        } else if (x->bits || y->bits) {
+            const roaring_container* array = x->bits ? y : x;
+            const uint64_t* bits = x->bits ? x->bits : y->bits;
+            for (uint32_t k = 0; k < array->cardinality; k++) total += (uint64_t)test_bit(bits, array->values[k]);
+        } else {
+            uint32_t p = 0, q = 0;
+            while (p < x->cardinality && q < y->cardinality) {
+                if (x->values[p] < y->values[q]) p++;
+                else if (y->values[q] < x->values[p]) q++;
+                else {
+                    total++;
+                    p++;
+                    q++;
+                }
+            }
+        }
+    }
+    return total;
+}
+
+uint64_t roaring_count_words(const roaring* r, const uint64_t* words, size_t word_count) {
+    uint64_t total = 0;
+    for (uint32_t i = 0; i < r->count; i++) {
+        const roaring_container* c = &r->containers[i];
+        size_t base = (size_t)r->keys[i] * ROARING_WORDS;
+        if (base >= word_count) break;
+        if (c->bits) {
+            size_t n = word_count - base < ROARING_WORDS ? word_count - base : ROARING_WORDS;
+            for (size_t w = 0; w < n; w++) total += (uint64_t)bit_count(c->bits[w] & words[base + w]);
+        } else {
+            for (uint32_t k = 0; k < c->cardinality; k++) {
+                size_t w = base + (c->values[k] >> 6);
+                if (w < word_count) total += (words[w] >> (c->values[k] & 63)) & 1;
+            }
+        }
+    }
+    return total;
+}
+
+void roaring_to_words(const roaring* r, uint64_t* words, size_t word_count) {
+    for (uint32_t i = 0; i < r->count; i++) {
+        const roaring_container* c = &r->containers[i];
+        size_t base = (size_t)r->keys[i] * ROARING_WORDS;
+        if (base >= word_count) break;
+        if (c->bits) {
+            size_t n = word_count - base < ROARING_WORDS ? word_count - base : ROARING_WORDS;
+            for (size_t w = 0; w < n; w++) words[base + w] |= c->bits[w];
+        } else {
+            for (uint32_t k = 0; k < c->cardinality; k++) {
+                size_t w = base + (c->values[k] >> 6);
+                if (w < word_count) words[w] |= (uint64_t)1 << (c->values[k] & 63);
+            }
+        }
+    }
+}
+
+int roaring_from_words(roaring* r, const uint64_t* words, size_t word_count) {
+    roaring result;
+    roaring_init(&result);
+    for (size_t base = 0; base < word_count; base += ROARING_WORDS) {
+        size_t n = word_count - base < ROARING_WORDS ? word_count - base : ROARING_WORDS;
+        uint32_t cardinality = 0;
+        for (size_t w = 0; w < n; w++) cardinality += (uint32_t)bit_count(words[base + w]);
+        if (cardinality == 0) continue;
+
+        roaring_container c;
+        memset(&c, 0, sizeof(c));
+        c.bits = calloc(ROARING_WORDS, sizeof(uint64_t));
+        if (!c.bits) {
+            roaring_free(&result);
+            return 0;
+        }
+        memcpy(c.bits, words + base, n * sizeof(uint64_t));
+        c.cardinality = cardinality;
+        if (cardinality <= ROARING_ARRAY_MAX) to_array(&c);
+        if (!push_container(&result, (uint16_t)(base / ROARING_WORDS), &c)) {
+            roaring_free(&result);
+            return 0;
+        }
+    }
+    roaring_free(r);
+    *r = result;
+    return 1;
+}
+
+int64_t roaring_to_slots(const roaring* r, int64_t** out) {
+    uint64_t total = roaring_cardinality(r);
+    *out = malloc((total ? total : 1) * sizeof(int64_t));
+    if (!*out) return -1;
+    int64_t n = 0;
+    for (uint32_t i = 0; i < r->count; i++) {
+        const roaring_container* c = &r->containers[i];
+        int64_t base = (int64_t)r->keys[i] << 16;
+        if (c->bits) {
+            for (uint32_t w = 0; w < ROARING_WORDS; w++) {
+                for (uint64_t bits = c->bits[w]; bits; bits &= bits - 1) (*out)[n++] = base + w * 64 + lowest_bit(bits);
+            }
+        } else {
+            for (uint32_t k = 0; k < c->cardinality; k++) (*out)[n++] = base + c->values[k];
+        }
+    }
+    return n;
+}
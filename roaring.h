@@ -0,0 +1,62 @@
+#ifndef ROARING_H
+#define ROARING_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// ============================================================================
+// Сжатое множество 32-битных позиций в духе Roaring.
+// Позиции делятся на куски по старшим 16 битам; кусок хранится либо
+// отсортированным массивом младших 16 бит (до ROARING_ARRAY_MAX значений),
+// либо битовой картой на 65536 бит. Вид выбирается по мощности куска и
+// меняется при вставке, удалении и операциях над множествами.
+// ============================================================================
+
+#define ROARING_ARRAY_MAX 4096 // больше значений - кусок становится битовой картой
+#define ROARING_WORDS 1024     // слов в битовой карте куска
+
+typedef struct roaring_container {
+    uint32_t cardinality;
+    uint32_t capacity; // емкость values
+    uint16_t* values;  // массив по возрастанию (bits == NULL)
+    uint64_t* bits;    // битовая карта из ROARING_WORDS слов
+} roaring_container;
+
+typedef struct roaring {
+    uint16_t* keys;    // старшие 16 бит кусков, по возрастанию
+    roaring_container* containers;
+    uint32_t count;
+    uint32_t capacity;
+} roaring;
+
+void roaring_init(roaring* r);
+void roaring_free(roaring* r);
+void roaring_clear(roaring* r);
+
+// 0 - не хватило памяти (множество не изменилось)
+int roaring_add(roaring* r, uint32_t value);
+void roaring_remove(roaring* r, uint32_t value);
+int roaring_contains(const roaring* r, uint32_t value);
+uint64_t roaring_cardinality(const roaring* r);
+
+// out = a и b, a или b, a без b. out - инициализированное множество,
+// его прежнее содержимое заменяется; может совпадать с a или b.
+// 0 - не хватило памяти (out не изменен).
+int roaring_and(roaring* out, const roaring* a, const roaring* b);
+int roaring_or(roaring* out, const roaring* a, const roaring* b);
+int roaring_andnot(roaring* out, const roaring* a, const roaring* b);
+
+// Мощность пересечения без построения результата
+uint64_t roaring_and_cardinality(const roaring* a, const roaring* b);
+
+// Обмен с плотной битовой картой по позициям (бит i - слово i / 64, как filter_bitmap).
+// count_words - число позиций множества, у которых стоит бит в words;
+// to_words добавляет позиции в words; from_words строит множество заново.
+uint64_t roaring_count_words(const roaring* r, const uint64_t* words, size_t word_count);
+void roaring_to_words(const roaring* r, uint64_t* words, size_t word_count);
+int roaring_from_words(roaring* r, const uint64_t* words, size_t word_count);
+
+// Позиции по возрастанию (*out - malloc). Возвращает их число или -1.
+int64_t roaring_to_slots(const roaring* r, int64_t** out);
+
+#endif // ROARING_H
@@ -0,0 +1,419 @@
+#include "segment.h"
+#include "crc32c.h"
+#include "parallel.h"
+#include "work_dict.h"
+#include "file_io.h"
+
+// ============================================================================
+// Internal utilities
+// ============================================================================
+
+static uint32_t segment_count_for(uint64_t count, uint32_t segment_records) {
+    return (uint32_t)((count + segment_records - 1) / segment_records);
+}
+
+// Порядок байтов манифеста: little-endian
+static int host_is_little_endian(void) {
+    const uint16_t probe = 1;
+    return *(const uint8_t*)&probe == 1;
+}
+
+static uint32_t swap32(uint32_t v) {
+    return (v >> 24) | ((v >> 8) & 0xFF00u) | ((v << 8) & 0xFF0000u) | (v << 24);
+}
+
+static uint64_t swap64(uint64_t v) {
+    return ((uint64_t)swap32((uint32_t)v) << 32) | swap32((uint32_t)(v >> 32));
+}
+
+// Преобразования симметричны: годятся и для записи, и для чтения
+static void header_to_little_endian(segment_manifest_header* h) {
+    if (host_is_little_endian()) return;
+    h->magic = swap32(h->magic);
+    h->version = swap32(h->version);
+    h->record_count = swap64(h->record_count);
+    h->segment_count = swap32(h->segment_count);
+    h->segment_records = swap32(h->segment_records);
+    h->checkpoint_lsn = swap64(h->checkpoint_lsn);
+    h->checksum = swap32(h->checksum);
+    h->dict_size = swap32(h->dict_size);
+}
+
+static void entries_to_little_endian(segment_entry* e, size_t count) {
+    if (host_is_little_endian()) return;
+    for (size_t i = 0; i < count; i++) {
+        e[i].record_count = swap64(e[i].record_count);
+        e[i].checksum = swap32(e[i].checksum);
+        e[i].generation = swap32(e[i].generation);
+    }
+}
+
+// Манифест пишется рядом и заменяет прежний переименованием: прервавшаяся
+// запись оставляет прежний манифест целым. Контрольная сумма считается по
+// байтам таблицы сегментов в файле (little-endian).
+static int write_manifest(const char* filename, segment_manifest_header header,
+                          segment_entry* entries, const unsigned char* dict) {
+    size_t n = header.segment_count;
+    size_t dict_size = header.dict_size;
+    entries_to_little_endian(entries, n);
+    header.checksum = crc32c(crc32c(0, entries, n * sizeof(segment_entry)), dict, dict_size);
+    header_to_little_endian(&header);
+
+    char tmp[300];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", filename);
+    FILE* f = fopen(tmp, "wb");
+    int ok = f && fwrite(&header, sizeof(header), 1, f) == 1 &&
+             (n == 0 || fwrite(entries, sizeof(segment_entry), n, f) == n) &&
+             fwrite(dict, 1, dict_size, f) == dict_size &&
+             file_sync(f);
+    if (f && fclose(f) != 0) ok = 0;
+    entries_to_little_endian(entries, n);
+    if (ok) ok = file_replace(tmp, filename);
+    if (!ok) remove(tmp);
+    return ok;
+}
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+void get_segment_filename(const char* manifest, uint32_t index, uint32_t generation, char* out, size_t out_size) {
+    if (generation == 0) {
+        snprintf(out, out_size, "%s.%04u", manifest, index);
+    } else {
+        snprintf(out, out_size, "%s.%04u.%u", manifest, index, generation);
+    }
+}
+
+int segment_read_manifest(const char* filename, segment_manifest_header* header, segment_entry** entries,
+                          uint32_t** remap, uint32_t* remap_count) {
+    *entries = NULL;
+    if (remap) {
+        *remap = NULL;
+        *remap_count = 0;
+    }
+    FILE* f = fopen(filename, "rb");
+    if (!f) return 0;
+
+    unsigned char* dict = NULL;
+    int ok = fread(header, sizeof(*header), 1, f) == 1;
+    if (ok) header_to_little_endian(header);
+    ok = ok && header->magic == SEGMENT_MAGIC &&
+         header->version >= 1 && header->version <= SEGMENT_VERSION &&
+         header->segment_records > 0 && header->segment_records % FILE_BLOCK_RECORDS == 0 &&
+         header->segment_count == segment_count_for(header->record_count, header->segment_records);
+    if (ok && header->version == 1) header->dict_size = 0;
+    if (ok) {
+        size_t n = header->segment_count;
+        *entries = malloc((n ? n : 1) * sizeof(segment_entry));
+        dict = malloc(header->dict_size ? header->dict_size : 1);
+        ok = *entries && dict && fread(*entries, sizeof(segment_entry), n, f) == n &&
+             fread(dict, 1, header->dict_size, f) == header->dict_size &&
+             crc32c(crc32c(0, *entries, n * sizeof(segment_entry)), dict, header->dict_size) == header->checksum;
+        if (ok) entries_to_little_endian(*entries, n);
+        // До версии 3 поле поколения было резервным
+        for (size_t i = 0; ok && header->version < SEGMENT_VERSION && i < n; i++) (*entries)[i].generation = 0;
+    }
+    fclose(f);
+
+    if (ok && remap && header->version != 1) {
+        ok = work_dict_import(work_dict_shared(), dict, header->dict_size, remap, remap_count);
+    }
+    free(dict);
+
+    if (!ok) {
+        free(*entries);
+        *entries = NULL;
+        return 0;
+    }
+
+    // Все сегменты, кроме последнего, заполнены полностью
+    uint64_t total = 0;
+    for (uint32_t i = 0; i < header->segment_count; i++) {
+        uint64_t expected = header->record_count - total < header->segment_records
+                          ? header->record_count - total : header->segment_records;
+        if ((*entries)[i].record_count != expected) {
+            free(*entries);
+            *entries = NULL;
+            if (remap) {
+                free(*remap);
+                *remap = NULL;
+            }
+            return 0;
+        }
+        total += expected;
+    }
+    return 1;
+}
+
+int segment_is_manifest(const char* filename) {
+    FILE* f = fopen(filename, "rb");
+    if (!f) return 0;
+    uint32_t magic = 0;
+    int ok = fread(&magic, sizeof(magic), 1, f) == 1 &&
+             (host_is_little_endian() ? magic : swap32(magic)) == SEGMENT_MAGIC;
+    fclose(f);
+    return ok;
+}
+
+// ============================================================================
+// Сохранение
+// ============================================================================
+
+enum { SEGMENT_FAILED = 0, SEGMENT_WRITTEN = 1, SEGMENT_KEPT = 2 };
+
+typedef struct {
+    struct data_base* system;
+    const char* manifest;
+    segment_entry* entries;
+    const segment_entry* old_entries; // NULL, если старые сегменты нельзя переиспользовать
+    const segment_entry* live_entries; // сегменты действующего манифеста (NULL - его нет)
+    uint32_t old_count;
+    int* status;
+} SegmentSaveJob;
+
+static void save_segment(void* ctx, size_t index) {
+    SegmentSaveJob* job = (SegmentSaveJob*)ctx;
+    uint64_t first = (uint64_t)index * SEGMENT_RECORDS;
+    uint64_t left = (uint64_t)job->system->size - first;
+    uint64_t n = left < SEGMENT_RECORDS ? left : SEGMENT_RECORDS;
+
+    segment_entry* entry = &job->entries[index];
+    memset(entry, 0, sizeof(*entry));
+    entry->record_count = n;
+
+    // Сегмент без измененных страниц уже лежит на диске в нужном виде
+    if (job->old_entries && index < job->old_count &&
+        job->old_entries[index].record_count == n &&
+        !db_range_dirty(job->system, (int64_t)first, (int64_t)n)) {
+        entry->checksum = job->old_entries[index].checksum;
+        entry->generation = job->old_entries[index].generation;
+        job->status[index] = SEGMENT_KEPT;
+        return;
+    }
+
+    // Файл действующего манифеста не трогаем: новое содержимое - в следующее поколение
+    if (job->live_entries && index < job->old_count) entry->generation = job->live_entries[index].generation + 1;
+    char filename[300];
+    get_segment_filename(job->manifest, (uint32_t)index, entry->generation, filename, sizeof(filename));
+    job->status[index] = write_records_v2(filename, job->system->records + first, (size_t)n,
+                                          job->system->lsn, &entry->checksum)
+                       ? SEGMENT_WRITTEN : SEGMENT_FAILED;
+}
+
+int save_to_segments(struct data_base* system, const char* manifest) {
+    // Сохранение может заменить файл, который сейчас отображен: переносим записи в память
+    db_compact(system);
+    db_detach_mapping(system, system->capacity);
+
+    segment_manifest_header header;
+    memset(&header, 0, sizeof(header));
+    header.magic = SEGMENT_MAGIC;
+    header.version = SEGMENT_VERSION;
+    header.record_count = (uint64_t)system->size;
+    header.segment_records = SEGMENT_RECORDS;
+    header.segment_count = segment_count_for(header.record_count, SEGMENT_RECORDS);
+    header.checkpoint_lsn = system->lsn;
+
+    segment_manifest_header old_header;
+    segment_entry* old_entries = NULL;
+    int have_old = segment_read_manifest(manifest, &old_header, &old_entries, NULL, NULL);
+
+    size_t n = header.segment_count;
+    segment_entry* entries = malloc((n ? n : 1) * sizeof(segment_entry));
+    int* status = malloc((n ? n : 1) * sizeof(int));
+    if (!entries || !status) {
+        printf("Ошибка: недостаточно памяти для сохранения\n");
+        free(entries);
+        free(status);
+        free(old_entries);
+        return 0;
+    }
+
+    SegmentSaveJob job;
+    job.system = system;
+    job.manifest = manifest;
+    job.entries = entries;
+    job.old_entries = have_old && old_header.version == SEGMENT_VERSION &&
+                      old_header.segment_records == SEGMENT_RECORDS &&
+                      strcmp(system->synced_file, manifest) == 0 ? old_entries : NULL;
+    job.live_entries = have_old ? old_entries : NULL;
+    job.old_count = have_old ? old_header.segment_count : 0;
+    job.status = status;
+    crc32c_init();
+    parallel_for(n, save_segment, &job);
+
+    int ok = 1;
+    uint32_t written = 0;
+    for (uint32_t i = 0; i < header.segment_count; i++) {
+        if (status[i] == SEGMENT_FAILED) {
+            char filename[300];
+            get_segment_filename(manifest, i, entries[i].generation, filename, sizeof(filename));
+            printf("Ошибка записи сегмента: %s\n", filename);
+            ok = 0;
+        } else if (status[i] == SEGMENT_WRITTEN) {
+            written++;
+        }
+    }
+
+    // Манифест подменяется последним: до этого момента действуют прежний манифест
+    // и его сегменты, новые поколения лежат рядом и ни на что не влияют.
+    // Словарь только пополняется, поэтому id в нетронутых сегментах остаются верными.
+    size_t dict_size = 0;
+    unsigned char* dict = ok ? work_dict_serialize(work_dict_shared(), &dict_size) : NULL;
+    if (ok && !dict) {
+        printf("Ошибка: недостаточно памяти для сохранения\n");
+        ok = 0;
+    }
+    if (ok) {
+        header.dict_size = (uint32_t)dict_size;
+        ok = write_manifest(manifest, header, entries, dict);
+        if (!ok) printf("Ошибка записи манифеста: %s\n", manifest);
+    }
+    free(dict);
+
+    // После подмены не нужны прежние поколения перезаписанных сегментов и сегменты
+    // за концом уменьшившейся базы; при ошибке - наоборот, недействующие новые файлы
+    for (uint32_t i = 0; i < header.segment_count || (have_old && i < old_header.segment_count); i++) {
+        int rewritten = i < header.segment_count && status[i] == SEGMENT_WRITTEN;
+        int was_live = have_old && i < old_header.segment_count;
+        char filename[300];
+        if (ok && was_live && (rewritten || i >= header.segment_count)) {
+            get_segment_filename(manifest, i, old_entries[i].generation, filename, sizeof(filename));
+            remove(filename);
+        } else if (!ok && rewritten) {
+            get_segment_filename(manifest, i, entries[i].generation, filename, sizeof(filename));
+            remove(filename);
+        }
+    }
+
+    free(entries);
+    free(status);
+    free(old_entries);
+
+    if (!ok) return 0;
+    db_mark_synced(system, manifest);
+    printf("Данные сохранены в сегментированную базу: %s\n", manifest);
+    printf("  Записей: %lld, сегментов: %u (перезаписано: %u)\n",
+           (long long)system->size, header.segment_count, written);
+    return 1;
+}
+
+// ============================================================================
+// Загрузка
+// ============================================================================
+
+enum { SEGMENT_READ_ERROR = 0, SEGMENT_OK = 1, SEGMENT_DAMAGED = -1 };
+
+typedef struct {
+    const char* manifest;
+    const segment_manifest_header* header;
+    const segment_entry* entries;
+    const uint32_t* remap;
+    uint32_t remap_count;
+    technical_maintenance* records;
+    int* status;
+} SegmentLoadJob;
+
+static void load_segment(void* ctx, size_t index) {
+    SegmentLoadJob* job = (SegmentLoadJob*)ctx;
+    char filename[300];
+    get_segment_filename(job->manifest, (uint32_t)index, job->entries[index].generation, filename, sizeof(filename));
+
+    uint64_t first = (uint64_t)index * job->header->segment_records;
+    uint32_t checksum = 0;
+    int result = read_records_v2(filename, job->records + first, (size_t)job->entries[index].record_count,
+                                 job->remap, job->remap_count, &checksum);
+    if (result == 1 && checksum != job->entries[index].checksum) result = SEGMENT_DAMAGED;
+    job->status[index] = result;
+}
+
+int load_from_segments(struct data_base* system, const char* manifest) {
+    segment_manifest_header header;
+    segment_entry* entries = NULL;
+    uint32_t* remap = NULL;
+    uint32_t remap_count = 0;
+    // Словарь импортируется до параллельного чтения: потоки только читают remap
+    if (!segment_read_manifest(manifest, &header, &entries, &remap, &remap_count)) {
+        printf("Ошибка: поврежден манифест сегментированной базы: %s\n", manifest);
+        return 0;
+    }
+    if (header.record_count > SIZE_MAX / sizeof(technical_maintenance)) {
+        printf("Ошибка: Некорректное количество записей: %llu\n", (unsigned long long)header.record_count);
+        free(entries);
+        free(remap);
+        return 0;
+    }
+
+    // Записи на диске совпадут с памятью, только если id словаря не менялись
+    int same_ids = header.version != 1;
+    for (uint32_t i = 0; same_ids && i < remap_count; i++) {
+        if (remap[i] != i) same_ids = 0;
+    }
+
+    size_t count = (size_t)header.record_count;
+    size_t n = header.segment_count;
+    technical_maintenance* records = malloc((count > 10 ? count : 10) * sizeof(technical_maintenance));
+    int* status = malloc((n ? n : 1) * sizeof(int));
+    if (!records || !status) {
+        printf("Ошибка: недостаточно памяти для загрузки\n");
+        free(records);
+        free(status);
+        free(entries);
+        free(remap);
+        return 0;
+    }
+
+    SegmentLoadJob job;
+    job.manifest = manifest;
+    job.header = &header;
+    job.entries = entries;
+    job.remap = remap;
+    job.remap_count = remap_count;
+    job.records = records;
+    job.status = status;
+    crc32c_init();
+    if (header.version != 1) {
+        parallel_for(n, load_segment, &job);
+    } else {
+        // Сегменты версии 1 пополняют общий словарь при чтении - только последовательно
+        for (size_t i = 0; i < n; i++) load_segment(&job, i);
+    }
+
+    int failed = 0, damaged = 0;
+    for (uint32_t i = 0; i < header.segment_count; i++) {
+        char filename[300];
+        get_segment_filename(manifest, i, entries[i].generation, filename, sizeof(filename));
+        uint64_t first = (uint64_t)i * header.segment_records;
+        if (status[i] == SEGMENT_READ_ERROR) {
+            printf("Ошибка чтения сегмента: %s\n", filename);
+            failed++;
+        } else if (status[i] == SEGMENT_DAMAGED) {
+            if (damaged == 0) printf("Предупреждение: Контрольная сумма не совпадает!\n");
+            printf("  Повреждены записи %llu-%llu (сегмент %s)\n",
+                   (unsigned long long)first + 1,
+                   (unsigned long long)(first + entries[i].record_count), filename);
+            damaged++;
+        }
+    }
+    free(status);
+    free(entries);
+    free(remap);
+
+    if (failed > 0) {
+        free(records);
+        return 0;
+    }
+
+    db_adopt_records(system, records, (int64_t)count, count > 10 ? (int64_t)count : 10);
+    system->lsn = header.checkpoint_lsn;
+
+    if (damaged > 0) {
+        printf("  Возможно повреждение данных\n");
+        return 1;
+    }
+    if (same_ids) db_mark_synced(system, manifest);
+    printf("Данные загружены из сегментированной базы: %s\n", manifest);
+    printf("  Записей: %lld, сегментов: %u\n", (long long)system->size, header.segment_count);
+    return 1;
+}
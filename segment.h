@@ -0,0 +1,61 @@
+#ifndef SEGMENT_H
+#define SEGMENT_H
+
+#include "database.h"
+
+// ============================================================================
+// Сегментированная база: манифест + файлы сегментов.
+// Записи делятся на сегменты по SEGMENT_RECORDS, каждый сегмент - обычный
+// файл v2 с таблицей CRC блоков (<манифест>.0000, <манифест>.0001, ...).
+// Манифест лежит под именем базы и хранит число записей, LSN контрольной
+// точки, контрольную сумму и поколение каждого сегмента и словарь типов работ,
+// общий для всех сегментов (с версии 2). Сегменты читаются, пишутся и
+// проверяются параллельно; при сохранении неизмененные сегменты не трогаются.
+// Измененный сегмент пишется в файл следующего поколения (<манифест>.0001.3),
+// а манифест - во временный файл, который заменяет прежний одним переименованием.
+// До замены прежний манифест и все его сегменты остаются целыми, после нее
+// файлы прежних поколений удаляются.
+// Все поля little-endian.
+// ============================================================================
+
+#define SEGMENT_MAGIC   0x47455341 // "ASEG"
+#define SEGMENT_VERSION 3 // 2 - без поколений сегментов, 1 - еще и без словаря (type_work строкой)
+
+#define SEGMENT_RECORDS (1u << 20) // записей в сегменте (24 МиБ), кратно FILE_BLOCK_RECORDS
+
+typedef struct segment_manifest_header {
+    uint32_t magic;           // SEGMENT_MAGIC
+    uint32_t version;         // SEGMENT_VERSION
+    uint64_t record_count;    // Всего записей
+    uint32_t segment_count;   // Число сегментов (segment_entry сразу после заголовка)
+    uint32_t segment_records; // Записей в каждом сегменте, кроме последнего
+    uint64_t checkpoint_lsn;  // LSN последнего изменения журнала, вошедшего в базу
+    uint32_t checksum;        // CRC32C таблицы сегментов и словаря
+    uint32_t dict_size;       // Байт словаря типов работ после таблицы сегментов
+} segment_manifest_header;
+
+typedef struct segment_entry {
+    uint64_t record_count; // Записей в сегменте
+    uint32_t checksum;     // Итоговая контрольная сумма заголовка файла сегмента
+    uint32_t generation;   // Поколение файла сегмента (0 в манифестах до версии 3)
+} segment_entry;
+
+// Имя файла сегмента: <манифест>.NNNN, начиная с поколения 1 - <манифест>.NNNN.G
+void get_segment_filename(const char* manifest, uint32_t index, uint32_t generation, char* out, size_t out_size);
+
+// Читает и проверяет манифест. *entries выделяется malloc (освобождает вызывающий).
+// Если remap не NULL, словарь манифеста добавляется в общий словарь, а *remap
+// получает перевод id сегментов в общие id (NULL для манифеста версии 1).
+int segment_read_manifest(const char* filename, segment_manifest_header* header, segment_entry** entries,
+                          uint32_t** remap, uint32_t* remap_count);
+
+// 1, если filename - манифест сегментированной базы
+int segment_is_manifest(const char* filename);
+
+// Сохраняет базу сегментами и подменяет манифест последним
+int save_to_segments(struct data_base* system, const char* manifest);
+
+// Загружает все сегменты параллельно с проверкой CRC
+int load_from_segments(struct data_base* system, const char* manifest);
+
+#endif // SEGMENT_H
@@ -0,0 +1,479 @@
+#include "simd.h"
+
+#include <math.h>
+#include <string.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SIMD_X86 1
+#include <immintrin.h>
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#define TARGET_SSE41 __attribute__((target("sse4.1")))
+#endif
+
+#define BLOCK 64 // значений на одно слово битовой карты
+
+// ============================================================================
+// Общие части
+// ============================================================================
+
+typedef struct {
+    int64_t count;
+    double sum;
+    float min;
+    float max;
+} f32_acc;
+
+typedef struct {
+    int64_t count;
+    int64_t sum;
+    int32_t min;
+    int32_t max;
+} i32_acc;
+
+typedef struct {
+    double lo;
+    double width;
+    double last; // bins - 1
+} hist_params;
+
+static int lowest_bit(uint64_t w) {
+#ifdef __GNUC__
+    return __builtin_ctzll(w);
+#else
+    int i = 0;
+    while (!(w & 1)) {
+        w >>= 1;
+        i++;
+    }
+    return i;
+#endif
+}
+
+static int bit_count(uint64_t w) {
+#ifdef __GNUC__
+    return __builtin_popcountll(w);
+#else
+    int c = 0;
+    for (; w; w &= w - 1) c++;
+    return c;
+#endif
+}
+
+// Слово отбора для блока b; биты за концом массива сброшены
+static uint64_t block_mask(const uint64_t* selection, size_t b, size_t n) {
+    uint64_t w = selection ? selection[b] : ~(uint64_t)0;
+    size_t rest = n - b * BLOCK;
+    if (rest < BLOCK) w &= ((uint64_t)1 << rest) - 1;
+    return w;
+}
+
+// Номер корзины; NaN и значения меньше lo - в первую корзину
+static uint32_t bin_of(double v, const hist_params* p) {
+    double x = (v - p->lo) / p->width;
+    if (!(x >= 0)) x = 0;
+    if (x > p->last) x = p->last;
+    return (uint32_t)x;
+}
+
+static void count_bins(const uint32_t* idx, uint64_t mask, uint64_t* counts) {
+    if (mask == ~(uint64_t)0) {
+        for (int i = 0; i < BLOCK; i++) counts[idx[i]]++;
+    } else {
+        for (; mask; mask &= mask - 1) counts[idx[lowest_bit(mask)]]++;
+    }
+}
+
+// ============================================================================
+// Скалярные ядра (и хвосты неполных блоков)
+// ============================================================================
+
+static void stats_f32_scalar(const float* v, uint64_t mask, f32_acc* acc) {
+    if (mask == ~(uint64_t)0) {
+        for (int i = 0; i < BLOCK; i++) {
+            acc->sum += v[i];
+            if (v[i] < acc->min) acc->min = v[i];
+            if (v[i] > acc->max) acc->max = v[i];
+        }
+    } else {
+        for (uint64_t w = mask; w; w &= w - 1) {
+            float x = v[lowest_bit(w)];
+            acc->sum += x;
+            if (x < acc->min) acc->min = x;
+            if (x > acc->max) acc->max = x;
+        }
+    }
+    acc->count += bit_count(mask);
+}
+
+static void stats_i32_scalar(const int32_t* v, uint64_t mask, i32_acc* acc) {
+    if (mask == ~(uint64_t)0) {
+        for (int i = 0; i < BLOCK; i++) {
+            acc->sum += v[i];
+            if (v[i] < acc->min) acc->min = v[i];
+            if (v[i] > acc->max) acc->max = v[i];
+        }
+    } else {
+        for (uint64_t w = mask; w; w &= w - 1) {
+            int32_t x = v[lowest_bit(w)];
+            acc->sum += x;
+            if (x < acc->min) acc->min = x;
+            if (x > acc->max) acc->max = x;
+        }
+    }
+    acc->count += bit_count(mask);
+}
+
+static void hist_f32_scalar(const float* v, uint64_t mask, const hist_params* p, uint64_t* counts) {
+    for (; mask; mask &= mask - 1) counts[bin_of(v[lowest_bit(mask)], p)]++;
+}
+
+static void hist_i32_scalar(const int32_t* v, uint64_t mask, const hist_params* p, uint64_t* counts) {
+    for (; mask; mask &= mask - 1) counts[bin_of(v[lowest_bit(mask)], p)]++;
+}
+
+#ifdef SIMD_X86
+
+// ============================================================================
+// SSE4.1: по 4 значения, маска дорожек из полубайта слова отбора
+// ============================================================================
+
+TARGET_SSE41 static __m128i lanes4(unsigned nibble) {
+    const __m128i bits = _mm_setr_epi32(1, 2, 4, 8);
+    return _mm_cmpeq_epi32(_mm_and_si128(_mm_set1_epi32((int)nibble), bits), bits);
+}
+
+TARGET_SSE41 static void stats_f32_sse41(const float* v, uint64_t mask, f32_acc* acc) {
+    __m128d sum = _mm_setzero_pd();
+    __m128 mn = _mm_set1_ps(acc->min), mx = _mm_set1_ps(acc->max);
+    const __m128 pinf = _mm_set1_ps(INFINITY), ninf = _mm_set1_ps(-INFINITY);
+    for (int k = 0; k < BLOCK / 4; k++) {
+        unsigned nibble = (unsigned)(mask >> (4 * k)) & 0xf;
+        if (!nibble) continue;
+        __m128 x = _mm_loadu_ps(v + 4 * k);
+        if (nibble != 0xf) {
+            __m128 m = _mm_castsi128_ps(lanes4(nibble));
+            mn = _mm_min_ps(mn, _mm_blendv_ps(pinf, x, m));
+            mx = _mm_max_ps(mx, _mm_blendv_ps(ninf, x, m));
+            x = _mm_and_ps(x, m);
+        } else {
+            mn = _mm_min_ps(mn, x);
+            mx = _mm_max_ps(mx, x);
+        }
+        sum = _mm_add_pd(sum, _mm_add_pd(_mm_cvtps_pd(x), _mm_cvtps_pd(_mm_movehl_ps(x, x))));
+    }
+    double s[2];
+    float a[4], b[4];
+    _mm_storeu_pd(s, sum);
+    _mm_storeu_ps(a, mn);
+    _mm_storeu_ps(b, mx);
+    acc->sum += s[0] + s[1];
+    for (int i = 0; i < 4; i++) {
+        if (a[i] < acc->min) acc->min = a[i];
+        if (b[i] > acc->max) acc->max = b[i];
+    }
+    acc->count += bit_count(mask);
+}
+
+TARGET_SSE41 static void stats_i32_sse41(const int32_t* v, uint64_t mask, i32_acc* acc) {
+    __m128i sum = _mm_setzero_si128();
+    __m128i mn = _mm_set1_epi32(acc->min), mx = _mm_set1_epi32(acc->max);
+    const __m128i imax = _mm_set1_epi32(INT32_MAX), imin = _mm_set1_epi32(INT32_MIN);
+    for (int k = 0; k < BLOCK / 4; k++) {
+        unsigned nibble = (unsigned)(mask >> (4 * k)) & 0xf;
+        if (!nibble) continue;
+        __m128i x = _mm_loadu_si128((const __m128i*)(v + 4 * k));
+        if (nibble != 0xf) {
+            __m128i m = lanes4(nibble);
+            mn = _mm_min_epi32(mn, _mm_blendv_epi8(imax, x, m));
+            mx = _mm_max_epi32(mx, _mm_blendv_epi8(imin, x, m));
+            x = _mm_and_si128(x, m);
+        } else {
+            mn = _mm_min_epi32(mn, x);
+            mx = _mm_max_epi32(mx, x);
+        }
+        sum = _mm_add_epi64(sum, _mm_cvtepi32_epi64(x));
+        sum = _mm_add_epi64(sum, _mm_cvtepi32_epi64(_mm_srli_si128(x, 8)));
+    }
+    int64_t s[2];
+    int32_t a[4], b[4];
+    _mm_storeu_si128((__m128i*)s, sum);
+    _mm_storeu_si128((__m128i*)a, mn);
+    _mm_storeu_si128((__m128i*)b, mx);
+    acc->sum += s[0] + s[1];
+    for (int i = 0; i < 4; i++) {
+        if (a[i] < acc->min) acc->min = a[i];
+        if (b[i] > acc->max) acc->max = b[i];
+    }
+    acc->count += bit_count(mask);
+}
+
+// Корзины двух значений, уже переведенных в double
+TARGET_SSE41 static void bins2_sse41(__m128d x, const hist_params* p, uint32_t* out) {
+    x = _mm_div_pd(_mm_sub_pd(x, _mm_set1_pd(p->lo)), _mm_set1_pd(p->width));
+    x = _mm_max_pd(x, _mm_setzero_pd()); // NaN -> 0, как в bin_of
+    x = _mm_min_pd(x, _mm_set1_pd(p->last));
+    _mm_storel_epi64((__m128i*)out, _mm_cvttpd_epi32(x));
+}
+
+TARGET_SSE41 static void hist_f32_sse41(const float* v, uint64_t mask, const hist_params* p, uint64_t* counts) {
+    uint32_t idx[BLOCK];
+    for (int k = 0; k < BLOCK; k += 4) {
+        __m128 x = _mm_loadu_ps(v + k);
+        bins2_sse41(_mm_cvtps_pd(x), p, idx + k);
+        bins2_sse41(_mm_cvtps_pd(_mm_movehl_ps(x, x)), p, idx + k + 2);
+    }
+    count_bins(idx, mask, counts);
+}
+
+TARGET_SSE41 static void hist_i32_sse41(const int32_t* v, uint64_t mask, const hist_params* p, uint64_t* counts) {
+    uint32_t idx[BLOCK];
+    for (int k = 0; k < BLOCK; k += 2) {
+        bins2_sse41(_mm_cvtepi32_pd(_mm_loadl_epi64((const __m128i*)(v + k))), p, idx + k);
+    }
+    count_bins(idx, mask, counts);
+}
+
+// ============================================================================
+// AVX2: по 8 значений, маска дорожек из байта слова отбора
+// ============================================================================
+
+TARGET_AVX2 static __m256i lanes8(unsigned byte) {
+    const __m256i bits = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+    return _mm256_cmpeq_epi32(_mm256_and_si256(_mm256_set1_epi32((int)byte), bits), bits);
+}
+
+TARGET_AVX2 static void stats_f32_avx2(const float* v, uint64_t mask, f32_acc* acc) {
+    __m256d sum = _mm256_setzero_pd();
+    __m256 mn = _mm256_set1_ps(acc->min), mx = _mm256_set1_ps(acc->max);
+    const __m256 pinf = _mm256_set1_ps(INFINITY), ninf = _mm256_set1_ps(-INFINITY);
+    for (int k = 0; k < BLOCK / 8; k++) {
+        unsigned byte = (unsigned)(mask >> (8 * k)) & 0xff;
+        if (!byte) continue;
+        __m256 x = _mm256_loadu_ps(v + 8 * k);
+        if (byte != 0xff) {
+            __m256 m = _mm256_castsi256_ps(lanes8(byte));
+            mn = _mm256_min_ps(mn, _mm256_blendv_ps(pinf, x, m));
+            mx = _mm256_max_ps(mx, _mm256_blendv_ps(ninf, x, m));
+            x = _mm256_and_ps(x, m);
+        } else {
+            mn = _mm256_min_ps(mn, x);
+            mx = _mm256_max_ps(mx, x);
+        }
+        sum = _mm256_add_pd(sum, _mm256_add_pd(_mm256_cvtps_pd(_mm256_castps256_ps128(x)),
+                                               _mm256_cvtps_pd(_mm256_extractf128_ps(x, 1))));
+    }
+    double s[4];
+    float a[8], b[8];
+    _mm256_storeu_pd(s, sum);
+    _mm256_storeu_ps(a, mn);
+    _mm256_storeu_ps(b, mx);
+    acc->sum += (s[0] + s[1]) + (s[2] + s[3]);
+    for (int i = 0; i < 8; i++) {
+        if (a[i] < acc->min) acc->min = a[i];
+        if (b[i] > acc->max) acc->max = b[i];
+    }
+    acc->count += bit_count(mask);
+}
+
+TARGET_AVX2 static void stats_i32_avx2(const int32_t* v, uint64_t mask, i32_acc* acc) {
+    __m256i sum = _mm256_setzero_si256();
+    __m256i mn = _mm256_set1_epi32(acc->min), mx = _mm256_set1_epi32(acc->max);
+    const __m256i imax = _mm256_set1_epi32(INT32_MAX), imin = _mm256_set1_epi32(INT32_MIN);
+    for (int k = 0; k < BLOCK / 8; k++) {
+        unsigned byte = (unsigned)(mask >> (8 * k)) & 0xff;
+        if (!byte) continue;
+        __m256i x = _mm256_loadu_si256((const __m256i*)(v + 8 * k));
+        if (byte != 0xff) {
+            __m256i m = lanes8(byte);
+            mn = _mm256_min_epi32(mn, _mm256_blendv_epi8(imax, x, m));
+            mx = _mm256_max_epi32(mx, _mm256_blendv_epi8(imin, x, m));
+            x = _mm256_and_si256(x, m);
+        } else {
+            mn = _mm256_min_epi32(mn, x);
+            mx = _mm256_max_epi32(mx, x);
+        }
+        sum = _mm256_add_epi64(sum, _mm256_cvtepi32_epi64(_mm256_castsi256_si128(x)));
+        sum = _mm256_add_epi64(sum, _mm256_cvtepi32_epi64(_mm256_extracti128_si256(x, 1)));
+    }
+    int64_t s[4];
+    int32_t a[8], b[8];
+    _mm256_storeu_si256((__m256i*)s, sum);
+    _mm256_storeu_si256((__m256i*)a, mn);
+    _mm256_storeu_si256((__m256i*)b, mx);
+    acc->sum += s[0] + s[1] + s[2] + s[3];
+    for (int i = 0; i < 8; i++) {
+        if (a[i] < acc->min) acc->min = a[i];
+        if (b[i] > acc->max) acc->max = b[i];
+    }
+    acc->count += bit_count(mask);
+}
+
+TARGET_AVX2 static void bins4_avx2(__m256d x, const hist_params* p, uint32_t* out) {
+    x = _mm256_div_pd(_mm256_sub_pd(x, _mm256_set1_pd(p->lo)), _mm256_set1_pd(p->width));
+    x = _mm256_max_pd(x, _mm256_setzero_pd()); // NaN -> 0, как в bin_of
+    x = _mm256_min_pd(x, _mm256_set1_pd(p->last));
+    _mm_storeu_si128((__m128i*)out, _mm256_cvttpd_epi32(x));
+}
+
+TARGET_AVX2 static void hist_f32_avx2(const float* v, uint64_t mask, const hist_params* p, uint64_t* counts) {
+    uint32_t idx[BLOCK];
+    for (int k = 0; k < BLOCK; k += 4) bins4_avx2(_mm256_cvtps_pd(_mm_loadu_ps(v + k)), p, idx + k);
+    count_bins(idx, mask, counts);
+}
+
+TARGET_AVX2 static void hist_i32_avx2(const int32_t* v, uint64_t mask, const hist_params* p, uint64_t* counts) {
+    uint32_t idx[BLOCK];
+    for (int k = 0; k < BLOCK; k += 4) {
+        bins4_avx2(_mm256_cvtepi32_pd(_mm_loadu_si128((const __m128i*)(v + k))), p, idx + k);
+    }
+    count_bins(idx, mask, counts);
+}
+
+#endif // SIMD_X86
+
+// ============================================================================
+// Выбор реализации
+// ============================================================================
+
+typedef struct {
+    SimdLevel level;
+    void (*stats_f32)(const float*, uint64_t, f32_acc*);
+    void (*stats_i32)(const int32_t*, uint64_t, i32_acc*);
+    void (*hist_f32)(const float*, uint64_t, const hist_params*, uint64_t*);
+    void (*hist_i32)(const int32_t*, uint64_t, const hist_params*, uint64_t*);
+} simd_kernels;
+
+static simd_kernels kernels;
+static int kernels_ready = 0;
+static SimdLevel supported_level = SIMD_SCALAR;
+
+static void use_level(SimdLevel level) {
+    kernels.level = SIMD_SCALAR;
+    kernels.stats_f32 = stats_f32_scalar;
+    kernels.stats_i32 = stats_i32_scalar;
+    kernels.hist_f32 = hist_f32_scalar;
+    kernels.hist_i32 = hist_i32_scalar;
+#ifdef SIMD_X86
+    if (level >= SIMD_AVX2) {
+        kernels.level = SIMD_AVX2;
+        kernels.stats_f32 = stats_f32_avx2;
+        kernels.stats_i32 = stats_i32_avx2;
+        kernels.hist_f32 = hist_f32_avx2;
+        kernels.hist_i32 = hist_i32_avx2;
+    } else if (level >= SIMD_SSE41) {
+        kernels.level = SIMD_SSE41;
+        kernels.stats_f32 = stats_f32_sse41;
+        kernels.stats_i32 = stats_i32_sse41;
+        kernels.hist_f32 = hist_f32_sse41;
+        kernels.hist_i32 = hist_i32_sse41;
+    }
+#else
+    (void)level;
+#endif
+}
+
+static void ensure_kernels(void) {
+    if (kernels_ready) return;
+#ifdef SIMD_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        supported_level = SIMD_AVX2;
+    } else if (__builtin_cpu_supports("sse4.1")) {
+        supported_level = SIMD_SSE41;
+    }
+#endif
+    use_level(supported_level);
+    kernels_ready = 1;
+}
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+SimdLevel simd_level(void) {
+    ensure_kernels();
+    return kernels.level;
+}
+
+const char* simd_level_name(SimdLevel level) {
+    switch (level) {
+        case SIMD_AVX2:  return "AVX2";
+        case SIMD_SSE41: return "SSE4.1";
+        default:         return "scalar";
+    }
+}
+
+SimdLevel simd_set_level(SimdLevel level) {
+    ensure_kernels();
+    use_level(level < supported_level ? level : supported_level);
+    return kernels.level;
+}
+
+// Полные блоки идут в векторное ядро, последний неполный - в скалярное
+void simd_stats_f32(const float* values, size_t n, const uint64_t* selection, simd_stats* out) {
+    ensure_kernels();
+    f32_acc acc = { 0, 0.0, INFINITY, -INFINITY };
+    for (size_t b = 0; b * BLOCK < n; b++) {
+        uint64_t mask = block_mask(selection, b, n);
+        if (!mask) continue;
+        if (n - b * BLOCK >= BLOCK) {
+            kernels.stats_f32(values + b * BLOCK, mask, &acc);
+        } else {
+            stats_f32_scalar(values + b * BLOCK, mask, &acc);
+        }
+    }
+    out->count = acc.count;
+    out->sum = acc.sum;
+    out->min = acc.count ? acc.min : 0.0;
+    out->max = acc.count ? acc.max : 0.0;
+}
+
+void simd_stats_i32(const int32_t* values, size_t n, const uint64_t* selection, simd_stats* out) {
+    ensure_kernels();
+    i32_acc acc = { 0, 0, INT32_MAX, INT32_MIN };
+    for (size_t b = 0; b * BLOCK < n; b++) {
+        uint64_t mask = block_mask(selection, b, n);
+        if (!mask) continue;
+        if (n - b * BLOCK >= BLOCK) {
+            kernels.stats_i32(values + b * BLOCK, mask, &acc);
+        } else {
+            stats_i32_scalar(values + b * BLOCK, mask, &acc);
+        }
+    }
+    out->count = acc.count;
+    out->sum = (double)acc.sum;
+    out->min = acc.count ? acc.min : 0.0;
+    out->max = acc.count ? acc.max : 0.0;
+}
+
+void simd_histogram_f32(const float* values, size_t n, const uint64_t* selection,
+                        double lo, double width, uint32_t bins, uint64_t* counts) {
+    if (bins == 0 || !(width > 0)) return;
+    ensure_kernels();
+    hist_params p = { lo, width, (double)(bins - 1) };
+    for (size_t b = 0; b * BLOCK < n; b++) {
+        uint64_t mask = block_mask(selection, b, n);
+        if (!mask) continue;
+        if (n - b * BLOCK >= BLOCK) {
+            kernels.hist_f32(values + b * BLOCK, mask, &p, counts);
+        } else {
+            hist_f32_scalar(values + b * BLOCK, mask, &p, counts);
+        }
+    }
+}
+
+void simd_histogram_i32(const int32_t* values, size_t n, const uint64_t* selection,
+                        double lo, double width, uint32_t bins, uint64_t* counts) {
+    if (bins == 0 || !(width > 0)) return;
+    ensure_kernels();
+    hist_params p = { lo, width, (double)(bins - 1) };
+    for (size_t b = 0; b * BLOCK < n; b++) {
+        uint64_t mask = block_mask(selection, b, n);
+        if (!mask) continue;
+        if (n - b * BLOCK >= BLOCK) {
+            kernels.hist_i32(values + b * BLOCK, mask, &p, counts);
+        } else {
+            hist_i32_scalar(values + b * BLOCK, mask, &p, counts);
+        }
+    }
+}
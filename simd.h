@@ -0,0 +1,47 @@
+#ifndef SIMD_H
+#define SIMD_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// ============================================================================
+// Векторные ядра агрегатов по столбцам (SoA, см. soa.h): сумма, минимум,
+// максимум, число значений и гистограмма. Для каждого ядра есть AVX2, SSE4.1
+// и скалярный вариант, нужный выбирается по процессору при первом вызове.
+//
+// selection - необязательная битовая карта отбора: бит i (слово i / 64,
+// бит i % 64) - значение i участвует. NULL - участвуют все n значений.
+// ============================================================================
+
+typedef enum {
+    SIMD_SCALAR = 0,
+    SIMD_SSE41 = 1,
+    SIMD_AVX2 = 2
+} SimdLevel;
+
+typedef struct simd_stats {
+    int64_t count;
+    double sum;
+    double min; // при count == 0 min и max равны 0
+    double max;
+} simd_stats;
+
+// Уровень, который используют ядра (определяется при первом обращении)
+SimdLevel simd_level(void);
+const char* simd_level_name(SimdLevel level);
+
+// Понижает уровень (для сравнения реализаций); выше поддерживаемого не поднимает.
+// Возвращает установленный уровень.
+SimdLevel simd_set_level(SimdLevel level);
+
+void simd_stats_f32(const float* values, size_t n, const uint64_t* selection, simd_stats* out);
+void simd_stats_i32(const int32_t* values, size_t n, const uint64_t* selection, simd_stats* out);
+
+// Корзина значения v: (v - lo) / width с отбрасыванием дробной части; значения
+// за границами попадают в крайние корзины. counts[bins] прибавляются (не обнуляются).
+void simd_histogram_f32(const float* values, size_t n, const uint64_t* selection,
+                        double lo, double width, uint32_t bins, uint64_t* counts);
+void simd_histogram_i32(const int32_t* values, size_t n, const uint64_t* selection,
+                        double lo, double width, uint32_t bins, uint64_t* counts);
+
+#endif // SIMD_H
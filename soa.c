@@ -0,0 +1,183 @@
+#include "soa.h"
+#include "parallel.h"
+
+#define SOA_CHUNK 65536 // позиций на задачу при построении (кратно 64)
+
+// ============================================================================
+// Память
+// ============================================================================
+
+static void mirror_free_columns(soa_mirror* m) {
+    free(m->date);
+    free(m->type_id);
+    free(m->mileage);
+    free(m->price);
+    free(m->live);
+    m->date = NULL;
+    m->type_id = NULL;
+    m->mileage = NULL;
+    m->price = NULL;
+    m->live = NULL;
+    m->count = 0;
+    m->capacity = 0;
+}
+
+// Вместимость не меньше need позиций (с запасом вдвое); старые значения сохраняются
+static int mirror_reserve(soa_mirror* m, size_t need) {
+    if (need <= m->capacity) return 1;
+    size_t capacity = m->capacity ? m->capacity : 1024;
+    while (capacity < need) capacity *= 2;
+
+    int32_t* date = realloc(m->date, capacity * sizeof(int32_t));
+    if (date) m->date = date;
+    uint32_t* type_id = realloc(m->type_id, capacity * sizeof(uint32_t));
+    if (type_id) m->type_id = type_id;
+    int32_t* mileage = realloc(m->mileage, capacity * sizeof(int32_t));
+    if (mileage) m->mileage = mileage;
+    float* price = realloc(m->price, capacity * sizeof(float));
+    if (price) m->price = price;
+    uint64_t* live = realloc(m->live, capacity / 64 * sizeof(uint64_t));
+    if (live) m->live = live;
+    if (!date || !type_id || !mileage || !price || !live) return 0;
+
+    memset(m->live + m->capacity / 64, 0, (capacity - m->capacity) / 64 * sizeof(uint64_t));
+    m->capacity = capacity;
+    return 1;
+}
+
+static void mirror_set(soa_mirror* m, size_t slot, const technical_maintenance* r) {
+    m->date[slot] = r->date;
+    m->type_id[slot] = r->type_id;
+    m->mileage[slot] = r->mileage;
+    m->price[slot] = r->price;
+    uint64_t bit = (uint64_t)1 << (slot % 64);
+    if (record_is_deleted(r)) m->live[slot / 64] &= ~bit; else m->live[slot / 64] |= bit;
+}
+
+// ============================================================================
+// Построение
+// ============================================================================
+
+typedef struct {
+    const struct data_base* system;
+    soa_mirror* mirror;
+} BuildJob;
+
+// Куски кратны 64, поэтому слова live у задач не пересекаются
+static void build_chunk(void* ctx, size_t chunk) {
+    BuildJob* job = (BuildJob*)ctx;
+    size_t from = chunk * SOA_CHUNK;
+    size_t to = from + SOA_CHUNK < job->mirror->count ? from + SOA_CHUNK : job->mirror->count;
+    for (size_t i = from; i < to; i++) mirror_set(job->mirror, i, &job->system->records[i]);
+}
+
+static int mirror_build(struct data_base* system, soa_mirror* m) {
+    size_t n = (size_t)system->size;
+    if (!mirror_reserve(m, n ? n : 1)) {
+        printf("Ошибка: недостаточно памяти для столбцового зеркала\n");
+        return 0;
+    }
+    memset(m->live, 0, m->capacity / 64 * sizeof(uint64_t));
+    m->count = n;
+
+    BuildJob job;
+    job.system = system;
+    job.mirror = m;
+    parallel_for((n + SOA_CHUNK - 1) / SOA_CHUNK, build_chunk, &job);
+    m->ready = 1;
+    return 1;
+}
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+int soa_enable(struct data_base* system) {
+    if (system->soa) return 1;
+    system->soa = calloc(1, sizeof(soa_mirror));
+    return system->soa != NULL;
+}
+
+void soa_disable(struct data_base* system) {
+    if (!system->soa) return;
+    mirror_free_columns(system->soa);
+    free(system->soa);
+    system->soa = NULL;
+}
+
+const soa_mirror* soa_get(struct data_base* system) {
+    soa_mirror* m = system->soa;
+    if (!m) return NULL;
+    if (!m->ready && !mirror_build(system, m)) return NULL;
+    // Надгробия в конце базы отрезаются без уведомления: их биты уже сброшены
+    m->count = (size_t)system->size;
+    return m;
+}
+
+void soa_on_write(struct data_base* system, int64_t slot) {
+    soa_mirror* m = system->soa;
+    if (!m || !m->ready) return;
+    // Без памяти зеркало перестроится при следующем обращении
+    if (!mirror_reserve(m, (size_t)slot + 1)) {
+        m->ready = 0;
+        return;
+    }
+    mirror_set(m, (size_t)slot, &system->records[slot]);
+    if ((size_t)slot >= m->count) m->count = (size_t)slot + 1;
+}
+
+void soa_invalidate(struct data_base* system) {
+    if (system->soa) system->soa->ready = 0;
+}
+
+// Отбор, пересеченный с живыми записями (malloc) или сама карта live.
+// Для дат записи без даты (DATE_NONE) тоже отбрасываются.
+static const uint64_t* live_selection(const soa_mirror* m, SoaColumn column, const uint64_t* selection,
+                                      uint64_t** owned) {
+    *owned = NULL;
+    if (!selection && column != SOA_DATE) return m->live;
+    size_t words = (m->count + 63) / 64;
+    *owned = malloc((words ? words : 1) * sizeof(uint64_t));
+    if (!*owned) return NULL;
+    for (size_t w = 0; w < words; w++) (*owned)[w] = selection ? selection[w] & m->live[w] : m->live[w];
+    if (column == SOA_DATE) {
+        for (size_t i = 0; i < m->count; i++) {
+            if (m->date[i] == DATE_NONE) (*owned)[i / 64] &= ~((uint64_t)1 << (i % 64));
+        }
+    }
+    return *owned;
+}
+
+int soa_stats(struct data_base* system, SoaColumn column, const uint64_t* selection, simd_stats* out) {
+    memset(out, 0, sizeof(*out));
+    const soa_mirror* m = soa_get(system);
+    if (!m) return 0;
+    uint64_t* owned;
+    const uint64_t* sel = live_selection(m, column, selection, &owned);
+    if (!sel) return 0;
+
+    switch (column) {
+        case SOA_DATE:    simd_stats_i32(m->date, m->count, sel, out); break;
+        case SOA_MILEAGE: simd_stats_i32(m->mileage, m->count, sel, out); break;
+        default:          simd_stats_f32(m->price, m->count, sel, out); break;
+    }
+    free(owned);
+    return 1;
+}
+
+int soa_histogram(struct data_base* system, SoaColumn column, const uint64_t* selection,
+                  double lo, double width, uint32_t bins, uint64_t* counts) {
+    const soa_mirror* m = soa_get(system);
+    if (!m) return 0;
+    uint64_t* owned;
+    const uint64_t* sel = live_selection(m, column, selection, &owned);
+    if (!sel) return 0;
+
+    switch (column) {
+        case SOA_DATE:    simd_histogram_i32(m->date, m->count, sel, lo, width, bins, counts); break;
+        case SOA_MILEAGE: simd_histogram_i32(m->mileage, m->count, sel, lo, width, bins, counts); break;
+        default:          simd_histogram_f32(m->price, m->count, sel, lo, width, bins, counts); break;
+    }
+    free(owned);
+    return 1;
+}
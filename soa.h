@@ -0,0 +1,52 @@
+#ifndef SOA_H
+#define SOA_H
+
+#include "database.h"
+#include "simd.h"
+
+// ============================================================================
+// Зеркало data_base по столбцам (structure of arrays): отдельные массивы
+// дат, типов работ, пробегов и цен плюс битовая карта живых записей.
+// Агрегаты по одному полю читают плотный массив вместо шага в целую запись
+// и считаются векторными ядрами simd.h.
+// Ведется по желанию (soa_enable): add_item / modify_item / delete_item
+// обновляют позицию за O(1), после загрузки и уплотнения зеркало строится
+// заново при первом обращении.
+// ============================================================================
+
+typedef enum {
+    SOA_DATE,    // номер дня
+    SOA_MILEAGE,
+    SOA_PRICE
+} SoaColumn;
+
+typedef struct soa_mirror {
+    int32_t* date;
+    uint32_t* type_id;
+    int32_t* mileage;
+    float* price;
+    uint64_t* live;  // бит на позицию: запись не надгробие
+    size_t count;    // = system->size
+    size_t capacity; // кратна 64
+    int ready;       // 0 - перестроить при следующем обращении
+} soa_mirror;
+
+int soa_enable(struct data_base* system);
+void soa_disable(struct data_base* system);
+
+// Актуальное зеркало или NULL, если оно не включено или не хватило памяти
+const soa_mirror* soa_get(struct data_base* system);
+
+// Вызываются из database.c после изменения позиции slot / замены всех записей
+void soa_on_write(struct data_base* system, int64_t slot);
+void soa_invalidate(struct data_base* system);
+
+// Агрегаты по живым записям. selection - необязательная битовая карта отбора
+// по позициям (например, filter_bitmap), NULL - все живые записи.
+// Записи без даты в агрегаты по SOA_DATE не входят.
+// Без включенного зеркала возвращают 0.
+int soa_stats(struct data_base* system, SoaColumn column, const uint64_t* selection, simd_stats* out);
+int soa_histogram(struct data_base* system, SoaColumn column, const uint64_t* selection,
+                  double lo, double width, uint32_t bins, uint64_t* counts);
+
+#endif // SOA_H
@@ -0,0 +1,423 @@
+#include "tenant_store.h"
+#include "crc32c.h"
+#include "file_io.h"
+#include "work_dict.h"
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TENANT_MAGIC    0x53544E54 // "TNTS"
+#define TENANT_VERSION  1
+#define TENANT_NAME     56
+
+// Заголовок в начале страницы 0: 64 байта, little-endian
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t page_size;
+    uint32_t entry_count;
+    uint64_t directory_page;  // первая страница каталога (0 - каталога нет)
+    uint64_t directory_pages;
+    uint64_t file_pages;      // страниц до конца последнего экстента
+    uint32_t directory_crc;   // crc32c каталога
+    uint8_t reserved[16];
+    uint32_t checksum;        // crc32c первых 60 байт
+} tenant_header;
+
+// Запись каталога: 96 байт, little-endian
+typedef struct {
+    char username[TENANT_NAME]; // с '\0', остаток забит нулями
+    uint64_t page;              // первая страница экстента
+    uint64_t pages;
+    uint64_t record_count;
+    uint32_t dict_size;         // байт словаря перед записями
+    uint32_t crc;               // crc32c словаря и записей
+    uint64_t lsn;
+} tenant_entry;
+
+typedef char tenant_header_size_check[sizeof(tenant_header) == 64 ? 1 : -1];
+typedef char tenant_entry_size_check[sizeof(tenant_entry) == 96 ? 1 : -1];
+
+struct tenant_store {
+    file_rw* file;
+    tenant_header header; // в порядке байтов машины
+    tenant_entry* entries;
+    uint32_t count;
+};
+
+// Занятый диапазон страниц
+typedef struct {
+    uint64_t page;
+    uint64_t pages;
+} extent;
+
+// ============================================================================
+// Порядок байтов
+// ============================================================================
+
+static int host_is_little_endian(void) {
+    const uint16_t probe = 1;
+    return *(const uint8_t*)&probe == 1;
+}
+
+static uint32_t swap32(uint32_t v) {
+    return (v >> 24) | ((v >> 8) & 0xFF00u) | ((v << 8) & 0xFF0000u) | (v << 24);
+}
+
+static uint64_t swap64(uint64_t v) {
+    return ((uint64_t)swap32((uint32_t)v) << 32) | swap32((uint32_t)(v >> 32));
+}
+
+// Преобразования симметричны: годятся и для записи, и для чтения
+static void header_to_little_endian(tenant_header* h) {
+    if (host_is_little_endian()) return;
+    h->magic = swap32(h->magic);
+    h->version = swap32(h->version);
+    h->page_size = swap32(h->page_size);
+    h->entry_count = swap32(h->entry_count);
+    h->directory_page = swap64(h->directory_page);
+    h->directory_pages = swap64(h->directory_pages);
+    h->file_pages = swap64(h->file_pages);
+    h->directory_crc = swap32(h->directory_crc);
+    h->checksum = swap32(h->checksum);
+}
+
+static void entries_to_little_endian(tenant_entry* e, uint32_t count) {
+    if (host_is_little_endian()) return;
+    for (uint32_t i = 0; i < count; i++) {
+        e[i].page = swap64(e[i].page);
+        e[i].pages = swap64(e[i].pages);
+        e[i].record_count = swap64(e[i].record_count);
+        e[i].dict_size = swap32(e[i].dict_size);
+        e[i].crc = swap32(e[i].crc);
+        e[i].lsn = swap64(e[i].lsn);
+    }
+}
+
+// Все поля записи - 4 байта
+static void records_swap(technical_maintenance* records, size_t count) {
+    if (host_is_little_endian()) return;
+    uint32_t* words = (uint32_t*)records;
+    for (size_t i = 0; i < count * sizeof(technical_maintenance) / 4; i++) words[i] = swap32(words[i]);
+}
+
+// ============================================================================
+// Заголовок и каталог
+// ============================================================================
+
+static uint32_t header_checksum(const tenant_header* little_endian) {
+    return crc32c(0, little_endian, offsetof(tenant_header, checksum));
+}
+
+static int write_header(file_rw* file, const tenant_header* header) {
+    tenant_header h = *header;
+    h.checksum = 0;
+    header_to_little_endian(&h);
+    uint32_t checksum = header_checksum(&h);
+    h.checksum = host_is_little_endian() ? checksum : swap32(checksum);
+    return file_pwrite(file, &h, sizeof(h), 0);
+}
+
+static uint64_t pages_for(uint64_t bytes) {
+    return (bytes + TENANT_PAGE_SIZE - 1) / TENANT_PAGE_SIZE;
+}
+
+static int find_entry(const tenant_store* ts, const char* username) {
+    for (uint32_t i = 0; i < ts->count; i++) {
+        if (strcmp(ts->entries[i].username, username) == 0) return (int)i;
+    }
+    return -1;
+}
+
+static int compare_extents(const void* a, const void* b) {
+    uint64_t x = ((const extent*)a)->page, y = ((const extent*)b)->page;
+    return (x > y) - (x < y);
+}
+
+// Первый промежуток из pages свободных страниц. Заняты заголовок, действующие
+// каталог и экстенты (их место освободится только после смены заголовка) и extra.
+static uint64_t allocate(const tenant_store* ts, uint64_t pages, const extent* extra, size_t extra_count) {
+    size_t n = 0;
+    extent* used = malloc((ts->count + extra_count + 2) * sizeof(extent));
+    if (!used) return ts->header.file_pages;
+    used[n].page = 0;
+    used[n++].pages = 1;
+    if (ts->header.directory_pages) {
+        used[n].page = ts->header.directory_page;
+        used[n++].pages = ts->header.directory_pages;
+    }
+    for (uint32_t i = 0; i < ts->count; i++) {
+        used[n].page = ts->entries[i].page;
+        used[n++].pages = ts->entries[i].pages;
+    }
+    for (size_t i = 0; i < extra_count; i++) used[n++] = extra[i];
+    qsort(used, n, sizeof(extent), compare_extents);
+
+    uint64_t next = 0; // первая страница после уже просмотренных экстентов
+    for (size_t i = 0; i < n; i++) {
+        if (used[i].page >= next + pages) break;
+        if (used[i].page + used[i].pages > next) next = used[i].page + used[i].pages;
+    }
+    free(used);
+    return next;
+}
+
+// Каталог entries пишется в свободное место, затем заголовок переключается на него.
+// Экстент и каталог сбрасываются на диск до записи заголовка: иначе заголовок мог бы
+// попасть на диск раньше каталога, и проверка directory_crc отвергла бы весь файл
+static int commit_directory(tenant_store* ts, tenant_entry* entries, uint32_t count,
+                            const extent* fresh, tenant_header* out_header) {
+    tenant_header header = ts->header;
+    header.entry_count = count;
+    header.directory_page = 0;
+    header.directory_pages = 0;
+    header.directory_crc = 0;
+    if (count > 0) {
+        size_t size = (size_t)count * sizeof(tenant_entry);
+        tenant_entry* disk = malloc(size);
+        if (!disk) {
+            printf("Ошибка: недостаточно памяти для каталога пользователей\n");
+            return 0;
+        }
+        memcpy(disk, entries, size);
+        entries_to_little_endian(disk, count);
+        header.directory_pages = pages_for(size);
+        header.directory_page = allocate(ts, header.directory_pages, fresh, 1);
+        header.directory_crc = crc32c(0, disk, size);
+        int ok = file_pwrite(ts->file, disk, size, header.directory_page * TENANT_PAGE_SIZE);
+        free(disk);
+        if (!ok) return 0;
+    }
+    uint64_t end = fresh->page + fresh->pages;
+    if (end > header.file_pages) header.file_pages = end;
+    end = header.directory_page + header.directory_pages;
+    if (end > header.file_pages) header.file_pages = end;
+    if (!file_rw_sync(ts->file) || !write_header(ts->file, &header) || !file_rw_sync(ts->file)) return 0;
+    *out_header = header;
+    return 1;
+}
+
+static int create_file(const char* filename) {
+    FILE* f = fopen(filename, "wb");
+    if (!f) return 0;
+    fclose(f);
+    file_rw* file = file_open_rw(filename);
+    if (!file) return 0;
+    tenant_header header;
+    memset(&header, 0, sizeof(header));
+    header.magic = TENANT_MAGIC;
+    header.version = TENANT_VERSION;
+    header.page_size = TENANT_PAGE_SIZE;
+    header.file_pages = 1;
+    int ok = write_header(file, &header) && file_rw_sync(file);
+    file_close_rw(file);
+    return ok;
+}
+
+// ============================================================================
+// Экстенты
+// ============================================================================
+
+// Содержимое экстента: словарь, затем записи с type_id в общем словаре (malloc).
+// 0 - ошибка чтения или контрольная сумма не совпала.
+static int read_extent(tenant_store* ts, const tenant_entry* e, technical_maintenance** out_records) {
+    size_t records_size = (size_t)e->record_count * sizeof(technical_maintenance);
+    size_t size = e->dict_size + records_size;
+    unsigned char* data = malloc(size ? size : 1);
+    if (!data) {
+        printf("Ошибка: недостаточно памяти для данных пользователя %s\n", e->username);
+        return 0;
+    }
+    if (!file_pread(ts->file, data, size, e->page * TENANT_PAGE_SIZE) || crc32c(0, data, size) != e->crc) {
+        printf("Ошибка: данные пользователя %s в общем файле повреждены\n", e->username);
+        free(data);
+        return 0;
+    }
+
+    uint32_t* remap = NULL;
+    uint32_t remap_count = 0;
+    technical_maintenance* records = malloc((e->record_count > 10 ? (size_t)e->record_count : 10) *
+                                            sizeof(technical_maintenance));
+    int ok = records && work_dict_import(work_dict_shared(), data, e->dict_size, &remap, &remap_count);
+    if (ok) {
+        memcpy(records, data + e->dict_size, records_size);
+        records_swap(records, (size_t)e->record_count);
+        records_remap_types(records, (size_t)e->record_count, remap, remap_count);
+        *out_records = records;
+    } else {
+        printf("Ошибка: не удалось прочитать данные пользователя %s\n", e->username);
+        free(records);
+    }
+    free(remap);
+    free(data);
+    return ok;
+}
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+tenant_store* tenant_store_open(const char* filename, int create) {
+    if (!filename) filename = TENANT_STORE_FILE;
+    file_rw* file = file_open_rw(filename);
+    if (!file && create && create_file(filename)) file = file_open_rw(filename);
+    if (!file) return NULL;
+
+    tenant_store* ts = calloc(1, sizeof(tenant_store));
+    tenant_header h;
+    int ok = ts && file_pread(file, &h, sizeof(h), 0);
+    if (ok) {
+        uint32_t checksum = header_checksum(&h);
+        header_to_little_endian(&h);
+        ok = h.magic == TENANT_MAGIC && h.version == TENANT_VERSION && h.page_size == TENANT_PAGE_SIZE &&
+             h.checksum == checksum &&
+             (uint64_t)h.entry_count * sizeof(tenant_entry) <= h.directory_pages * TENANT_PAGE_SIZE;
+    }
+    if (ok && h.entry_count > 0) {
+        size_t size = (size_t)h.entry_count * sizeof(tenant_entry);
+        ts->entries = malloc(size);
+        ok = ts->entries && file_pread(file, ts->entries, size, h.directory_page * TENANT_PAGE_SIZE) &&
+             crc32c(0, ts->entries, size) == h.directory_crc;
+        if (ok) entries_to_little_endian(ts->entries, h.entry_count);
+        for (uint32_t i = 0; ok && i < h.entry_count; i++) ts->entries[i].username[TENANT_NAME - 1] = '\0';
+    }
+    if (!ok) {
+        printf("Ошибка: общий файл данных %s поврежден\n", filename);
+        if (ts) free(ts->entries);
+        free(ts);
+        file_close_rw(file);
+        return NULL;
+    }
+    ts->file = file;
+    ts->header = h;
+    ts->count = h.entry_count;
+    return ts;
+}
+
+void tenant_store_close(tenant_store* ts) {
+    if (!ts) return;
+    file_close_rw(ts->file);
+    free(ts->entries);
+    free(ts);
+}
+
+int tenant_store_has(const tenant_store* ts, const char* username) {
+    return ts && username && find_entry(ts, username) >= 0;
+}
+
+int tenant_store_load(tenant_store* ts, const char* username, struct data_base* system) {
+    int i = find_entry(ts, username);
+    if (i < 0) return 0;
+    const tenant_entry* e = &ts->entries[i];
+    technical_maintenance* records = NULL;
+    if (!read_extent(ts, e, &records)) return 0;
+    int64_t count = (int64_t)e->record_count;
+    db_adopt_records(system, records, count, count > 10 ? count : 10);
+    system->lsn = e->lsn;
+    printf("Данные пользователя %s загружены из %s: %lld записей\n", username, TENANT_STORE_FILE, (long long)count);
+    return 1;
+}
+
+int tenant_store_save(tenant_store* ts, const char* username, struct data_base* system) {
+    if (!username || !username[0] || strlen(username) >= TENANT_NAME) {
+        printf("Ошибка: логин не помещается в каталог общего файла\n");
+        return 0;
+    }
+    db_verify_pending(system);
+    db_compact(system);
+
+    size_t dict_size = 0;
+    unsigned char* dict = work_dict_serialize(work_dict_shared(), &dict_size);
+    size_t records_size = (size_t)system->size * sizeof(technical_maintenance);
+    unsigned char* data = dict && dict_size <= UINT32_MAX ? malloc(dict_size + records_size) : NULL;
+    if (!data) {
+        free(dict);
+        printf("Ошибка: недостаточно памяти для сохранения\n");
+        return 0;
+    }
+    memcpy(data, dict, dict_size);
+    memcpy(data + dict_size, system->records, records_size);
+    records_swap((technical_maintenance*)(data + dict_size), (size_t)system->size);
+    free(dict);
+
+    tenant_entry entry;
+    memset(&entry, 0, sizeof(entry));
+    strncpy(entry.username, username, TENANT_NAME - 1);
+    entry.pages = pages_for(dict_size + records_size);
+    if (entry.pages == 0) entry.pages = 1;
+    entry.page = allocate(ts, entry.pages, NULL, 0);
+    entry.record_count = (uint64_t)system->size;
+    entry.dict_size = (uint32_t)dict_size;
+    entry.crc = crc32c(0, data, dict_size + records_size);
+    entry.lsn = system->lsn;
+    int ok = file_pwrite(ts->file, data, dict_size + records_size, entry.page * TENANT_PAGE_SIZE);
+    free(data);
+
+    // Новый каталог: та же таблица с замененной или добавленной записью
+    int i = find_entry(ts, username);
+    uint32_t count = i < 0 ? ts->count + 1 : ts->count;
+    tenant_entry* entries = ok ? malloc(count * sizeof(tenant_entry)) : NULL;
+    if (entries) {
+        if (ts->count) memcpy(entries, ts->entries, ts->count * sizeof(tenant_entry));
+        entries[i < 0 ? ts->count : (uint32_t)i] = entry;
+        extent fresh = { entry.page, entry.pages };
+        tenant_header header;
+        ok = commit_directory(ts, entries, count, &fresh, &header);
+        if (ok) {
+            free(ts->entries);
+            ts->entries = entries;
+            ts->count = count;
+            ts->header = header;
+        } else {
+            free(entries);
+        }
+    } else {
+        ok = 0;
+    }
+    if (!ok) {
+        printf("Ошибка записи в общий файл данных\n");
+        return 0;
+    }
+    printf("Данные пользователя %s сохранены в %s: %lld записей\n", username, TENANT_STORE_FILE,
+           (long long)system->size);
+    return 1;
+}
+
+typedef struct {
+    uint64_t page;
+    uint32_t index;
+} scan_order;
+
+static int compare_order(const void* a, const void* b) {
+    uint64_t x = ((const scan_order*)a)->page, y = ((const scan_order*)b)->page;
+    return (x > y) - (x < y);
+}
+
+int tenant_store_scan(tenant_store* ts, tenant_visit visit, void* ctx) {
+    scan_order* order = malloc((ts->count ? ts->count : 1) * sizeof(scan_order));
+    if (!order) {
+        printf("Ошибка: недостаточно памяти для обхода общего файла\n");
+        return 0;
+    }
+    for (uint32_t i = 0; i < ts->count; i++) {
+        order[i].page = ts->entries[i].page;
+        order[i].index = i;
+    }
+    qsort(order, ts->count, sizeof(scan_order), compare_order);
+
+    int ok = 1;
+    for (uint32_t i = 0; ok && i < ts->count; i++) {
+        const tenant_entry* e = &ts->entries[order[i].index];
+        technical_maintenance* records = NULL;
+        ok = read_extent(ts, e, &records);
+        if (ok && !visit(e->username, records, (int64_t)e->record_count, ctx)) {
+            free(records);
+            break;
+        }
+        free(records);
+    }
+    free(order);
+    return ok;
+}
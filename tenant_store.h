@@ -0,0 +1,43 @@
+#ifndef TENANT_STORE_H
+#define TENANT_STORE_H
+
+#include "database.h"
+
+// ============================================================================
+// Общий файл данных всех пользователей вместо data_<логин>.dat/.asf на каждого.
+// Файл делится на страницы TENANT_PAGE_SIZE: страница 0 - заголовок, данные
+// пользователя - один экстент из целых страниц (словарь типов работ и записи
+// в раскладке файла v2), каталог "логин -> экстент" - тоже экстент.
+// Загрузка пользователя - одно позиционное чтение его экстента. Сохранение
+// пишет новую версию в свободное место (первый подходящий промежуток между
+// экстентами или конец файла), затем новый каталог, и последним - заголовок,
+// который на него указывает; до этого момента действует прежняя версия, а
+// место прежнего экстента освобождается для следующих сохранений.
+// Обход всех пользователей читает экстенты в порядке смещений, то есть подряд.
+// ============================================================================
+
+#define TENANT_STORE_FILE "tenants.dat"
+#define TENANT_PAGE_SIZE 4096
+
+typedef struct tenant_store tenant_store;
+
+// Открывает файл, создавая пустой при create = 1. NULL - нет файла, он поврежден или нет памяти.
+tenant_store* tenant_store_open(const char* filename, int create);
+void tenant_store_close(tenant_store* ts);
+
+// 1, если в файле есть данные пользователя
+int tenant_store_has(const tenant_store* ts, const char* username);
+
+// Заменяет записи базы данными пользователя. 0 - их нет или ошибка чтения.
+int tenant_store_load(tenant_store* ts, const char* username, struct data_base* system);
+
+// Сохраняет базу (с уплотнением) как данные пользователя
+int tenant_store_save(tenant_store* ts, const char* username, struct data_base* system);
+
+// Обход всех пользователей в порядке расположения в файле. type_id записей -
+// уже в общем словаре. visit возвращает 0, чтобы остановить обход.
+typedef int (*tenant_visit)(const char* username, const technical_maintenance* records,
+                            int64_t count, void* ctx);
+int tenant_store_scan(tenant_store* ts, tenant_visit visit, void* ctx);
+
+#endif // TENANT_STORE_H
@@ -0,0 +1,189 @@
+#include "data_source.h"
+#include "wal.h"
+#include "work_dict.h"
+#include "database_new.h"
+
+// ============================================================================
+// Контрольная точка журнала и повторный вход, когда сессия загружена не из
+// data_<логин>.dat, а из ASF или из общего файла пользователей. Рядом лежит
+// устаревший .dat: после перезапуска должны вернуться все изменения - и
+// свернутые в базу на контрольной точке, и записанные в журнал после нее.
+// ============================================================================
+
+#define TEST_USER "ckpt_test"
+#define TEST_TENANTS "test_tenants.dat"
+#define TEST_RECORDS 200
+
+static int failures = 0;
+
+static void remove_files(void) {
+    char name[100];
+    snprintf(name, sizeof(name), "data_%s.dat", TEST_USER);
+    remove(name);
+    get_user_wal_filename(TEST_USER, name);
+    remove(name);
+    snprintf(name, sizeof(name), "data_%s.asf", TEST_USER);
+    remove(name);
+    remove(TEST_TENANTS);
+}
+
+static technical_maintenance make_record(int i) {
+    static const char* types[] = {"замена масла", "осмотр ТС", "замена колодок"};
+    technical_maintenance r;
+    memset(&r, 0, sizeof(r));
+    char date[16];
+    snprintf(date, sizeof(date), "%02d.%02d.2024", i % 28 + 1, i % 12 + 1);
+    date_to_days(date, &r.date);
+    r.type_id = work_dict_intern(work_dict_shared(), types[i % 3]);
+    r.mileage = 1000 + i * 10;
+    r.price = (float)(100 + i % 50);
+    return r;
+}
+
+// Живые записи по порядку (без надгробий)
+static int64_t live_records(const struct data_base* db, technical_maintenance* out) {
+    int64_t n = 0;
+    for (int64_t i = 0; i < db->size; i++) {
+        if (!record_is_deleted(&db->records[i])) out[n++] = db->records[i];
+    }
+    return n;
+}
+
+static void expect(int condition, const char* what, const char* base) {
+    if (!condition) {
+        printf("❌ %s: %s\n", base, what);
+        failures++;
+    }
+}
+
+// Сессия: загрузка из хранилища, проигрывание журнала, изменения до и после
+// контрольной точки, выход без сохранения (как при сбое)
+static int64_t run_session(tenant_store* tenants, DataSourceKind expected_kind,
+                           technical_maintenance* expected, const char* label) {
+    data_source base;
+    data_source_select(&base, TEST_USER, tenants);
+    expect(base.kind == expected_kind, "выбрано не то хранилище", label);
+
+    struct data_base db;
+    init_system(&db, 10);
+    data_source_load(&base, &db);
+
+    char wal_filename[100];
+    get_user_wal_filename(TEST_USER, wal_filename);
+    wal_replay(&db, wal_filename);
+    wal log;
+    memset(&log, 0, sizeof(log));
+    expect(wal_open(&log, wal_filename, &db), "журнал не открылся", label);
+    db.wal = &log;
+
+    // До контрольной точки: удаления оставляют надгробия в середине массива
+    for (int64_t i = 3; i < db.size; i += 7) delete_item(&db, i);
+    for (int64_t i = 0; i < db.size; i += 5) {
+        if (record_is_deleted(&db.records[i])) continue;
+        technical_maintenance r = db.records[i];
+        r.mileage += 7;
+        modify_item(&db, i, r);
+    }
+    add_item(&db, make_record(1000));
+    expect(wal_checkpoint(&log, &db, &base), "контрольная точка не выполнена", label);
+
+    // После нее журнал ссылается на позиции записей в уплотненной базе
+    for (int64_t i = 1; i < db.size; i += 11) delete_item(&db, i);
+    for (int64_t i = 2; i < db.size; i += 9) {
+        if (record_is_deleted(&db.records[i])) continue;
+        technical_maintenance r = db.records[i];
+        r.price += 1.0f;
+        modify_item(&db, i, r);
+    }
+    add_item(&db, make_record(1001));
+
+    // Уплотнение в простое сдвигает позиции: журнал после него ссылается на новые
+    for (int64_t i = 0; i < db.size; i += 3) delete_item(&db, i);
+    expect(db_compact_idle(&db), "уплотнение в простое не выполнено", label);
+    for (int64_t i = 0; i < db.size; i += 4) {
+        technical_maintenance r = db.records[i];
+        r.mileage += 3;
+        modify_item(&db, i, r);
+    }
+    delete_item(&db, 1);
+    wal_commit(&log);
+
+    int64_t count = live_records(&db, expected);
+    db.wal = NULL;
+    wal_close(&log);
+    free_system(&db);
+    return count;
+}
+
+// Повторный вход: то же хранилище, журнал поверх него
+static void check_restart(tenant_store* tenants, DataSourceKind expected_kind,
+                          const technical_maintenance* expected, int64_t count, const char* label) {
+    data_source base;
+    data_source_select(&base, TEST_USER, tenants);
+    expect(base.kind == expected_kind, "после перезапуска выбрано не то хранилище", label);
+
+    struct data_base db;
+    init_system(&db, 10);
+    data_source_load(&base, &db);
+    char wal_filename[100];
+    get_user_wal_filename(TEST_USER, wal_filename);
+    wal_replay(&db, wal_filename);
+
+    technical_maintenance* actual = malloc((size_t)(db.size + 1) * sizeof(technical_maintenance));
+    int64_t n = actual ? live_records(&db, actual) : -1;
+    expect(n == count, "число записей после перезапуска не совпадает", label);
+    int same = n == count;
+    for (int64_t i = 0; same && i < n; i++) {
+        same = actual[i].id == expected[i].id && actual[i].date == expected[i].date &&
+               actual[i].type_id == expected[i].type_id && actual[i].mileage == expected[i].mileage &&
+               actual[i].price == expected[i].price;
+    }
+    expect(same, "записи после перезапуска не совпадают", label);
+    printf("%s %s: записей %lld\n", same ? "✅" : "❌", label, (long long)n);
+    free(actual);
+    free_system(&db);
+}
+
+// Исходные данные: хранилище-база и устаревший .dat рядом с ним
+static void seed(tenant_store* tenants) {
+    struct data_base db;
+    init_system(&db, 10);
+    for (int i = 0; i < TEST_RECORDS; i++) add_item(&db, make_record(i));
+
+    char name[100];
+    snprintf(name, sizeof(name), "data_%s.asf", TEST_USER);
+    if (tenants) {
+        tenant_store_save(tenants, TEST_USER, &db);
+    } else {
+        save_to_asf_compressed(&db, name, TEST_USER);
+    }
+    delete_item(&db, 0);
+    snprintf(name, sizeof(name), "data_%s.dat", TEST_USER);
+    save_to_file(&db, name);
+    free_system(&db);
+}
+
+int main(void) {
+    technical_maintenance* expected = malloc((TEST_RECORDS + 16) * sizeof(technical_maintenance));
+    if (!expected) return 1;
+
+    remove_files();
+    seed(NULL);
+    int64_t count = run_session(NULL, DATA_SOURCE_ASF, expected, "ASF");
+    check_restart(NULL, DATA_SOURCE_ASF, expected, count, "ASF");
+
+    remove_files();
+    tenant_store* tenants = tenant_store_open(TEST_TENANTS, 1);
+    expect(tenants != NULL, "общий файл не создан", "tenant");
+    seed(tenants);
+    count = run_session(tenants, DATA_SOURCE_TENANT, expected, "tenant");
+    tenant_store_close(tenants);
+    tenants = tenant_store_open(TEST_TENANTS, 0);
+    check_restart(tenants, DATA_SOURCE_TENANT, expected, count, "tenant");
+    tenant_store_close(tenants);
+
+    remove_files();
+    free(expected);
+    if (failures) printf("Ошибок: %d\n", failures);
+    return failures ? 1 : 0;
+}
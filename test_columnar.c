@@ -0,0 +1,120 @@
+#include "columnar.h"
+#include "wal.h"
+
+// ============================================================================
+// Поколоночный файл: записи и LSN контрольной точки переживают сохранение и
+// загрузку, журнал поверх файла не проигрывается повторно (сбой между
+// сохранением и очисткой журнала), агрегаты по одной колонке совпадают с
+// обычным проходом по записям базы.
+// ============================================================================
+
+#define TEST_FILE "test_columnar.dat"
+#define TEST_WAL "test_columnar.wal"
+
+static int failures = 0;
+static uint32_t seed = 777;
+
+static uint32_t next_random(void) {
+    seed = seed * 1103515245u + 12345u;
+    return seed >> 8;
+}
+
+static void expect(int condition, const char* what) {
+    printf("%s %s\n", condition ? "✅" : "❌", what);
+    if (!condition) failures++;
+}
+
+static void fill(struct data_base* db, int count) {
+    for (int i = 0; i < count; i++) {
+        technical_maintenance r;
+        memset(&r, 0, sizeof(r));
+        r.date = (int32_t)(next_random() % 20000);
+        r.mileage = (int32_t)(next_random() % 300000);
+        r.price = (float)(next_random() % 100000) / 100.0f;
+        add_item(db, r);
+    }
+}
+
+static int same_records(const struct data_base* a, const struct data_base* b) {
+    if (a->size != b->size) return 0;
+    for (int64_t i = 0; i < a->size; i++) {
+        const technical_maintenance* x = &a->records[i];
+        const technical_maintenance* y = &b->records[i];
+        if (x->id != y->id || x->date != y->date || x->type_id != y->type_id ||
+            x->mileage != y->mileage || x->price != y->price) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// Агрегаты обычным проходом по живым записям - в том же порядке, что и в файле
+static void scalar_stats(const struct data_base* db, column_stats* price, column_stats* mileage) {
+    memset(price, 0, sizeof(*price));
+    memset(mileage, 0, sizeof(*mileage));
+    int64_t mileage_sum = 0;
+    for (int64_t i = 0; i < db->size; i++) {
+        const technical_maintenance* r = &db->records[i];
+        if (record_is_deleted(r)) continue;
+        if (price->count == 0 || r->price < price->min) price->min = r->price;
+        if (price->count == 0 || r->price > price->max) price->max = r->price;
+        if (mileage->count == 0 || r->mileage < mileage->min) mileage->min = r->mileage;
+        if (mileage->count == 0 || r->mileage > mileage->max) mileage->max = r->mileage;
+        price->sum += r->price;
+        mileage_sum += r->mileage;
+        price->count++;
+        mileage->count++;
+    }
+    mileage->sum = (double)mileage_sum;
+}
+
+static int same_stats(const column_stats* a, const column_stats* b) {
+    return a->count == b->count && a->sum == b->sum && a->min == b->min && a->max == b->max;
+}
+
+int main(void) {
+    remove(TEST_FILE);
+    remove(TEST_WAL);
+
+    struct data_base db;
+    init_system(&db, 10);
+    fill(&db, 1000);
+    wal log;
+    memset(&log, 0, sizeof(log));
+    expect(wal_open(&log, TEST_WAL, &db), "журнал открыт");
+    db.wal = &log;
+
+    // Изменения под журналом, затем сохранение без очистки журнала (как при сбое)
+    for (int64_t i = 0; i < db.size; i += 9) delete_item(&db, i);
+    fill(&db, 37);
+    wal_commit(&log);
+    column_stats expected_price, expected_mileage;
+    scalar_stats(&db, &expected_price, &expected_mileage);
+    expect(save_to_columnar(&db, TEST_FILE), "файл сохранен");
+    expect(db.lsn > 0, "LSN контрольной точки ненулевой");
+    db.wal = NULL;
+    wal_close(&log);
+
+    struct data_base loaded;
+    init_system(&loaded, 10);
+    expect(load_from_columnar(&loaded, TEST_FILE), "файл загружен");
+    expect(loaded.lsn == db.lsn, "LSN восстановлен из заголовка");
+    expect(same_records(&db, &loaded), "записи совпадают");
+
+    // Журнал целиком уже вошел в файл: повторный вход не должен дублировать записи
+    wal_replay(&loaded, TEST_WAL);
+    expect(same_records(&db, &loaded), "журнал не проигран повторно");
+
+    column_stats price, mileage;
+    expect(columnar_price_stats(TEST_FILE, &price) && same_stats(&price, &expected_price),
+           "сводка по цене совпадает с проходом по записям");
+    expect(columnar_mileage_stats(TEST_FILE, &mileage) && same_stats(&mileage, &expected_mileage),
+           "сводка по пробегу совпадает с проходом по записям");
+
+    free_system(&loaded);
+    free_system(&db);
+    remove(TEST_FILE);
+    remove(TEST_WAL);
+    if (failures) printf("Ошибок: %d\n", failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,137 @@
+#include "ext_sort.h"
+
+// ============================================================================
+// Внешняя сортировка файла: при наименьшем бюджете памяти вход режется на
+// много прогонов, и слияние идет в несколько проходов. Результат сверяется
+// с обычной устойчивой сортировкой записей в памяти (qsort по ключам и
+// позиции), разреженный индекс .fence - с положением первой записи не
+// раньше заданного значения. Маленький файл сортируется на месте одним прогоном.
+// ============================================================================
+
+#define TEST_INPUT "test_ext_sort.dat"
+#define TEST_OUTPUT "test_ext_sort.out"
+#define TEST_RECORDS 600000
+
+static int failures = 0;
+static uint32_t seed = 2024;
+
+static uint32_t next_random(void) {
+    seed = seed * 1103515245u + 12345u;
+    return seed >> 8;
+}
+
+static void report(int ok, const char* label) {
+    printf("%s %s\n", ok ? "✅" : "❌", label);
+    if (!ok) failures++;
+}
+
+// Много равных ключей, чтобы была видна устойчивость
+static void fill(struct data_base* db, int count) {
+    for (int i = 0; i < count; i++) {
+        technical_maintenance r;
+        memset(&r, 0, sizeof(r));
+        r.date = next_random() % 50 == 0 ? DATE_NONE : (int32_t)(next_random() % 3000);
+        r.mileage = (int32_t)(next_random() % 1000);
+        r.price = (float)(next_random() % 200);
+        add_item(db, r);
+    }
+}
+
+// Дата по возрастанию (без даты - раньше всех), цена по убыванию, затем исходная позиция
+static const sort_key keys[] = {{SORT_DATE, 0}, {SORT_PRICE, 1}};
+
+static const technical_maintenance* compare_base;
+
+static int compare_slots(const void* a, const void* b) {
+    int64_t i = *(const int64_t*)a, j = *(const int64_t*)b;
+    const technical_maintenance* x = &compare_base[i];
+    const technical_maintenance* y = &compare_base[j];
+    if (x->date != y->date) return x->date < y->date ? -1 : 1;
+    if (x->price != y->price) return x->price > y->price ? -1 : 1;
+    return i < j ? -1 : (i > j ? 1 : 0);
+}
+
+// Сортирует файл input в output и сверяет результат с qsort по живым записям db
+static void check_sort(const struct data_base* db, const char* input, const char* output,
+                       size_t min_passes, const char* label) {
+    int64_t* slots = malloc((size_t)(db->size + 1) * sizeof(int64_t));
+    if (!slots) {
+        report(0, label);
+        return;
+    }
+    int64_t live = 0;
+    for (int64_t i = 0; i < db->size; i++) {
+        if (!record_is_deleted(&db->records[i])) slots[live++] = i;
+    }
+    compare_base = db->records;
+    qsort(slots, (size_t)live, sizeof(int64_t), compare_slots);
+
+    ext_sort_stats stats;
+    memset(&stats, 0, sizeof(stats));
+    int ok = external_sort(input, output, keys, 2, EXT_SORT_MIN_BUDGET, EXT_SORT_FENCE, &stats);
+
+    struct data_base sorted;
+    init_system(&sorted, 10);
+    if (ok) load_from_file(&sorted, output);
+    ok = ok && sorted.size == live && stats.records == (uint64_t)live && stats.passes >= min_passes;
+    int64_t mismatched = 0;
+    for (int64_t i = 0; ok && i < live; i++) {
+        const technical_maintenance* expected = &db->records[slots[i]];
+        const technical_maintenance* got = &sorted.records[i];
+        if (got->id != expected->id || got->date != expected->date || got->price != expected->price ||
+            got->mileage != expected->mileage) {
+            mismatched++;
+        }
+    }
+    ok = ok && mismatched == 0;
+
+    // Для нескольких значений даты: до позиции из .fence - только более ранние записи,
+    // первая подходящая запись - в том же блоке, что и позиция
+    static const int32_t probes[] = {0, 1, 1500, 2999, 5000};
+    for (size_t p = 0; ok && p < sizeof(probes) / sizeof(probes[0]); p++) {
+        int64_t at = fence_lookup(output, (double)probes[p]);
+        int64_t first = 0;
+        while (first < sorted.size && sorted.records[first].date < probes[p]) first++;
+        ok = at >= 0 && at % FILE_BLOCK_RECORDS == 0 && at <= first && first - at <= FILE_BLOCK_RECORDS;
+    }
+
+    char line[160];
+    snprintf(line, sizeof(line), "%s: записей %lld, прогонов %lu, проходов слияния %lu, расхождений %lld", label,
+             (long long)sorted.size, (unsigned long)stats.runs, (unsigned long)stats.passes, (long long)mismatched);
+    report(ok, line);
+    free_system(&sorted);
+    free(slots);
+}
+
+static void remove_fence(const char* output) {
+    char name[300];
+    snprintf(name, sizeof(name), "%s.fence", output);
+    remove(name);
+}
+
+int main(void) {
+    // Прогонов больше, чем путей слияния в бюджете: несколько проходов
+    struct data_base db;
+    init_system(&db, 10);
+    fill(&db, TEST_RECORDS);
+    for (int64_t i = 0; i < db.size; i += 11) delete_item(&db, i);
+    remove(TEST_INPUT);
+    save_to_file(&db, TEST_INPUT);
+    check_sort(&db, TEST_INPUT, TEST_OUTPUT, 2, "многопроходное слияние");
+    remove(TEST_OUTPUT);
+    remove_fence(TEST_OUTPUT);
+    free_system(&db);
+
+    // Один прогон, результат на месте входа
+    init_system(&db, 10);
+    fill(&db, 1000);
+    remove(TEST_INPUT);
+    save_to_file(&db, TEST_INPUT);
+    check_sort(&db, TEST_INPUT, TEST_INPUT, 0, "один прогон на месте");
+    remove(TEST_INPUT);
+    remove_fence(TEST_INPUT);
+    free_system(&db);
+
+    if (failures) printf("Ошибок: %d\n", failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,153 @@
+#include "range_query.h"
+#include "segment.h"
+
+// ============================================================================
+// Выборка по диапазонам прямо из файла: одиночный файл v2 со сводками блоков,
+// сегментированная база и сжатый файл без сводок. Результат каждой выборки
+// сверяется с обычным проходом по всем записям в памяти, а отсечение блоков
+// по сводкам - с тем, что узкий диапазон дат не читает весь файл.
+// ============================================================================
+
+#define TEST_FILE "test_range_query.dat"
+#define TEST_PACKED "test_range_query.pak"
+
+static int failures = 0;
+static uint32_t seed = 4242;
+
+static uint32_t next_random(void) {
+    seed = seed * 1103515245u + 12345u;
+    return seed >> 8;
+}
+
+// Даты и пробег растут вместе с номером записи (как в журнале обслуживания),
+// поэтому сводки блоков по ним узкие; цена случайна
+static void fill(struct data_base* db, int count) {
+    for (int i = 0; i < count; i++) {
+        technical_maintenance r;
+        memset(&r, 0, sizeof(r));
+        r.date = next_random() % 20 == 0 ? DATE_NONE : (int32_t)(i / 50 + next_random() % 3);
+        r.mileage = i * 3 + (int32_t)(next_random() % 100);
+        r.price = (float)(next_random() % 50000) / 10.0f;
+        add_item(db, r);
+    }
+}
+
+// Проверка записи без range_query_match: даты ограничены - записи без даты не подходят
+static int scalar_match(const range_query* q, const technical_maintenance* r) {
+    int dates = q->date_from != INT32_MIN || q->date_to != INT32_MAX;
+    if (dates && (r->date == DATE_NONE || r->date < q->date_from || r->date > q->date_to)) return 0;
+    return r->mileage >= q->mileage_from && r->mileage <= q->mileage_to &&
+           r->price >= q->price_from && r->price <= q->price_to;
+}
+
+// Выборка из файла должна дать те же записи и в том же порядке, что и проход по базе
+static void check_query(const struct data_base* db, const char* filename, const range_query* q,
+                        int expect_pruning, const char* label) {
+    struct data_base out;
+    init_system(&out, 10);
+    range_query_stats stats;
+    int ok = range_query_file(filename, q, &out, &stats);
+
+    int64_t expected = 0, mismatched = 0;
+    for (int64_t i = 0; ok && i < db->size; i++) {
+        const technical_maintenance* r = &db->records[i];
+        if (record_is_deleted(r) || !scalar_match(q, r)) continue;
+        if (expected < out.size) {
+            const technical_maintenance* got = &out.records[expected];
+            if (got->id != r->id || got->date != r->date || got->mileage != r->mileage || got->price != r->price) {
+                mismatched++;
+            }
+        }
+        expected++;
+    }
+    ok = ok && out.size == expected && mismatched == 0 && stats.records_matched == (uint64_t)expected &&
+         stats.blocks_read <= stats.blocks_total;
+    if (ok && expect_pruning) ok = stats.blocks_read < stats.blocks_total / 2;
+    printf("%s %s: записей %lld из ожидаемых %lld, блоков прочитано %llu из %llu\n", ok ? "✅" : "❌", label,
+           (long long)out.size, (long long)expected,
+           (unsigned long long)stats.blocks_read, (unsigned long long)stats.blocks_total);
+    if (!ok) failures++;
+    free_system(&out);
+}
+
+static void check_file(const struct data_base* db, const char* filename, int zones, const char* label) {
+    char name[128];
+    int32_t last_day = 0;
+    for (int64_t i = 0; i < db->size; i++) {
+        if (db->records[i].date != DATE_NONE && db->records[i].date > last_day) last_day = db->records[i].date;
+    }
+    range_query q;
+
+    range_query_init(&q);
+    snprintf(name, sizeof(name), "%s, без ограничений", label);
+    check_query(db, filename, &q, 0, name);
+
+    range_query_init(&q);
+    q.date_from = last_day / 3;
+    q.date_to = last_day / 3 + 5;
+    snprintf(name, sizeof(name), "%s, узкий диапазон дат", label);
+    check_query(db, filename, &q, zones, name);
+
+    range_query_init(&q);
+    q.mileage_from = (int32_t)(db->size / 2);
+    q.mileage_to = (int32_t)(db->size / 2) + 2000;
+    q.price_from = 1000.0f;
+    q.price_to = 3000.0f;
+    snprintf(name, sizeof(name), "%s, пробег и цена", label);
+    check_query(db, filename, &q, zones, name);
+
+    range_query_init(&q);
+    q.price_from = 4990.0f;
+    snprintf(name, sizeof(name), "%s, только цена", label);
+    check_query(db, filename, &q, 0, name);
+
+    range_query_init(&q);
+    q.date_from = last_day + 100;
+    snprintf(name, sizeof(name), "%s, даты после последней записи", label);
+    check_query(db, filename, &q, zones, name);
+}
+
+int main(void) {
+    // Одиночный файл v2 с удаленными записями
+    struct data_base db;
+    init_system(&db, 10);
+    fill(&db, 100000);
+    for (int64_t i = 0; i < db.size; i += 13) delete_item(&db, i);
+    remove(TEST_FILE);
+    save_to_file(&db, TEST_FILE);
+    check_file(&db, TEST_FILE, 1, "файл v2");
+
+    // Сжатый контейнер: сводок нет, файл загружается целиком
+    save_to_file_compressed(&db, TEST_PACKED);
+    check_file(&db, TEST_PACKED, 0, "сжатый файл");
+    remove(TEST_PACKED);
+    free_system(&db);
+
+    // Сегментированная база: сводки проверяются в каждом сегменте
+    init_system(&db, 10);
+    fill(&db, (int)SEGMENT_RECORDS + 100000);
+    remove(TEST_FILE);
+    save_to_file(&db, TEST_FILE);
+    if (!segment_is_manifest(TEST_FILE)) {
+        printf("❌ база не сохранена сегментами\n");
+        failures++;
+    }
+    check_file(&db, TEST_FILE, 1, "сегменты");
+
+    // Манифест и файлы сегментов
+    segment_manifest_header header;
+    segment_entry* entries = NULL;
+    if (segment_read_manifest(TEST_FILE, &header, &entries, NULL, NULL)) {
+        for (uint32_t i = 0; i < header.segment_count; i++) {
+            char segment[300];
+            get_segment_filename(TEST_FILE, i, entries[i].generation, segment, sizeof(segment));
+            remove(segment);
+        }
+        free(entries);
+    }
+    remove(TEST_FILE);
+    free_system(&db);
+
+    if (failures) printf("Ошибок: %d\n", failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,225 @@
+#include "soa.h"
+
+#include <math.h>
+
+// ============================================================================
+// Векторные агрегаты по столбцам: ядра simd.h на каждом доступном уровне
+// (AVX2, SSE4.1, скалярном) и soa_stats / soa_histogram по базе сверяются с
+// обычным проходом по значениям. Размеры массивов не кратны блоку из 64
+// значений, карта отбора содержит лишние биты за концом массива - так
+// проверяются и остаток, и маски.
+// ============================================================================
+
+static int failures = 0;
+static uint32_t seed = 99;
+
+static uint32_t next_random(void) {
+    seed = seed * 1103515245u + 12345u;
+    return seed >> 8;
+}
+
+static void report(int ok, const char* label) {
+    printf("%s %s\n", ok ? "✅" : "❌", label);
+    if (!ok) failures++;
+}
+
+// Суммы float складываются в другом порядке: допускается погрешность округления
+static int same_sum(double a, double b) {
+    double scale = fabs(a) > fabs(b) ? fabs(a) : fabs(b);
+    return fabs(a - b) <= 1e-9 * (scale > 1.0 ? scale : 1.0);
+}
+
+static int same_stats(const simd_stats* a, const simd_stats* b) {
+    return a->count == b->count && same_sum(a->sum, b->sum) && a->min == b->min && a->max == b->max;
+}
+
+static int selected(const uint64_t* selection, size_t i) {
+    return !selection || (selection[i / 64] >> (i % 64)) & 1;
+}
+
+// Корзина как в описании simd_histogram_*: с отбрасыванием дробной части, края - в крайние корзины
+static uint32_t scalar_bin(double v, double lo, double width, uint32_t bins) {
+    double x = (v - lo) / width;
+    if (!(x >= 0)) return 0;
+    if (x > bins - 1) return bins - 1;
+    return (uint32_t)x;
+}
+
+static void scalar_stats_f32(const float* v, size_t n, const uint64_t* selection, simd_stats* out) {
+    memset(out, 0, sizeof(*out));
+    for (size_t i = 0; i < n; i++) {
+        if (!selected(selection, i)) continue;
+        if (out->count == 0 || v[i] < out->min) out->min = v[i];
+        if (out->count == 0 || v[i] > out->max) out->max = v[i];
+        out->sum += v[i];
+        out->count++;
+    }
+}
+
+static void scalar_stats_i32(const int32_t* v, size_t n, const uint64_t* selection, simd_stats* out) {
+    memset(out, 0, sizeof(*out));
+    int64_t sum = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (!selected(selection, i)) continue;
+        if (out->count == 0 || v[i] < out->min) out->min = v[i];
+        if (out->count == 0 || v[i] > out->max) out->max = v[i];
+        sum += v[i];
+        out->count++;
+    }
+    out->sum = (double)sum;
+}
+
+#define BINS 7
+#define MAX_N 1100
+
+// Все ядра на одном уровне для массивов разной длины и трех видов отбора
+static void check_kernels(SimdLevel level) {
+    static const size_t sizes[] = {0, 1, 3, 31, 63, 64, 65, 127, 128, 129, 200, 1000, 1089};
+    static float f[MAX_N];
+    static int32_t d[MAX_N];
+    static uint64_t selection[MAX_N / 64 + 1];
+    int ok = 1;
+
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        size_t n = sizes[s];
+        for (size_t i = 0; i < n; i++) {
+            f[i] = (float)((int)(next_random() % 20000) - 5000) / 8.0f;
+            d[i] = (int32_t)(next_random() % 2000000) - 1000000;
+        }
+        // Отбор: все, случайные биты (в том числе за концом массива), ни одного
+        for (int mode = 0; mode < 3; mode++) {
+            for (size_t w = 0; w < sizeof(selection) / sizeof(selection[0]); w++) {
+                selection[w] = mode == 1 ? ((uint64_t)next_random() << 40) ^ ((uint64_t)next_random() << 20) ^
+                                           next_random()
+                                         : 0;
+            }
+            const uint64_t* sel = mode == 0 ? NULL : selection;
+
+            simd_stats got, expected;
+            simd_stats_f32(f, n, sel, &got);
+            scalar_stats_f32(f, n, sel, &expected);
+            ok = ok && same_stats(&got, &expected);
+            simd_stats_i32(d, n, sel, &got);
+            scalar_stats_i32(d, n, sel, &expected);
+            ok = ok && same_stats(&got, &expected);
+
+            uint64_t counts[BINS] = {0}, expected_counts[BINS] = {0};
+            simd_histogram_f32(f, n, sel, -300.0, 150.0, BINS, counts);
+            for (size_t i = 0; i < n; i++) {
+                if (selected(sel, i)) expected_counts[scalar_bin(f[i], -300.0, 150.0, BINS)]++;
+            }
+            ok = ok && memcmp(counts, expected_counts, sizeof(counts)) == 0;
+
+            memset(counts, 0, sizeof(counts));
+            memset(expected_counts, 0, sizeof(expected_counts));
+            simd_histogram_i32(d, n, sel, -500000.0, 250000.0, BINS, counts);
+            for (size_t i = 0; i < n; i++) {
+                if (selected(sel, i)) expected_counts[scalar_bin(d[i], -500000.0, 250000.0, BINS)]++;
+            }
+            ok = ok && memcmp(counts, expected_counts, sizeof(counts)) == 0;
+        }
+    }
+
+    char label[64];
+    snprintf(label, sizeof(label), "ядра simd, уровень %s", simd_level_name(level));
+    report(ok, label);
+}
+
+// soa_stats / soa_histogram по базе с удалениями и записями без даты
+static void check_soa(void) {
+    struct data_base db;
+    init_system(&db, 10);
+    soa_enable(&db);
+    for (int i = 0; i < 5003; i++) {
+        technical_maintenance r;
+        memset(&r, 0, sizeof(r));
+        r.date = next_random() % 10 == 0 ? DATE_NONE : (int32_t)(next_random() % 20000);
+        r.mileage = (int32_t)(next_random() % 300000);
+        r.price = (float)(next_random() % 100000) / 100.0f;
+        add_item(&db, r);
+    }
+    for (int64_t i = 0; i < db.size; i += 7) delete_item(&db, i);
+    technical_maintenance changed = db.records[1];
+    changed.price = 12345.5f;
+    modify_item(&db, 1, changed);
+
+    size_t words = ((size_t)db.size + 63) / 64;
+    uint64_t* selection = calloc(words, sizeof(uint64_t));
+    float* price = malloc((size_t)db.size * sizeof(float));
+    int32_t* mileage = malloc((size_t)db.size * sizeof(int32_t));
+    int32_t* date = malloc((size_t)db.size * sizeof(int32_t));
+    uint64_t* live = calloc(words, sizeof(uint64_t));
+    uint64_t* dated = calloc(words, sizeof(uint64_t));
+    uint64_t* picked = calloc(words, sizeof(uint64_t));
+    uint64_t* picked_dated = calloc(words, sizeof(uint64_t));
+    if (!selection || !price || !mileage || !date || !live || !dated || !picked || !picked_dated) {
+        report(0, "soa: недостаточно памяти");
+    } else {
+        // Ожидаемые отборы строятся по записям базы, а не по зеркалу
+        for (int64_t i = 0; i < db.size; i++) {
+            const technical_maintenance* r = &db.records[i];
+            uint64_t bit = (uint64_t)1 << (i % 64);
+            if (next_random() % 3 == 0) selection[i / 64] |= bit;
+            price[i] = r->price;
+            mileage[i] = r->mileage;
+            date[i] = r->date;
+            if (record_is_deleted(r)) continue;
+            live[i / 64] |= bit;
+            if (r->date != DATE_NONE) dated[i / 64] |= bit;
+        }
+        for (size_t w = 0; w < words; w++) {
+            picked[w] = live[w] & selection[w];
+            picked_dated[w] = dated[w] & selection[w];
+        }
+
+        size_t n = (size_t)db.size;
+        simd_stats got, expected;
+        int ok = soa_stats(&db, SOA_PRICE, NULL, &got);
+        scalar_stats_f32(price, n, live, &expected);
+        ok = ok && same_stats(&got, &expected);
+        ok = ok && soa_stats(&db, SOA_MILEAGE, selection, &got);
+        scalar_stats_i32(mileage, n, picked, &expected);
+        ok = ok && same_stats(&got, &expected);
+        ok = ok && soa_stats(&db, SOA_DATE, NULL, &got);
+        scalar_stats_i32(date, n, dated, &expected);
+        ok = ok && same_stats(&got, &expected);
+        report(ok, "soa_stats совпадает с проходом по записям");
+
+        uint64_t counts[BINS] = {0}, expected_counts[BINS] = {0};
+        ok = soa_histogram(&db, SOA_DATE, selection, 2000.0, 2500.0, BINS, counts);
+        for (size_t i = 0; i < n; i++) {
+            if (selected(picked_dated, i)) expected_counts[scalar_bin(date[i], 2000.0, 2500.0, BINS)]++;
+        }
+        ok = ok && memcmp(counts, expected_counts, sizeof(counts)) == 0;
+        memset(counts, 0, sizeof(counts));
+        memset(expected_counts, 0, sizeof(expected_counts));
+        ok = ok && soa_histogram(&db, SOA_PRICE, NULL, 0.0, 100.0, BINS, counts);
+        for (size_t i = 0; i < n; i++) {
+            if (selected(live, i)) expected_counts[scalar_bin(price[i], 0.0, 100.0, BINS)]++;
+        }
+        ok = ok && memcmp(counts, expected_counts, sizeof(counts)) == 0;
+        report(ok, "soa_histogram совпадает с проходом по записям");
+    }
+
+    free(selection);
+    free(price);
+    free(mileage);
+    free(date);
+    free(live);
+    free(dated);
+    free(picked);
+    free(picked_dated);
+    free_system(&db);
+}
+
+int main(void) {
+    SimdLevel best = simd_level();
+    for (int level = (int)best; level >= (int)SIMD_SCALAR; level--) {
+        check_kernels(simd_set_level((SimdLevel)level));
+    }
+    simd_set_level(best);
+    check_soa();
+
+    if (failures) printf("Ошибок: %d\n", failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,110 @@
+#include "topk.h"
+#include "db_index.h"
+
+// ============================================================================
+// Постраничный вывод по дате через индекс, когда у части записей нет даты
+// (DATE_NONE = INT32_MIN). Страница, закончившаяся внутри группы без даты,
+// должна продолжаться с курсора и вернуть остальные записи этой группы.
+// Каждая живая запись должна встретиться ровно один раз и в нужном порядке.
+// ============================================================================
+
+static int failures = 0;
+static uint32_t seed = 12345;
+
+static uint32_t next_random(void) {
+    seed = seed * 1103515245u + 12345u;
+    return seed >> 8;
+}
+
+static void fill(struct data_base* db, int count, int undated_percent) {
+    for (int i = 0; i < count; i++) {
+        technical_maintenance r;
+        memset(&r, 0, sizeof(r));
+        r.date = (int)(next_random() % 100) < undated_percent ? DATE_NONE : (int32_t)(next_random() % 500);
+        r.mileage = (int32_t)(next_random() % 100000);
+        r.price = (float)(next_random() % 1000);
+        add_item(db, r);
+    }
+}
+
+// Обходит все страницы и сверяет их с живыми записями базы
+static void check_pages(struct data_base* db, int descending, size_t page_size, const char* label) {
+    int32_t max_id = 0;
+    int64_t live = 0;
+    for (int64_t i = 0; i < db->size; i++) {
+        if (record_is_deleted(&db->records[i])) continue;
+        if (db->records[i].id > max_id) max_id = db->records[i].id;
+        live++;
+    }
+    unsigned char* seen = calloc((size_t)max_id + 1, 1);
+    int64_t* slots = malloc(page_size * sizeof(int64_t));
+    if (!seen || !slots) {
+        printf("❌ %s: недостаточно памяти\n", label);
+        failures++;
+        free(seen);
+        free(slots);
+        return;
+    }
+
+    page_cursor cursor;
+    memset(&cursor, 0, sizeof(cursor));
+    int64_t returned = 0, duplicates = 0, misordered = 0;
+    int have_prev = 0;
+    int32_t prev_date = 0, prev_id = 0;
+    for (;;) {
+        page_cursor next;
+        int64_t n = topk_page(db, SORT_DATE, descending, cursor.valid ? &cursor : NULL, page_size, NULL,
+                              slots, &next);
+        if (n <= 0) break;
+        for (int64_t i = 0; i < n; i++) {
+            const technical_maintenance* r = &db->records[slots[i]];
+            if (seen[r->id]) duplicates++;
+            seen[r->id] = 1;
+            // Порядок: по дате, при равенстве - по id в ту же сторону
+            if (have_prev) {
+                int before = r->date != prev_date ? r->date < prev_date : r->id < prev_id;
+                if (descending ? !before : before) misordered++;
+            }
+            prev_date = r->date;
+            prev_id = r->id;
+            have_prev = 1;
+            returned++;
+        }
+        cursor = next;
+    }
+
+    int ok = returned == live && duplicates == 0 && misordered == 0;
+    printf("%s %s: выдано %lld из %lld (повторов %lld, нарушений порядка %lld)\n", ok ? "✅" : "❌", label,
+           (long long)returned, (long long)live, (long long)duplicates, (long long)misordered);
+    if (!ok) failures++;
+    free(seen);
+    free(slots);
+}
+
+int main(void) {
+    // 10 записей, треть без даты, страницы по 3
+    struct data_base small;
+    init_system(&small, 10);
+    db_index_enable(&small, INDEX_MASK(INDEX_DATE));
+    fill(&small, 10, 35);
+    check_pages(&small, 1, 3, "10 записей, по убыванию");
+    check_pages(&small, 0, 3, "10 записей, по возрастанию");
+    free_system(&small);
+
+    // Большая база с удалениями: записи без даты идут подряд длинной группой
+    struct data_base big;
+    init_system(&big, 10);
+    db_index_enable(&big, INDEX_MASK(INDEX_DATE));
+    fill(&big, 60000, 20);
+    for (int64_t i = 0; i < big.size; i += 8) delete_item(&big, i);
+    check_pages(&big, 1, 50, "60000 записей, по убыванию");
+    check_pages(&big, 0, 50, "60000 записей, по возрастанию");
+
+    // То же без индекса - куча по всем записям
+    db_index_disable(&big);
+    check_pages(&big, 1, 50, "без индекса, по убыванию");
+    free_system(&big);
+
+    if (failures) printf("Ошибок: %d\n", failures);
+    return failures ? 1 : 0;
+}
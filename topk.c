@@ -0,0 +1,293 @@
+#include "topk.h"
+#include "db_index.h"
+#include "parallel.h"
+
+#include <float.h>
+
+typedef struct {
+    double value;
+    int32_t id;
+    int64_t slot;
+} rank_entry;
+
+// ============================================================================
+// Порядок
+// ============================================================================
+
+static double field_value(const technical_maintenance* r, SortField field) {
+    switch (field) {
+        case SORT_ID:      return r->id;
+        case SORT_DATE:    return r->date;
+        case SORT_MILEAGE: return r->mileage;
+        default:           return r->price;
+    }
+}
+
+// a выдается раньше b
+static int before(const rank_entry* a, const rank_entry* b, int descending) {
+    if (a->value != b->value) return descending ? a->value > b->value : a->value < b->value;
+    return descending ? a->id > b->id : a->id < b->id;
+}
+
+static int after_cursor(const rank_entry* e, const page_cursor* cursor, int descending) {
+    if (!cursor || !cursor->valid) return 1;
+    rank_entry c;
+    c.value = cursor->value;
+    c.id = cursor->id;
+    c.slot = -1;
+    return before(&c, e, descending);
+}
+
+static int compare_asc(const void* a, const void* b) {
+    const rank_entry* x = (const rank_entry*)a;
+    const rank_entry* y = (const rank_entry*)b;
+    return before(x, y, 0) ? -1 : before(y, x, 0) ? 1 : 0;
+}
+
+static int compare_desc(const void* a, const void* b) {
+    const rank_entry* x = (const rank_entry*)a;
+    const rank_entry* y = (const rank_entry*)b;
+    return before(x, y, 1) ? -1 : before(y, x, 1) ? 1 : 0;
+}
+
+static void sort_entries(rank_entry* entries, size_t count, int descending) {
+    if (count > 1) qsort(entries, count, sizeof(rank_entry), descending ? compare_desc : compare_asc);
+}
+
+// ============================================================================
+// Куча: в корне худшая (выдаваемая последней) из лучших K
+// ============================================================================
+
+typedef struct {
+    rank_entry* items;
+    size_t count;
+    size_t capacity;
+} rank_heap;
+
+static void heap_push(rank_heap* h, const rank_entry* e, int descending) {
+    if (h->count < h->capacity) {
+        size_t i = h->count++;
+        h->items[i] = *e;
+        while (i > 0 && before(&h->items[(i - 1) / 2], &h->items[i], descending)) {
+            rank_entry t = h->items[i];
+            h->items[i] = h->items[(i - 1) / 2];
+            h->items[(i - 1) / 2] = t;
+            i = (i - 1) / 2;
+        }
+        return;
+    }
+    if (h->capacity == 0 || !before(e, &h->items[0], descending)) return;
+
+    // Замена корня и просеивание вниз
+    size_t i = 0;
+    h->items[0] = *e;
+    for (;;) {
+        size_t worst = i, l = 2 * i + 1, r = l + 1;
+        if (l < h->count && before(&h->items[worst], &h->items[l], descending)) worst = l;
+        if (r < h->count && before(&h->items[worst], &h->items[r], descending)) worst = r;
+        if (worst == i) break;
+        rank_entry t = h->items[i];
+        h->items[i] = h->items[worst];
+        h->items[worst] = t;
+        i = worst;
+    }
+}
+
+// ============================================================================
+// Полный проход: куча на каждый кусок, затем слияние
+// ============================================================================
+
+typedef struct {
+    const struct data_base* system;
+    SortField field;
+    int descending;
+    const page_cursor* after;
+    const filter_program* where;
+    rank_heap* heaps;
+    size_t chunk_size;
+} ScanJob;
+
+static void consider(ScanJob* job, rank_heap* h, int64_t slot) {
+    const technical_maintenance* r = &job->system->records[slot];
+    rank_entry e;
+    e.value = field_value(r, job->field);
+    e.id = r->id;
+    e.slot = slot;
+    if (after_cursor(&e, job->after, job->descending)) heap_push(h, &e, job->descending);
+}
+
+static void scan_chunk(void* ctx, size_t chunk) {
+    ScanJob* job = (ScanJob*)ctx;
+    rank_heap* h = &job->heaps[chunk];
+    size_t from = chunk * job->chunk_size;
+    size_t to = from + job->chunk_size < (size_t)job->system->size ? from + job->chunk_size : (size_t)job->system->size;
+    const technical_maintenance* records = job->system->records;
+
+    for (size_t first = from; first < to; first += FILTER_BATCH) {
+        size_t n = to - first < FILTER_BATCH ? to - first : FILTER_BATCH;
+        if (job->where) {
+            uint32_t selection[FILTER_BATCH];
+            size_t selected = filter_eval_batch(job->where, records + first, n, selection);
+            for (size_t i = 0; i < selected; i++) consider(job, h, (int64_t)(first + selection[i]));
+        } else {
+            for (size_t i = first; i < first + n; i++) {
+                if (!record_is_deleted(&records[i])) consider(job, h, (int64_t)i);
+            }
+        }
+    }
+}
+
+static int64_t scan_page(struct data_base* system, SortField field, int descending, const page_cursor* after,
+                         size_t limit, const filter_program* where, rank_entry** out) {
+    size_t n = (size_t)system->size;
+    size_t chunks = (size_t)parallel_cpu_count();
+    ScanJob job;
+    job.system = system;
+    job.field = field;
+    job.descending = descending;
+    job.after = after;
+    job.where = where;
+    job.chunk_size = (n + chunks - 1) / chunks;
+    if (job.chunk_size < FILTER_BATCH) job.chunk_size = FILTER_BATCH;
+    chunks = (n + job.chunk_size - 1) / job.chunk_size;
+
+    // Куча одного куска не больше самого куска
+    size_t per_heap = limit < job.chunk_size ? limit : job.chunk_size;
+    job.heaps = calloc(chunks ? chunks : 1, sizeof(rank_heap));
+    size_t slots = chunks * per_heap;
+    rank_entry* items = malloc((slots ? slots : 1) * sizeof(rank_entry));
+    if (!job.heaps || !items) {
+        free(job.heaps);
+        free(items);
+        return -1;
+    }
+    for (size_t c = 0; c < chunks; c++) {
+        job.heaps[c].items = items + c * per_heap;
+        job.heaps[c].capacity = per_heap;
+    }
+    parallel_for(chunks, scan_chunk, &job);
+
+    // Кучи уплотняются в начало общего массива и сортируются вместе
+    size_t total = 0;
+    for (size_t c = 0; c < chunks; c++) {
+        memmove(items + total, job.heaps[c].items, job.heaps[c].count * sizeof(rank_entry));
+        total += job.heaps[c].count;
+    }
+    free(job.heaps);
+    sort_entries(items, total, descending);
+    *out = items;
+    return (int64_t)(total < limit ? total : limit);
+}
+
+// ============================================================================
+// Обход индекса
+// ============================================================================
+
+static int index_field(SortField field, IndexField* out) {
+    switch (field) {
+        case SORT_DATE:    *out = INDEX_DATE; return 1;
+        case SORT_MILEAGE: *out = INDEX_MILEAGE; return 1;
+        case SORT_PRICE:   *out = INDEX_PRICE; return 1;
+        default:           return 0;
+    }
+}
+
+// Индекс выдает записи с равным ключом по позициям, а порядок страницы - по id,
+// поэтому записи с одинаковым значением собираются в группу и сортируются
+static int64_t index_page(struct data_base* system, SortField field, int descending, const page_cursor* after,
+                          size_t limit, const filter_program* where, index_iter* it, rank_entry** out) {
+    size_t capacity = 64;
+    rank_entry* result = malloc(limit * sizeof(rank_entry));
+    rank_entry* group = malloc(capacity * sizeof(rank_entry));
+    if (!result || !group) {
+        free(result);
+        free(group);
+        return -1;
+    }
+
+    size_t found = 0, grouped = 0;
+    int64_t slot = 0;
+    while (found < limit && slot >= 0) {
+        slot = index_iter_next(it);
+        double value = slot >= 0 ? field_value(&system->records[slot], field) : 0;
+
+        if (grouped > 0 && (slot < 0 || value != group[0].value)) {
+            sort_entries(group, grouped, descending);
+            for (size_t i = 0; i < grouped && found < limit; i++) {
+                if (!after_cursor(&group[i], after, descending)) continue;
+                if (where && !filter_match(where, &system->records[group[i].slot])) continue;
+                result[found++] = group[i];
+            }
+            grouped = 0;
+        }
+        if (slot < 0 || found >= limit) break;
+
+        if (grouped == capacity) {
+            rank_entry* grown = realloc(group, capacity * 2 * sizeof(rank_entry));
+            if (!grown) {
+                free(result);
+                free(group);
+                return -1;
+            }
+            group = grown;
+            capacity *= 2;
+        }
+        group[grouped].value = value;
+        group[grouped].id = system->records[slot].id;
+        group[grouped].slot = slot;
+        grouped++;
+    }
+    free(group);
+    *out = result;
+    return (int64_t)found;
+}
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+int64_t topk_page(struct data_base* system, SortField field, int descending,
+                  const page_cursor* after, size_t limit, const filter_program* where,
+                  int64_t* out_slots, page_cursor* next) {
+    if (next) {
+        if (after) *next = *after; else memset(next, 0, sizeof(*next));
+    }
+    if (field == SORT_TYPE_WORK) {
+        printf("Ошибка: постраничный вывод по type_work не поддерживается\n");
+        return -1;
+    }
+    if (limit == 0) return 0;
+
+    rank_entry* entries = NULL;
+    int64_t found;
+    IndexField index;
+    index_iter it;
+    int from_cursor = after && after->valid;
+    int indexed = index_field(field, &index) && system->indexes &&
+                  (system->indexes->enabled & INDEX_MASK(index)) &&
+                  (descending ? db_index_range_desc(system, index, -DBL_MAX, from_cursor ? after->value : DBL_MAX, &it)
+                              : db_index_range(system, index, from_cursor ? after->value : -DBL_MAX, DBL_MAX, &it));
+    if (indexed) {
+        found = index_page(system, field, descending, after, limit, where, &it, &entries);
+    } else {
+        found = scan_page(system, field, descending, after, limit, where, &entries);
+    }
+    if (found < 0) {
+        printf("Ошибка: недостаточно памяти для выборки\n");
+        return -1;
+    }
+
+    for (int64_t i = 0; i < found; i++) out_slots[i] = entries[i].slot;
+    if (next && found > 0) {
+        next->valid = 1;
+        next->value = entries[found - 1].value;
+        next->id = entries[found - 1].id;
+    }
+    free(entries);
+    return found;
+}
+
+int64_t topk_select(struct data_base* system, SortField field, int descending, size_t k,
+                    int64_t* out_slots) {
+    return topk_page(system, field, descending, NULL, k, NULL, out_slots, NULL);
+}
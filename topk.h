@@ -0,0 +1,41 @@
+#ifndef TOPK_H
+#define TOPK_H
+
+#include "database.h"
+#include "filter.h"
+#include "db_sort.h" // SortField
+
+// ============================================================================
+// Первые K записей по полю без полной сортировки и постраничный вывод по
+// ключу ("самые дорогие 20 работ", "последние 50 заказов").
+// Порядок - по значению поля, при равенстве по id, так что он полный и не
+// зависит от позиций записей. Страница продолжается с курсора (значение и
+// id последней выданной записи), а не со смещения, поэтому изменения базы
+// между страницами не сдвигают и не дублируют записи.
+//
+// Без индекса - куча из K элементов на каждый поток, O(n log K).
+// Если по полю включен индекс db_index.h - обход индекса с нужного ключа,
+// O(log n + K).
+// ============================================================================
+
+typedef struct page_cursor {
+    int valid;    // 0 - с начала
+    double value; // значение поля последней выданной записи
+    int32_t id;
+} page_cursor;
+
+// Поля: SORT_ID, SORT_DATE (записи без даты идут раньше всех), SORT_MILEAGE, SORT_PRICE.
+// Позиции до limit записей (живых и подходящих под where, если он задан),
+// следующих за курсором after (NULL - с начала) в порядке field по возрастанию
+// или убыванию (descending = 1). out_slots - не меньше limit элементов.
+// В next (может быть NULL) - курсор для следующей страницы.
+// Возвращает число записей или -1 (нехватка памяти, SORT_TYPE_WORK).
+int64_t topk_page(struct data_base* system, SortField field, int descending,
+                  const page_cursor* after, size_t limit, const filter_program* where,
+                  int64_t* out_slots, page_cursor* next);
+
+// Первые k записей - первая страница
+int64_t topk_select(struct data_base* system, SortField field, int descending, size_t k,
+                    int64_t* out_slots);
+
+#endif // TOPK_H
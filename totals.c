@@ -0,0 +1,225 @@
+#include "totals.h"
+#include "work_dict.h"
+
+// ============================================================================
+// Строки итогов
+// ============================================================================
+
+static int64_t price_cents(float price) {
+    double cents = (double)price * 100.0;
+    return (int64_t)(cents >= 0 ? cents + 0.5 : cents - 0.5);
+}
+
+static void row_apply(totals_row* row, const technical_maintenance* r, int64_t sign) {
+    row->count += sign;
+    row->revenue += sign * price_cents(r->price);
+    row->mileage += sign * (int64_t)r->mileage;
+}
+
+static size_t month_hash(int32_t month, size_t mask) {
+    return ((uint32_t)month * 2654435761u) & mask;
+}
+
+static int grow_months(db_totals* t) {
+    size_t slot_count = t->month_slots ? t->month_slots * 2 : 64;
+    int32_t* keys = calloc(slot_count, sizeof(int32_t));
+    totals_row* rows = calloc(slot_count, sizeof(totals_row));
+    if (!keys || !rows) {
+        free(keys);
+        free(rows);
+        return 0;
+    }
+    for (size_t i = 0; i < t->month_slots; i++) {
+        if (!t->month_keys[i]) continue;
+        size_t h = month_hash(t->month_keys[i], slot_count - 1);
+        while (keys[h]) h = (h + 1) & (slot_count - 1);
+        keys[h] = t->month_keys[i];
+        rows[h] = t->month_rows[i];
+    }
+    free(t->month_keys);
+    free(t->month_rows);
+    t->month_keys = keys;
+    t->month_rows = rows;
+    t->month_slots = slot_count;
+    return 1;
+}
+
+// Строка месяца (create = 1 - с добавлением) или NULL
+static totals_row* month_row(db_totals* t, int32_t month, int create) {
+    if (month == 0) return &t->no_date;
+    if (t->month_slots) {
+        size_t mask = t->month_slots - 1;
+        for (size_t h = month_hash(month, mask); t->month_keys[h]; h = (h + 1) & mask) {
+            if (t->month_keys[h] == month) return &t->month_rows[h];
+        }
+    }
+    if (!create) return NULL;
+
+    // Заполнение не больше половины
+    if ((t->month_count + 1) * 2 > t->month_slots && !grow_months(t)) return NULL;
+    size_t mask = t->month_slots - 1;
+    size_t h = month_hash(month, mask);
+    while (t->month_keys[h]) h = (h + 1) & mask;
+    t->month_keys[h] = month;
+    t->month_count++;
+    return &t->month_rows[h];
+}
+
+static totals_row* type_row(db_totals* t, uint32_t type_id, int create) {
+    if (type_id == WORK_DICT_NONE) return NULL;
+    if (type_id >= t->type_count) {
+        if (!create) return NULL;
+        uint32_t count = t->type_count ? t->type_count : 16;
+        while (count <= type_id) count *= 2;
+        totals_row* types = realloc(t->types, count * sizeof(totals_row));
+        if (!types) return NULL;
+        memset(types + t->type_count, 0, (count - t->type_count) * sizeof(totals_row));
+        t->types = types;
+        t->type_count = count;
+    }
+    return &t->types[type_id];
+}
+
+// Учитывает запись со знаком sign; 0 - не хватило памяти
+static int apply(db_totals* t, const technical_maintenance* r, int64_t sign) {
+    totals_row* by_type = type_row(t, r->type_id, 1);
+    totals_row* by_month = month_row(t, date_month(r->date), 1);
+    if ((!by_type && r->type_id != WORK_DICT_NONE) || !by_month) return 0;
+    row_apply(&t->all, r, sign);
+    if (by_type) row_apply(by_type, r, sign);
+    row_apply(by_month, r, sign);
+    return 1;
+}
+
+static void reset(db_totals* t) {
+    memset(&t->all, 0, sizeof(t->all));
+    memset(&t->no_date, 0, sizeof(t->no_date));
+    if (t->types) memset(t->types, 0, t->type_count * sizeof(totals_row));
+    if (t->month_keys) memset(t->month_keys, 0, t->month_slots * sizeof(int32_t));
+    if (t->month_rows) memset(t->month_rows, 0, t->month_slots * sizeof(totals_row));
+    t->month_count = 0;
+}
+
+static int ensure_ready(struct data_base* system) {
+    db_totals* t = system->totals;
+    if (!t) return 0;
+    if (t->ready) return 1;
+
+    reset(t);
+    for (int64_t i = 0; i < system->size; i++) {
+        if (record_is_deleted(&system->records[i])) continue;
+        if (!apply(t, &system->records[i], 1)) {
+            printf("Ошибка: недостаточно памяти для итогов\n");
+            return 0;
+        }
+    }
+    t->ready = 1;
+    return 1;
+}
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+int totals_enable(struct data_base* system) {
+    if (system->totals) return 1;
+    system->totals = calloc(1, sizeof(db_totals));
+    return system->totals != NULL;
+}
+
+void totals_disable(struct data_base* system) {
+    db_totals* t = system->totals;
+    if (!t) return;
+    free(t->types);
+    free(t->month_keys);
+    free(t->month_rows);
+    free(t);
+    system->totals = NULL;
+}
+
+void totals_on_add(struct data_base* system, const technical_maintenance* record) {
+    db_totals* t = system->totals;
+    // Без памяти итоги пересчитаются при следующем чтении
+    if (t && t->ready && !apply(t, record, 1)) t->ready = 0;
+}
+
+void totals_on_remove(struct data_base* system, const technical_maintenance* record) {
+    db_totals* t = system->totals;
+    if (t && t->ready && !apply(t, record, -1)) t->ready = 0;
+}
+
+void totals_invalidate(struct data_base* system) {
+    if (system->totals) system->totals->ready = 0;
+}
+
+int totals_all(struct data_base* system, totals_row* out) {
+    memset(out, 0, sizeof(*out));
+    if (!ensure_ready(system)) return 0;
+    *out = system->totals->all;
+    return 1;
+}
+
+int totals_by_type(struct data_base* system, uint32_t type_id, totals_row* out) {
+    memset(out, 0, sizeof(*out));
+    if (!ensure_ready(system)) return 0;
+    const totals_row* row = type_row(system->totals, type_id, 0);
+    if (row) *out = *row;
+    return 1;
+}
+
+int totals_by_month(struct data_base* system, int32_t month, totals_row* out) {
+    memset(out, 0, sizeof(*out));
+    if (!ensure_ready(system)) return 0;
+    const totals_row* row = month_row(system->totals, month, 0);
+    if (row) *out = *row;
+    return 1;
+}
+
+static int push_group(group_result* result, size_t* capacity, const totals_row* row,
+                      uint32_t type_id, int32_t month) {
+    if (row->count == 0) return 1;
+    if (result->count == *capacity) {
+        size_t grown = *capacity ? *capacity * 2 : 16;
+        group_row* rows = realloc(result->rows, grown * sizeof(group_row));
+        if (!rows) return 0;
+        result->rows = rows;
+        *capacity = grown;
+    }
+    group_row* g = &result->rows[result->count++];
+    g->type_id = type_id;
+    g->month = month;
+    g->count = row->count;
+    g->sum = (double)row->revenue / 100.0;
+    g->min = 0;
+    g->max = 0;
+    return 1;
+}
+
+int totals_to_groups(struct data_base* system, unsigned keys, group_result* result) {
+    memset(result, 0, sizeof(*result));
+    if (!ensure_ready(system)) return 0;
+    db_totals* t = system->totals;
+
+    size_t capacity = 0;
+    int ok = 1;
+    if (keys == GROUP_BY_TYPE_WORK) {
+        for (uint32_t id = 0; id < t->type_count && ok; id++) {
+            ok = push_group(result, &capacity, &t->types[id], id, -1);
+        }
+    } else if (keys == GROUP_BY_MONTH) {
+        ok = push_group(result, &capacity, &t->no_date, WORK_DICT_NONE, 0);
+        for (size_t i = 0; i < t->month_slots && ok; i++) {
+            if (t->month_keys[i]) ok = push_group(result, &capacity, &t->month_rows[i], WORK_DICT_NONE, t->month_keys[i]);
+        }
+    } else {
+        return 0;
+    }
+
+    if (!ok) {
+        printf("Ошибка: недостаточно памяти для итогов\n");
+        group_result_free(result);
+        return 0;
+    }
+    group_result_sort(result);
+    return 1;
+}
@@ -0,0 +1,52 @@
+#ifndef TOTALS_H
+#define TOTALS_H
+
+#include "database.h"
+#include "group_by.h"
+
+// ============================================================================
+// Накопительные итоги по виду работ и по месяцу: число записей, выручка и
+// сумма пробегов. Ведутся по желанию (totals_enable): add_item, modify_item
+// и delete_item поправляют их за O(1), clear_database и загрузка сбрасывают,
+// и итоги пересчитываются при первом чтении. Чтение итога - O(1).
+// Выручка хранится в копейках, поэтому добавление и удаление записи
+// взаимно уничтожаются точно, без накопления ошибки округления.
+// ============================================================================
+
+typedef struct totals_row {
+    int64_t count;
+    int64_t revenue;  // копейки
+    int64_t mileage;
+} totals_row;
+
+typedef struct db_totals {
+    totals_row all;
+    totals_row* types;      // types[type_id]
+    uint32_t type_count;
+    int32_t* month_keys;    // открытая адресация по date_month, 0 - пусто
+    totals_row* month_rows;
+    size_t month_slots;     // степень двойки
+    size_t month_count;     // занятых
+    totals_row no_date;     // записи без даты
+    int ready;              // 0 - пересчитать при следующем чтении
+} db_totals;
+
+int totals_enable(struct data_base* system);
+void totals_disable(struct data_base* system);
+
+// Вызываются из database.c: on_add - после появления живой записи,
+// on_remove - до изменения или удаления, invalidate - записи заменены целиком
+void totals_on_add(struct data_base* system, const technical_maintenance* record);
+void totals_on_remove(struct data_base* system, const technical_maintenance* record);
+void totals_invalidate(struct data_base* system);
+
+// Итоги; 0, если итоги не включены. Неизвестный вид работ или месяц - нулевая строка.
+int totals_all(struct data_base* system, totals_row* out);
+int totals_by_type(struct data_base* system, uint32_t type_id, totals_row* out);
+int totals_by_month(struct data_base* system, int32_t month, totals_row* out); // гггг*100 + мм, 0 - без даты
+
+// Непустые итоги в виде результата группировки (keys - GROUP_BY_TYPE_WORK или
+// GROUP_BY_MONTH) для вывода отчетов; min и max в строках не ведутся и равны 0.
+int totals_to_groups(struct data_base* system, unsigned keys, group_result* result);
+
+#endif // TOTALS_H
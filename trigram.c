@@ -0,0 +1,337 @@
+#include "trigram.h"
+#include "work_dict.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define FOLD_STACK_SIZE 256 // строки короче сворачиваются без malloc
+
+typedef struct {
+    uint64_t key;    // три символа по 21 биту; 0 - пустой слот
+    uint32_t* ids;   // id строк словаря по возрастанию
+    uint32_t count;
+    uint32_t capacity;
+} posting;
+
+typedef struct {
+    posting* slots;    // открытая адресация
+    size_t slot_count; // степень двойки
+    size_t used;
+    uint32_t indexed;  // строки словаря [0, indexed) уже в индексе
+} trigram_index;
+
+static trigram_index* shared_index = NULL;
+
+// ============================================================================
+// UTF-8 и регистр
+// ============================================================================
+
+// Следующий символ; байт, не начинающий корректную последовательность,
+// возвращается как 0xDC00 + байт
+static uint32_t next_char(const unsigned char** p) {
+    const unsigned char* s = *p;
+    uint32_t c = s[0];
+    size_t len = c < 0x80 ? 1 : (c & 0xE0) == 0xC0 ? 2 : (c & 0xF0) == 0xE0 ? 3 : (c & 0xF8) == 0xF0 ? 4 : 0;
+    if (len == 1) {
+        (*p)++;
+        return c;
+    }
+    if (len) {
+        uint32_t cp = c & (0x7Fu >> len);
+        size_t i = 1;
+        while (i < len && (s[i] & 0xC0) == 0x80) cp = (cp << 6) | (s[i++] & 0x3F);
+        if (i == len) {
+            *p += len;
+            return cp;
+        }
+    }
+    (*p)++;
+    return 0xDC00 | c;
+}
+
+// Нижний регистр латиницы, Latin-1 и кириллицы (включая Ё). Длина символа
+// в UTF-8 при этом не меняется, поэтому свернутая строка той же длины.
+static uint32_t fold_char(uint32_t c) {
+    if (c >= 'A' && c <= 'Z') return c + 0x20;
+    if (c >= 0x410 && c <= 0x42F) return c + 0x20;
+    if (c >= 0x400 && c <= 0x40F) return c + 0x50;
+    if (c >= 0xC0 && c <= 0xDE && c != 0xD7) return c + 0x20;
+    return c;
+}
+
+// Свертка len байт s в out (не меньше len + 1 байт)
+static void fold_into(const char* s, size_t len, char* out) {
+    const unsigned char* p = (const unsigned char*)s;
+    const unsigned char* end = p + len;
+    unsigned char* o = (unsigned char*)out;
+    while (p < end) {
+        const unsigned char* start = p;
+        uint32_t c = next_char(&p);
+        uint32_t f = fold_char(c);
+        if (f == c) {
+            memcpy(o, start, (size_t)(p - start));
+            o += p - start;
+        } else if (f < 0x80) {
+            *o++ = (unsigned char)f;
+        } else {
+            *o++ = (unsigned char)(0xC0 | (f >> 6));
+            *o++ = (unsigned char)(0x80 | (f & 0x3F));
+        }
+    }
+    *o = '\0';
+}
+
+char* utf8_fold(const char* s) {
+    size_t len = strlen(s);
+    char* out = malloc(len + 1);
+    if (out) fold_into(s, len, out);
+    return out;
+}
+
+int utf8_contains_folded(const char* s, const char* folded) {
+    if (!s) return 0;
+    char local[FOLD_STACK_SIZE];
+    size_t len = strlen(s);
+    char* text = len < sizeof(local) ? local : malloc(len + 1);
+    if (!text) return 0;
+    fold_into(s, len, text);
+    int found = strstr(text, folded) != NULL;
+    if (text != local) free(text);
+    return found;
+}
+
+// Символы свернутой строки (malloc, не больше strlen символов)
+static uint32_t* decode(const char* folded, size_t* out_count) {
+    size_t len = strlen(folded);
+    uint32_t* chars = malloc((len ? len : 1) * sizeof(uint32_t));
+    if (!chars) return NULL;
+    const unsigned char* p = (const unsigned char*)folded;
+    size_t n = 0;
+    while (*p) chars[n++] = next_char(&p);
+    *out_count = n;
+    return chars;
+}
+
+static uint64_t trigram_key(const uint32_t* c) {
+    return ((uint64_t)(c[0] & 0x1FFFFF) << 42) | ((uint64_t)(c[1] & 0x1FFFFF) << 21) | (c[2] & 0x1FFFFF);
+}
+
+// ============================================================================
+// Списки триграмм
+// ============================================================================
+
+static size_t key_hash(uint64_t key, size_t mask) {
+    key ^= key >> 29;
+    key *= 0xbf58476d1ce4e5b9ull;
+    key ^= key >> 32;
+    return (size_t)key & mask;
+}
+
+static int grow_slots(trigram_index* t) {
+    size_t slot_count = t->slot_count ? t->slot_count * 2 : 1024;
+    posting* slots = calloc(slot_count, sizeof(posting));
+    if (!slots) return 0;
+    for (size_t i = 0; i < t->slot_count; i++) {
+        if (!t->slots[i].key) continue;
+        size_t h = key_hash(t->slots[i].key, slot_count - 1);
+        while (slots[h].key) h = (h + 1) & (slot_count - 1);
+        slots[h] = t->slots[i];
+    }
+    free(t->slots);
+    t->slots = slots;
+    t->slot_count = slot_count;
+    return 1;
+}
+
+// Список триграммы или NULL (create = 1 - с добавлением; NULL тогда - нет памяти)
+static posting* find_posting(trigram_index* t, uint64_t key, int create) {
+    if (t->slot_count) {
+        size_t mask = t->slot_count - 1;
+        for (size_t h = key_hash(key, mask); t->slots[h].key; h = (h + 1) & mask) {
+            if (t->slots[h].key == key) return &t->slots[h];
+        }
+    }
+    if (!create) return NULL;
+
+    // Заполнение не больше половины
+    if ((t->used + 1) * 2 > t->slot_count && !grow_slots(t)) return NULL;
+    size_t mask = t->slot_count - 1;
+    size_t h = key_hash(key, mask);
+    while (t->slots[h].key) h = (h + 1) & mask;
+    t->slots[h].key = key;
+    t->used++;
+    return &t->slots[h];
+}
+
+static int posting_add(posting* p, uint32_t id) {
+    // Повтор триграммы в той же строке
+    if (p->count && p->ids[p->count - 1] == id) return 1;
+    if (p->count == p->capacity) {
+        uint32_t capacity = p->capacity ? p->capacity * 2 : 4;
+        uint32_t* ids = realloc(p->ids, capacity * sizeof(uint32_t));
+        if (!ids) return 0;
+        p->ids = ids;
+        p->capacity = capacity;
+    }
+    p->ids[p->count++] = id;
+    return 1;
+}
+
+static int index_string(trigram_index* t, uint32_t id, const char* s) {
+    char* folded = utf8_fold(s);
+    size_t n = 0;
+    uint32_t* chars = folded ? decode(folded, &n) : NULL;
+    int ok = chars != NULL;
+    for (size_t i = 0; ok && i + 3 <= n; i++) {
+        posting* p = find_posting(t, trigram_key(chars + i), 1);
+        ok = p && posting_add(p, id);
+    }
+    free(chars);
+    free(folded);
+    return ok;
+}
+
+// Добавляет в индекс строки, появившиеся в словаре после прошлого поиска.
+// Недоиндексированная строка индексируется заново: повтор id в списке не попадет.
+static int catch_up(trigram_index* t) {
+    const work_dict* dict = work_dict_shared();
+    while (t->indexed < dict->count) {
+        if (!index_string(t, t->indexed, work_dict_get(dict, t->indexed))) return 0;
+        t->indexed++;
+    }
+    return 1;
+}
+
+// ============================================================================
+// Пересечение
+// ============================================================================
+
+// Первая позиция в list[from, count) со значением >= value: шаги удваиваются,
+// пока не перескочат value, затем двоичный поиск внутри последнего шага
+static size_t gallop(const uint32_t* list, size_t from, size_t count, uint32_t value) {
+    size_t lo = from, hi = from, step = 1;
+    while (hi < count && list[hi] < value) {
+        lo = hi + 1;
+        hi += step;
+        step *= 2;
+    }
+    if (hi > count) hi = count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (list[mid] < value) lo = mid + 1; else hi = mid;
+    }
+    return lo;
+}
+
+static int compare_postings(const void* a, const void* b) {
+    uint32_t x = (*(const posting* const*)a)->count;
+    uint32_t y = (*(const posting* const*)b)->count;
+    return x < y ? -1 : x > y;
+}
+
+// Кандидаты - id строк, в которых есть все триграммы запроса (malloc).
+// 0 - нет памяти; *out_count = 0 - какой-то триграммы нет нигде.
+static int intersect(trigram_index* t, const uint32_t* chars, size_t n, uint32_t** out, size_t* out_count) {
+    size_t lists = n - 2;
+    const posting** postings = malloc(lists * sizeof(posting*));
+    if (!postings) return 0;
+    *out = NULL;
+    *out_count = 0;
+    for (size_t i = 0; i < lists; i++) {
+        postings[i] = find_posting(t, trigram_key(chars + i), 0);
+        if (!postings[i]) {
+            free(postings);
+            return 1;
+        }
+    }
+    qsort(postings, lists, sizeof(posting*), compare_postings);
+
+    // Самый короткий список сужается по остальным
+    size_t count = postings[0]->count;
+    uint32_t* candidates = malloc((count ? count : 1) * sizeof(uint32_t));
+    if (!candidates) {
+        free(postings);
+        return 0;
+    }
+    memcpy(candidates, postings[0]->ids, count * sizeof(uint32_t));
+    for (size_t l = 1; l < lists && count > 0; l++) {
+        const posting* p = postings[l];
+        size_t pos = 0, kept = 0;
+        for (size_t i = 0; i < count && pos < p->count; i++) {
+            pos = gallop(p->ids, pos, p->count, candidates[i]);
+            if (pos < p->count && p->ids[pos] == candidates[i]) candidates[kept++] = candidates[i];
+        }
+        count = kept;
+    }
+    free(postings);
+    *out = candidates;
+    *out_count = count;
+    return 1;
+}
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+int trigram_enable(void) {
+    if (shared_index) return 1;
+    shared_index = calloc(1, sizeof(trigram_index));
+    return shared_index != NULL;
+}
+
+void trigram_disable(void) {
+    trigram_index* t = shared_index;
+    if (!t) return;
+    for (size_t i = 0; i < t->slot_count; i++) free(t->slots[i].ids);
+    free(t->slots);
+    free(t);
+    shared_index = NULL;
+}
+
+int trigram_enabled(void) {
+    return shared_index != NULL;
+}
+
+int64_t trigram_search(const char* needle, uint32_t** out_ids) {
+    *out_ids = NULL;
+    const work_dict* dict = work_dict_shared();
+    char* folded = utf8_fold(needle);
+    size_t n = 0;
+    uint32_t* chars = folded ? decode(folded, &n) : NULL;
+    if (!chars) {
+        free(folded);
+        printf("Ошибка: недостаточно памяти для поиска\n");
+        return -1;
+    }
+
+    uint32_t* ids = NULL;
+    size_t count = 0;
+    int indexed = shared_index && n >= 3;
+    if (indexed && !catch_up(shared_index)) {
+        printf("Предупреждение: недостаточно памяти для индекса триграмм, поиск по всему словарю\n");
+        indexed = 0;
+    }
+    int ok = indexed ? intersect(shared_index, chars, n, &ids, &count) : 1;
+    if (ok && !indexed) {
+        count = dict->count;
+        ids = malloc((count ? count : 1) * sizeof(uint32_t));
+        ok = ids != NULL;
+        for (size_t i = 0; ok && i < count; i++) ids[i] = (uint32_t)i;
+    }
+    free(chars);
+    if (!ok) {
+        free(folded);
+        printf("Ошибка: недостаточно памяти для поиска\n");
+        return -1;
+    }
+
+    // Триграммы совпали - подстрока проверяется по самой строке
+    size_t found = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (utf8_contains_folded(work_dict_get(dict, ids[i]), folded)) ids[found++] = ids[i];
+    }
+    free(folded);
+    *out_ids = ids;
+    return (int64_t)found;
+}
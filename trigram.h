@@ -0,0 +1,35 @@
+#ifndef TRIGRAM_H
+#define TRIGRAM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// ============================================================================
+// Поиск подстроки в type_work без учета регистра.
+// Записи хранят не строки, а id общего словаря (work_dict_shared), поэтому
+// индексируются строки словаря: каждая строка приводится к нижнему регистру
+// (латиница и кириллица, по символам UTF-8) и режется на триграммы символов.
+// Для триграммы хранится возрастающий список id строк, в которых она есть.
+// Запрос пересекает списки своих триграмм (от короткого к длинному,
+// галопирующим поиском) и проверяет подстроку только у оставшихся строк.
+// Словарь только растет, поэтому индекс догоняет его при каждом поиске.
+// Без индекса (или для запроса короче трех символов) проверяются все строки.
+// ============================================================================
+
+// Включает индекс (строится при первом поиске). 0 - нет памяти.
+int trigram_enable(void);
+void trigram_disable(void);
+int trigram_enabled(void);
+
+// id строк общего словаря, содержащих needle без учета регистра, по возрастанию.
+// *out_ids - malloc (освобождает вызывающий). Возвращает их число или -1.
+// Вызывается из того же потока, что добавляет строки в словарь.
+int64_t trigram_search(const char* needle, uint32_t** out_ids);
+
+// Копия s в нижнем регистре (malloc); длина в байтах не меняется
+char* utf8_fold(const char* s);
+
+// 1, если s без учета регистра содержит folded (результат utf8_fold)
+int utf8_contains_folded(const char* s, const char* folded);
+
+#endif // TRIGRAM_H
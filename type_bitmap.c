@@ -0,0 +1,133 @@
+#include "type_bitmap.h"
+#include "work_dict.h"
+
+// ============================================================================
+// Построение
+// ============================================================================
+
+static void clear_all(type_bitmaps* t) {
+    for (uint32_t i = 0; i < t->type_count; i++) roaring_clear(&t->types[i]);
+    roaring_clear(&t->live);
+}
+
+// Множество типа (с расширением массива) или NULL без памяти
+static roaring* type_set(type_bitmaps* t, uint32_t type_id) {
+    if (type_id >= t->type_count) {
+        uint32_t count = t->type_count ? t->type_count : 16;
+        while (count <= type_id) count *= 2;
+        roaring* types = realloc(t->types, count * sizeof(roaring));
+        if (!types) return NULL;
+        for (uint32_t i = t->type_count; i < count; i++) roaring_init(&types[i]);
+        t->types = types;
+        t->type_count = count;
+    }
+    return &t->types[type_id];
+}
+
+static int add_slot(type_bitmaps* t, const technical_maintenance* r, int64_t slot) {
+    if (r->type_id == WORK_DICT_NONE) return roaring_add(&t->live, (uint32_t)slot);
+    roaring* set = type_set(t, r->type_id);
+    return set && roaring_add(set, (uint32_t)slot) && roaring_add(&t->live, (uint32_t)slot);
+}
+
+static int ensure_ready(struct data_base* system) {
+    type_bitmaps* t = system->type_bitmaps;
+    if (!t) return 0;
+    if (t->ready) return 1;
+    if ((uint64_t)system->size > UINT32_MAX) {
+        printf("Ошибка: битовый индекс видов работ не покрывает больше 2^32 записей\n");
+        return 0;
+    }
+
+    // Позиции идут по возрастанию, поэтому вставка - дописывание в конец куска
+    clear_all(t);
+    for (int64_t i = 0; i < system->size; i++) {
+        if (record_is_deleted(&system->records[i])) continue;
+        if (!add_slot(t, &system->records[i], i)) {
+            clear_all(t);
+            printf("Ошибка: недостаточно памяти для битового индекса видов работ\n");
+            return 0;
+        }
+    }
+    t->ready = 1;
+    return 1;
+}
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+int type_bitmaps_enable(struct data_base* system) {
+    if (system->type_bitmaps) return 1;
+    system->type_bitmaps = calloc(1, sizeof(type_bitmaps));
+    return system->type_bitmaps != NULL;
+}
+
+void type_bitmaps_disable(struct data_base* system) {
+    type_bitmaps* t = system->type_bitmaps;
+    if (!t) return;
+    for (uint32_t i = 0; i < t->type_count; i++) roaring_free(&t->types[i]);
+    free(t->types);
+    roaring_free(&t->live);
+    free(t);
+    system->type_bitmaps = NULL;
+}
+
+void type_bitmaps_on_add(struct data_base* system, int64_t slot) {
+    type_bitmaps* t = system->type_bitmaps;
+    if (!t || !t->ready) return;
+    const technical_maintenance* r = &system->records[slot];
+    if (record_is_deleted(r)) return;
+    // Без памяти индекс перестроится при следующем обращении
+    if ((uint64_t)slot > UINT32_MAX || !add_slot(t, r, slot)) t->ready = 0;
+}
+
+void type_bitmaps_on_remove(struct data_base* system, int64_t slot) {
+    type_bitmaps* t = system->type_bitmaps;
+    if (!t || !t->ready) return;
+    const technical_maintenance* r = &system->records[slot];
+    if (record_is_deleted(r)) return;
+    if (r->type_id < t->type_count) roaring_remove(&t->types[r->type_id], (uint32_t)slot);
+    roaring_remove(&t->live, (uint32_t)slot);
+}
+
+void type_bitmaps_invalidate(struct data_base* system) {
+    if (system->type_bitmaps) system->type_bitmaps->ready = 0;
+}
+
+int type_bitmaps_union(struct data_base* system, const uint32_t* type_ids, size_t count, roaring* out) {
+    if (!ensure_ready(system)) return 0;
+    type_bitmaps* t = system->type_bitmaps;
+    roaring result;
+    roaring_init(&result);
+    for (size_t i = 0; i < count; i++) {
+        if (type_ids[i] >= t->type_count) continue;
+        if (!roaring_or(&result, &result, &t->types[type_ids[i]])) {
+            roaring_free(&result);
+            return 0;
+        }
+    }
+    roaring_free(out);
+    *out = result;
+    return 1;
+}
+
+int type_bitmaps_not(struct data_base* system, const roaring* x, roaring* out) {
+    if (!ensure_ready(system)) return 0;
+    return roaring_andnot(out, &system->type_bitmaps->live, x);
+}
+
+int64_t type_bitmaps_count(struct data_base* system, const uint32_t* type_ids, size_t count,
+                           const uint64_t* selection) {
+    if (!ensure_ready(system)) return -1;
+    type_bitmaps* t = system->type_bitmaps;
+    size_t words = ((size_t)system->size + 63) / 64;
+    // Множества разных типов не пересекаются: итог - сумма по типам
+    int64_t total = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (type_ids[i] >= t->type_count) continue;
+        const roaring* set = &t->types[type_ids[i]];
+        total += (int64_t)(selection ? roaring_count_words(set, selection, words) : roaring_cardinality(set));
+    }
+    return total;
+}
@@ -0,0 +1,46 @@
+#ifndef TYPE_BITMAP_H
+#define TYPE_BITMAP_H
+
+#include "database.h"
+#include "roaring.h"
+
+// ============================================================================
+// Битовые индексы по виду работ: для каждого type_id - сжатое множество
+// (roaring.h) позиций живых записей с этим типом, и множество всех живых
+// записей для отрицания. Ведутся по желанию (type_bitmaps_enable):
+// add_item, modify_item и delete_item поправляют их точечно, загрузка и
+// уплотнение сбрасывают, и индекс строится заново при первом обращении.
+// Условия "тип работы из набора" становятся объединением множеств, а число
+// записей по категориям - суммой мощностей или popcount пересечения с отбором.
+// Позиции хранятся 32-битными: база больше 2^32 записей индексом не покрывается.
+// ============================================================================
+
+typedef struct type_bitmaps {
+    roaring* types;      // types[type_id]
+    uint32_t type_count;
+    roaring live;        // все живые записи
+    int ready;           // 0 - построить при следующем обращении
+} type_bitmaps;
+
+int type_bitmaps_enable(struct data_base* system);
+void type_bitmaps_disable(struct data_base* system);
+
+// Вызываются из database.c: on_add - после записи в позицию slot,
+// on_remove - до изменения или удаления, invalidate - записи заменены целиком
+void type_bitmaps_on_add(struct data_base* system, int64_t slot);
+void type_bitmaps_on_remove(struct data_base* system, int64_t slot);
+void type_bitmaps_invalidate(struct data_base* system);
+
+// Позиции живых записей с одним из type_ids (out - инициализированное множество).
+// 0 - индекс не включен или не хватило памяти.
+int type_bitmaps_union(struct data_base* system, const uint32_t* type_ids, size_t count, roaring* out);
+
+// Живые записи, не входящие в x
+int type_bitmaps_not(struct data_base* system, const roaring* x, roaring* out);
+
+// Число живых записей с одним из type_ids (без повторов); если selection != NULL (карта
+// filter_bitmap) - только среди отобранных. -1 - индекс не включен или нет памяти.
+int64_t type_bitmaps_count(struct data_base* system, const uint32_t* type_ids, size_t count,
+                           const uint64_t* selection);
+
+#endif // TYPE_BITMAP_H
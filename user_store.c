@@ -0,0 +1,341 @@
+#include "user_store.h"
+#include "crc32c.h"
+#include "file_io.h"
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define USER_STORE_MAGIC     0x53525355 // "USRS"
+#define USER_STORE_VERSION   1
+#define USER_STORE_MIN_SLOTS 64
+#define USER_SLOT_NAME       56
+#define USER_SLOT_USED       1
+
+// Заголовок файла: 64 байта, little-endian
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t slot_count; // степень двойки
+    uint64_t count;      // занятые слоты (при открытии пересчитываются)
+    uint8_t reserved[36];
+    uint32_t checksum;   // crc32c первых 60 байт
+} user_store_header;
+
+// Слот: 64 байта, little-endian; слот i лежит по смещению 64 * (i + 1)
+typedef struct {
+    char username[USER_SLOT_NAME]; // с '\0', остаток забит нулями
+    uint32_t password_hash;
+    uint32_t state;                // 0 - пусто, USER_SLOT_USED - занят
+} user_slot;
+
+typedef struct {
+    user_slot* slots;    // копия таблицы файла
+    uint64_t slot_count;
+    uint64_t count;
+    file_rw* file;
+    char filename[260];
+    int opened;
+} user_store;
+
+static user_store store;
+
+// ============================================================================
+// Порядок байтов
+// ============================================================================
+
+static int host_is_little_endian(void) {
+    const uint16_t probe = 1;
+    return *(const uint8_t*)&probe == 1;
+}
+
+static uint32_t swap32(uint32_t v) {
+    return (v >> 24) | ((v >> 8) & 0xFF00u) | ((v << 8) & 0xFF0000u) | (v << 24);
+}
+
+static uint64_t swap64(uint64_t v) {
+    return ((uint64_t)swap32((uint32_t)v) << 32) | swap32((uint32_t)(v >> 32));
+}
+
+// Преобразование симметрично: годится и для записи, и для чтения
+static void header_to_little_endian(user_store_header* h) {
+    if (host_is_little_endian()) return;
+    h->magic = swap32(h->magic);
+    h->version = swap32(h->version);
+    h->slot_count = swap64(h->slot_count);
+    h->count = swap64(h->count);
+    h->checksum = swap32(h->checksum);
+}
+
+static void slot_to_little_endian(user_slot* s) {
+    if (host_is_little_endian()) return;
+    s->password_hash = swap32(s->password_hash);
+    s->state = swap32(s->state);
+}
+
+// ============================================================================
+// Таблица в памяти
+// ============================================================================
+
+// FNV-1a
+static uint32_t name_hash(const char* s) {
+    uint32_t h = 2166136261u;
+    for (const unsigned char* p = (const unsigned char*)s; *p; ++p) {
+        h ^= *p;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+// Слот логина или пустой слот, куда его поставить
+static uint64_t probe(const user_slot* slots, uint64_t slot_count, const char* username) {
+    uint64_t mask = slot_count - 1;
+    uint64_t i = name_hash(username) & mask;
+    while (slots[i].state == USER_SLOT_USED && strcmp(slots[i].username, username) != 0) i = (i + 1) & mask;
+    return i;
+}
+
+static void fill_slot(user_slot* slot, const char* username, uint32_t password_hash) {
+    memset(slot, 0, sizeof(*slot));
+    strncpy(slot->username, username, USER_SLOT_NAME - 1);
+    slot->password_hash = password_hash;
+    slot->state = USER_SLOT_USED;
+}
+
+// Имя должно возвращаться в User.username без обрезки; слот файла не короче его
+typedef char user_name_slot_check[sizeof(((User*)0)->username) <= USER_SLOT_NAME ? 1 : -1];
+
+static int valid_name(const char* username) {
+    return username && username[0] && strlen(username) < sizeof(((User*)0)->username);
+}
+
+// Таблица на slot_count слотов с занятыми слотами из slots (NULL - без памяти)
+static user_slot* rehash(const user_slot* slots, uint64_t old_count, uint64_t slot_count) {
+    user_slot* table = calloc((size_t)slot_count, sizeof(user_slot));
+    if (!table) return NULL;
+    for (uint64_t i = 0; i < old_count; i++) {
+        if (slots[i].state != USER_SLOT_USED) continue;
+        table[probe(table, slot_count, slots[i].username)] = slots[i];
+    }
+    return table;
+}
+
+// ============================================================================
+// Файл
+// ============================================================================
+
+static void fill_header(user_store_header* h, uint64_t slot_count, uint64_t count) {
+    memset(h, 0, sizeof(*h));
+    h->magic = USER_STORE_MAGIC;
+    h->version = USER_STORE_VERSION;
+    h->slot_count = slot_count;
+    h->count = count;
+    header_to_little_endian(h);
+    h->checksum = crc32c(0, h, offsetof(user_store_header, checksum));
+    if (!host_is_little_endian()) h->checksum = swap32(h->checksum);
+}
+
+static int write_table(const char* filename, const user_slot* slots, uint64_t slot_count, uint64_t count) {
+    FILE* f = fopen(filename, "wb");
+    if (!f) return 0;
+    user_store_header header;
+    fill_header(&header, slot_count, count);
+    int ok = fwrite(&header, sizeof(header), 1, f) == 1;
+    for (uint64_t i = 0; ok && i < slot_count; i++) {
+        user_slot s = slots[i];
+        slot_to_little_endian(&s);
+        ok = fwrite(&s, sizeof(s), 1, f) == 1;
+    }
+    ok = file_sync(f) && ok;
+    return fclose(f) == 0 && ok;
+}
+
+// Новая таблица пишется рядом и подменяет прежнюю; если программа прервется
+// между удалением и переименованием, user_store_open подберет временный файл
+static int replace_table(const user_slot* slots, uint64_t slot_count, uint64_t count) {
+    char tmp[300];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", store.filename);
+    if (!write_table(tmp, slots, slot_count, count)) {
+        remove(tmp);
+        return 0;
+    }
+    if (store.file) {
+        file_close_rw(store.file);
+        store.file = NULL;
+    }
+    remove(store.filename);
+    if (rename(tmp, store.filename) != 0) return 0;
+    store.file = file_open_rw(store.filename);
+    return store.file != NULL;
+}
+
+static int load_table(const char* filename) {
+    size_t size = 0;
+    unsigned char* data = file_map_private(filename, &size);
+    if (!data) return 0;
+
+    user_store_header header;
+    int ok = size >= sizeof(header);
+    if (ok) {
+        memcpy(&header, data, sizeof(header));
+        uint32_t checksum = crc32c(0, &header, offsetof(user_store_header, checksum));
+        header_to_little_endian(&header);
+        ok = header.magic == USER_STORE_MAGIC && header.version == USER_STORE_VERSION &&
+             header.checksum == checksum && header.slot_count >= USER_STORE_MIN_SLOTS &&
+             (header.slot_count & (header.slot_count - 1)) == 0 &&
+             (uint64_t)size == sizeof(header) + header.slot_count * sizeof(user_slot);
+    }
+    user_slot* slots = ok ? malloc((size_t)header.slot_count * sizeof(user_slot)) : NULL;
+    if (slots) {
+        memcpy(slots, data + sizeof(header), (size_t)header.slot_count * sizeof(user_slot));
+        store.count = 0;
+        for (uint64_t i = 0; i < header.slot_count; i++) {
+            slot_to_little_endian(&slots[i]);
+            slots[i].username[USER_SLOT_NAME - 1] = '\0';
+            if (slots[i].state == USER_SLOT_USED) store.count++;
+        }
+        store.slots = slots;
+        store.slot_count = header.slot_count;
+    }
+    file_unmap(data, size);
+    if (!ok) printf("Ошибка: файл пользователей %s поврежден\n", filename);
+    else if (!slots) printf("Ошибка: недостаточно памяти для списка пользователей\n");
+    return slots != NULL;
+}
+
+// Таблица из старого файла: массив User подряд. При повторе логина действует
+// первая запись, как и при прежнем поиске перебором.
+static int migrate(const char* legacy_filename) {
+    store.slot_count = USER_STORE_MIN_SLOTS;
+    store.count = 0;
+    store.slots = calloc((size_t)store.slot_count, sizeof(user_slot));
+    if (!store.slots) return 0;
+
+    FILE* f = fopen(legacy_filename, "rb");
+    if (!f) return 1;
+    User user;
+    int ok = 1;
+    while (ok && fread(&user, sizeof(User), 1, f) == 1) {
+        user.username[sizeof(user.username) - 1] = '\0';
+        if (!valid_name(user.username)) continue;
+        if ((store.count + 1) * 2 > store.slot_count) {
+            user_slot* grown = rehash(store.slots, store.slot_count, store.slot_count * 2);
+            if (!grown) {
+                ok = 0;
+                break;
+            }
+            free(store.slots);
+            store.slots = grown;
+            store.slot_count *= 2;
+        }
+        user_slot* slot = &store.slots[probe(store.slots, store.slot_count, user.username)];
+        if (slot->state == USER_SLOT_USED) continue;
+        fill_slot(slot, user.username, user.password_hash);
+        store.count++;
+    }
+    fclose(f);
+    if (ok) printf("Пользователи перенесены из %s: %llu\n", legacy_filename, (unsigned long long)store.count);
+    return ok;
+}
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+int user_store_open(const char* filename, const char* legacy_filename) {
+    if (store.opened) return 1;
+    if (!filename) filename = USER_STORE_FILE;
+    if (!legacy_filename) legacy_filename = USER_STORE_LEGACY_FILE;
+    strncpy(store.filename, filename, sizeof(store.filename) - 1);
+    store.filename[sizeof(store.filename) - 1] = '\0';
+
+    char tmp[300];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", store.filename);
+    FILE* existing = fopen(store.filename, "rb");
+    if (!existing) {
+        // Подмена таблицы прервалась после удаления прежнего файла
+        FILE* pending = fopen(tmp, "rb");
+        if (pending) {
+            fclose(pending);
+            rename(tmp, store.filename);
+            existing = fopen(store.filename, "rb");
+        }
+    }
+
+    int ok;
+    if (existing) {
+        fclose(existing);
+        ok = load_table(store.filename);
+        store.file = ok ? file_open_rw(store.filename) : NULL;
+        ok = ok && store.file;
+    } else {
+        ok = migrate(legacy_filename) && replace_table(store.slots, store.slot_count, store.count);
+    }
+    if (!ok) {
+        if (!existing) printf("Ошибка создания файла пользователей %s!\n", store.filename);
+        user_store_close();
+        return 0;
+    }
+    store.opened = 1;
+    return 1;
+}
+
+void user_store_close(void) {
+    if (store.file) file_close_rw(store.file);
+    free(store.slots);
+    memset(&store, 0, sizeof(store));
+}
+
+int user_store_find(const char* username, User* out) {
+    if (!user_store_open(NULL, NULL) || !valid_name(username)) return 0;
+    const user_slot* slot = &store.slots[probe(store.slots, store.slot_count, username)];
+    if (slot->state != USER_SLOT_USED) return 0;
+    if (out) {
+        memset(out, 0, sizeof(*out));
+        // Найденное имя прошло valid_name и короче User.username; хвост слота забит нулями
+        memcpy(out->username, slot->username, sizeof(out->username) - 1);
+        out->password_hash = slot->password_hash;
+    }
+    return 1;
+}
+
+int user_store_add(const User* user) {
+    if (!user_store_open(NULL, NULL) || !store.file) return 0;
+    if (!valid_name(user->username)) return 0;
+    if (user_store_find(user->username, NULL)) return 0;
+
+    // Заполнение не больше половины: цепочки пробирования остаются короткими
+    if ((store.count + 1) * 2 > store.slot_count) {
+        uint64_t slot_count = store.slot_count * 2;
+        user_slot* grown = rehash(store.slots, store.slot_count, slot_count);
+        if (!grown || !replace_table(grown, slot_count, store.count)) {
+            free(grown);
+            printf("Ошибка записи файла пользователей %s!\n", store.filename);
+            return 0;
+        }
+        free(store.slots);
+        store.slots = grown;
+        store.slot_count = slot_count;
+    }
+
+    uint64_t i = probe(store.slots, store.slot_count, user->username);
+    user_slot slot;
+    fill_slot(&slot, user->username, user->password_hash);
+    user_slot disk = slot;
+    slot_to_little_endian(&disk);
+    user_store_header header;
+    fill_header(&header, store.slot_count, store.count + 1);
+    // Сначала слот, потом заголовок: число записей при открытии все равно пересчитывается
+    if (!file_pwrite(store.file, &disk, sizeof(disk), sizeof(header) + i * sizeof(user_slot)) ||
+        !file_pwrite(store.file, &header, sizeof(header), 0)) {
+        return 0;
+    }
+    store.slots[i] = slot;
+    store.count++;
+    return 1;
+}
+
+size_t user_store_count(void) {
+    return user_store_open(NULL, NULL) ? (size_t)store.count : 0;
+}
@@ -0,0 +1,34 @@
+#ifndef USER_STORE_H
+#define USER_STORE_H
+
+#include "database.h"
+
+// ============================================================================
+// Хранилище учетных записей с хеш-индексом на диске.
+// Файл USER_STORE_FILE - заголовок и таблица слотов фиксированного размера
+// с открытой адресацией (линейное пробирование по FNV-1a от логина), поэтому
+// слот логина вычисляется без чтения остальных и файл можно отображать в память.
+// При открытии таблица читается в память целиком; поиск - O(1) в памяти,
+// добавление пишет на диск один слот и заголовок. При заполнении больше половины
+// таблица удваивается и записывается во временный файл, который заменяет прежний.
+// Если файла еще нет, он строится из старого плоского USER_STORE_LEGACY_FILE
+// (массив User подряд); старый файл остается как есть.
+// ============================================================================
+
+#define USER_STORE_FILE "users.idx"
+#define USER_STORE_LEGACY_FILE "users.dat"
+
+// Открывает хранилище (NULL - имена по умолчанию). Вызывается и автоматически
+// при первом обращении. 0 - файл поврежден или не удалось его создать.
+int user_store_open(const char* filename, const char* legacy_filename);
+void user_store_close(void);
+
+// 1 - логин найден (out может быть NULL)
+int user_store_find(const char* username, User* out);
+
+// Добавляет пользователя. 0 - такой логин уже есть или ошибка записи.
+int user_store_add(const User* user);
+
+size_t user_store_count(void);
+
+#endif // USER_STORE_H
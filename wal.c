@@ -0,0 +1,224 @@
+#include "wal.h"
+#include "crc32c.h"
+#include "file_io.h"
+
+// ============================================================================
+// Internal utilities
+// ============================================================================
+
+static uint32_t entry_crc(const wal_entry_header* entry, const void* payload) {
+    wal_entry_header h = *entry;
+    h.crc = 0;
+    uint32_t crc = crc32c(0, &h, sizeof(h));
+    return crc32c(crc, payload, entry->payload_size);
+}
+
+static int write_file_header(FILE* f) {
+    wal_file_header header;
+    memset(&header, 0, sizeof(header));
+    header.magic = WAL_MAGIC;
+    header.version = WAL_VERSION;
+    return fwrite(&header, sizeof(header), 1, f) == 1;
+}
+
+typedef void (*wal_visit_fn)(void* ctx, const wal_entry_header* entry, const technical_maintenance* record);
+
+// Последовательный проход по целым записям журнала.
+// valid_end - смещение конца последней целой записи (за ним может быть оборванный хвост).
+static int wal_scan(const char* filename, wal_visit_fn fn, void* ctx,
+                    uint64_t* valid_end, uint64_t* last_lsn, size_t* entries) {
+    *valid_end = 0;
+    *last_lsn = 0;
+    *entries = 0;
+
+    FILE* f = fopen(filename, "rb");
+    if (!f) return 0;
+
+    wal_file_header header;
+    if (fread(&header, sizeof(header), 1, f) != 1 ||
+        header.magic != WAL_MAGIC || header.version != WAL_VERSION) {
+        fclose(f);
+        return 0;
+    }
+    *valid_end = sizeof(header);
+
+    wal_entry_header entry;
+    wide_record wide;
+    technical_maintenance record;
+    while (fread(&entry, sizeof(entry), 1, f) == 1) {
+        if (entry.payload_size != 0 && entry.payload_size != sizeof(wide)) break;
+        if (entry.payload_size && fread(&wide, sizeof(wide), 1, f) != 1) break;
+        if (entry_crc(&entry, &wide) != entry.crc) break;
+        if (entry.lsn <= *last_lsn) break;
+
+        if (fn && entry.payload_size) record_from_wide(&wide, &record);
+        if (fn) fn(ctx, &entry, entry.payload_size ? &record : NULL);
+        *last_lsn = entry.lsn;
+        *valid_end += sizeof(entry) + entry.payload_size;
+        (*entries)++;
+    }
+
+    fclose(f);
+    return 1;
+}
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+void get_user_wal_filename(const char* username, char* filename) {
+    sprintf(filename, "data_%s.wal", username);
+}
+
+int wal_open(wal* log, const char* filename, const struct data_base* db) {
+    memset(log, 0, sizeof(*log));
+    strncpy(log->filename, filename, sizeof(log->filename) - 1);
+
+    uint64_t valid_end = 0, last_lsn = 0;
+    size_t entries = 0;
+    if (wal_scan(filename, NULL, NULL, &valid_end, &last_lsn, &entries)) {
+        // Отрезаем запись, оборванную при сбое, чтобы новые изменения шли сразу за целыми
+        file_truncate(filename, valid_end);
+        log->file = fopen(filename, "ab");
+    } else {
+        log->file = fopen(filename, "wb");
+        if (log->file && (!write_file_header(log->file) || !file_sync(log->file))) {
+            fclose(log->file);
+            log->file = NULL;
+        }
+    }
+
+    if (!log->file) {
+        printf("Ошибка открытия журнала изменений: %s\n", filename);
+        return 0;
+    }
+
+    uint64_t base_lsn = db ? db->lsn : 0;
+    log->next_lsn = (last_lsn > base_lsn ? last_lsn : base_lsn) + 1;
+    log->entries = entries;
+    return 1;
+}
+
+void wal_close(wal* log) {
+    if (!log->file) return;
+    wal_commit(log);
+    fclose(log->file);
+    log->file = NULL;
+}
+
+int wal_append(wal* log, struct data_base* db, WalOp op, int64_t index, const technical_maintenance* record) {
+    if (!log->file) return 0;
+
+    wide_record wide;
+    memset(&wide, 0, sizeof(wide));
+    if (record) record_to_wide(record, &wide);
+
+    wal_entry_header entry;
+    memset(&entry, 0, sizeof(entry));
+    entry.op = (uint32_t)op;
+    entry.payload_size = record ? sizeof(wide_record) : 0;
+    entry.lsn = log->next_lsn++;
+    entry.index = index;
+    entry.crc = entry_crc(&entry, &wide);
+
+    if (fwrite(&entry, sizeof(entry), 1, log->file) != 1 ||
+        (record && fwrite(&wide, sizeof(wide), 1, log->file) != 1)) {
+        printf("Ошибка записи в журнал изменений\n");
+        return 0;
+    }
+
+    db->lsn = entry.lsn;
+    log->entries++;
+    if (++log->pending >= WAL_GROUP_COMMIT) return wal_commit(log);
+    return 1;
+}
+
+int wal_commit(wal* log) {
+    if (!log->file) return 0;
+    if (log->pending == 0) return 1;
+    if (!file_sync(log->file)) {
+        printf("Ошибка сброса журнала изменений на диск\n");
+        return 0;
+    }
+    log->pending = 0;
+    return 1;
+}
+
+typedef struct {
+    struct data_base* db;
+    int applied;
+} ReplayCtx;
+
+static void replay_entry(void* ctx, const wal_entry_header* entry, const technical_maintenance* record) {
+    ReplayCtx* rc = (ReplayCtx*)ctx;
+    struct data_base* db = rc->db;
+    if (entry->lsn <= db->lsn) return;
+
+    switch (entry->op) {
+        case WAL_OP_ADD:
+            if (record) add_item(db, *record);
+            break;
+        case WAL_OP_MODIFY:
+            if (record) modify_item(db, entry->index, *record);
+            break;
+        case WAL_OP_DELETE:
+            delete_item(db, entry->index);
+            break;
+        case WAL_OP_CLEAR:
+            clear_database(db);
+            break;
+        case WAL_OP_COMPACT:
+            db_compact(db);
+            break;
+        default:
+            return;
+    }
+    db->lsn = entry->lsn;
+    rc->applied++;
+}
+
+int wal_replay(struct data_base* db, const char* filename) {
+    ReplayCtx ctx;
+    ctx.db = db;
+    ctx.applied = 0;
+
+    // Повторно журналировать проигрываемые изменения нельзя
+    wal* attached = db->wal;
+    db->wal = NULL;
+
+    uint64_t valid_end = 0, last_lsn = 0;
+    size_t entries = 0;
+    wal_scan(filename, replay_entry, &ctx, &valid_end, &last_lsn, &entries);
+
+    db->wal = attached;
+    if (ctx.applied > 0) {
+        printf("Из журнала изменений восстановлено операций: %d\n", ctx.applied);
+    }
+    return ctx.applied;
+}
+
+int wal_needs_checkpoint(const wal* log) {
+    return log->entries >= WAL_CHECKPOINT_ENTRIES;
+}
+
+int wal_reset(wal* log) {
+    if (log->file) fclose(log->file);
+    log->file = fopen(log->filename, "wb");
+    if (!log->file || !write_file_header(log->file) || !file_sync(log->file)) {
+        printf("Ошибка очистки журнала изменений: %s\n", log->filename);
+        return 0;
+    }
+    log->pending = 0;
+    log->entries = 0;
+    return 1;
+}
+
+int wal_checkpoint(wal* log, struct data_base* db, const data_source* base) {
+    wal_commit(log);
+    // Хранилище получает LSN последнего изменения, поэтому сбой между
+    // сохранением и очисткой журнала не приведет к повторному применению.
+    // Сохранять нужно туда же, откуда загружается сессия: иначе следующий
+    // вход возьмет устаревшую базу, а журнал уже будет очищен.
+    if (!data_source_save(base, db)) return 0;
+    return wal_reset(log);
+}
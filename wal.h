@@ -0,0 +1,87 @@
+#ifndef WAL_H
+#define WAL_H
+
+#include "database.h"
+#include "data_source.h"
+
+// ============================================================================
+// Журнал упреждающей записи (WAL) для изменений базы пользователя.
+// add_item / modify_item / delete_item / clear_database дописывают в журнал
+// компактные записи; fsync выполняется группами (group commit). Контрольная
+// точка сохраняет базовое хранилище (data_source.h) и обрезает журнал, а при
+// запуске журнал проигрывается поверх последней контрольной точки.
+//
+// Формат: [wal_file_header][wal_entry_header + запись wide_record]...
+// В журнале запись хранится со строкой type_work: id общего словаря
+// не переживают перезапуск процесса.
+// Каждая запись имеет свой LSN и CRC32C; проигрывание останавливается на первой
+// недописанной записи (обрыв при сбое), такой хвост отрезается при открытии.
+// ============================================================================
+
+#define WAL_MAGIC   0x4C415741  // "AWAL"
+#define WAL_VERSION 1
+
+#define WAL_GROUP_COMMIT      16    // изменений в группе до принудительного fsync
+#define WAL_CHECKPOINT_ENTRIES 1024 // размер журнала, после которого нужна контрольная точка
+
+typedef enum {
+    WAL_OP_ADD = 1,    // payload: запись
+    WAL_OP_MODIFY = 2, // index + payload: запись
+    WAL_OP_DELETE = 3, // index
+    WAL_OP_CLEAR = 4,
+    WAL_OP_COMPACT = 5 // уплотнение (db_compact): дальше позиции записей уже сдвинуты
+} WalOp;
+
+typedef struct wal_file_header {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t reserved;
+} wal_file_header;
+
+typedef struct wal_entry_header {
+    uint32_t op;           // WalOp
+    uint32_t payload_size; // 0 или sizeof(wide_record)
+    uint64_t lsn;          // Порядковый номер изменения
+    int64_t index;         // Позиция записи в data_base
+    uint32_t crc;          // CRC32C заголовка (с crc = 0) и payload
+    uint32_t reserved;
+} wal_entry_header;
+
+typedef struct wal {
+    FILE* file;
+    char filename[260];
+    uint64_t next_lsn;
+    int pending;    // изменений после последнего fsync
+    size_t entries; // изменений с последней контрольной точки
+} wal;
+
+// Имя журнала пользователя: data_<user>.wal
+void get_user_wal_filename(const char* username, char* filename);
+
+// Открывает (создает) журнал для дозаписи. Недописанный хвост отрезается.
+// LSN продолжается после max(последний LSN журнала, db->lsn).
+int wal_open(wal* log, const char* filename, const struct data_base* db);
+
+// fsync оставшейся группы и закрытие
+void wal_close(wal* log);
+
+// Добавление изменения (вызывается из add_item / modify_item / delete_item / clear_database)
+int wal_append(wal* log, struct data_base* db, WalOp op, int64_t index, const technical_maintenance* record);
+
+// Сброс группы на диск: после возврата все изменения переживут сбой
+int wal_commit(wal* log);
+
+// Проигрывает журнал поверх db (изменения с LSN <= db->lsn пропускаются).
+// db->wal на время проигрывания должен быть NULL. Возвращает число примененных изменений.
+int wal_replay(struct data_base* db, const char* filename);
+
+// 1, если журнал пора свернуть в базовый файл
+int wal_needs_checkpoint(const wal* log);
+
+// Контрольная точка: сохраняет db в хранилище, из которого загружена сессия, и очищает журнал
+int wal_checkpoint(wal* log, struct data_base* db, const data_source* base);
+
+// Очистка журнала после того, как база сохранена другим способом (например, в ASF)
+int wal_reset(wal* log);
+
+#endif // WAL_H
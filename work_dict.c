@@ -0,0 +1,172 @@
+#include "work_dict.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// ============================================================================
+// Internal utilities
+// ============================================================================
+
+// FNV-1a
+static uint32_t dict_hash(const char* s) {
+    uint32_t h = 2166136261u;
+    for (const unsigned char* p = (const unsigned char*)s; *p; ++p) {
+        h ^= *p;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static uint32_t dict_probe(const work_dict* dict, const char* s, uint32_t h) {
+    uint32_t mask = dict->slot_count - 1;
+    uint32_t i = h & mask;
+    while (dict->slots[i] != 0) {
+        if (strcmp(dict->strings[dict->slots[i] - 1], s) == 0) break;
+        i = (i + 1) & mask;
+    }
+    return i;
+}
+
+static int dict_grow_slots(work_dict* dict) {
+    uint32_t new_count = dict->slot_count ? dict->slot_count * 2 : 64;
+    uint32_t* slots = (uint32_t*)calloc(new_count, sizeof(uint32_t));
+    if (!slots) return 0;
+
+    free(dict->slots);
+    dict->slots = slots;
+    dict->slot_count = new_count;
+
+    for (uint32_t id = 0; id < dict->count; id++) {
+        uint32_t i = dict_probe(dict, dict->strings[id], dict_hash(dict->strings[id]));
+        dict->slots[i] = id + 1;
+    }
+    return 1;
+}
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+void work_dict_init(work_dict* dict) {
+    memset(dict, 0, sizeof(*dict));
+}
+
+void work_dict_free(work_dict* dict) {
+    if (!dict) return;
+    for (uint32_t i = 0; i < dict->count; i++) free(dict->strings[i]);
+    free(dict->strings);
+    free(dict->slots);
+    memset(dict, 0, sizeof(*dict));
+}
+
+uint32_t work_dict_intern(work_dict* dict, const char* s) {
+    if (!dict || !s) return WORK_DICT_NONE;
+
+    // Заполненность не более 1/2
+    if ((dict->count + 1) * 2 > dict->slot_count && !dict_grow_slots(dict)) return WORK_DICT_NONE;
+
+    uint32_t i = dict_probe(dict, s, dict_hash(s));
+    if (dict->slots[i] != 0) return dict->slots[i] - 1;
+
+    if (dict->count >= dict->capacity) {
+        uint32_t new_cap = dict->capacity ? dict->capacity * 2 : 16;
+        char** strings = (char**)realloc(dict->strings, new_cap * sizeof(char*));
+        if (!strings) return WORK_DICT_NONE;
+        dict->strings = strings;
+        dict->capacity = new_cap;
+    }
+
+    size_t len = strlen(s);
+    char* copy = (char*)malloc(len + 1);
+    if (!copy) return WORK_DICT_NONE;
+    memcpy(copy, s, len + 1);
+
+    uint32_t id = dict->count++;
+    dict->strings[id] = copy;
+    dict->slots[i] = id + 1;
+    return id;
+}
+
+uint32_t work_dict_find(const work_dict* dict, const char* s) {
+    if (!dict || !s || dict->slot_count == 0) return WORK_DICT_NONE;
+    uint32_t i = dict_probe(dict, s, dict_hash(s));
+    return dict->slots[i] ? dict->slots[i] - 1 : WORK_DICT_NONE;
+}
+
+const char* work_dict_get(const work_dict* dict, uint32_t id) {
+    if (!dict || id >= dict->count) return NULL;
+    return dict->strings[id];
+}
+
+work_dict* work_dict_shared(void) {
+    static work_dict shared; // нулевая инициализация == work_dict_init
+    // id 0 - пустая строка, чтобы обнуленная запись не получала чужой тип работы
+    if (shared.count == 0) work_dict_intern(&shared, "");
+    return &shared;
+}
+
+unsigned char* work_dict_serialize(const work_dict* dict, size_t* out_size) {
+    size_t size = sizeof(uint32_t);
+    for (uint32_t i = 0; i < dict->count; i++) {
+        size += sizeof(uint32_t) + strlen(dict->strings[i]);
+    }
+
+    unsigned char* block = (unsigned char*)malloc(size);
+    if (!block) return NULL;
+
+    unsigned char* p = block;
+    memcpy(p, &dict->count, sizeof(uint32_t));
+    p += sizeof(uint32_t);
+    for (uint32_t i = 0; i < dict->count; i++) {
+        uint32_t len = (uint32_t)strlen(dict->strings[i]);
+        memcpy(p, &len, sizeof(len));
+        p += sizeof(len);
+        memcpy(p, dict->strings[i], len);
+        p += len;
+    }
+
+    *out_size = size;
+    return block;
+}
+
+int work_dict_import(work_dict* dict, const unsigned char* block, size_t size,
+                     uint32_t** out_remap, uint32_t* out_count) {
+    *out_remap = NULL;
+    *out_count = 0;
+    if (size < sizeof(uint32_t)) return 0;
+    uint32_t count;
+    memcpy(&count, block, sizeof(count));
+    if (count > size / sizeof(uint32_t)) return 0;
+
+    uint32_t* remap = (uint32_t*)malloc((count ? count : 1) * sizeof(uint32_t));
+    char* text = (char*)malloc(size + 1);
+    if (!remap || !text) {
+        free(remap);
+        free(text);
+        return 0;
+    }
+
+    size_t pos = sizeof(uint32_t);
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t len;
+        if (size - pos < sizeof(len)) break;
+        memcpy(&len, block + pos, sizeof(len));
+        pos += sizeof(len);
+        if (size - pos < len) break;
+        memcpy(text, block + pos, len);
+        text[len] = '\0';
+        pos += len;
+        remap[i] = work_dict_intern(dict, text);
+        if (remap[i] == WORK_DICT_NONE) break;
+        *out_count = i + 1;
+    }
+    free(text);
+
+    if (*out_count != count) {
+        free(remap);
+        *out_count = 0;
+        return 0;
+    }
+    *out_remap = remap;
+    return 1;
+}
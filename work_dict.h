@@ -0,0 +1,48 @@
+#ifndef WORK_DICT_H
+#define WORK_DICT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// ============================================================================
+// Словарь строк type_work: строка <-> 32-битный идентификатор.
+// Идентификаторы выдаются подряд с нуля в порядке первого появления.
+// ============================================================================
+
+#define WORK_DICT_NONE UINT32_MAX
+
+typedef struct work_dict {
+    char** strings;      // strings[id]
+    uint32_t count;
+    uint32_t capacity;
+    uint32_t* slots;     // открытая адресация: id + 1, 0 = пусто
+    uint32_t slot_count; // степень двойки
+} work_dict;
+
+void work_dict_init(work_dict* dict);
+void work_dict_free(work_dict* dict);
+
+// Возвращает id строки, добавляя ее при необходимости (WORK_DICT_NONE при нехватке памяти)
+uint32_t work_dict_intern(work_dict* dict, const char* s);
+
+// Поиск без добавления: WORK_DICT_NONE, если строки нет
+uint32_t work_dict_find(const work_dict* dict, const char* s);
+
+// Строка по id или NULL
+const char* work_dict_get(const work_dict* dict, uint32_t id);
+
+// Общий словарь процесса: в нем живут type_id всех записей technical_maintenance.
+// id 0 всегда соответствует пустой строке.
+// Добавлять строки можно только из одного потока; чтение из нескольких потоков
+// безопасно, пока никто не добавляет.
+work_dict* work_dict_shared(void);
+
+// Сериализация: uint32 count, затем (uint32 len, байты без '\0') x count
+unsigned char* work_dict_serialize(const work_dict* dict, size_t* out_size);
+
+// Разбор сериализованного словаря с добавлением строк в dict.
+// *out_remap[i] - id в dict для i-й строки блока (malloc, освобождает вызывающий).
+int work_dict_import(work_dict* dict, const unsigned char* block, size_t size,
+                     uint32_t** out_remap, uint32_t* out_count);
+
+#endif // WORK_DICT_H